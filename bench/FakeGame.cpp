@@ -0,0 +1,164 @@
+// Stand-in for a game process used by scan_benchmark. It maps a configurable
+// amount of anonymous memory filled with noise floats, plants a known Vector3 in
+// it, allocates heap entities reachable through a pointer chain from a global,
+// and moves the entities on a background thread.
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr float plantedValue[3] = {123.5f, 64.25f, -17.75f};
+
+struct Entity {
+    uint32_t id;
+    uint32_t flags;
+    float health;
+    float position[3];
+    float velocity[3];
+};
+
+struct World {
+    uint64_t tick;
+    Entity **entities;
+    size_t entityCount;
+};
+
+struct Options {
+    size_t memoryMiB{256};
+    size_t regionMiB{64};
+    size_t plantEvery{1u << 20};
+    size_t entities{1024};
+    double moveRate{60.0};
+};
+
+// Module-static roots of the pointer chain g_world -> World -> entities[] -> Entity.
+World *volatile g_world = nullptr;
+std::atomic<bool> g_stop{false};
+
+uint64_t nextRandom(uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+void handleTerminate(int) {
+    g_stop.store(true);
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        const size_t value = static_cast<size_t>(std::strtoull(argv[i + 1], nullptr, 0));
+        if (arg == "--memory-mib") {
+            options.memoryMiB = value;
+        } else if (arg == "--region-mib") {
+            options.regionMiB = value == 0 ? 1 : value;
+        } else if (arg == "--plant-every") {
+            // Each interval holds one whole planted value.
+            if (value <= sizeof(plantedValue)) {
+                std::fprintf(stderr, "--plant-every must be more than %zu bytes\n", sizeof(plantedValue));
+                return false;
+            }
+            options.plantEvery = value;
+        } else if (arg == "--entities") {
+            options.entities = value;
+        } else if (arg == "--move-rate") {
+            options.moveRate = std::strtod(argv[i + 1], nullptr);
+        } else {
+            std::fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "Usage: %s [--memory-mib n] [--region-mib n] [--plant-every bytes] [--entities n] [--move-rate hz]\n",
+                     argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::signal(SIGTERM, handleTerminate);
+    std::signal(SIGINT, handleTerminate);
+    // The benchmark measures from forked children, which Yama would otherwise
+    // not let read a sibling's memory.
+    ::prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY, 0, 0, 0);
+
+    uint64_t random = 0x9e3779b97f4a7c15ull;
+    size_t planted = 0;
+    size_t mappedBytes = 0;
+    for (size_t remaining = options.memoryMiB; remaining > 0;) {
+        const size_t regionMiB = std::min(remaining, options.regionMiB);
+        const size_t size = regionMiB << 20;
+        void *mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            std::perror("mmap");
+            return EXIT_FAILURE;
+        }
+        auto *floats = static_cast<float *>(mapping);
+        const size_t floatCount = size / sizeof(float);
+        for (size_t i = 0; i < floatCount; ++i) {
+            floats[i] = static_cast<float>(static_cast<int64_t>(nextRandom(random) % 2000000) - 1000000) / 1000.0f;
+        }
+        for (size_t offset = 0; offset + options.plantEvery <= size; offset += options.plantEvery) {
+            const size_t slot = (offset + nextRandom(random) % (options.plantEvery - sizeof(plantedValue))) / sizeof(float);
+            std::memcpy(floats + slot, plantedValue, sizeof(plantedValue));
+            ++planted;
+        }
+        mappedBytes += size;
+        remaining -= regionMiB;
+    }
+
+    auto *world = new World{};
+    world->entityCount = options.entities;
+    world->entities = new Entity *[options.entities];
+    for (size_t i = 0; i < options.entities; ++i) {
+        auto *entity = new Entity{};
+        entity->id = static_cast<uint32_t>(i);
+        entity->health = 100.0f;
+        std::memcpy(entity->position, plantedValue, sizeof(plantedValue));
+        entity->position[0] += static_cast<float>(i);
+        entity->velocity[0] = static_cast<float>(nextRandom(random) % 200) / 100.0f - 1.0f;
+        entity->velocity[2] = static_cast<float>(nextRandom(random) % 200) / 100.0f - 1.0f;
+        world->entities[i] = entity;
+    }
+    g_world = world;
+
+    std::printf("ready pid=%d planted=%zu entities=%zu mapped=%zu world=%p\n", static_cast<int>(::getpid()), planted,
+                options.entities, mappedBytes, static_cast<void *>(world));
+    std::fflush(stdout);
+
+    // Entity 0 sits on the planted value and never moves, so it is the one heap
+    // match and chains to it stay valid; the rest start elsewhere and wander.
+    const auto period = std::chrono::duration<double>(options.moveRate > 0.0 ? 1.0 / options.moveRate : 1.0);
+    while (!g_stop.load()) {
+        std::this_thread::sleep_for(period);
+        if (options.moveRate <= 0.0) {
+            continue;
+        }
+        ++world->tick;
+        for (size_t i = 1; i < world->entityCount; ++i) {
+            Entity *entity = world->entities[i];
+            for (int axis = 0; axis < 3; ++axis) {
+                entity->position[axis] += entity->velocity[axis] * 0.1f;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,338 @@
+// Measures scan and verify throughput against fake_game across memory sizes and
+// thread counts and writes the results as JSON. Every configuration runs in its
+// own forked child so its peak RSS can be read back with wait4.
+#include "OffsetScanner.h"
+#include "ProcessMemoryReader.h"
+#include "ProcessUtils.h"
+#include "Vector3.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifndef FAKE_GAME_PATH
+#define FAKE_GAME_PATH "fake_game"
+#endif
+
+namespace {
+
+const Vector3 plantedValue{123.5f, 64.25f, -17.75f};
+constexpr float tolerance = 0.01f;
+
+struct Options {
+    std::string fakeGame{FAKE_GAME_PATH};
+    std::vector<size_t> sizesMiB{64, 256, 1024};
+    std::vector<size_t> threadCounts;
+    size_t regionMiB{64};
+    size_t repeat{3};
+    std::string outputPath;
+};
+
+struct FakeGame {
+    pid_t pid{-1};
+    size_t planted{};
+    size_t entities{};
+    size_t mappedBytes{};
+};
+
+// Written by the measuring child through a pipe.
+struct Measurement {
+    size_t scannedBytes{};
+    size_t candidates{};
+    double scanSeconds{};
+    double verifySeconds{};
+    uint64_t verifySyscalls{};
+    size_t verified{};
+    // streamCandidates: a full pass, one stopped by onHits after its first batch
+    // and one cancelled from onProgress after the first finished task.
+    double streamSeconds{};
+    size_t streamHits{};
+    size_t streamProgressReports{};
+    // The full pass returned true and its last progress report covered every byte.
+    bool streamComplete{};
+    bool streamStoppedEarly{};
+    bool streamCancelled{};
+};
+
+struct Result {
+    size_t memoryMiB{};
+    size_t threads{};
+    size_t planted{};
+    Measurement measurement;
+    long peakRssKiB{};
+};
+
+std::vector<size_t> parseList(const std::string &text) {
+    std::vector<size_t> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(static_cast<size_t>(std::strtoull(item.c_str(), nullptr, 0)));
+        }
+    }
+    return values;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--fake-game") {
+            options.fakeGame = value;
+        } else if (arg == "--sizes") {
+            options.sizesMiB = parseList(value);
+        } else if (arg == "--threads") {
+            options.threadCounts = parseList(value);
+        } else if (arg == "--region-mib") {
+            options.regionMiB = static_cast<size_t>(std::strtoull(value.c_str(), nullptr, 0));
+        } else if (arg == "--repeat") {
+            options.repeat = std::max<size_t>(std::strtoull(value.c_str(), nullptr, 0), 1);
+        } else if (arg == "--output") {
+            options.outputPath = value;
+        } else {
+            return false;
+        }
+    }
+    if (options.threadCounts.empty()) {
+        options.threadCounts = {1};
+        if (ThreadPool::defaultThreadCount() > 1) {
+            options.threadCounts.push_back(ThreadPool::defaultThreadCount());
+        }
+    }
+    return !options.sizesMiB.empty();
+}
+
+bool startFakeGame(const Options &options, size_t memoryMiB, FakeGame &game) {
+    int pipeFds[2];
+    if (::pipe(pipeFds) != 0) {
+        return false;
+    }
+    const std::string memory = std::to_string(memoryMiB);
+    const std::string region = std::to_string(options.regionMiB);
+    const pid_t child = ::fork();
+    if (child == 0) {
+        ::dup2(pipeFds[1], STDOUT_FILENO);
+        ::close(pipeFds[0]);
+        ::close(pipeFds[1]);
+        ::execl(options.fakeGame.c_str(), options.fakeGame.c_str(), "--memory-mib", memory.c_str(), "--region-mib",
+                region.c_str(), static_cast<char *>(nullptr));
+        std::_Exit(127);
+    }
+    ::close(pipeFds[1]);
+    if (child < 0) {
+        ::close(pipeFds[0]);
+        return false;
+    }
+    game.pid = child;
+
+    std::string line;
+    char c = 0;
+    while (::read(pipeFds[0], &c, 1) == 1 && c != '\n') {
+        line += c;
+    }
+    ::close(pipeFds[0]);
+    int pid = 0;
+    return std::sscanf(line.c_str(), "ready pid=%d planted=%zu entities=%zu mapped=%zu", &pid, &game.planted, &game.entities,
+                       &game.mappedBytes) == 4;
+}
+
+void stopFakeGame(FakeGame &game) {
+    if (game.pid > 0) {
+        ::kill(game.pid, SIGTERM);
+        ::waitpid(game.pid, nullptr, 0);
+        game.pid = -1;
+    }
+}
+
+void measureStreaming(const OffsetScanner &scanner, Measurement &measurement) {
+    using Clock = std::chrono::steady_clock;
+    // Not thread-safe, which the sink's memory need not be.
+    std::pmr::unsynchronized_pool_resource memory;
+    ScanSink sink;
+    sink.memory = &memory;
+    ScanProgress lastProgress;
+    sink.onHits = [&](const CandidateOffset *, size_t count) {
+        measurement.streamHits += count;
+        return true;
+    };
+    sink.onProgress = [&](const ScanProgress &progress) {
+        ++measurement.streamProgressReports;
+        lastProgress = progress;
+    };
+    const auto streamStart = Clock::now();
+    const bool complete = scanner.streamCandidates(plantedValue, tolerance, sink);
+    measurement.streamSeconds = std::chrono::duration<double>(Clock::now() - streamStart).count();
+    measurement.streamComplete = complete && lastProgress.bytesScanned == lastProgress.totalBytes;
+
+    size_t batches = 0;
+    sink.onHits = [&](const CandidateOffset *, size_t) {
+        ++batches;
+        return false;
+    };
+    sink.onProgress = nullptr;
+    measurement.streamStoppedEarly = !scanner.streamCandidates(plantedValue, tolerance, sink) && batches == 1;
+
+    std::atomic<bool> cancel{false};
+    sink.cancel = &cancel;
+    sink.onHits = [](const CandidateOffset *, size_t) { return true; };
+    sink.onProgress = [&](const ScanProgress &) { cancel.store(true); };
+    measurement.streamCancelled = !scanner.streamCandidates(plantedValue, tolerance, sink);
+}
+
+Measurement measure(pid_t pid, size_t threads, size_t repeat) {
+    using Clock = std::chrono::steady_clock;
+    RegionFilter filter;
+    filter.requiredPermissions = "rw";
+    std::vector<MemoryRegion> regions = ProcessUtils::filterRegions(ProcessUtils::listMemoryRegions(pid), filter);
+    Measurement measurement;
+    for (const auto &region : regions) {
+        measurement.scannedBytes += region.size();
+    }
+
+    OffsetScanner scanner(pid, std::move(regions), ProcessMemoryReader(pid));
+    scanner.setThreadCount(threads);
+    CandidateSet candidates;
+    measurement.scanSeconds = 1e300;
+    measurement.verifySeconds = 1e300;
+    for (size_t run = 0; run < repeat; ++run) {
+        const auto scanStart = Clock::now();
+        candidates = scanner.findCandidateSet(plantedValue, tolerance);
+        const auto scanEnd = Clock::now();
+        measurement.scanSeconds = std::min(measurement.scanSeconds, std::chrono::duration<double>(scanEnd - scanStart).count());
+
+        const ReadStatistics readsBefore = scanner.reader().statistics();
+        const auto verifyStart = Clock::now();
+        const CandidateSet verified = scanner.verifyCandidateSet(candidates, plantedValue, tolerance);
+        const auto verifyEnd = Clock::now();
+        measurement.verifySeconds =
+            std::min(measurement.verifySeconds, std::chrono::duration<double>(verifyEnd - verifyStart).count());
+        measurement.verifySyscalls = (scanner.reader().statistics() - readsBefore).syscalls();
+        measurement.verified = verified.size();
+    }
+    measurement.candidates = candidates.size();
+    measureStreaming(scanner, measurement);
+    return measurement;
+}
+
+// Runs measure() in a child process and collects its result and peak RSS.
+bool measureInChild(pid_t target, size_t threads, size_t repeat, Measurement &measurement, long &peakRssKiB) {
+    int pipeFds[2];
+    if (::pipe(pipeFds) != 0) {
+        return false;
+    }
+    const pid_t child = ::fork();
+    if (child == 0) {
+        ::close(pipeFds[0]);
+        const Measurement result = measure(target, threads, repeat);
+        const bool written = ::write(pipeFds[1], &result, sizeof(result)) == static_cast<ssize_t>(sizeof(result));
+        std::_Exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    ::close(pipeFds[1]);
+    if (child < 0) {
+        ::close(pipeFds[0]);
+        return false;
+    }
+    const bool received = ::read(pipeFds[0], &measurement, sizeof(measurement)) == static_cast<ssize_t>(sizeof(measurement));
+    ::close(pipeFds[0]);
+    int status = 0;
+    struct rusage usage{};
+    ::wait4(child, &status, 0, &usage);
+    peakRssKiB = usage.ru_maxrss;
+    return received && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+void writeJson(std::ostream &out, const std::vector<Result> &results) {
+    out << "{\n  \"benchmark\": \"scan\",\n  \"value\": [" << plantedValue.x << ", " << plantedValue.y << ", "
+        << plantedValue.z << "],\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        const Measurement &m = result.measurement;
+        const double gigabytes = static_cast<double>(m.scannedBytes) / 1e9;
+        out << (i == 0 ? "\n" : ",\n") << "    {\"memory_mib\": " << result.memoryMiB << ", \"threads\": " << result.threads
+            << ", \"scanned_bytes\": " << m.scannedBytes << ", \"planted\": " << result.planted
+            << ", \"candidates\": " << m.candidates << ", \"scan_seconds\": " << m.scanSeconds
+            << ", \"scan_gb_per_second\": " << (m.scanSeconds > 0.0 ? gigabytes / m.scanSeconds : 0.0)
+            << ", \"verify_seconds\": " << m.verifySeconds << ", \"verified\": " << m.verified
+            << ", \"verify_candidates_per_second\": "
+            << (m.verifySeconds > 0.0 ? static_cast<double>(m.candidates) / m.verifySeconds : 0.0)
+            << ", \"verify_syscalls\": " << m.verifySyscalls << ", \"syscalls_per_candidate\": "
+            << (m.candidates > 0 ? static_cast<double>(m.verifySyscalls) / static_cast<double>(m.candidates) : 0.0)
+            << ", \"stream_seconds\": " << m.streamSeconds << ", \"stream_hits\": " << m.streamHits
+            << ", \"stream_progress_reports\": " << m.streamProgressReports
+            << ", \"stream_complete\": " << (m.streamComplete ? "true" : "false")
+            << ", \"stream_stopped_early\": " << (m.streamStoppedEarly ? "true" : "false")
+            << ", \"stream_cancelled\": " << (m.streamCancelled ? "true" : "false")
+            << ", \"peak_rss_kib\": " << result.peakRssKiB << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--fake-game path] [--sizes mib,mib,...] [--threads n,n,...] [--region-mib n] [--repeat n] [--output file]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Result> results;
+    for (const size_t memoryMiB : options.sizesMiB) {
+        FakeGame game;
+        if (!startFakeGame(options, memoryMiB, game)) {
+            std::cerr << "Failed to start " << options.fakeGame << "\n";
+            stopFakeGame(game);
+            return EXIT_FAILURE;
+        }
+        for (const size_t threads : options.threadCounts) {
+            Result result;
+            result.memoryMiB = memoryMiB;
+            result.threads = threads;
+            result.planted = game.planted;
+            if (!measureInChild(game.pid, threads, options.repeat, result.measurement, result.peakRssKiB)) {
+                std::cerr << "Measurement failed for " << memoryMiB << " MiB with " << threads << " threads\n";
+                stopFakeGame(game);
+                return EXIT_FAILURE;
+            }
+            const Measurement &m = result.measurement;
+            std::cerr << memoryMiB << " MiB, " << threads << " threads: scan " << static_cast<double>(m.scannedBytes) / 1e9 / m.scanSeconds
+                      << " GB/s, " << m.candidates << " candidates (" << game.planted << " planted), verify "
+                      << m.verifySeconds * 1e3 << " ms, stream " << m.streamSeconds * 1e3 << " ms (" << m.streamHits
+                      << " hits, " << (m.streamComplete ? "complete" : "INCOMPLETE") << ", stop " << (m.streamStoppedEarly ? "ok" : "FAILED") << ", cancel "
+                      << (m.streamCancelled ? "ok" : "FAILED") << "), peak RSS " << result.peakRssKiB / 1024 << " MiB\n";
+            results.push_back(result);
+        }
+        stopFakeGame(game);
+    }
+
+    if (options.outputPath.empty()) {
+        writeJson(std::cout, results);
+        return EXIT_SUCCESS;
+    }
+    std::ofstream out(options.outputPath);
+    writeJson(out, results);
+    if (!out) {
+        std::cerr << "Failed to write " << options.outputPath << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
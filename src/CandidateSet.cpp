@@ -0,0 +1,407 @@
+#include "CandidateSet.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+size_t bitmapWords(size_t slotCount) {
+    return (slotCount + 63) / 64;
+}
+
+void appendVarint(std::vector<uint8_t> &out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+constexpr char setMagic[8] = {'O', 'S', 'C', 'A', 'N', 'D', '0', '1'};
+
+template <typename T>
+void writeValue(std::ofstream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool readValue(std::ifstream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+// Checks a loaded block against what Cursor, forEach and contains rely on: a
+// bitmap of exactly the block's words with count bits set inside it, or count
+// strictly increasing slots whose varints end exactly at the data's end.
+bool validBlock(const CandidateSet::Block &block) {
+    using Encoding = CandidateSet::Encoding;
+    if (block.count > block.slotCount ||
+        block.slotCount > (UINTPTR_MAX - block.base) / CandidateSet::slotSize) {
+        return false;
+    }
+    switch (block.encoding) {
+    case Encoding::Full:
+        return block.count == block.slotCount && block.bits.empty() && block.deltas.empty();
+    case Encoding::Bitmap: {
+        if (block.bits.size() != bitmapWords(block.slotCount) || !block.deltas.empty()) {
+            return false;
+        }
+        const size_t tailBits = block.slotCount % 64;
+        if (tailBits != 0 && (block.bits.back() >> tailBits) != 0) {
+            return false;
+        }
+        size_t set = 0;
+        for (const uint64_t word : block.bits) {
+            set += static_cast<size_t>(__builtin_popcountll(word));
+        }
+        return set == block.count;
+    }
+    case Encoding::Delta: {
+        if (!block.bits.empty()) {
+            return false;
+        }
+        size_t position = 0;
+        size_t slot = 0;
+        for (size_t i = 0; i < block.count; ++i) {
+            size_t value = 0;
+            unsigned shift = 0;
+            for (;;) {
+                if (position == block.deltas.size() || shift >= 64) {
+                    return false;
+                }
+                const uint8_t byte = block.deltas[position++];
+                value |= static_cast<size_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+                shift += 7;
+            }
+            if ((i != 0 && value == 0) || value >= block.slotCount - slot) {
+                return false;
+            }
+            slot += value;
+        }
+        return position == block.deltas.size();
+    }
+    }
+    return false;
+}
+
+} // namespace
+
+bool CandidateSet::Block::contains(uintptr_t address) const {
+    if (address < base || address >= end() || (address - base) % slotSize != 0) {
+        return false;
+    }
+    const size_t target = (address - base) / slotSize;
+    switch (encoding) {
+    case Encoding::Full:
+        return true;
+    case Encoding::Bitmap:
+        return (bits[target / 64] >> (target % 64)) & 1u;
+    case Encoding::Delta: {
+        size_t position = 0;
+        size_t slot = 0;
+        for (size_t i = 0; i < count; ++i) {
+            slot += CandidateSetDetail::readVarint(deltas.data(), position);
+            if (slot >= target) {
+                return slot == target;
+            }
+        }
+        return false;
+    }
+    }
+    return false;
+}
+
+CandidateSet::BlockBuilder::BlockBuilder(uintptr_t base, size_t byteLength) {
+    block_.base = base;
+    block_.slotCount = byteLength / slotSize;
+}
+
+void CandidateSet::BlockBuilder::add(uintptr_t address) {
+    const size_t slot = (address - block_.base) / slotSize;
+    if (block_.encoding == Encoding::Bitmap) {
+        block_.bits[slot / 64] |= uint64_t{1} << (slot % 64);
+    } else {
+        appendVarint(block_.deltas, block_.count == 0 ? slot : slot - lastSlot_);
+        if (block_.deltas.size() >= bitmapWords(block_.slotCount) * sizeof(uint64_t)) {
+            lastSlot_ = slot;
+            ++block_.count;
+            convertToBitmap();
+            return;
+        }
+    }
+    lastSlot_ = slot;
+    ++block_.count;
+}
+
+void CandidateSet::BlockBuilder::convertToBitmap() {
+    Block &block = block_;
+    block.bits.assign(bitmapWords(block.slotCount), 0);
+    size_t position = 0;
+    size_t slot = 0;
+    for (size_t i = 0; i < block.count; ++i) {
+        slot += CandidateSetDetail::readVarint(block.deltas.data(), position);
+        block.bits[slot / 64] |= uint64_t{1} << (slot % 64);
+    }
+    block.deltas.clear();
+    block.deltas.shrink_to_fit();
+    block.encoding = Encoding::Bitmap;
+}
+
+CandidateSet::Block CandidateSet::BlockBuilder::finish() {
+    Block block = std::move(block_);
+    if (block.count == block.slotCount && block.slotCount != 0) {
+        block.encoding = Encoding::Full;
+        block.bits.clear();
+        block.bits.shrink_to_fit();
+        block.deltas.clear();
+        block.deltas.shrink_to_fit();
+    } else {
+        block.deltas.shrink_to_fit();
+    }
+    block_ = Block{};
+    block_.base = block.end();
+    lastSlot_ = 0;
+    return block;
+}
+
+bool CandidateSet::Cursor::next(uintptr_t &address) {
+    const auto &blocks = set_->blocks_;
+    while (blockIndex_ < blocks.size()) {
+        const Block &block = blocks[blockIndex_];
+        switch (block.encoding) {
+        case Encoding::Full:
+            if (started_) {
+                ++slot_;
+            }
+            started_ = true;
+            if (slot_ < block.slotCount) {
+                address = block.base + slot_ * slotSize;
+                return true;
+            }
+            break;
+        case Encoding::Bitmap: {
+            size_t slot = started_ ? slot_ + 1 : 0;
+            started_ = true;
+            while (slot < block.slotCount) {
+                const uint64_t word = block.bits[slot / 64] >> (slot % 64);
+                if (word != 0) {
+                    slot += static_cast<size_t>(__builtin_ctzll(word));
+                    slot_ = slot;
+                    address = block.base + slot * slotSize;
+                    return true;
+                }
+                slot = (slot / 64 + 1) * 64;
+            }
+            break;
+        }
+        case Encoding::Delta:
+            if (!started_) {
+                started_ = true;
+                position_ = 0;
+                slot_ = 0;
+            }
+            if (position_ < block.deltas.size()) {
+                slot_ += CandidateSetDetail::readVarint(block.deltas.data(), position_);
+                address = block.base + slot_ * slotSize;
+                return true;
+            }
+            break;
+        }
+        ++blockIndex_;
+        position_ = 0;
+        slot_ = 0;
+        started_ = false;
+    }
+    return false;
+}
+
+void CandidateSet::Cursor::skipBlocksBefore(uintptr_t address) {
+    const auto &blocks = set_->blocks_;
+    while (blockIndex_ < blocks.size() && blocks[blockIndex_].end() <= address) {
+        ++blockIndex_;
+        position_ = 0;
+        slot_ = 0;
+        started_ = false;
+    }
+}
+
+void CandidateSet::append(Block &&block) {
+    if (block.count == 0) {
+        return;
+    }
+    size_ += block.count;
+    blocks_.push_back(std::move(block));
+}
+
+void CandidateSet::append(CandidateSet &&other) {
+    blocks_.reserve(blocks_.size() + other.blocks_.size());
+    for (auto &block : other.blocks_) {
+        append(std::move(block));
+    }
+    other.blocks_.clear();
+    other.size_ = 0;
+}
+
+CandidateSet CandidateSet::everySlot(uintptr_t base, size_t byteLength) {
+    CandidateSet set;
+    Block block;
+    block.base = base;
+    block.slotCount = byteLength / slotSize;
+    block.count = block.slotCount;
+    block.encoding = Encoding::Full;
+    set.append(std::move(block));
+    return set;
+}
+
+size_t CandidateSet::memoryUsage() const {
+    size_t total = sizeof(CandidateSet) + (blocks_.capacity() - blocks_.size()) * sizeof(Block);
+    for (const auto &block : blocks_) {
+        total += block.memoryUsage();
+    }
+    return total;
+}
+
+bool CandidateSet::contains(uintptr_t address) const {
+    auto it = std::upper_bound(blocks_.begin(), blocks_.end(), address, [](uintptr_t value, const Block &block) {
+        return value < block.base;
+    });
+    if (it == blocks_.begin()) {
+        return false;
+    }
+    --it;
+    return it->contains(address);
+}
+
+CandidateSet CandidateSet::intersect(const CandidateSet &other) const {
+    CandidateSet result;
+    Cursor otherCursor(other);
+    uintptr_t otherAddress = 0;
+    bool otherValid = otherCursor.next(otherAddress);
+    size_t otherBlock = 0;
+    for (const auto &block : blocks_) {
+        while (otherBlock < other.blocks_.size() && other.blocks_[otherBlock].end() <= block.base) {
+            ++otherBlock;
+        }
+        // Same range encoded as bitmaps or full on both sides: combine whole words.
+        if (otherBlock < other.blocks_.size()) {
+            const Block &peer = other.blocks_[otherBlock];
+            if (peer.base == block.base && peer.slotCount == block.slotCount && block.encoding != Encoding::Delta &&
+                peer.encoding != Encoding::Delta) {
+                if (block.encoding == Encoding::Full || peer.encoding == Encoding::Full) {
+                    Block copy = block.encoding == Encoding::Full ? peer : block;
+                    result.append(std::move(copy));
+                } else {
+                    Block combined;
+                    combined.base = block.base;
+                    combined.slotCount = block.slotCount;
+                    combined.encoding = Encoding::Bitmap;
+                    combined.bits.resize(block.bits.size());
+                    for (size_t word = 0; word < block.bits.size(); ++word) {
+                        combined.bits[word] = block.bits[word] & peer.bits[word];
+                        combined.count += static_cast<size_t>(__builtin_popcountll(combined.bits[word]));
+                    }
+                    result.append(std::move(combined));
+                }
+                otherCursor.skipBlocksBefore(block.end());
+                otherValid = otherCursor.next(otherAddress);
+                continue;
+            }
+        }
+        BlockBuilder builder(block.base, block.slotCount * slotSize);
+        block.forEach([&](uintptr_t address) {
+            while (otherValid && otherAddress < address) {
+                otherValid = otherCursor.next(otherAddress);
+            }
+            if (otherValid && otherAddress == address) {
+                builder.add(address);
+            }
+        });
+        result.append(builder.finish());
+    }
+    return result;
+}
+
+bool CandidateSet::save(const std::string &path, std::string &error) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    out.write(setMagic, sizeof(setMagic));
+    writeValue(out, static_cast<uint64_t>(blocks_.size()));
+    for (const auto &block : blocks_) {
+        writeValue(out, static_cast<uint64_t>(block.base));
+        writeValue(out, static_cast<uint64_t>(block.slotCount));
+        writeValue(out, static_cast<uint64_t>(block.count));
+        writeValue(out, static_cast<uint8_t>(block.encoding));
+        writeValue(out, static_cast<uint64_t>(block.bits.size()));
+        out.write(reinterpret_cast<const char *>(block.bits.data()), static_cast<std::streamsize>(block.bits.size() * sizeof(uint64_t)));
+        writeValue(out, static_cast<uint64_t>(block.deltas.size()));
+        out.write(reinterpret_cast<const char *>(block.deltas.data()), static_cast<std::streamsize>(block.deltas.size()));
+    }
+    if (!out) {
+        error = "failed to write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::optional<CandidateSet> CandidateSet::load(const std::string &path, std::string &error) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        error = "cannot read " + path;
+        return std::nullopt;
+    }
+    const auto fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    // Sizes read from the file are checked against what is left of it before
+    // anything is allocated for them.
+    const auto remaining = [&] { return fileSize - static_cast<uint64_t>(in.tellg()); };
+    char magic[sizeof(setMagic)] = {};
+    uint64_t blockCount = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, setMagic, sizeof(setMagic)) != 0 || !readValue(in, blockCount)) {
+        error = path + " is not a candidate set file";
+        return std::nullopt;
+    }
+    CandidateSet set;
+    for (uint64_t i = 0; i < blockCount; ++i) {
+        Block block;
+        uint64_t base = 0;
+        uint64_t slotCount = 0;
+        uint64_t count = 0;
+        uint8_t encoding = 0;
+        uint64_t wordCount = 0;
+        uint64_t deltaBytes = 0;
+        bool ok = readValue(in, base) && readValue(in, slotCount) && readValue(in, count) && readValue(in, encoding) &&
+                  encoding <= static_cast<uint8_t>(Encoding::Delta) && readValue(in, wordCount) &&
+                  wordCount == (encoding == static_cast<uint8_t>(Encoding::Bitmap) ? bitmapWords(slotCount) : 0) &&
+                  wordCount <= remaining() / sizeof(uint64_t);
+        if (ok) {
+            block.bits.resize(wordCount);
+            ok = static_cast<bool>(in.read(reinterpret_cast<char *>(block.bits.data()), static_cast<std::streamsize>(wordCount * sizeof(uint64_t)))) &&
+                 readValue(in, deltaBytes) && deltaBytes <= remaining();
+        }
+        if (ok) {
+            block.deltas.resize(deltaBytes);
+            ok = static_cast<bool>(in.read(reinterpret_cast<char *>(block.deltas.data()), static_cast<std::streamsize>(deltaBytes)));
+        }
+        if (!ok) {
+            error = path + " is truncated or corrupt";
+            return std::nullopt;
+        }
+        block.base = static_cast<uintptr_t>(base);
+        block.slotCount = static_cast<size_t>(slotCount);
+        block.count = static_cast<size_t>(count);
+        block.encoding = static_cast<Encoding>(encoding);
+        // Blocks must also be in address order and disjoint, as append requires.
+        if (!validBlock(block) || (!set.blocks_.empty() && block.base < set.blocks_.back().end())) {
+            error = path + " is truncated or corrupt";
+            return std::nullopt;
+        }
+        set.append(std::move(block));
+    }
+    return set;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Sorted set of 4-byte aligned addresses. The set is made of blocks, each covering
+// one address range and picking its own encoding: no payload when every slot in the
+// range is present, a bitmap over the slots when hits are dense, or varint encoded
+// slot deltas when they are sparse. A block never takes more than its bitmap would,
+// so millions of hits in a dense range stay at one bit per 4 bytes scanned.
+class CandidateSet {
+public:
+    static constexpr size_t slotSize = 4;
+
+    enum class Encoding : uint8_t {
+        Full,
+        Bitmap,
+        Delta,
+    };
+
+    struct Block {
+        uintptr_t base{};
+        size_t slotCount{};
+        size_t count{};
+        Encoding encoding{Encoding::Delta};
+        std::vector<uint64_t> bits;
+        std::vector<uint8_t> deltas;
+
+        uintptr_t end() const { return base + slotCount * slotSize; }
+        bool contains(uintptr_t address) const;
+        size_t memoryUsage() const { return sizeof(Block) + bits.capacity() * sizeof(uint64_t) + deltas.capacity(); }
+
+        template <typename Fn>
+        void forEach(Fn &&fn) const;
+    };
+
+    // Builds one block over [base, base + byteLength). Addresses must be added in
+    // strictly increasing order and be slot aligned relative to base.
+    class BlockBuilder {
+    public:
+        BlockBuilder(uintptr_t base, size_t byteLength);
+
+        void add(uintptr_t address);
+        size_t count() const { return block_.count; }
+        Block finish();
+
+    private:
+        void convertToBitmap();
+
+        Block block_;
+        size_t lastSlot_{};
+    };
+
+    // Walks the set in address order.
+    class Cursor {
+    public:
+        explicit Cursor(const CandidateSet &set) : set_(&set) {}
+
+        bool next(uintptr_t &address);
+        // Drops every remaining block that ends at or before address.
+        void skipBlocksBefore(uintptr_t address);
+
+    private:
+        const CandidateSet *set_;
+        size_t blockIndex_{};
+        size_t position_{};
+        size_t slot_{};
+        bool started_{false};
+    };
+
+    // Blocks must be appended in address order and must not overlap. Empty blocks
+    // are dropped.
+    void append(Block &&block);
+    void append(CandidateSet &&other);
+    // A set holding every slot of every range, used as the starting point when the
+    // value is unknown.
+    static CandidateSet everySlot(uintptr_t base, size_t byteLength);
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t memoryUsage() const;
+    bool contains(uintptr_t address) const;
+    const std::vector<Block> &blocks() const { return blocks_; }
+
+    CandidateSet intersect(const CandidateSet &other) const;
+
+    // Binary file round trip, used to carry a candidate set between runs.
+    bool save(const std::string &path, std::string &error) const;
+    static std::optional<CandidateSet> load(const std::string &path, std::string &error);
+
+    template <typename Fn>
+    void forEach(Fn &&fn) const {
+        for (const auto &block : blocks_) {
+            block.forEach(fn);
+        }
+    }
+
+    // Visits the addresses in [begin, end) in order.
+    template <typename Fn>
+    void forEachInRange(uintptr_t begin, uintptr_t end, Fn &&fn) const;
+
+private:
+    std::vector<Block> blocks_;
+    size_t size_{};
+};
+
+namespace CandidateSetDetail {
+
+inline size_t readVarint(const uint8_t *data, size_t &position) {
+    size_t value = 0;
+    unsigned shift = 0;
+    while (true) {
+        const uint8_t byte = data[position++];
+        value |= static_cast<size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+        shift += 7;
+    }
+}
+
+}
+
+template <typename Fn>
+void CandidateSet::Block::forEach(Fn &&fn) const {
+    switch (encoding) {
+    case Encoding::Full:
+        for (size_t slot = 0; slot < slotCount; ++slot) {
+            fn(base + slot * slotSize);
+        }
+        break;
+    case Encoding::Bitmap:
+        for (size_t word = 0; word < bits.size(); ++word) {
+            uint64_t mask = bits[word];
+            while (mask != 0) {
+                const size_t slot = word * 64 + static_cast<size_t>(__builtin_ctzll(mask));
+                fn(base + slot * slotSize);
+                mask &= mask - 1;
+            }
+        }
+        break;
+    case Encoding::Delta: {
+        size_t position = 0;
+        size_t slot = 0;
+        for (size_t i = 0; i < count; ++i) {
+            slot += CandidateSetDetail::readVarint(deltas.data(), position);
+            fn(base + slot * slotSize);
+        }
+        break;
+    }
+    }
+}
+
+template <typename Fn>
+void CandidateSet::forEachInRange(uintptr_t begin, uintptr_t end, Fn &&fn) const {
+    auto it = blocks_.begin();
+    size_t low = 0;
+    size_t high = blocks_.size();
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (blocks_[middle].end() <= begin) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (it += static_cast<std::ptrdiff_t>(low); it != blocks_.end() && it->base < end; ++it) {
+        const Block &block = *it;
+        if (block.base >= begin && block.end() <= end) {
+            block.forEach(fn);
+        } else if (block.encoding == Encoding::Full) {
+            const uintptr_t first = std::max(begin, block.base);
+            const uintptr_t aligned = block.base + (first - block.base + slotSize - 1) / slotSize * slotSize;
+            for (uintptr_t address = aligned; address < end && address < block.end(); address += slotSize) {
+                fn(address);
+            }
+        } else {
+            block.forEach([&](uintptr_t address) {
+                if (address >= begin && address < end) {
+                    fn(address);
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,180 @@
+#include "CandidateWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+size_t bucketIndex(uint64_t value) {
+    if (value < 16) {
+        return static_cast<size_t>(value);
+    }
+    const int msb = 63 - __builtin_clzll(value);
+    const uint64_t sub = (value >> (msb - 4)) & 15;
+    return static_cast<size_t>(msb - 3) * 16 + static_cast<size_t>(sub);
+}
+
+uint64_t bucketUpperBound(size_t index) {
+    if (index < 16) {
+        return index;
+    }
+    const int msb = static_cast<int>(index / 16) + 3;
+    const uint64_t lower = (16 + index % 16) << (msb - 4);
+    return lower + (uint64_t{1} << (msb - 4)) - 1;
+}
+
+float distanceBetween(const Vector3 &lhs, const Vector3 &rhs) {
+    const float dx = lhs.x - rhs.x;
+    const float dy = lhs.y - rhs.y;
+    const float dz = lhs.z - rhs.z;
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+} // namespace
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    ++buckets_[bucketIndex(nanoseconds)];
+    ++count_;
+    max_ = std::max(max_, nanoseconds);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count_))), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+void LatencyHistogram::reset() {
+    buckets_.fill(0);
+    count_ = 0;
+    max_ = 0;
+}
+
+CandidateWatcher::CandidateWatcher(const MemorySource &reader, const std::vector<CandidateOffset> &candidates,
+                                   const WatchOptions &options)
+    : reader_(reader), options_(options), valueSize_(VectorKernels::layoutOf(options.valueType).size) {
+    candidates_.reserve(candidates.size());
+    for (const auto &candidate : candidates) {
+        WatchedCandidate watched;
+        watched.address = candidate.address;
+        watched.value = candidate.value;
+        candidates_.push_back(watched);
+    }
+    const size_t entries = candidates_.size() + (options_.reference ? 1 : 0);
+    values_.resize(entries * valueSize_);
+    requests_.resize(entries);
+    bindRequests();
+}
+
+void CandidateWatcher::bindRequests() {
+    size_t entry = 0;
+    if (options_.reference) {
+        requests_[entry] = {*options_.reference, values_.data(), valueSize_};
+        ++entry;
+    }
+    for (const auto &candidate : candidates_) {
+        requests_[entry] = {candidate.address, values_.data() + entry * valueSize_, valueSize_};
+        ++entry;
+    }
+    requests_.resize(entry);
+}
+
+bool CandidateWatcher::poll() {
+    reader_.readBatch(requests_);
+    ++polls_;
+
+    size_t entry = 0;
+    bool referenceMoved = false;
+    if (options_.reference) {
+        if (!requests_[0].succeeded) {
+            return false;
+        }
+        const Vector3 current = VectorKernels::decodeValue(options_.valueType, values_.data(), options_.fixedPointScale);
+        referenceMoved = referenceKnown_ && !approximatelyEqual(current, referenceValue_, options_.tolerance);
+        referenceValue_ = current;
+        referenceKnown_ = true;
+        referenceMoves_ += referenceMoved ? 1 : 0;
+        entry = 1;
+    }
+
+    size_t kept = 0;
+    bool compacted = false;
+    for (size_t i = 0; i < candidates_.size(); ++i, ++entry) {
+        WatchedCandidate candidate = candidates_[i];
+        bool keep = requests_[entry].succeeded;
+        if (keep) {
+            const Vector3 current =
+                VectorKernels::decodeValue(options_.valueType, values_.data() + entry * valueSize_, options_.fixedPointScale);
+            if (!approximatelyEqual(current, candidate.value, options_.tolerance)) {
+                ++candidate.moves;
+                candidate.distance += distanceBetween(current, candidate.value);
+                candidate.stillPolls = 0;
+            } else if (referenceMoved) {
+                ++candidate.stillPolls;
+                keep = candidate.stillPolls < options_.stillLimit;
+            }
+            candidate.value = current;
+        }
+        if (!keep) {
+            ++pruned_;
+            compacted = true;
+            continue;
+        }
+        candidates_[kept++] = candidate;
+    }
+    if (compacted) {
+        // Shrinking never reallocates, so the loop stays allocation free.
+        candidates_.resize(kept);
+        bindRequests();
+    }
+    return true;
+}
+
+void CandidateWatcher::run(const std::atomic<bool> *stop, const std::function<void(const WatchProgress &)> &progress) {
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options_.rate));
+    const auto started = Clock::now();
+    const auto finish = started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.duration));
+    auto deadline = started;
+    auto nextReport = started + std::chrono::seconds(1);
+
+    while (stop == nullptr || !stop->load(std::memory_order_relaxed)) {
+        const auto pollStart = Clock::now();
+        if (options_.duration > 0.0 && pollStart >= finish) {
+            break;
+        }
+        const bool referenceRead = poll();
+        const auto pollEnd = Clock::now();
+        latency_.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(pollEnd - pollStart).count()));
+        if (!referenceRead || candidates_.empty()) {
+            break;
+        }
+
+        if (pollEnd >= nextReport) {
+            nextReport += std::chrono::seconds(1);
+            if (progress) {
+                progress({std::chrono::duration<double>(pollEnd - started).count(), polls_, missedDeadlines_, candidates_.size(), &latency_});
+            }
+        }
+
+        deadline += period;
+        if (pollEnd > deadline + period) {
+            // Too far behind to catch up: skip the missed ticks instead of bursting.
+            missedDeadlines_ += static_cast<uint64_t>((pollEnd - deadline) / period);
+            deadline = pollEnd;
+        } else {
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+}
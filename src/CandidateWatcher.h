@@ -0,0 +1,110 @@
+#pragma once
+
+#include "OffsetScanner.h"
+#include "MemorySource.h"
+#include "Vector3.h"
+#include "VectorMatchKernels.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Fixed-size log-linear histogram of durations in nanoseconds: 16 sub-buckets per
+// power of two, so any percentile is accurate to about 6% and recording never
+// allocates.
+class LatencyHistogram {
+public:
+    void record(uint64_t nanoseconds);
+    // Upper bound of the bucket holding the given fraction (0..1) of samples.
+    uint64_t percentile(double fraction) const;
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    void reset();
+
+private:
+    static constexpr size_t subBuckets = 16;
+    static constexpr size_t bucketCount = 64 * subBuckets;
+
+    std::array<uint64_t, bucketCount> buckets_{};
+    uint64_t count_{};
+    uint64_t max_{};
+};
+
+struct WatchedCandidate {
+    uintptr_t address{};
+    Vector3 value{};
+    // Polls in which the value moved by more than the tolerance, and the path
+    // length it travelled.
+    size_t moves{};
+    float distance{};
+    // Consecutive polls in which the reference moved and this value did not.
+    size_t stillPolls{};
+};
+
+struct WatchOptions {
+    double rate{1000.0};
+    // Zero runs until stop is set.
+    double duration{10.0};
+    std::optional<uintptr_t> reference;
+    float tolerance{0.01f};
+    // A candidate is dropped after holding still for this many polls in a row
+    // while the reference moved, or as soon as it cannot be read.
+    size_t stillLimit{3};
+    // Layout of the watched values, as passed to OffsetScanner::setValueType.
+    VectorKernels::ValueType valueType{VectorKernels::ValueType::Vec3f};
+    double fixedPointScale{1.0};
+};
+
+struct WatchProgress {
+    double elapsed{};
+    uint64_t polls{};
+    uint64_t missedDeadlines{};
+    size_t remaining{};
+    const LatencyHistogram *latency{};
+};
+
+// Polls a fixed candidate list with one batched read per tick. All buffers are
+// sized up front; pruning compacts them in place, so the polling loop does not
+// allocate.
+class CandidateWatcher {
+public:
+    CandidateWatcher(const MemorySource &reader, const std::vector<CandidateOffset> &candidates, const WatchOptions &options);
+
+    // One poll: reads the reference and every remaining candidate, updates their
+    // motion and prunes the ones that hold still. Returns false when the reference
+    // could not be read.
+    bool poll();
+
+    // Polls at options.rate until options.duration elapses or stop is set, calling
+    // progress about once per second. Latency is measured per poll.
+    void run(const std::atomic<bool> *stop, const std::function<void(const WatchProgress &)> &progress);
+
+    const std::vector<WatchedCandidate> &candidates() const { return candidates_; }
+    const LatencyHistogram &latency() const { return latency_; }
+    uint64_t polls() const { return polls_; }
+    uint64_t missedDeadlines() const { return missedDeadlines_; }
+    uint64_t referenceMoves() const { return referenceMoves_; }
+    size_t pruned() const { return pruned_; }
+
+private:
+    void bindRequests();
+
+    const MemorySource &reader_;
+    WatchOptions options_;
+    std::vector<WatchedCandidate> candidates_;
+    // One value per candidate, preceded by the reference when there is one.
+    size_t valueSize_{};
+    std::vector<uint8_t> values_;
+    std::vector<ReadRequest> requests_;
+    Vector3 referenceValue_{};
+    bool referenceKnown_{false};
+    LatencyHistogram latency_;
+    uint64_t polls_{};
+    uint64_t missedDeadlines_{};
+    uint64_t referenceMoves_{};
+    size_t pruned_{};
+};
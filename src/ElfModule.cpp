@@ -0,0 +1,259 @@
+#include "ElfModule.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+constexpr uintptr_t pageMask = 4096 - 1;
+// Sanity limits against corrupt or hostile headers.
+constexpr size_t maxProgramHeaders = 4096;
+constexpr size_t maxSectionHeaders = 1u << 16;
+constexpr size_t maxNameTableSize = 16u << 20;
+
+bool hostIsLittleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+} // namespace
+
+template <typename Header, typename ProgramHeader, typename SectionHeader>
+bool ElfModule::parseClass(const ByteReader &read, bool withSections, std::string &error) {
+    Header header{};
+    if (!read(0, &header, sizeof(header))) {
+        error = "ELF header is truncated";
+        return false;
+    }
+    if (header.e_phentsize != sizeof(ProgramHeader) || header.e_phnum == 0 || header.e_phnum > maxProgramHeaders) {
+        error = "ELF program header table is missing or malformed";
+        return false;
+    }
+    std::vector<ProgramHeader> programHeaders(header.e_phnum);
+    if (!read(header.e_phoff, programHeaders.data(), programHeaders.size() * sizeof(ProgramHeader))) {
+        error = "ELF program header table is truncated";
+        return false;
+    }
+    for (const auto &program : programHeaders) {
+        if (program.p_type != PT_LOAD) {
+            continue;
+        }
+        ElfSegment segment;
+        segment.address = program.p_vaddr;
+        segment.memorySize = program.p_memsz;
+        segment.fileOffset = program.p_offset;
+        segment.fileSize = program.p_filesz;
+        segment.writable = (program.p_flags & PF_W) != 0;
+        segment.executable = (program.p_flags & PF_X) != 0;
+        segments_.push_back(segment);
+    }
+    if (segments_.empty()) {
+        error = "ELF file has no loadable segments";
+        return false;
+    }
+    std::sort(segments_.begin(), segments_.end(),
+              [](const ElfSegment &lhs, const ElfSegment &rhs) { return lhs.address < rhs.address; });
+
+    if (!withSections || header.e_shoff == 0 || header.e_shentsize != sizeof(SectionHeader)) {
+        return true;
+    }
+    // With many sections the real count and name table index live in section 0.
+    SectionHeader first{};
+    if (!read(header.e_shoff, &first, sizeof(first))) {
+        return true;
+    }
+    const size_t count = header.e_shnum != 0 ? header.e_shnum : static_cast<size_t>(first.sh_size);
+    const size_t nameIndex = header.e_shstrndx != SHN_XINDEX ? header.e_shstrndx : static_cast<size_t>(first.sh_link);
+    if (count == 0 || count > maxSectionHeaders || nameIndex >= count) {
+        return true;
+    }
+    std::vector<SectionHeader> sectionHeaders(count);
+    if (!read(header.e_shoff, sectionHeaders.data(), count * sizeof(SectionHeader))) {
+        return true;
+    }
+    const SectionHeader &nameTable = sectionHeaders[nameIndex];
+    if (nameTable.sh_size == 0 || nameTable.sh_size > maxNameTableSize) {
+        return true;
+    }
+    std::vector<char> names(static_cast<size_t>(nameTable.sh_size) + 1, '\0');
+    if (!read(nameTable.sh_offset, names.data(), names.size() - 1)) {
+        return true;
+    }
+    for (const auto &section : sectionHeaders) {
+        // .tbss takes no room in the image; its addresses belong to what follows.
+        const bool threadLocalBss = (section.sh_flags & SHF_TLS) != 0 && section.sh_type == SHT_NOBITS;
+        if ((section.sh_flags & SHF_ALLOC) == 0 || section.sh_size == 0 || threadLocalBss) {
+            continue;
+        }
+        ElfSection entry;
+        entry.name = section.sh_name < names.size() ? names.data() + section.sh_name : "";
+        entry.address = section.sh_addr;
+        entry.size = section.sh_size;
+        entry.writable = (section.sh_flags & SHF_WRITE) != 0;
+        entry.noBits = section.sh_type == SHT_NOBITS;
+        sections_.push_back(std::move(entry));
+    }
+    std::sort(sections_.begin(), sections_.end(),
+              [](const ElfSection &lhs, const ElfSection &rhs) { return lhs.address < rhs.address; });
+    return true;
+}
+
+std::optional<ElfModule> ElfModule::parse(const ByteReader &read, bool withSections, std::string &error) {
+    unsigned char ident[EI_NIDENT]{};
+    if (!read(0, ident, sizeof(ident))) {
+        error = "ELF header is truncated";
+        return std::nullopt;
+    }
+    if (std::memcmp(ident, ELFMAG, SELFMAG) != 0) {
+        error = "not an ELF file";
+        return std::nullopt;
+    }
+    if (ident[EI_DATA] != (hostIsLittleEndian() ? ELFDATA2LSB : ELFDATA2MSB)) {
+        error = "ELF byte order differs from the host";
+        return std::nullopt;
+    }
+    ElfModule module;
+    bool parsed = false;
+    if (ident[EI_CLASS] == ELFCLASS64) {
+        parsed = module.parseClass<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr>(read, withSections, error);
+    } else if (ident[EI_CLASS] == ELFCLASS32) {
+        parsed = module.parseClass<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr>(read, withSections, error);
+    } else {
+        error = "unknown ELF class";
+    }
+    if (!parsed) {
+        return std::nullopt;
+    }
+    return module;
+}
+
+std::optional<ElfModule> ElfModule::loadFile(const std::string &path, std::string &error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    const auto read = [fd](uint64_t offset, void *buffer, size_t size) {
+        auto *bytes = static_cast<uint8_t *>(buffer);
+        while (size > 0) {
+            const ssize_t count = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            bytes += count;
+            offset += static_cast<uint64_t>(count);
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    };
+    auto module = parse(read, true, error);
+    ::close(fd);
+    if (!module) {
+        error = path + ": " + error;
+    }
+    return module;
+}
+
+std::optional<ElfModule> ElfModule::readMapped(const MemorySource &reader, uintptr_t base, std::string &error) {
+    const auto read = [&reader, base](uint64_t offset, void *buffer, size_t size) {
+        return reader.read(base + static_cast<uintptr_t>(offset), buffer, size);
+    };
+    return parse(read, false, error);
+}
+
+std::optional<ElfModule> ElfModule::forModule(pid_t pid, const std::vector<MemoryRegion> &mappings,
+                                              const MemorySource &reader, std::string &error) {
+    if (mappings.empty()) {
+        error = "module has no mappings";
+        return std::nullopt;
+    }
+    const MemoryRegion &lowest = mappings.front();
+    std::optional<ElfModule> module;
+    std::string fileError;
+    const std::string &path = lowest.pathname;
+    if (!path.empty() && path[0] == '/') {
+        // map_files opens the mapped file itself, even when it was deleted or
+        // replaced on disk, but needs CAP_SYS_ADMIN. Offline sources have no pid.
+        if (pid != 0) {
+            std::ostringstream mapFile;
+            mapFile << "/proc/" << pid << "/map_files/" << std::hex << lowest.start << '-' << lowest.end;
+            module = loadFile(mapFile.str(), fileError);
+        }
+        // A " (deleted)" suffix means the path no longer leads to the image.
+        const std::string deleted = " (deleted)";
+        const bool onDisk = path.size() < deleted.size() || path.compare(path.size() - deleted.size(), deleted.size(), deleted) != 0;
+        if (!module && onDisk && pid != 0) {
+            module = loadFile("/proc/" + std::to_string(pid) + "/root" + path, fileError);
+        }
+        if (!module && onDisk) {
+            module = loadFile(path, fileError);
+        }
+    }
+    if (!module) {
+        module = readMapped(reader, lowest.start, error);
+        if (!module) {
+            if (!fileError.empty()) {
+                error = fileError + "; mapped header: " + error;
+            }
+            return std::nullopt;
+        }
+    }
+    // The lowest mapping holds the page the first segment starts in.
+    module->setLoadBias(lowest.start - static_cast<uintptr_t>(module->segments_.front().address & ~uint64_t{pageMask}));
+    return module;
+}
+
+std::vector<MemoryRegion> ElfModule::dataRegions(const std::vector<MemoryRegion> &processRegions) const {
+    std::vector<MemoryRegion> regions;
+    for (const auto &segment : segments_) {
+        if (!segment.writable || segment.memorySize == 0) {
+            continue;
+        }
+        const uintptr_t start = loadBias_ + static_cast<uintptr_t>(segment.address);
+        const uintptr_t end = start + static_cast<uintptr_t>(segment.memorySize);
+        auto it = std::upper_bound(processRegions.begin(), processRegions.end(), start,
+                                   [](uintptr_t address, const MemoryRegion &region) { return address < region.end; });
+        for (; it != processRegions.end() && it->start < end; ++it) {
+            if (!it->isReadable() || !it->isWritable()) {
+                continue;
+            }
+            MemoryRegion region = *it;
+            region.start = std::max(region.start, start);
+            region.end = std::min(region.end, end);
+            // Segments that share a page would otherwise add it twice.
+            if (!regions.empty() && region.start < regions.back().end) {
+                region.start = regions.back().end;
+            }
+            if (region.start < region.end) {
+                regions.push_back(std::move(region));
+            }
+        }
+    }
+    return regions;
+}
+
+std::optional<ElfLocation> ElfModule::locate(uintptr_t address) const {
+    const uint64_t linkAddress = static_cast<uint64_t>(address - loadBias_);
+    for (const auto &section : sections_) {
+        if (linkAddress >= section.address && linkAddress - section.address < section.size) {
+            return ElfLocation{section.name, linkAddress - section.address};
+        }
+    }
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        const ElfSegment &segment = segments_[i];
+        if (linkAddress >= segment.address && linkAddress - segment.address < segment.memorySize) {
+            return ElfLocation{"segment " + std::to_string(i), linkAddress - segment.address};
+        }
+    }
+    return std::nullopt;
+}
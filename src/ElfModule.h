@@ -0,0 +1,88 @@
+#pragma once
+
+#include "MemorySource.h"
+#include "ProcessUtils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+// A PT_LOAD program header, in link-time addresses.
+struct ElfSegment {
+    uint64_t address{};
+    uint64_t memorySize{};
+    uint64_t fileOffset{};
+    uint64_t fileSize{};
+    bool writable{false};
+    bool executable{false};
+};
+
+// An allocated section (SHF_ALLOC), in link-time addresses. noBits marks sections
+// without file contents such as .bss.
+struct ElfSection {
+    std::string name;
+    uint64_t address{};
+    uint64_t size{};
+    bool writable{false};
+    bool noBits{false};
+};
+
+// Where an address lies inside a module: a section name (or "segment <n>" when
+// the section headers are unavailable) and the offset from its start.
+struct ElfLocation {
+    std::string name;
+    uint64_t offset{};
+};
+
+// Program and section headers of a loaded ELF module and its load bias, so scans
+// can be limited to the writable data segments and addresses reported relative to
+// the section that holds them. Both ELF classes are accepted, in host byte order.
+class ElfModule {
+public:
+    // Reads size bytes at a file offset; false when they are not available.
+    using ByteReader = std::function<bool(uint64_t offset, void *buffer, size_t size)>;
+
+    // Parses the headers through read. Without withSections only the ELF and
+    // program headers are needed, which is all a mapped image is guaranteed to hold.
+    static std::optional<ElfModule> parse(const ByteReader &read, bool withSections, std::string &error);
+    static std::optional<ElfModule> loadFile(const std::string &path, std::string &error);
+    // Headers from the image mapped at base; program headers only.
+    static std::optional<ElfModule> readMapped(const MemorySource &reader, uintptr_t base, std::string &error);
+
+    // Headers of the module mapped by mappings (every mapping of its file, sorted by
+    // address), with the load bias set from the lowest one. The file is opened
+    // through /proc/<pid>/map_files, then /proc/<pid>/root so a target in another
+    // mount namespace works, then by its path; the mapped header is the fallback.
+    static std::optional<ElfModule> forModule(pid_t pid, const std::vector<MemoryRegion> &mappings,
+                                              const MemorySource &reader, std::string &error);
+
+    const std::vector<ElfSegment> &segments() const { return segments_; }
+    const std::vector<ElfSection> &sections() const { return sections_; }
+    bool hasSections() const { return !sections_.empty(); }
+
+    // Runtime address minus link-time address.
+    uintptr_t loadBias() const { return loadBias_; }
+    void setLoadBias(uintptr_t bias) { loadBias_ = bias; }
+
+    // The writable segments as they are mapped in processRegions (sorted by
+    // address): each writable mapping overlapping a segment, clipped to it. This
+    // covers .data as well as the anonymous mapping holding the tail of .bss, and
+    // leaves out the RELRO pages the loader made read-only after relocation.
+    std::vector<MemoryRegion> dataRegions(const std::vector<MemoryRegion> &processRegions) const;
+
+    // The section, or without section headers the segment, holding address.
+    std::optional<ElfLocation> locate(uintptr_t address) const;
+
+private:
+    template <typename Header, typename ProgramHeader, typename SectionHeader>
+    bool parseClass(const ByteReader &read, bool withSections, std::string &error);
+
+    std::vector<ElfSegment> segments_;
+    std::vector<ElfSection> sections_;
+    uintptr_t loadBias_{};
+};
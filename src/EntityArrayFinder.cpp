@@ -0,0 +1,233 @@
+#include "EntityArrayFinder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <set>
+#include <utility>
+
+namespace {
+
+constexpr size_t extendBatch = 64;
+
+struct EntryReader {
+    const MemorySource &reader;
+    VectorKernels::ValueType type;
+    double fixedPointScale;
+    size_t valueSize;
+
+    // Decodes count entries starting at first with one read.
+    bool read(uintptr_t first, size_t stride, size_t count, std::vector<Vector3> &out) const {
+        std::vector<uint8_t> bytes((count - 1) * stride + valueSize);
+        if (!reader.read(first, bytes.data(), bytes.size())) {
+            return false;
+        }
+        out.clear();
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(VectorKernels::decodeValue(type, bytes.data() + i * stride, fixedPointScale));
+        }
+        return true;
+    }
+};
+
+bool isPlausible(const Vector3 &value, double maxCoordinate) {
+    bool nonZero = false;
+    for (const float component : value.toArray()) {
+        if (!std::isfinite(component) || std::fabs(component) > maxCoordinate) {
+            return false;
+        }
+        nonZero = nonZero || component != 0.0f;
+    }
+    return nonZero;
+}
+
+// First hit in [low, high) that lies on the grid through anchor with the given
+// stride and is not already taken by another sample, or 0.
+uintptr_t hitOnGrid(const std::vector<uintptr_t> &hits, uintptr_t low, uintptr_t high, uintptr_t anchor, size_t stride,
+                    const std::vector<uintptr_t> &taken) {
+    for (auto it = std::lower_bound(hits.begin(), hits.end(), low); it != hits.end() && *it < high; ++it) {
+        const uintptr_t distance = *it > anchor ? *it - anchor : anchor - *it;
+        if (distance % stride == 0 && std::find(taken.begin(), taken.end(), *it) == taken.end()) {
+            return *it;
+        }
+    }
+    return 0;
+}
+
+// Grows the array below first and above last, entry by entry, while the entries
+// hold plausible positions and stay inside [regionStart, regionEnd). With
+// checkInner the entries between the samples must be plausible too; without it
+// they are taken as they are. Returns an empty array when the samples span more
+// than maxEntries entries.
+EntityArray extendArray(const EntryReader &reader, const std::vector<uintptr_t> &sampleAddresses, size_t stride,
+                        bool checkInner, uintptr_t regionStart, uintptr_t regionEnd, const EntityArrayOptions &options) {
+    const uintptr_t first = *std::min_element(sampleAddresses.begin(), sampleAddresses.end());
+    const uintptr_t last = *std::max_element(sampleAddresses.begin(), sampleAddresses.end());
+    const size_t inner = (last - first) / stride + 1;
+    if (inner > options.maxEntries) {
+        return {};
+    }
+
+    std::vector<Vector3> values;
+    if (!reader.read(first, stride, inner, values)) {
+        return {};
+    }
+    if (checkInner && !std::all_of(values.begin(), values.end(),
+                                   [&](const Vector3 &value) { return isPlausible(value, options.maxCoordinate); })) {
+        return {};
+    }
+
+    std::vector<Vector3> below;
+    std::vector<Vector3> batch;
+    uintptr_t lowest = first;
+    bool stopped = false;
+    while (!stopped && inner + below.size() < options.maxEntries) {
+        const size_t room = (lowest - regionStart) / stride;
+        const size_t count = std::min({room, extendBatch, options.maxEntries - inner - below.size()});
+        if (count == 0 || !reader.read(lowest - count * stride, stride, count, batch)) {
+            break;
+        }
+        for (size_t i = count; i-- > 0;) {
+            if (!isPlausible(batch[i], options.maxCoordinate)) {
+                stopped = true;
+                break;
+            }
+            below.push_back(batch[i]);
+            lowest -= stride;
+        }
+    }
+
+    uintptr_t highest = last;
+    stopped = false;
+    while (!stopped && values.size() + below.size() < options.maxEntries) {
+        const size_t room = (regionEnd - highest - reader.valueSize) / stride;
+        const size_t count = std::min({room, extendBatch, options.maxEntries - values.size() - below.size()});
+        if (count == 0 || !reader.read(highest + stride, stride, count, batch)) {
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (!isPlausible(batch[i], options.maxCoordinate)) {
+                stopped = true;
+                break;
+            }
+            values.push_back(batch[i]);
+            highest += stride;
+        }
+    }
+
+    EntityArray array;
+    array.base = lowest;
+    array.stride = stride;
+    array.values.assign(below.rbegin(), below.rend());
+    array.values.insert(array.values.end(), values.begin(), values.end());
+    for (const uintptr_t address : sampleAddresses) {
+        array.sampleEntries.push_back((address - lowest) / stride);
+    }
+    return array;
+}
+
+} // namespace
+
+std::vector<EntityArray> findEntityArrays(const OffsetScanner &scanner, const std::vector<Vector3> &samples, float tolerance,
+                                          const EntityArrayOptions &options) {
+    if (samples.size() < 2 || options.maxEntries < 2) {
+        return {};
+    }
+    std::vector<std::vector<uintptr_t>> hits(samples.size());
+    for (const auto &hit : scanner.findTargetHits(samples, tolerance)) {
+        hits[hit.target].push_back(hit.address);
+    }
+    std::vector<size_t> order(samples.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return hits[lhs].size() < hits[rhs].size(); });
+    if (hits[order.front()].empty()) {
+        return {};
+    }
+
+    const VectorKernels::ValueLayout layout = VectorKernels::layoutOf(scanner.valueType());
+    const EntryReader reader{scanner.reader(), scanner.valueType(), scanner.fixedPointScale(), layout.size};
+    const uintptr_t window = options.maxStride * (options.maxEntries - 1);
+    const size_t minStride = (layout.size + layout.alignment - 1) / layout.alignment * layout.alignment;
+    const size_t maxStride = options.maxStride / layout.alignment * layout.alignment;
+
+    std::vector<EntityArray> arrays;
+    std::set<std::pair<uintptr_t, size_t>> seen;
+    std::vector<uintptr_t> sampleAddresses(samples.size());
+    std::vector<uintptr_t> taken;
+    for (const uintptr_t anchor : hits[order[0]]) {
+        const MemoryRegion *region = ProcessUtils::findRegionContaining(scanner.moduleRegions(), anchor);
+        if (region == nullptr) {
+            continue;
+        }
+        // Every sample has to sit in the same mapping, within reach of the anchor.
+        const uintptr_t low = anchor - std::min<uintptr_t>(window, anchor - region->start);
+        const uintptr_t high = anchor + std::min<uintptr_t>(window, region->end - anchor);
+        const std::vector<uintptr_t> &partners = hits[order[1]];
+        for (auto partner = std::lower_bound(partners.begin(), partners.end(), low); partner != partners.end() && *partner < high;
+             ++partner) {
+            if (*partner == anchor) {
+                continue;
+            }
+            const uintptr_t distance = *partner > anchor ? *partner - anchor : anchor - *partner;
+            bool found = false;
+            for (size_t stride = maxStride; stride >= minStride && stride > 0; stride -= layout.alignment) {
+                if (distance % stride != 0) {
+                    continue;
+                }
+                taken = {anchor, *partner};
+                for (size_t k = 2; k < order.size(); ++k) {
+                    const uintptr_t hit = hitOnGrid(hits[order[k]], low, high, anchor, stride, taken);
+                    if (hit == 0) {
+                        break;
+                    }
+                    taken.push_back(hit);
+                }
+                if (taken.size() != samples.size()) {
+                    continue;
+                }
+                for (size_t k = 0; k < order.size(); ++k) {
+                    sampleAddresses[order[k]] = taken[k];
+                }
+                found = true;
+                break;
+            }
+            if (!found) {
+                continue;
+            }
+            // Samples that skip entries sit a multiple of the stride apart, so every
+            // divisor of their common spacing is a candidate; the one giving the
+            // longest array wins. Below the largest, a candidate must also find
+            // plausible positions between the samples.
+            size_t spacing = 0;
+            for (const uintptr_t address : taken) {
+                spacing = std::gcd<size_t>(spacing, address > anchor ? address - anchor : anchor - address);
+            }
+            EntityArray best;
+            bool largest = true;
+            for (size_t stride = std::min(spacing, maxStride) / layout.alignment * layout.alignment;
+                 stride >= minStride && stride > 0; stride -= layout.alignment) {
+                if (spacing % stride != 0) {
+                    continue;
+                }
+                EntityArray array = extendArray(reader, sampleAddresses, stride, !largest, region->start, region->end, options);
+                largest = false;
+                if (array.count() > best.count()) {
+                    best = std::move(array);
+                }
+            }
+            if (best.count() != 0 && seen.emplace(best.base, best.stride).second) {
+                arrays.push_back(std::move(best));
+            }
+            if (arrays.size() >= options.maxArrays) {
+                break;
+            }
+        }
+        if (arrays.size() >= options.maxArrays) {
+            break;
+        }
+    }
+    std::stable_sort(arrays.begin(), arrays.end(), [](const EntityArray &lhs, const EntityArray &rhs) { return lhs.count() > rhs.count(); });
+    return arrays;
+}
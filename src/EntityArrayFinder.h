@@ -0,0 +1,44 @@
+#pragma once
+
+#include "OffsetScanner.h"
+#include "Vector3.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct EntityArrayOptions {
+    // Largest distance between the positions of consecutive entries.
+    size_t maxStride{0x1000};
+    // Largest number of entries an array may have; samples further apart than
+    // maxStride * (maxEntries - 1) are not considered part of one array.
+    size_t maxEntries{4096};
+    // Extension stops at the first entry with a coordinate beyond this magnitude,
+    // a non-finite coordinate or an all-zero position.
+    double maxCoordinate{1e7};
+    size_t maxArrays{16};
+};
+
+// Positions stored at a constant stride: entry i holds its position at
+// base + i * stride.
+struct EntityArray {
+    uintptr_t base{};
+    size_t stride{};
+    // Entry that holds each sample, in the order the samples were given.
+    std::vector<size_t> sampleEntries;
+    // Position of every entry, so values().size() is the entry count.
+    std::vector<Vector3> values;
+
+    size_t count() const { return values.size(); }
+};
+
+// Finds arrays of structs holding every sample at one stride from a common base.
+// A single multi-target scan collects the hits of all samples; the hits of the
+// rarest sample anchor the search and a stride that puts a hit of every other
+// sample on the same grid picks them. Each divisor of the samples' common spacing
+// is then tried as the stride, extending the array in both directions for as long
+// as the entries hold plausible positions, and the longest array wins, so samples
+// that skip entries still yield the true stride. Arrays with the most entries
+// come first.
+std::vector<EntityArray> findEntityArrays(const OffsetScanner &scanner, const std::vector<Vector3> &samples, float tolerance,
+                                          const EntityArrayOptions &options);
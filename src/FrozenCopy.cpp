@@ -0,0 +1,544 @@
+#include "FrozenCopy.h"
+
+#include "PageMap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Large enough to keep the iovec count per process_vm_readv call low, small
+// enough to balance the copy across threads.
+constexpr size_t copyPieceSize = 1u << 20;
+// Tasks per thread, so a thread held up by page faults in the target does not
+// keep the others waiting.
+constexpr size_t tasksPerThread = 4;
+constexpr auto signalStopTimeout = std::chrono::seconds(2);
+constexpr auto signalStopPoll = std::chrono::microseconds(20);
+
+double millisecondsBetween(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+std::vector<pid_t> listThreads(pid_t pid) {
+    std::vector<pid_t> threads;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator("/proc/" + std::to_string(pid) + "/task", error)) {
+        const std::string name = entry.path().filename().string();
+        if (!name.empty() && std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            threads.push_back(static_cast<pid_t>(std::stol(name)));
+        }
+    }
+    std::sort(threads.begin(), threads.end());
+    return threads;
+}
+
+// The state letter from /proc/<pid>/task/<tid>/stat, or 'X' when the thread is gone.
+char threadState(pid_t pid, pid_t tid) {
+    std::ifstream file("/proc/" + std::to_string(pid) + "/task/" + std::to_string(tid) + "/stat");
+    std::string line;
+    if (!std::getline(file, line)) {
+        return 'X';
+    }
+    // The command name may contain spaces and parentheses; the state follows the last ')'.
+    const size_t close = line.rfind(')');
+    if (close == std::string::npos || close + 2 >= line.size()) {
+        return 'X';
+    }
+    return line[close + 2];
+}
+
+bool isStoppedOrGone(char state) {
+    return state == 'T' || state == 't' || state == 'Z' || state == 'X';
+}
+
+// MemAvailable from /proc/meminfo in bytes, or nothing when it cannot be read.
+std::optional<uint64_t> availableMemory() {
+    std::ifstream file("/proc/meminfo");
+    std::string key;
+    uint64_t kibibytes = 0;
+    std::string unit;
+    while (file >> key >> kibibytes) {
+        std::getline(file, unit);
+        if (key == "MemAvailable:") {
+            return kibibytes * 1024;
+        }
+    }
+    return std::nullopt;
+}
+
+// Backs every page of the buffer before the target is stopped, so the copy does
+// not take page faults of its own during the pause. Fails rather than touching
+// the pages by hand when the kernel reports it is out of memory, which would
+// end in an OOM kill instead.
+bool prefault(uint8_t *buffer, size_t size, std::string &error) {
+    ::madvise(buffer, size, MADV_HUGEPAGE);
+#ifdef MADV_POPULATE_WRITE
+    if (::madvise(buffer, size, MADV_POPULATE_WRITE) == 0) {
+        return true;
+    }
+    // EINVAL: the kernel predates MADV_POPULATE_WRITE.
+    if (errno != EINVAL) {
+        error = "cannot fault in " + std::to_string(size >> 20) + " MiB for the copy: " + std::strerror(errno);
+        return false;
+    }
+#endif
+    const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < size; offset += pageSize) {
+        buffer[offset] = 0;
+    }
+    return true;
+}
+
+// Splits pieces into at most taskCount runs of consecutive pieces with about
+// equal byte counts, so each task is one batch. Fills starts with the first piece
+// of every run and pieces.size() last; it needs room for taskCount + 1 entries.
+void groupPieces(const std::vector<ReadRequest> &pieces, size_t taskCount, std::vector<size_t> &starts) {
+    size_t total = 0;
+    for (const auto &piece : pieces) {
+        total += piece.size;
+    }
+    const size_t taskBytes = std::max<size_t>(copyPieceSize, total / std::max<size_t>(taskCount, 1) + 1);
+    starts.assign(1, 0);
+    size_t taskSize = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (taskSize >= taskBytes) {
+            starts.push_back(i);
+            taskSize = 0;
+        }
+        taskSize += pieces[i].size;
+    }
+    starts.push_back(pieces.size());
+}
+
+} // namespace
+
+bool parseFreezeMethod(const std::string &text, FreezeMethod &out) {
+    if (text == "ptrace") {
+        out = FreezeMethod::Ptrace;
+    } else if (text == "signal") {
+        out = FreezeMethod::Signal;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *freezeMethodName(FreezeMethod method) {
+    return method == FreezeMethod::Ptrace ? "ptrace" : "signal";
+}
+
+bool ProcessFreezer::stop(std::string &error) {
+    return method_ == FreezeMethod::Ptrace ? seizeAll(error) : signalStop(error);
+}
+
+void ProcessFreezer::resume() {
+    if (method_ == FreezeMethod::Ptrace) {
+        for (const auto &thread : seized_) {
+            if (thread.attached) {
+                ::ptrace(PTRACE_DETACH, thread.tid, nullptr, reinterpret_cast<void *>(static_cast<intptr_t>(thread.signal)));
+            }
+        }
+        seized_.clear();
+    } else if (signalled_) {
+        ::kill(pid_, SIGCONT);
+        signalled_ = false;
+    }
+}
+
+bool ProcessFreezer::isSeized(pid_t tid) const {
+    return std::any_of(seized_.begin(), seized_.end(), [tid](const SeizedThread &thread) { return thread.tid == tid; });
+}
+
+bool ProcessFreezer::seizeAll(std::string &error) {
+    for (;;) {
+        size_t first = seized_.size();
+        for (;;) {
+            bool added = false;
+            for (pid_t tid : listThreads(pid_)) {
+                if (isSeized(tid)) {
+                    continue;
+                }
+                if (::ptrace(PTRACE_SEIZE, tid, nullptr, nullptr) != 0) {
+                    if (errno == ESRCH) {
+                        continue;
+                    }
+                    error = "cannot seize thread " + std::to_string(tid) + ": " + std::strerror(errno);
+                    // Only stopped threads can be detached.
+                    for (; first < seized_.size(); ++first) {
+                        waitForStop(seized_[first]);
+                    }
+                    return false;
+                }
+                seized_.push_back({tid});
+                ::ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr);
+                added = true;
+            }
+            if (!added) {
+                break;
+            }
+        }
+        if (first == seized_.size()) {
+            break;
+        }
+        for (; first < seized_.size(); ++first) {
+            waitForStop(seized_[first]);
+        }
+    }
+    threadCount_ = static_cast<size_t>(
+        std::count_if(seized_.begin(), seized_.end(), [](const SeizedThread &thread) { return thread.attached; }));
+    if (threadCount_ == 0) {
+        error = "process " + std::to_string(pid_) + " has exited";
+        return false;
+    }
+    return true;
+}
+
+void ProcessFreezer::waitForStop(SeizedThread &thread) {
+    int status = 0;
+    pid_t result = 0;
+    do {
+        result = ::waitpid(thread.tid, &status, __WALL);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0 || WIFEXITED(status) || WIFSIGNALED(status)) {
+        thread.attached = false;
+        return;
+    }
+    // A stop to deliver a signal rather than our interrupt keeps the signal pending for the detach.
+    if (WIFSTOPPED(status) && (status >> 16) != PTRACE_EVENT_STOP) {
+        thread.signal = WSTOPSIG(status);
+    }
+}
+
+bool ProcessFreezer::signalStop(std::string &error) {
+    std::vector<pid_t> threads = listThreads(pid_);
+    if (threads.empty()) {
+        error = "process " + std::to_string(pid_) + " has exited";
+        return false;
+    }
+    // A target stopped by someone else stays stopped afterwards.
+    const auto allStopped = [&] {
+        return std::all_of(threads.begin(), threads.end(), [&](pid_t tid) { return isStoppedOrGone(threadState(pid_, tid)); });
+    };
+    threadCount_ = threads.size();
+    if (allStopped()) {
+        return true;
+    }
+    if (::kill(pid_, SIGSTOP) != 0) {
+        error = "cannot stop process " + std::to_string(pid_) + ": " + std::strerror(errno);
+        return false;
+    }
+    signalled_ = true;
+    const auto deadline = Clock::now() + signalStopTimeout;
+    while (!allStopped()) {
+        if (Clock::now() > deadline) {
+            error = "process " + std::to_string(pid_) + " did not stop";
+            return false;
+        }
+        std::this_thread::sleep_for(signalStopPoll);
+        threads = listThreads(pid_);
+    }
+    threadCount_ = threads.size();
+    return true;
+}
+
+std::unique_ptr<FrozenCopy> FrozenCopy::capture(const ProcessMemoryReader &reader, const std::vector<MemoryRegion> &regions,
+                                                FreezeMethod method, ThreadPool *pool, std::string &error) {
+    std::unique_ptr<FrozenCopy> copy(new FrozenCopy());
+    copy->pid_ = reader.pid();
+    copy->timing_.method = method;
+    size_t total = 0;
+    for (const auto &region : regions) {
+        if (region.size() == 0) {
+            continue;
+        }
+        copy->regions_.push_back(region);
+        copy->offsets_.push_back(total);
+        total += region.size();
+    }
+    if (total == 0) {
+        error = "no memory to copy";
+        return nullptr;
+    }
+
+    const std::optional<uint64_t> available = availableMemory();
+    if (available && total > *available) {
+        error = "the copy needs " + std::to_string(total >> 20) + " MiB but only " + std::to_string(*available >> 20) +
+                " MiB are available";
+        return nullptr;
+    }
+
+    const auto prepareStart = Clock::now();
+    void *mapping = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        error = "cannot allocate " + std::to_string(total >> 20) + " MiB for the copy: " + std::strerror(errno);
+        return nullptr;
+    }
+    copy->mapping_ = static_cast<uint8_t *>(mapping);
+    copy->mappingSize_ = total;
+    if (!prefault(copy->mapping_, total, error)) {
+        return nullptr;
+    }
+
+    // Untouched anonymous pages read as zeros, which the buffer already holds. The
+    // page map says which ones they are; it is read once the target is stopped.
+    const std::string pagemapPath = "/proc/" + std::to_string(copy->pid_) + "/pagemap";
+    const int pagemapFd = ::open(pagemapPath.c_str(), O_RDONLY | O_CLOEXEC);
+    std::vector<uint64_t> entries;
+    size_t largestRegion = 0;
+    for (const auto &region : copy->regions_) {
+        largestRegion = std::max<size_t>(largestRegion, region.size());
+    }
+    entries.reserve(largestRegion / PageMap::pageSize + 1);
+    // Nothing below allocates once the target is stopped, so every buffer is sized
+    // for the worst case here. Zero and non-zero pages can alternate, leaving one
+    // piece per page; a piece's spans and holes each number at most its pages + 1.
+    const size_t maxPieces = total / PageMap::pageSize + 2 * copy->regions_.size();
+    std::vector<ReadRequest> pieces;
+    pieces.reserve(maxPieces);
+    const size_t threadCount = pool != nullptr ? pool->threadCount() : 1;
+    const size_t taskCount = threadCount * tasksPerThread;
+    std::vector<size_t> taskStarts;
+    taskStarts.reserve(taskCount + 2);
+    std::vector<std::vector<ReadSpan>> taskSpans(taskCount + 1);
+    for (auto &spans : taskSpans) {
+        spans.reserve(copyPieceSize / PageMap::pageSize + 2);
+    }
+    std::vector<AddressRun> holes(total / PageMap::pageSize + 2 * maxPieces);
+    std::atomic<size_t> holeCount{0};
+    copy->timing_.prepareMilliseconds = millisecondsBetween(prepareStart, Clock::now());
+
+    ProcessFreezer freezer(reader.pid(), method);
+    const auto stopStart = Clock::now();
+    if (!freezer.stop(error)) {
+        if (pagemapFd >= 0) {
+            ::close(pagemapFd);
+        }
+        return nullptr;
+    }
+    const auto copyStart = Clock::now();
+    copy->timing_.zeroBytes = copy->planReads(pagemapFd, entries, pieces);
+    if (pagemapFd >= 0) {
+        ::close(pagemapFd);
+    }
+    groupPieces(pieces, taskCount, taskStarts);
+    const auto addHole = [&](uintptr_t start, uintptr_t end) {
+        holes[holeCount.fetch_add(1, std::memory_order_relaxed)] = {start, end};
+    };
+    ThreadPool::run(pool, taskStarts.size() - 1, [&](size_t task) {
+        ReadRequest *first = pieces.data() + taskStarts[task];
+        const size_t count = taskStarts[task + 1] - taskStarts[task];
+        if (reader.readBatch(first, count) == count) {
+            return;
+        }
+        std::vector<ReadSpan> &spans = taskSpans[task];
+        for (size_t i = 0; i < count; ++i) {
+            const ReadRequest &piece = first[i];
+            if (piece.succeeded) {
+                continue;
+            }
+            spans.clear();
+            reader.readAvailable(piece.address, piece.buffer, piece.size, spans);
+            size_t offset = 0;
+            for (const auto &span : spans) {
+                if (span.offset > offset) {
+                    addHole(piece.address + offset, piece.address + span.offset);
+                }
+                offset = span.offset + span.size;
+            }
+            if (offset < piece.size) {
+                addHole(piece.address + offset, piece.address + piece.size);
+            }
+        }
+    });
+    const auto copyEnd = Clock::now();
+    freezer.resume();
+    const auto resumed = Clock::now();
+
+    FreezeTiming &timing = copy->timing_;
+    timing.threads = freezer.threadCount();
+    timing.stopMilliseconds = millisecondsBetween(stopStart, copyStart);
+    timing.copyMilliseconds = millisecondsBetween(copyStart, copyEnd);
+    timing.pauseMilliseconds = millisecondsBetween(stopStart, resumed);
+    holes.resize(holeCount.load());
+    std::sort(holes.begin(), holes.end(), [](const AddressRun &lhs, const AddressRun &rhs) { return lhs.start < rhs.start; });
+    for (const auto &hole : holes) {
+        // Pieces never straddle regions, so adjacent holes only merge within one.
+        if (!copy->unreadable_.empty() && copy->unreadable_.back().end == hole.start) {
+            copy->unreadable_.back().end = hole.end;
+        } else {
+            copy->unreadable_.push_back(hole);
+        }
+        timing.unreadableBytes += hole.end - hole.start;
+    }
+    timing.bytes = total - timing.unreadableBytes - timing.zeroBytes;
+    return copy;
+}
+
+uint64_t FrozenCopy::planReads(int pagemapFd, std::vector<uint64_t> &entries, std::vector<ReadRequest> &pieces) const {
+    uint64_t zeroBytes = 0;
+    for (size_t index = 0; index < regions_.size(); ++index) {
+        const MemoryRegion &region = regions_[index];
+        uint8_t *base = mapping_ + offsets_[index];
+        const auto addPiece = [&](uintptr_t start, uintptr_t end) {
+            pieces.push_back({start, base + (start - region.start), static_cast<size_t>(end - start)});
+        };
+        const size_t pages = region.size() / PageMap::pageSize;
+        const bool pageAligned = region.start % PageMap::pageSize == 0 && region.size() % PageMap::pageSize == 0;
+        const bool usePageMap = pagemapFd >= 0 && pageAligned && PageMap::isAnonymous(region);
+        if (usePageMap) {
+            entries.resize(pages);
+        }
+        if (!usePageMap || !PageMap::readEntries(pagemapFd, region.start, pages, entries.data())) {
+            for (uintptr_t address = region.start; address < region.end; address += copyPieceSize) {
+                addPiece(address, std::min<uintptr_t>(address + copyPieceSize, region.end));
+            }
+            continue;
+        }
+        std::optional<uintptr_t> runStart;
+        for (size_t page = 0; page < pages; ++page) {
+            const uintptr_t address = region.start + page * PageMap::pageSize;
+            if (PageMap::classify(entries[page], true) == PageMap::PageState::Zero) {
+                if (runStart) {
+                    addPiece(*runStart, address);
+                    runStart.reset();
+                }
+                zeroBytes += PageMap::pageSize;
+                continue;
+            }
+            if (runStart && address - *runStart == copyPieceSize) {
+                addPiece(*runStart, address);
+                runStart.reset();
+            }
+            if (!runStart) {
+                runStart = address;
+            }
+        }
+        if (runStart) {
+            addPiece(*runStart, region.end);
+        }
+    }
+    return zeroBytes;
+}
+
+FrozenCopy::~FrozenCopy() {
+    if (mapping_ != nullptr) {
+        ::munmap(mapping_, mappingSize_);
+    }
+}
+
+const uint8_t *FrozenCopy::locate(uintptr_t address, size_t size) const {
+    const MemoryRegion *region = ProcessUtils::findRegionContaining(regions_, address);
+    if (region == nullptr || size == 0 || size > region->end - address) {
+        return nullptr;
+    }
+    if (!unreadable_.empty()) {
+        auto it = std::upper_bound(unreadable_.begin(), unreadable_.end(), address,
+                                   [](uintptr_t value, const AddressRun &run) { return value < run.end; });
+        if (it != unreadable_.end() && it->start < address + size) {
+            return nullptr;
+        }
+    }
+    const size_t index = static_cast<size_t>(region - regions_.data());
+    return mapping_ + offsets_[index] + (address - region->start);
+}
+
+const uint8_t *FrozenCopy::view(uintptr_t address, size_t size) const {
+    const uint8_t *data = locate(address, size);
+    if (data == nullptr) {
+        return nullptr;
+    }
+    counters_.mappedViews.fetch_add(1, std::memory_order_relaxed);
+    counters_.bytesRequested.fetch_add(size, std::memory_order_relaxed);
+    counters_.bytesRead.fetch_add(size, std::memory_order_relaxed);
+    return data;
+}
+
+bool FrozenCopy::read(uintptr_t address, void *buffer, size_t size) const {
+    auto *out = static_cast<uint8_t *>(buffer);
+    while (size > 0) {
+        const MemoryRegion *region = ProcessUtils::findRegionContaining(regions_, address);
+        if (region == nullptr) {
+            break;
+        }
+        const size_t bytes = std::min<size_t>(size, region->end - address);
+        const uint8_t *data = locate(address, bytes);
+        if (data == nullptr) {
+            break;
+        }
+        std::memcpy(out, data, bytes);
+        countRead(counters_.mappedCopies, bytes, static_cast<ssize_t>(bytes));
+        address += bytes;
+        out += bytes;
+        size -= bytes;
+    }
+    if (size != 0) {
+        counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+size_t FrozenCopy::readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const {
+    auto *out = static_cast<uint8_t *>(buffer);
+    if (const uint8_t *data = locate(address, size)) {
+        std::memcpy(out, data, size);
+        countRead(counters_.mappedCopies, size, static_cast<ssize_t>(size));
+        spans.push_back({0, size});
+        return size;
+    }
+    const size_t firstSpan = spans.size();
+    size_t copied = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        const uintptr_t at = address + offset;
+        const MemoryRegion *region = ProcessUtils::findRegionContaining(regions_, at);
+        if (region == nullptr) {
+            auto next = std::upper_bound(regions_.begin(), regions_.end(), at,
+                                         [](uintptr_t value, const MemoryRegion &entry) { return value < entry.start; });
+            offset = next == regions_.end() ? size : std::min<size_t>(size, next->start - address);
+            continue;
+        }
+        auto hole = std::upper_bound(unreadable_.begin(), unreadable_.end(), at,
+                                     [](uintptr_t value, const AddressRun &run) { return value < run.end; });
+        if (hole != unreadable_.end() && hole->start <= at) {
+            offset = std::min<size_t>(size, hole->end - address);
+            continue;
+        }
+        uintptr_t stop = std::min<uintptr_t>(region->end, address + size);
+        if (hole != unreadable_.end()) {
+            stop = std::min(stop, hole->start);
+        }
+        const size_t bytes = stop - at;
+        const size_t index = static_cast<size_t>(region - regions_.data());
+        std::memcpy(out + offset, mapping_ + offsets_[index] + (at - region->start), bytes);
+        if (spans.size() > firstSpan && spans.back().offset + spans.back().size == offset) {
+            spans.back().size += bytes;
+        } else {
+            spans.push_back({offset, bytes});
+        }
+        copied += bytes;
+        offset += bytes;
+    }
+    countRead(counters_.mappedCopies, size, static_cast<ssize_t>(copied));
+    return copied;
+}
+
+std::string FrozenCopy::describe() const {
+    return "frozen copy of pid " + std::to_string(pid_);
+}
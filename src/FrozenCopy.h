@@ -0,0 +1,123 @@
+#pragma once
+
+#include "MemorySource.h"
+#include "ProcessMemoryReader.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// How the target is held still while its memory is copied.
+enum class FreezeMethod {
+    // PTRACE_SEIZE and PTRACE_INTERRUPT on every thread. Invisible to the target's
+    // parent, but fails while a debugger is attached.
+    Ptrace,
+    // SIGSTOP, then SIGCONT once copied. Works under a debugger; the parent sees a
+    // job stop and the target's SIGCONT handler runs.
+    Signal,
+};
+
+bool parseFreezeMethod(const std::string &text, FreezeMethod &out);
+const char *freezeMethodName(FreezeMethod method);
+
+// Stops every thread of a process and resumes them when destroyed, so an error
+// halfway through never leaves the target stopped.
+class ProcessFreezer {
+public:
+    ProcessFreezer(pid_t pid, FreezeMethod method) : pid_(pid), method_(method) {}
+    ~ProcessFreezer() { resume(); }
+
+    ProcessFreezer(const ProcessFreezer &) = delete;
+    ProcessFreezer &operator=(const ProcessFreezer &) = delete;
+
+    bool stop(std::string &error);
+    void resume();
+    size_t threadCount() const { return threadCount_; }
+
+private:
+    struct SeizedThread {
+        pid_t tid{};
+        bool attached{true};
+        // A signal the thread stopped to receive, handed back on detach.
+        int signal{};
+    };
+
+    bool isSeized(pid_t tid) const;
+    // Threads created while others are being seized show up on the next listing;
+    // once every listed thread is stopped none can start another.
+    bool seizeAll(std::string &error);
+    static void waitForStop(SeizedThread &thread);
+    bool signalStop(std::string &error);
+
+    pid_t pid_;
+    FreezeMethod method_;
+    std::vector<SeizedThread> seized_;
+    bool signalled_{false};
+    size_t threadCount_{};
+};
+
+struct FreezeTiming {
+    FreezeMethod method{FreezeMethod::Ptrace};
+    size_t threads{};
+    uint64_t bytes{};
+    uint64_t unreadableBytes{};
+    // Untouched anonymous memory, which reads as zeros and is not copied.
+    uint64_t zeroBytes{};
+    // Allocating and faulting in the copy buffers, before the target is stopped.
+    double prepareMilliseconds{};
+    // From the stop request until every thread was stopped.
+    double stopMilliseconds{};
+    double copyMilliseconds{};
+    // From the stop request until the target was resumed.
+    double pauseMilliseconds{};
+};
+
+// A point-in-time copy of regions of a live process. The target is stopped, the
+// regions are copied with batched process_vm_readv calls spread over the thread
+// pool into buffers allocated and faulted in beforehand, and the target resumes
+// right away; scans of the copy then see one consistent state. Reads are served
+// from the copy as views, and pid() is 0 like any offline source.
+class FrozenCopy : public MemorySource {
+public:
+    // regions must be readable and sorted by address.
+    static std::unique_ptr<FrozenCopy> capture(const ProcessMemoryReader &reader, const std::vector<MemoryRegion> &regions,
+                                               FreezeMethod method, ThreadPool *pool, std::string &error);
+    ~FrozenCopy() override;
+
+    bool read(uintptr_t address, void *buffer, size_t size) const override;
+    const uint8_t *view(uintptr_t address, size_t size) const override;
+    size_t readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const override;
+    std::vector<MemoryRegion> regions() const override { return regions_; }
+    std::string describe() const override;
+
+    const FreezeTiming &timing() const { return timing_; }
+
+private:
+    struct AddressRun {
+        uintptr_t start{};
+        uintptr_t end{};
+    };
+
+    FrozenCopy() = default;
+    // Splits the regions into the reads capture issues, at most 1 MiB each, leaving
+    // out the untouched anonymous pages the page map reports. Returns the bytes
+    // left out.
+    uint64_t planReads(int pagemapFd, std::vector<uint64_t> &entries, std::vector<ReadRequest> &pieces) const;
+    // The copy of the size bytes at address when they lie in one region and were
+    // all readable, null otherwise.
+    const uint8_t *locate(uintptr_t address, size_t size) const;
+
+    pid_t pid_{};
+    uint8_t *mapping_{};
+    size_t mappingSize_{};
+    std::vector<MemoryRegion> regions_;
+    // Offset of each region's copy in mapping_, parallel to regions_.
+    std::vector<size_t> offsets_;
+    // Parts of the regions that could not be read, sorted and disjoint.
+    std::vector<AddressRun> unreadable_;
+    FreezeTiming timing_;
+};
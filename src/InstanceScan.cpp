@@ -0,0 +1,229 @@
+#include "InstanceScan.h"
+
+#include "ElfModule.h"
+#include "ProcessMemoryReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <map>
+
+namespace {
+
+// Read-ahead buffers a scan thread keeps in flight, by the scanner's chunk sizes.
+constexpr size_t scanWorkingSetPerThread = 1u << 20;
+
+// What a scan of scopeBytes holds at its peak: the frozen copy, the read buffers
+// and the kept candidates.
+size_t estimateMemory(const InstanceScanSettings &settings, size_t scopeBytes, size_t threads) {
+    size_t bytes = threads * scanWorkingSetPerThread;
+    if (settings.freeze) {
+        bytes += scopeBytes;
+    }
+    if (settings.signatures.empty()) {
+        bytes += settings.maxCandidates * sizeof(CandidateOffset);
+    }
+    return bytes;
+}
+
+// Runs after the scope is known, holding its share of the budget for the scan.
+void scanScope(InstanceResult &result, OffsetScanner &scanner, const ProcessMemoryReader &reader,
+               const InstanceScanSettings &settings, const SignatureMatcher *matcher, MemoryBudget &budget) {
+    const size_t reserved = estimateMemory(settings, result.scopeBytes, scanner.threadCount());
+    budget.acquire(reserved);
+    if (settings.freeze) {
+        std::string error;
+        auto frozen = FrozenCopy::capture(reader, scanner.snapshotRegions(), *settings.freeze, scanner.threadPool(), error);
+        if (!frozen) {
+            budget.release(reserved);
+            result.error = error;
+            return;
+        }
+        result.freeze = frozen->timing();
+        scanner.setSource(std::move(frozen));
+    }
+    if (matcher != nullptr) {
+        result.signatures = findSignatures(scanner, *matcher);
+    } else {
+        const CandidateSet candidates = scanner.findCandidateSet(settings.primary, settings.tolerance);
+        result.candidateCount = candidates.size();
+        result.candidates = scanner.candidatesFromSet(candidates, settings.maxCandidates);
+    }
+    // Drops the frozen copy before its bytes go back to the budget.
+    scanner.setSource(nullptr);
+    budget.release(reserved);
+}
+
+InstanceResult scanInstance(const ProcessInfo &process, const InstanceScanSettings &settings,
+                            const std::shared_ptr<ThreadPool> &pool, const SignatureMatcher *matcher, MemoryBudget &budget) {
+    const auto start = std::chrono::steady_clock::now();
+    InstanceResult result;
+    result.process = process;
+    auto reader = std::make_shared<ProcessMemoryReader>(process.pid);
+    if (!reader->isValid()) {
+        result.error = "cannot open the process memory";
+        return result;
+    }
+    const std::vector<MemoryRegion> mappings = ProcessUtils::findModuleRegions(*reader, settings.moduleName);
+    std::vector<MemoryRegion> scope = ProcessUtils::filterRegions(mappings, settings.regionFilter);
+    if (scope.empty()) {
+        result.error = "module '" + settings.moduleName + "' not found";
+        return result;
+    }
+    if (settings.dataSegments) {
+        std::string error;
+        const auto elf = ElfModule::forModule(process.pid, mappings, *reader, error);
+        if (!elf) {
+            result.error = "cannot read the ELF headers: " + error;
+            return result;
+        }
+        scope = ProcessUtils::filterRegions(elf->dataRegions(ProcessUtils::listMemoryRegions(*reader)), settings.regionFilter);
+        if (scope.empty()) {
+            result.error = "module has no writable data mappings";
+            return result;
+        }
+    }
+    for (const auto &region : scope) {
+        result.scopeBytes += region.size();
+    }
+
+    OffsetScanner scanner(reader, scope);
+    // Offsets count from the module's first mapping whatever the scope, so they
+    // compare across instances.
+    result.moduleBase = mappings.front().start;
+    scanner.setModuleBase(result.moduleBase);
+    scanner.setThreadPool(pool);
+    scanner.setKernel(settings.kernel);
+    scanner.setValueType(settings.valueType, settings.fixedPointScale);
+    scanScope(result, scanner, *reader, settings, matcher, budget);
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+} // namespace
+
+void MemoryBudget::acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (limit_ != 0) {
+        released_.wait(lock, [&] { return held_ == 0 || held_ + bytes <= limit_; });
+    }
+    held_ += bytes;
+    peak_ = std::max(peak_, held_);
+}
+
+void MemoryBudget::release(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        held_ -= bytes;
+    }
+    released_.notify_all();
+}
+
+size_t MemoryBudget::peak() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return peak_;
+}
+
+std::vector<InstanceResult> scanInstances(const std::vector<ProcessInfo> &processes, const InstanceScanSettings &settings,
+                                          const std::shared_ptr<ThreadPool> &pool,
+                                          const std::function<void(const InstanceResult &)> &done, size_t *peakBudgetBytes) {
+    std::optional<SignatureMatcher> matcher;
+    if (!settings.signatures.empty()) {
+        matcher.emplace(settings.signatures, settings.kernel);
+    }
+    const SignatureMatcher *matcherPointer = matcher ? &*matcher : nullptr;
+    MemoryBudget budget(settings.memoryBudget);
+    std::vector<InstanceResult> results(processes.size());
+    std::mutex doneMutex;
+    const auto finish = [&](size_t index, InstanceResult result) {
+        results[index] = std::move(result);
+        if (done) {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            done(results[index]);
+        }
+    };
+
+    const size_t threads = pool ? pool->threadCount() : 1;
+    if (pool && processes.size() >= threads) {
+        // Enough instances to keep every worker busy: the instances themselves are
+        // the tasks, and each one scans on its worker's thread.
+        pool->parallelFor(processes.size(), [&](size_t index) {
+            finish(index, scanInstance(processes[index], settings, nullptr, matcherPointer, budget));
+        });
+    } else {
+        for (size_t index = 0; index < processes.size(); ++index) {
+            finish(index, scanInstance(processes[index], settings, pool, matcherPointer, budget));
+        }
+    }
+    if (peakBudgetBytes != nullptr) {
+        *peakBudgetBytes = budget.peak();
+    }
+    return results;
+}
+
+size_t truncatedInstances(const std::vector<InstanceResult> &results, size_t maxCandidates) {
+    return static_cast<size_t>(std::count_if(results.begin(), results.end(), [&](const InstanceResult &result) {
+        return result.succeeded() && result.candidateCount > maxCandidates;
+    }));
+}
+
+std::vector<OffsetAgreement> agreeingOffsets(const std::vector<InstanceResult> &results, size_t maxCandidates) {
+    std::vector<ptrdiff_t> common;
+    bool first = true;
+    for (const auto &result : results) {
+        if (!result.succeeded()) {
+            continue;
+        }
+        std::vector<ptrdiff_t> offsets;
+        offsets.reserve(result.candidates.size());
+        for (const auto &candidate : result.candidates) {
+            offsets.push_back(candidate.offsetFromModule);
+        }
+        std::sort(offsets.begin(), offsets.end());
+        if (first) {
+            common = std::move(offsets);
+            first = false;
+            continue;
+        }
+        std::vector<ptrdiff_t> kept;
+        std::set_intersection(common.begin(), common.end(), offsets.begin(), offsets.end(), std::back_inserter(kept));
+        common = std::move(kept);
+    }
+    const size_t truncated = truncatedInstances(results, maxCandidates);
+    std::vector<OffsetAgreement> agreements;
+    agreements.reserve(common.size());
+    for (const ptrdiff_t offset : common) {
+        agreements.push_back({offset, truncated});
+    }
+    return agreements;
+}
+
+std::vector<SignatureAgreement> agreeingSignatures(const std::vector<InstanceResult> &results,
+                                                   const std::vector<Signature> &signatures) {
+    std::vector<SignatureAgreement> agreements(signatures.size());
+    for (uint32_t index = 0; index < signatures.size(); ++index) {
+        SignatureAgreement &agreement = agreements[index];
+        agreement.signature = index;
+        std::map<uint64_t, size_t> values;
+        size_t scanned = 0;
+        for (const auto &result : results) {
+            if (!result.succeeded() || index >= result.signatures.size()) {
+                continue;
+            }
+            ++scanned;
+            const SignatureResult &found = result.signatures[index];
+            if (found.matches.size() != 1 || !found.value) {
+                ++agreement.unresolved;
+                continue;
+            }
+            const uint64_t value = signatures[index].yieldsAddress() ? *found.value - result.moduleBase : *found.value;
+            ++values[value];
+        }
+        agreement.distinctValues = values.size();
+        agreement.agreed = scanned != 0 && agreement.unresolved == 0 && values.size() == 1;
+        if (values.size() == 1) {
+            agreement.value = values.begin()->first;
+        }
+    }
+    return agreements;
+}
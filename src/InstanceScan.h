@@ -0,0 +1,116 @@
+#pragma once
+
+#include "FrozenCopy.h"
+#include "OffsetScanner.h"
+#include "ProcessUtils.h"
+#include "SignatureScanner.h"
+#include "ThreadPool.h"
+#include "Vector3.h"
+#include "VectorMatchKernels.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// What to look for in every instance, and how. Either signatures are resolved or
+// primary is searched for; offsets are relative to the module's lowest mapping
+// so they compare across instances despite ASLR.
+struct InstanceScanSettings {
+    std::string moduleName;
+    // Scan only the module's writable ELF segments.
+    bool dataSegments{false};
+    RegionFilter regionFilter;
+    std::vector<Signature> signatures;
+    Vector3 primary{};
+    float tolerance{0.01f};
+    VectorKernels::KernelKind kernel{VectorKernels::bestSupported()};
+    VectorKernels::ValueType valueType{VectorKernels::ValueType::Vec3f};
+    double fixedPointScale{1.0};
+    std::optional<FreezeMethod> freeze;
+    // Candidates kept per instance for the agreement summary.
+    size_t maxCandidates{1u << 16};
+    // Bytes the instances being scanned at once may hold, by estimate; 0 for no
+    // limit. An instance larger than the budget still runs, alone.
+    size_t memoryBudget{0};
+};
+
+struct InstanceResult {
+    ProcessInfo process;
+    // Why the instance could not be scanned; empty when it was.
+    std::string error;
+    uintptr_t moduleBase{};
+    size_t scopeBytes{};
+    size_t candidateCount{};
+    // The first maxCandidates candidates, in address order.
+    std::vector<CandidateOffset> candidates;
+    std::vector<SignatureResult> signatures;
+    std::optional<FreezeTiming> freeze;
+    double milliseconds{};
+
+    bool succeeded() const { return error.empty(); }
+};
+
+// A module offset found in every scanned instance.
+struct OffsetAgreement {
+    ptrdiff_t moduleOffset{};
+    // Instances whose candidate list was cut at maxCandidates, which may hide
+    // offsets that would have agreed.
+    size_t truncatedInstances{};
+};
+
+// How one signature resolved across the scanned instances: agreed when every
+// instance found exactly one match and the same module offset (or value).
+struct SignatureAgreement {
+    uint32_t signature{};
+    bool agreed{false};
+    std::optional<uint64_t> value;
+    // Instances with no match, more than one, or an unreadable operand.
+    size_t unresolved{};
+    // Distinct values among the instances that resolved it.
+    size_t distinctValues{};
+};
+
+// Admits scans while the bytes they hold stay within a limit, blocking the rest
+// until enough is released. A request larger than the limit is admitted once
+// nothing else is held.
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit) : limit_(limit) {}
+
+    void acquire(size_t bytes);
+    void release(size_t bytes);
+    size_t peak() const;
+
+private:
+    size_t limit_;
+    size_t held_{};
+    size_t peak_{};
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+};
+
+// Scans every process in processes and returns one result per process, in the
+// same order. With at least as many processes as pool threads each thread scans
+// whole instances single-threaded; with fewer they are scanned one after another
+// on the whole pool. done, when set, is called as each instance finishes (from
+// the thread that scanned it, one call at a time).
+std::vector<InstanceResult> scanInstances(const std::vector<ProcessInfo> &processes, const InstanceScanSettings &settings,
+                                          const std::shared_ptr<ThreadPool> &pool,
+                                          const std::function<void(const InstanceResult &)> &done = {},
+                                          size_t *peakBudgetBytes = nullptr);
+
+// Module offsets present in every successful result, ascending.
+std::vector<OffsetAgreement> agreeingOffsets(const std::vector<InstanceResult> &results, size_t maxCandidates);
+// Successful results whose candidate list was cut at maxCandidates. When nonzero,
+// agreeing offsets may be missing, including when none were found.
+size_t truncatedInstances(const std::vector<InstanceResult> &results, size_t maxCandidates);
+// One entry per signature, comparing module offsets for address signatures and
+// raw values for the others.
+std::vector<SignatureAgreement> agreeingSignatures(const std::vector<InstanceResult> &results,
+                                                   const std::vector<Signature> &signatures);
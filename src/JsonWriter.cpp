@@ -0,0 +1,120 @@
+#include "JsonWriter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+void JsonWriter::separate() {
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    if (!hasElements_.empty()) {
+        if (hasElements_.back()) {
+            out_ << ',';
+        }
+        hasElements_.back() = true;
+    }
+}
+
+void JsonWriter::open(char bracket) {
+    separate();
+    out_ << bracket;
+    hasElements_.push_back(false);
+}
+
+void JsonWriter::close(char bracket) {
+    hasElements_.pop_back();
+    out_ << bracket;
+    if (hasElements_.empty()) {
+        out_ << '\n';
+    }
+}
+
+JsonWriter &JsonWriter::beginObject() {
+    open('{');
+    return *this;
+}
+
+JsonWriter &JsonWriter::endObject() {
+    close('}');
+    return *this;
+}
+
+JsonWriter &JsonWriter::beginArray() {
+    open('[');
+    return *this;
+}
+
+JsonWriter &JsonWriter::endArray() {
+    close(']');
+    return *this;
+}
+
+JsonWriter &JsonWriter::key(const std::string &name) {
+    value(name);
+    out_ << ':';
+    afterKey_ = true;
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(const std::string &text) {
+    separate();
+    out_ << '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            out_ << "\\\"";
+            break;
+        case '\\':
+            out_ << "\\\\";
+            break;
+        case '\n':
+            out_ << "\\n";
+            break;
+        case '\t':
+            out_ << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out_ << escaped;
+            } else {
+                out_ << c;
+            }
+        }
+    }
+    out_ << '"';
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(bool flag) {
+    separate();
+    out_ << (flag ? "true" : "false");
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(double number) {
+    if (!std::isfinite(number)) {
+        return null();
+    }
+    separate();
+    std::ostringstream oss;
+    oss << std::setprecision(9) << number;
+    out_ << oss.str();
+    return *this;
+}
+
+JsonWriter &JsonWriter::null() {
+    separate();
+    out_ << "null";
+    return *this;
+}
+
+JsonWriter &JsonWriter::address(uintptr_t address) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << address;
+    return value(oss.str());
+}
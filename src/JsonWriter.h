@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Minimal streaming JSON writer: commas and string escaping are handled here,
+// nesting is the caller's job. Output is compact, one document per line.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream &out) : out_(out) {}
+
+    JsonWriter &beginObject();
+    JsonWriter &endObject();
+    JsonWriter &beginArray();
+    JsonWriter &endArray();
+    JsonWriter &key(const std::string &name);
+
+    JsonWriter &value(const std::string &text);
+    JsonWriter &value(const char *text) { return value(std::string(text)); }
+    JsonWriter &value(bool flag);
+    // Non-finite numbers are written as null.
+    JsonWriter &value(double number);
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    JsonWriter &value(T number) {
+        separate();
+        if constexpr (std::is_signed_v<T>) {
+            out_ << static_cast<int64_t>(number);
+        } else {
+            out_ << static_cast<uint64_t>(number);
+        }
+        return *this;
+    }
+    JsonWriter &null();
+
+    // Hex strings keep 64-bit addresses exact for consumers that parse numbers as doubles.
+    JsonWriter &address(uintptr_t address);
+
+private:
+    void separate();
+    void open(char bracket);
+    void close(char bracket);
+
+    std::ostream &out_;
+    std::vector<bool> hasElements_;
+    bool afterKey_{false};
+};
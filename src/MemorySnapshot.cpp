@@ -0,0 +1,650 @@
+#include "MemorySnapshot.h"
+
+#include "Vector3.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef OFFSET_SCANNER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr char snapshotMagic[8] = {'O', 'S', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr uint32_t snapshotVersion = 1;
+// Written only for compressed snapshots, which older readers would misread.
+constexpr uint32_t compressedSnapshotVersion = 2;
+constexpr uint32_t flagZeroPagesElided = 1u << 0;
+constexpr uint32_t flagPagesCompressed = 1u << 1;
+constexpr uint64_t zeroPage = 0;
+constexpr uint64_t unreadablePage = UINT64_MAX;
+// A compressed page's entry is its file offset with this bit set and the
+// compressed length above compressedLengthShift; 48 bits of offset cover any
+// file that can be mapped.
+constexpr uint64_t compressedPageBit = 1ull << 63;
+constexpr unsigned compressedLengthShift = 48;
+constexpr uint64_t storedOffsetMask = (1ull << compressedLengthShift) - 1;
+
+std::atomic<uint64_t> nextSnapshotId{1};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t regionCount;
+    uint64_t regionTableOffset;
+    uint64_t stringTableOffset;
+    uint64_t pageTableOffset;
+    uint64_t pageCount;
+    uint64_t dataOffset;
+};
+
+struct FileRegion {
+    uint64_t start;
+    uint64_t end;
+    char permissions[8];
+    uint64_t pathOffset;
+    uint64_t pathLength;
+};
+
+uint64_t pagesIn(const MemoryRegion &region) {
+    return (region.size() + MemorySnapshot::pageSize - 1) / MemorySnapshot::pageSize;
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool writeAll(int fd, const void *data, size_t size, uint64_t offset) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t written = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool isZeroPage(const uint8_t *data, size_t size) {
+    uint64_t accumulator = 0;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        accumulator |= word;
+    }
+    for (; i < size; ++i) {
+        accumulator |= data[i];
+    }
+    return accumulator == 0;
+}
+
+bool isCompressedEntry(uint64_t entry) {
+    return entry != unreadablePage && (entry & compressedPageBit) != 0;
+}
+
+size_t compressedLength(uint64_t entry) {
+    return static_cast<size_t>((entry & ~compressedPageBit) >> compressedLengthShift);
+}
+
+// True when the bytes backing [pageOffset, pageOffset + bytes) of the page lie
+// inside a file of fileSize bytes.
+bool storedInFile(uint64_t entry, size_t pageOffset, size_t bytes, size_t fileSize) {
+    if (entry == unreadablePage) {
+        return false;
+    }
+    if (isCompressedEntry(entry)) {
+        return (entry & storedOffsetMask) + compressedLength(entry) <= fileSize;
+    }
+    return entry + pageOffset + bytes <= fileSize;
+}
+
+// Compresses one page (zero padded when size is short) into out and returns the
+// compressed length, or 0 when compression would not make it smaller.
+size_t compressPage(const uint8_t *data, size_t size, std::vector<uint8_t> &out) {
+#ifdef OFFSET_SCANNER_HAVE_ZLIB
+    uint8_t padded[MemorySnapshot::pageSize];
+    if (size < MemorySnapshot::pageSize) {
+        std::memcpy(padded, data, size);
+        std::memset(padded + size, 0, MemorySnapshot::pageSize - size);
+        data = padded;
+    }
+    // One deflate state per thread, reset per page: setting it up is far more
+    // expensive than compressing 4 KiB, and a page-sized window is all it needs.
+    struct Deflater {
+        z_stream stream{};
+        bool ready{false};
+        Deflater() { ready = deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 12, 8, Z_DEFAULT_STRATEGY) == Z_OK; }
+        ~Deflater() {
+            if (ready) {
+                deflateEnd(&stream);
+            }
+        }
+    };
+    thread_local Deflater deflater;
+    if (!deflater.ready || deflateReset(&deflater.stream) != Z_OK) {
+        return 0;
+    }
+    out.resize(MemorySnapshot::pageSize);
+    deflater.stream.next_in = const_cast<Bytef *>(data);
+    deflater.stream.avail_in = MemorySnapshot::pageSize;
+    deflater.stream.next_out = out.data();
+    deflater.stream.avail_out = static_cast<uInt>(out.size() - 1);
+    // Output that does not fit in less than a page is not worth storing compressed.
+    if (deflate(&deflater.stream, Z_FINISH) != Z_STREAM_END) {
+        return 0;
+    }
+    return static_cast<size_t>(deflater.stream.total_out);
+#else
+    (void)data;
+    (void)size;
+    (void)out;
+    return 0;
+#endif
+}
+
+std::vector<uint64_t> firstPages(const std::vector<MemoryRegion> &regions) {
+    std::vector<uint64_t> first;
+    first.reserve(regions.size() + 1);
+    uint64_t page = 0;
+    for (const auto &region : regions) {
+        first.push_back(page);
+        page += pagesIn(region);
+    }
+    first.push_back(page);
+    return first;
+}
+
+bool locateRegion(const std::vector<MemoryRegion> &regions, uintptr_t address, size_t &regionIndex) {
+    const MemoryRegion *region = ProcessUtils::findRegionContaining(regions, address);
+    if (region == nullptr) {
+        return false;
+    }
+    regionIndex = static_cast<size_t>(region - regions.data());
+    return true;
+}
+
+} // namespace
+
+bool SnapshotComparison::matches(const uint8_t *previous, const uint8_t *current) const {
+    const size_t components = kind == SnapshotValueKind::Float ? 1 : 3;
+    float before[3] = {};
+    float after[3] = {};
+    std::memcpy(before, previous, components * sizeof(float));
+    std::memcpy(after, current, components * sizeof(float));
+    bool unchanged = true;
+    float distanceSquared = 0.0f;
+    for (size_t i = 0; i < components; ++i) {
+        unchanged = unchanged && approximatelyEqual(after[i], before[i], tolerance);
+        distanceSquared += (after[i] - before[i]) * (after[i] - before[i]);
+    }
+    switch (change) {
+    case ChangeKind::Unchanged:
+        return unchanged;
+    case ChangeKind::Changed:
+        return !unchanged;
+    case ChangeKind::Increased:
+    case ChangeKind::Decreased: {
+        const float difference = change == ChangeKind::Increased ? after[0] - before[0] : before[0] - after[0];
+        return hasDelta ? approximatelyEqual(difference, delta, tolerance) : difference > tolerance;
+    }
+    case ChangeKind::Moved:
+        return approximatelyEqual(std::sqrt(distanceSquared), delta, tolerance);
+    }
+    return false;
+}
+
+bool parseChangeKind(const std::string &text, ChangeKind &out) {
+    static const std::pair<const char *, ChangeKind> names[] = {
+        {"changed", ChangeKind::Changed},     {"unchanged", ChangeKind::Unchanged}, {"increased", ChangeKind::Increased},
+        {"decreased", ChangeKind::Decreased}, {"moved", ChangeKind::Moved},
+    };
+    for (const auto &entry : names) {
+        if (text == entry.first) {
+            out = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseSnapshotValueKind(const std::string &text, SnapshotValueKind &out) {
+    if (text == "float") {
+        out = SnapshotValueKind::Float;
+        return true;
+    }
+    if (text == "vector3") {
+        out = SnapshotValueKind::Vector3;
+        return true;
+    }
+    return false;
+}
+
+std::unique_ptr<MemorySnapshot::Writer> MemorySnapshot::Writer::create(const std::string &path,
+                                                                       const std::vector<MemoryRegion> &regions,
+                                                                       SnapshotPageStorage storage, std::string &error) {
+    if (storage == SnapshotPageStorage::Compressed && !compressionAvailable()) {
+        error = "compressed snapshots need zlib, which this build does not have";
+        return nullptr;
+    }
+    std::unique_ptr<Writer> writer(new Writer());
+    if (path.empty()) {
+        const char *tmpdir = std::getenv("TMPDIR");
+        std::string pattern = std::string(tmpdir != nullptr && *tmpdir != '\0' ? tmpdir : "/tmp") + "/offset_scanner_XXXXXX";
+        writer->fd_ = ::mkstemp(pattern.data());
+        if (writer->fd_ >= 0) {
+            ::unlink(pattern.c_str());
+        }
+    } else {
+        writer->path_ = path;
+        writer->fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (writer->fd_ < 0) {
+        error = "cannot create snapshot file " + (path.empty() ? std::string("in temporary directory") : path) + ": " +
+                std::strerror(errno);
+        return nullptr;
+    }
+
+    writer->storage_ = storage;
+    writer->regions_ = regions;
+    writer->regionFirstPage_ = firstPages(regions);
+    const uint64_t pageCount = writer->regionFirstPage_.back();
+
+    uint64_t offset = sizeof(FileHeader) + regions.size() * sizeof(FileRegion);
+    for (const auto &region : regions) {
+        offset += region.pathname.size();
+    }
+    offset = alignUp(offset, sizeof(uint64_t)) + pageCount * sizeof(uint64_t);
+    writer->dataStart_ = alignUp(offset, pageSize);
+    writer->nextDataOffset_.store(writer->dataStart_);
+
+    writer->pageTable_.assign(pageCount, unreadablePage);
+    if (storage == SnapshotPageStorage::Full) {
+        if (::ftruncate(writer->fd_, static_cast<off_t>(writer->dataStart_ + pageCount * pageSize)) != 0) {
+            error = "cannot size snapshot file: " + std::string(std::strerror(errno));
+            return nullptr;
+        }
+    }
+    return writer;
+}
+
+bool MemorySnapshot::Writer::compressionAvailable() {
+#ifdef OFFSET_SCANNER_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+MemorySnapshot::Writer::~Writer() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool MemorySnapshot::Writer::locate(uintptr_t address, size_t &pageIndex) const {
+    size_t regionIndex = 0;
+    if (!locateRegion(regions_, address, regionIndex)) {
+        return false;
+    }
+    pageIndex = regionFirstPage_[regionIndex] + (address - regions_[regionIndex].start) / pageSize;
+    return true;
+}
+
+void MemorySnapshot::Writer::writePages(uintptr_t address, const uint8_t *data, size_t size) {
+    size_t firstPage = 0;
+    if (size == 0 || !locate(address, firstPage)) {
+        return;
+    }
+    if (storage_ == SnapshotPageStorage::Full) {
+        // Without elision pages sit at fixed offsets; the file was pre-sized, so a
+        // partial last page is already zero padded.
+        const uint64_t offset = dataStart_ + firstPage * pageSize;
+        if (!writeAll(fd_, data, size, offset)) {
+            failed_.store(true);
+        }
+        const size_t pages = static_cast<size_t>(alignUp(size, pageSize) / pageSize);
+        for (size_t i = 0; i < pages && firstPage + i < pageTable_.size(); ++i) {
+            pageTable_[firstPage + i] = offset + i * pageSize;
+        }
+        return;
+    }
+    for (size_t pageOffset = 0; pageOffset < size; pageOffset += pageSize) {
+        const size_t pageBytes = std::min(pageSize, size - pageOffset);
+        const uint8_t *page = data + pageOffset;
+        uint64_t &entry = pageTable_[firstPage + pageOffset / pageSize];
+        if (isZeroPage(page, pageBytes)) {
+            entry = zeroPage;
+            continue;
+        }
+        if (storage_ == SnapshotPageStorage::Compressed) {
+            thread_local std::vector<uint8_t> compressed;
+            const size_t length = compressPage(page, pageBytes, compressed);
+            if (length > 0) {
+                const uint64_t offset = nextDataOffset_.fetch_add(length);
+                if (!writeAll(fd_, compressed.data(), length, offset)) {
+                    failed_.store(true);
+                }
+                entry = offset | compressedPageBit | (static_cast<uint64_t>(length) << compressedLengthShift);
+                continue;
+            }
+        }
+        const uint64_t offset = nextDataOffset_.fetch_add(pageSize);
+        if (!writeAll(fd_, page, pageBytes, offset)) {
+            failed_.store(true);
+        }
+        entry = offset;
+    }
+}
+
+void MemorySnapshot::Writer::markUnreadable(uintptr_t address, size_t size) {
+    size_t firstPage = 0;
+    if (!locate(address, firstPage)) {
+        return;
+    }
+    const size_t pages = static_cast<size_t>(alignUp(size, pageSize) / pageSize);
+    for (size_t i = 0; i < pages && firstPage + i < pageTable_.size(); ++i) {
+        pageTable_[firstPage + i] = unreadablePage;
+    }
+}
+
+bool MemorySnapshot::Writer::finish(std::string &error) {
+    if (failed_.load()) {
+        error = "failed to write snapshot data";
+        return false;
+    }
+    FileHeader header{};
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = storage_ == SnapshotPageStorage::Compressed ? compressedSnapshotVersion : snapshotVersion;
+    header.flags = storage_ == SnapshotPageStorage::Full             ? 0
+                   : storage_ == SnapshotPageStorage::ElideZeroPages ? flagZeroPagesElided
+                                                                     : flagZeroPagesElided | flagPagesCompressed;
+    header.regionCount = regions_.size();
+    header.regionTableOffset = sizeof(FileHeader);
+    header.stringTableOffset = header.regionTableOffset + regions_.size() * sizeof(FileRegion);
+    header.pageCount = pageTable_.size();
+    header.dataOffset = dataStart_;
+
+    std::vector<FileRegion> fileRegions(regions_.size());
+    std::string strings;
+    for (size_t i = 0; i < regions_.size(); ++i) {
+        const MemoryRegion &region = regions_[i];
+        FileRegion &entry = fileRegions[i];
+        entry.start = region.start;
+        entry.end = region.end;
+        std::memset(entry.permissions, 0, sizeof(entry.permissions));
+        std::memcpy(entry.permissions, region.permissions.data(), std::min(region.permissions.size(), sizeof(entry.permissions)));
+        entry.pathOffset = strings.size();
+        entry.pathLength = region.pathname.size();
+        strings += region.pathname;
+    }
+    header.pageTableOffset = alignUp(header.stringTableOffset + strings.size(), sizeof(uint64_t));
+
+    const bool ok = writeAll(fd_, fileRegions.data(), fileRegions.size() * sizeof(FileRegion), header.regionTableOffset) &&
+                    writeAll(fd_, strings.data(), strings.size(), header.stringTableOffset) &&
+                    writeAll(fd_, pageTable_.data(), pageTable_.size() * sizeof(uint64_t), header.pageTableOffset) &&
+                    writeAll(fd_, &header, sizeof(header), 0);
+    if (!ok) {
+        error = "failed to write snapshot header: " + std::string(std::strerror(errno));
+        return false;
+    }
+    if (storage_ != SnapshotPageStorage::Full && ::ftruncate(fd_, static_cast<off_t>(nextDataOffset_.load())) != 0) {
+        error = "failed to size snapshot file: " + std::string(std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+std::optional<MemorySnapshot> MemorySnapshot::open(const std::string &path, std::string &error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open snapshot " + path + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    auto snapshot = mapFile(fd, error);
+    ::close(fd);
+    return snapshot;
+}
+
+std::optional<MemorySnapshot> MemorySnapshot::fromWriter(Writer &writer, std::string &error) {
+    return mapFile(writer.fd(), error);
+}
+
+std::optional<MemorySnapshot> MemorySnapshot::mapFile(int fd, std::string &error) {
+    struct stat info{};
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        error = "snapshot file is truncated";
+        return std::nullopt;
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        error = "cannot map snapshot: " + std::string(std::strerror(errno));
+        return std::nullopt;
+    }
+    MemorySnapshot snapshot;
+    snapshot.mapping_ = static_cast<const uint8_t *>(mapping);
+    snapshot.mappingSize_ = size;
+
+    FileHeader header{};
+    std::memcpy(&header, snapshot.mapping_, sizeof(header));
+    const bool compressed = (header.flags & flagPagesCompressed) != 0;
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+        header.version != (compressed ? compressedSnapshotVersion : snapshotVersion)) {
+        error = "not a snapshot file or unsupported version";
+        return std::nullopt;
+    }
+    if (compressed && !Writer::compressionAvailable()) {
+        error = "snapshot pages are compressed, but this build has no zlib";
+        return std::nullopt;
+    }
+    const uint64_t regionTableEnd = header.regionTableOffset + header.regionCount * sizeof(FileRegion);
+    if (regionTableEnd > size || header.pageTableOffset + header.pageCount * sizeof(uint64_t) > size) {
+        error = "snapshot file is truncated";
+        return std::nullopt;
+    }
+    snapshot.id_ = nextSnapshotId.fetch_add(1);
+    snapshot.zeroPagesElided_ = (header.flags & flagZeroPagesElided) != 0;
+    snapshot.pagesCompressed_ = compressed;
+    snapshot.pageTableOffset_ = header.pageTableOffset;
+    for (uint64_t i = 0; i < header.regionCount; ++i) {
+        FileRegion entry{};
+        std::memcpy(&entry, snapshot.mapping_ + header.regionTableOffset + i * sizeof(FileRegion), sizeof(entry));
+        MemoryRegion region;
+        region.start = static_cast<uintptr_t>(entry.start);
+        region.end = static_cast<uintptr_t>(entry.end);
+        region.permissions.assign(entry.permissions, strnlen(entry.permissions, sizeof(entry.permissions)));
+        if (header.stringTableOffset + entry.pathOffset + entry.pathLength <= size) {
+            region.pathname.assign(reinterpret_cast<const char *>(snapshot.mapping_ + header.stringTableOffset + entry.pathOffset),
+                                   entry.pathLength);
+        }
+        snapshot.regions_.push_back(std::move(region));
+    }
+    snapshot.regionFirstPage_ = firstPages(snapshot.regions_);
+    if (snapshot.regionFirstPage_.back() != header.pageCount) {
+        error = "snapshot page table does not match its regions";
+        return std::nullopt;
+    }
+    return snapshot;
+}
+
+MemorySnapshot::MemorySnapshot(MemorySnapshot &&other) noexcept
+    : mapping_(other.mapping_),
+      mappingSize_(other.mappingSize_),
+      id_(other.id_),
+      zeroPagesElided_(other.zeroPagesElided_),
+      pagesCompressed_(other.pagesCompressed_),
+      regions_(std::move(other.regions_)),
+      regionFirstPage_(std::move(other.regionFirstPage_)),
+      pageTableOffset_(other.pageTableOffset_) {
+    other.mapping_ = nullptr;
+    other.mappingSize_ = 0;
+}
+
+MemorySnapshot &MemorySnapshot::operator=(MemorySnapshot &&other) noexcept {
+    if (this != &other) {
+        if (mapping_ != nullptr) {
+            ::munmap(const_cast<uint8_t *>(mapping_), mappingSize_);
+        }
+        mapping_ = other.mapping_;
+        mappingSize_ = other.mappingSize_;
+        id_ = other.id_;
+        zeroPagesElided_ = other.zeroPagesElided_;
+        pagesCompressed_ = other.pagesCompressed_;
+        regions_ = std::move(other.regions_);
+        regionFirstPage_ = std::move(other.regionFirstPage_);
+        pageTableOffset_ = other.pageTableOffset_;
+        other.mapping_ = nullptr;
+        other.mappingSize_ = 0;
+    }
+    return *this;
+}
+
+MemorySnapshot::~MemorySnapshot() {
+    if (mapping_ != nullptr) {
+        ::munmap(const_cast<uint8_t *>(mapping_), mappingSize_);
+    }
+}
+
+size_t MemorySnapshot::capturedBytes() const {
+    size_t total = 0;
+    for (const auto &region : regions_) {
+        total += region.size();
+    }
+    return total;
+}
+
+const uint64_t *MemorySnapshot::pageTable() const {
+    return reinterpret_cast<const uint64_t *>(mapping_ + pageTableOffset_);
+}
+
+bool MemorySnapshot::locate(uintptr_t address, size_t &regionIndex) const {
+    return locateRegion(regions_, address, regionIndex);
+}
+
+const uint8_t *MemorySnapshot::decompressedPage(uint64_t entry) const {
+    struct DecodedPage {
+        uint64_t snapshot{};
+        uint64_t entry{};
+        uint8_t bytes[pageSize];
+    };
+    thread_local DecodedPage decoded;
+    if (decoded.snapshot == id_ && decoded.entry == entry) {
+        return decoded.bytes;
+    }
+#ifdef OFFSET_SCANNER_HAVE_ZLIB
+    uLongf length = pageSize;
+    decoded.snapshot = 0;
+    if (uncompress(decoded.bytes, &length, mapping_ + (entry & storedOffsetMask), static_cast<uLong>(compressedLength(entry))) != Z_OK ||
+        length != pageSize) {
+        return nullptr;
+    }
+    decoded.snapshot = id_;
+    decoded.entry = entry;
+    return decoded.bytes;
+#else
+    return nullptr;
+#endif
+}
+
+bool MemorySnapshot::copyRange(uintptr_t address, size_t size, uint8_t *out) const {
+    const uint64_t *table = pageTable();
+    while (size > 0) {
+        size_t regionIndex = 0;
+        if (!locate(address, regionIndex)) {
+            return false;
+        }
+        const MemoryRegion &region = regions_[regionIndex];
+        const size_t offsetInRegion = static_cast<size_t>(address - region.start);
+        const size_t pageOffset = offsetInRegion % pageSize;
+        const size_t bytes = std::min({size, pageSize - pageOffset, static_cast<size_t>(region.end - address)});
+        const uint64_t entry = table[regionFirstPage_[regionIndex] + offsetInRegion / pageSize];
+        if (!storedInFile(entry, pageOffset, bytes, mappingSize_)) {
+            return false;
+        }
+        if (entry == zeroPage) {
+            std::memset(out, 0, bytes);
+        } else if (isCompressedEntry(entry)) {
+            const uint8_t *page = decompressedPage(entry);
+            if (page == nullptr) {
+                return false;
+            }
+            std::memcpy(out, page + pageOffset, bytes);
+        } else {
+            std::memcpy(out, mapping_ + entry + pageOffset, bytes);
+        }
+        address += bytes;
+        out += bytes;
+        size -= bytes;
+    }
+    return true;
+}
+
+size_t MemorySnapshot::readableRun(uintptr_t address, size_t size, bool &readable) const {
+    const uint64_t *table = pageTable();
+    size_t run = 0;
+    while (run < size) {
+        const uintptr_t at = address + run;
+        size_t regionIndex = 0;
+        bool stored = false;
+        size_t bytes = 0;
+        if (locate(at, regionIndex)) {
+            const MemoryRegion &region = regions_[regionIndex];
+            const size_t offsetInRegion = static_cast<size_t>(at - region.start);
+            const size_t pageOffset = offsetInRegion % pageSize;
+            bytes = std::min({size - run, pageSize - pageOffset, static_cast<size_t>(region.end - at)});
+            const uint64_t entry = table[regionFirstPage_[regionIndex] + offsetInRegion / pageSize];
+            stored = storedInFile(entry, pageOffset, bytes, mappingSize_);
+        } else {
+            // Up to the next region, or the end of the range.
+            const auto next = std::upper_bound(regions_.begin(), regions_.end(), at,
+                                               [](uintptr_t value, const MemoryRegion &region) { return value < region.start; });
+            bytes = next == regions_.end() ? size - run : std::min(size - run, static_cast<size_t>(next->start - at));
+        }
+        if (run == 0) {
+            readable = stored;
+        } else if (stored != readable) {
+            break;
+        }
+        run += bytes;
+    }
+    return run;
+}
+
+bool MemorySnapshot::hasMagic(const void *data, size_t size) {
+    return size >= sizeof(snapshotMagic) && std::memcmp(data, snapshotMagic, sizeof(snapshotMagic)) == 0;
+}
+
+const uint8_t *MemorySnapshot::view(uintptr_t address, size_t size) const {
+    size_t regionIndex = 0;
+    if (zeroPagesElided_ || size == 0 || !locate(address, regionIndex)) {
+        return nullptr;
+    }
+    const MemoryRegion &region = regions_[regionIndex];
+    if (address + size > region.end) {
+        return nullptr;
+    }
+    const uint64_t *table = pageTable();
+    const size_t firstPage = regionFirstPage_[regionIndex] + (address - region.start) / pageSize;
+    const size_t lastPage = regionFirstPage_[regionIndex] + (address + size - 1 - region.start) / pageSize;
+    for (size_t page = firstPage; page <= lastPage; ++page) {
+        if (table[page] == unreadablePage) {
+            return nullptr;
+        }
+    }
+    const uint64_t offset = table[firstPage] + (address - region.start) % pageSize;
+    return offset + size <= mappingSize_ ? mapping_ + offset : nullptr;
+}
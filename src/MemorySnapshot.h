@@ -0,0 +1,147 @@
+#pragma once
+
+#include "ProcessUtils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class SnapshotValueKind {
+    Float,
+    Vector3,
+};
+
+enum class ChangeKind {
+    Changed,
+    Unchanged,
+    Increased,
+    Decreased,
+    Moved,
+};
+
+// How a value read now is compared with the same address in a previous snapshot.
+// Increased/Decreased apply to floats only; with hasDelta they require the change
+// to be delta within tolerance. Moved requires the distance between the old and new
+// value to be delta within tolerance.
+struct SnapshotComparison {
+    SnapshotValueKind kind{SnapshotValueKind::Vector3};
+    ChangeKind change{ChangeKind::Changed};
+    float tolerance{0.01f};
+    float delta{0.0f};
+    bool hasDelta{false};
+
+    size_t valueSize() const { return kind == SnapshotValueKind::Float ? sizeof(float) : 3 * sizeof(float); }
+    bool matches(const uint8_t *previous, const uint8_t *current) const;
+};
+
+// How a snapshot file stores page contents. Full keeps every region contiguous;
+// ElideZeroPages drops all-zero pages and packs the rest; Compressed additionally
+// stores each page zlib-compressed when that makes it smaller.
+enum class SnapshotPageStorage {
+    Full,
+    ElideZeroPages,
+    Compressed,
+};
+
+bool parseChangeKind(const std::string &text, ChangeKind &out);
+bool parseSnapshotValueKind(const std::string &text, SnapshotValueKind &out);
+
+// Region contents captured to a file and memory-mapped read-only, so multi-GB
+// snapshots live in the page cache instead of on the heap. Every 4 KiB page has a
+// page table entry. A snapshot with zero pages elided stores no data for all-zero
+// pages and packs the remaining pages densely, compressed ones at their compressed
+// length; otherwise each region is kept contiguous so view() can hand out direct
+// pointers.
+class MemorySnapshot {
+public:
+    static constexpr size_t pageSize = 4096;
+
+    class Writer {
+    public:
+        // An empty path creates an unlinked temporary file in $TMPDIR (or /tmp).
+        // Compressed fails when the build has no zlib.
+        static std::unique_ptr<Writer> create(const std::string &path, const std::vector<MemoryRegion> &regions,
+                                              SnapshotPageStorage storage, std::string &error);
+        // True when the build can write and read compressed snapshots.
+        static bool compressionAvailable();
+        ~Writer();
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        // Stores size bytes read at address. address must be page aligned and the
+        // range must lie inside one region; a partial last page is zero padded.
+        // Safe to call from several threads for disjoint ranges.
+        void writePages(uintptr_t address, const uint8_t *data, size_t size);
+        void markUnreadable(uintptr_t address, size_t size);
+        // Writes the page table and header. The file is complete only afterwards.
+        bool finish(std::string &error);
+
+        const std::string &path() const { return path_; }
+        int fd() const { return fd_; }
+
+    private:
+        Writer() = default;
+        bool locate(uintptr_t address, size_t &pageIndex) const;
+
+        std::string path_;
+        int fd_{-1};
+        SnapshotPageStorage storage_{SnapshotPageStorage::Full};
+        std::atomic<bool> failed_{false};
+        std::vector<MemoryRegion> regions_;
+        std::vector<uint64_t> regionFirstPage_;
+        std::vector<uint64_t> pageTable_;
+        uint64_t dataStart_{};
+        std::atomic<uint64_t> nextDataOffset_{0};
+    };
+
+    static std::optional<MemorySnapshot> open(const std::string &path, std::string &error);
+    // True when data starts with the snapshot file magic.
+    static bool hasMagic(const void *data, size_t size);
+    // Maps the file a finished writer produced; used for unlinked temporary files.
+    static std::optional<MemorySnapshot> fromWriter(Writer &writer, std::string &error);
+
+    MemorySnapshot(MemorySnapshot &&other) noexcept;
+    MemorySnapshot &operator=(MemorySnapshot &&other) noexcept;
+    MemorySnapshot(const MemorySnapshot &) = delete;
+    MemorySnapshot &operator=(const MemorySnapshot &) = delete;
+    ~MemorySnapshot();
+
+    const std::vector<MemoryRegion> &regions() const { return regions_; }
+    bool zeroPagesElided() const { return zeroPagesElided_; }
+    bool pagesCompressed() const { return pagesCompressed_; }
+    size_t capturedBytes() const;
+    size_t fileBytes() const { return mappingSize_; }
+
+    // Copies [address, address + size) out of the snapshot. Fails when any byte is
+    // outside the captured regions or on a page that could not be read.
+    bool copyRange(uintptr_t address, size_t size, uint8_t *out) const;
+    // Bytes from address on, at most size, that are either all stored or all
+    // missing (outside the regions or on unreadable pages); readable says which.
+    size_t readableRun(uintptr_t address, size_t size, bool &readable) const;
+    // Direct pointer into the mapping when the range is stored contiguously,
+    // nullptr otherwise (use copyRange then).
+    const uint8_t *view(uintptr_t address, size_t size) const;
+
+private:
+    MemorySnapshot() = default;
+    static std::optional<MemorySnapshot> mapFile(int fd, std::string &error);
+    const uint64_t *pageTable() const;
+    bool locate(uintptr_t address, size_t &regionIndex) const;
+    // The page a compressed entry stores, decompressed into a per-thread buffer
+    // that keeps the last page; nullptr when the data is corrupt.
+    const uint8_t *decompressedPage(uint64_t entry) const;
+
+    const uint8_t *mapping_{};
+    size_t mappingSize_{};
+    uint64_t id_{};
+    bool zeroPagesElided_{false};
+    bool pagesCompressed_{false};
+    std::vector<MemoryRegion> regions_;
+    std::vector<uint64_t> regionFirstPage_;
+    uint64_t pageTableOffset_{};
+};
@@ -0,0 +1,404 @@
+#include "MemorySource.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Enough of a file to tell the formats apart.
+constexpr size_t magicSize = 8;
+
+struct MappedFile {
+    const uint8_t *data{};
+    size_t size{};
+};
+
+std::optional<MappedFile> mapFile(const std::string &path, std::string &error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    struct stat info{};
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        error = path + " is empty or cannot be read";
+        ::close(fd);
+        return std::nullopt;
+    }
+    void *mapping = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    return MappedFile{static_cast<const uint8_t *>(mapping), static_cast<size_t>(info.st_size)};
+}
+
+size_t noteAlign(size_t size) {
+    return (size + 3) & ~size_t{3};
+}
+
+// Mapping paths from an NT_FILE note: a count and page size, then count start,
+// end and file offset triples in the class's word size, then count file names.
+template <typename Word>
+void parseFileNote(const uint8_t *desc, size_t size, std::vector<MemoryRegion> &files) {
+    if (size < 2 * sizeof(Word)) {
+        return;
+    }
+    Word count = 0;
+    std::memcpy(&count, desc, sizeof(count));
+    const size_t tableBytes = 2 * sizeof(Word) + static_cast<size_t>(count) * 3 * sizeof(Word);
+    if (count == 0 || count > size / (3 * sizeof(Word)) || tableBytes > size) {
+        return;
+    }
+    const char *name = reinterpret_cast<const char *>(desc + tableBytes);
+    const char *namesEnd = reinterpret_cast<const char *>(desc + size);
+    for (size_t i = 0; i < count && name < namesEnd; ++i) {
+        Word range[2] = {};
+        std::memcpy(range, desc + 2 * sizeof(Word) + i * 3 * sizeof(Word), sizeof(range));
+        const size_t length = strnlen(name, static_cast<size_t>(namesEnd - name));
+        MemoryRegion file;
+        file.start = static_cast<uintptr_t>(range[0]);
+        file.end = static_cast<uintptr_t>(range[1]);
+        file.pathname.assign(name, length);
+        files.push_back(std::move(file));
+        name += length + 1;
+    }
+}
+
+template <typename Header, typename ProgramHeader, typename Word>
+bool parseCore(const uint8_t *data, size_t size, std::vector<MemoryRegion> &regions, std::vector<uint64_t> &fileOffsets,
+               std::vector<uint64_t> &fileSizes, std::string &error) {
+    Header header{};
+    std::memcpy(&header, data, sizeof(header));
+    if (header.e_type != ET_CORE) {
+        error = "ELF file is not a core dump";
+        return false;
+    }
+    if (header.e_phentsize != sizeof(ProgramHeader) || header.e_phoff > size ||
+        header.e_phnum > (size - header.e_phoff) / sizeof(ProgramHeader)) {
+        error = "core program header table is malformed";
+        return false;
+    }
+    struct Segment {
+        MemoryRegion region;
+        uint64_t fileOffset{};
+        uint64_t fileSize{};
+    };
+    std::vector<Segment> segments;
+    std::vector<MemoryRegion> files;
+    for (size_t i = 0; i < header.e_phnum; ++i) {
+        ProgramHeader program{};
+        std::memcpy(&program, data + header.e_phoff + i * sizeof(ProgramHeader), sizeof(program));
+        if (program.p_type == PT_NOTE && program.p_offset <= size && program.p_filesz <= size - program.p_offset) {
+            const uint8_t *note = data + program.p_offset;
+            const uint8_t *notesEnd = note + program.p_filesz;
+            while (static_cast<size_t>(notesEnd - note) >= sizeof(Elf64_Nhdr)) {
+                Elf64_Nhdr noteHeader{};
+                std::memcpy(&noteHeader, note, sizeof(noteHeader));
+                const size_t descOffset = sizeof(noteHeader) + noteAlign(noteHeader.n_namesz);
+                if (descOffset > static_cast<size_t>(notesEnd - note) ||
+                    noteHeader.n_descsz > static_cast<size_t>(notesEnd - note) - descOffset) {
+                    break;
+                }
+                if (noteHeader.n_type == NT_FILE) {
+                    parseFileNote<Word>(note + descOffset, noteHeader.n_descsz, files);
+                }
+                note += descOffset + noteAlign(noteHeader.n_descsz);
+            }
+        }
+        if (program.p_type != PT_LOAD || program.p_memsz == 0) {
+            continue;
+        }
+        Segment segment;
+        segment.region.start = static_cast<uintptr_t>(program.p_vaddr);
+        segment.region.end = static_cast<uintptr_t>(program.p_vaddr + program.p_memsz);
+        segment.region.permissions = std::string((program.p_flags & PF_R) != 0 ? "r" : "-") +
+                                     ((program.p_flags & PF_W) != 0 ? "w" : "-") + ((program.p_flags & PF_X) != 0 ? "x" : "-") + "p";
+        segment.fileOffset = program.p_offset;
+        // Bytes past the end of the file read as missing, not as garbage.
+        segment.fileSize = program.p_offset < size ? std::min<uint64_t>(program.p_filesz, size - program.p_offset) : 0;
+        segments.push_back(std::move(segment));
+    }
+    if (segments.empty()) {
+        error = "core dump has no memory segments";
+        return false;
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment &lhs, const Segment &rhs) { return lhs.region.start < rhs.region.start; });
+    std::sort(files.begin(), files.end(), [](const MemoryRegion &lhs, const MemoryRegion &rhs) { return lhs.start < rhs.start; });
+    for (auto &segment : segments) {
+        if (const MemoryRegion *file = ProcessUtils::findRegionContaining(files, segment.region.start)) {
+            segment.region.pathname = file->pathname;
+        }
+        regions.push_back(std::move(segment.region));
+        fileOffsets.push_back(segment.fileOffset);
+        fileSizes.push_back(segment.fileSize);
+    }
+    return true;
+}
+
+} // namespace
+
+ReadStatistics ReadStatistics::operator-(const ReadStatistics &other) const {
+    return {vmReadvCalls - other.vmReadvCalls, preadCalls - other.preadCalls,       mappedCopies - other.mappedCopies,
+            mappedViews - other.mappedViews,   bytesRequested - other.bytesRequested, bytesRead - other.bytesRead,
+            failedReads - other.failedReads,   unreadablePages - other.unreadablePages, skippedPages - other.skippedPages};
+}
+
+void MemorySource::Counters::assign(const Counters &other) {
+    vmReadvCalls.store(other.vmReadvCalls.load());
+    preadCalls.store(other.preadCalls.load());
+    mappedCopies.store(other.mappedCopies.load());
+    mappedViews.store(other.mappedViews.load());
+    bytesRequested.store(other.bytesRequested.load());
+    bytesRead.store(other.bytesRead.load());
+    failedReads.store(other.failedReads.load());
+    unreadablePages.store(other.unreadablePages.load());
+    skippedPages.store(other.skippedPages.load());
+}
+
+ReadStatistics MemorySource::statistics() const {
+    ReadStatistics statistics;
+    statistics.vmReadvCalls = counters_.vmReadvCalls.load(std::memory_order_relaxed);
+    statistics.preadCalls = counters_.preadCalls.load(std::memory_order_relaxed);
+    statistics.mappedCopies = counters_.mappedCopies.load(std::memory_order_relaxed);
+    statistics.mappedViews = counters_.mappedViews.load(std::memory_order_relaxed);
+    statistics.bytesRequested = counters_.bytesRequested.load(std::memory_order_relaxed);
+    statistics.bytesRead = counters_.bytesRead.load(std::memory_order_relaxed);
+    statistics.failedReads = counters_.failedReads.load(std::memory_order_relaxed);
+    statistics.unreadablePages = counters_.unreadablePages.load(std::memory_order_relaxed);
+    statistics.skippedPages = counters_.skippedPages.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void MemorySource::countRead(std::atomic<uint64_t> &calls, size_t requested, ssize_t transferred) const {
+    calls.fetch_add(1, std::memory_order_relaxed);
+    counters_.bytesRequested.fetch_add(requested, std::memory_order_relaxed);
+    if (transferred > 0) {
+        counters_.bytesRead.fetch_add(static_cast<uint64_t>(transferred), std::memory_order_relaxed);
+    }
+}
+
+size_t MemorySource::readBatch(ReadRequest *requests, size_t count) const {
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; ++i) {
+        requests[i].succeeded = read(requests[i].address, requests[i].buffer, requests[i].size);
+        succeeded += requests[i].succeeded ? 1 : 0;
+    }
+    return succeeded;
+}
+
+const uint8_t *MemorySource::view(uintptr_t, size_t) const {
+    return nullptr;
+}
+
+size_t MemorySource::readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const {
+    if (!read(address, buffer, size)) {
+        return 0;
+    }
+    spans.push_back({0, size});
+    return size;
+}
+
+std::unique_ptr<CoreDumpSource> CoreDumpSource::open(const std::string &path, std::string &error) {
+    auto file = mapFile(path, error);
+    if (!file) {
+        return nullptr;
+    }
+    std::unique_ptr<CoreDumpSource> source(new CoreDumpSource());
+    source->path_ = path;
+    source->mapping_ = file->data;
+    source->mappingSize_ = file->size;
+    if (!source->parse(error)) {
+        error = path + ": " + error;
+        return nullptr;
+    }
+    return source;
+}
+
+CoreDumpSource::~CoreDumpSource() {
+    if (mapping_ != nullptr) {
+        ::munmap(const_cast<uint8_t *>(mapping_), mappingSize_);
+    }
+}
+
+bool CoreDumpSource::parse(std::string &error) {
+    if (mappingSize_ < EI_NIDENT || std::memcmp(mapping_, ELFMAG, SELFMAG) != 0) {
+        error = "not an ELF core dump";
+        return false;
+    }
+    if (mapping_[EI_CLASS] == ELFCLASS64 && mappingSize_ >= sizeof(Elf64_Ehdr)) {
+        return parseCore<Elf64_Ehdr, Elf64_Phdr, uint64_t>(mapping_, mappingSize_, regions_, fileOffsets_, fileSizes_, error);
+    }
+    if (mapping_[EI_CLASS] == ELFCLASS32 && mappingSize_ >= sizeof(Elf32_Ehdr)) {
+        return parseCore<Elf32_Ehdr, Elf32_Phdr, uint32_t>(mapping_, mappingSize_, regions_, fileOffsets_, fileSizes_, error);
+    }
+    error = "unknown ELF class or truncated header";
+    return false;
+}
+
+const uint8_t *CoreDumpSource::view(uintptr_t address, size_t size) const {
+    const MemoryRegion *region = ProcessUtils::findRegionContaining(regions_, address);
+    if (region == nullptr || size == 0) {
+        return nullptr;
+    }
+    const size_t index = static_cast<size_t>(region - regions_.data());
+    const uint64_t offset = address - region->start;
+    if (offset + size > fileSizes_[index]) {
+        return nullptr;
+    }
+    counters_.mappedViews.fetch_add(1, std::memory_order_relaxed);
+    counters_.bytesRequested.fetch_add(size, std::memory_order_relaxed);
+    counters_.bytesRead.fetch_add(size, std::memory_order_relaxed);
+    return mapping_ + fileOffsets_[index] + offset;
+}
+
+bool CoreDumpSource::read(uintptr_t address, void *buffer, size_t size) const {
+    auto *out = static_cast<uint8_t *>(buffer);
+    while (size > 0) {
+        const MemoryRegion *region = ProcessUtils::findRegionContaining(regions_, address);
+        if (region == nullptr) {
+            break;
+        }
+        const size_t index = static_cast<size_t>(region - regions_.data());
+        const uint64_t offset = address - region->start;
+        const size_t bytes = std::min<size_t>(size, region->end - address);
+        if (offset + bytes > fileSizes_[index]) {
+            break;
+        }
+        std::memcpy(out, mapping_ + fileOffsets_[index] + offset, bytes);
+        countRead(counters_.mappedCopies, bytes, static_cast<ssize_t>(bytes));
+        address += bytes;
+        out += bytes;
+        size -= bytes;
+    }
+    if (size != 0) {
+        counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+size_t CoreDumpSource::readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const {
+    auto *out = static_cast<uint8_t *>(buffer);
+    size_t offset = 0;
+    size_t copied = 0;
+    while (offset < size) {
+        const uintptr_t at = address + offset;
+        auto next = std::upper_bound(regions_.begin(), regions_.end(), at,
+                                     [](uintptr_t value, const MemoryRegion &region) { return value < region.start; });
+        if (next == regions_.begin() || at >= std::prev(next)->end) {
+            // Between segments: continue at the next one.
+            if (next == regions_.end() || next->start - at >= size - offset) {
+                break;
+            }
+            offset += static_cast<size_t>(next->start - at);
+            continue;
+        }
+        const auto region = std::prev(next);
+        const size_t index = static_cast<size_t>(region - regions_.begin());
+        const uint64_t offsetInRegion = at - region->start;
+        const size_t inRegion = std::min<size_t>(size - offset, region->end - at);
+        const size_t held = offsetInRegion < fileSizes_[index]
+                                ? static_cast<size_t>(std::min<uint64_t>(inRegion, fileSizes_[index] - offsetInRegion))
+                                : 0;
+        if (held != 0) {
+            std::memcpy(out + offset, mapping_ + fileOffsets_[index] + offsetInRegion, held);
+            countRead(counters_.mappedCopies, held, static_cast<ssize_t>(held));
+            if (!spans.empty() && spans.back().offset + spans.back().size == offset) {
+                spans.back().size += held;
+            } else {
+                spans.push_back({offset, held});
+            }
+            copied += held;
+        }
+        offset += inRegion;
+    }
+    if (copied != size) {
+        counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+    }
+    return copied;
+}
+
+std::string CoreDumpSource::describe() const {
+    return "core dump " + path_;
+}
+
+std::unique_ptr<SnapshotSource> SnapshotSource::open(const std::string &path, std::string &error) {
+    auto snapshot = MemorySnapshot::open(path, error);
+    if (!snapshot) {
+        return nullptr;
+    }
+    return std::unique_ptr<SnapshotSource>(new SnapshotSource(path, std::move(*snapshot)));
+}
+
+bool SnapshotSource::read(uintptr_t address, void *buffer, size_t size) const {
+    const bool copied = snapshot_.copyRange(address, size, static_cast<uint8_t *>(buffer));
+    countRead(counters_.mappedCopies, size, copied ? static_cast<ssize_t>(size) : 0);
+    if (!copied) {
+        counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+    }
+    return copied;
+}
+
+size_t SnapshotSource::readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const {
+    auto *out = static_cast<uint8_t *>(buffer);
+    size_t offset = 0;
+    size_t copied = 0;
+    while (offset < size) {
+        bool readable = false;
+        const size_t run = snapshot_.readableRun(address + offset, size - offset, readable);
+        if (readable && snapshot_.copyRange(address + offset, run, out + offset)) {
+            countRead(counters_.mappedCopies, run, static_cast<ssize_t>(run));
+            spans.push_back({offset, run});
+            copied += run;
+        }
+        offset += run;
+    }
+    if (copied != size) {
+        counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+    }
+    return copied;
+}
+
+const uint8_t *SnapshotSource::view(uintptr_t address, size_t size) const {
+    const uint8_t *data = snapshot_.view(address, size);
+    if (data != nullptr) {
+        counters_.mappedViews.fetch_add(1, std::memory_order_relaxed);
+        counters_.bytesRequested.fetch_add(size, std::memory_order_relaxed);
+        counters_.bytesRead.fetch_add(size, std::memory_order_relaxed);
+    }
+    return data;
+}
+
+std::string SnapshotSource::describe() const {
+    return "snapshot " + path_ +
+           (snapshot_.pagesCompressed() ? " (pages compressed)" : snapshot_.zeroPagesElided() ? " (zero pages elided)" : "");
+}
+
+std::unique_ptr<MemorySource> openMemoryCapture(const std::string &path, std::string &error) {
+    uint8_t magic[magicSize] = {};
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    const ssize_t count = ::pread(fd, magic, sizeof(magic), 0);
+    ::close(fd);
+    if (count > 0 && MemorySnapshot::hasMagic(magic, static_cast<size_t>(count))) {
+        return SnapshotSource::open(path, error);
+    }
+    if (count >= SELFMAG && std::memcmp(magic, ELFMAG, SELFMAG) == 0) {
+        return CoreDumpSource::open(path, error);
+    }
+    error = path + " is neither a core dump nor a snapshot";
+    return nullptr;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "MemorySnapshot.h"
+#include "ProcessUtils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+struct ReadRequest {
+    uintptr_t address{};
+    void *buffer{};
+    size_t size{};
+    bool succeeded{false};
+};
+
+// A readable stretch of a partial read, as an offset into the buffer and a length.
+struct ReadSpan {
+    size_t offset{};
+    size_t size{};
+};
+
+// Totals since the source was created. Take two snapshots and subtract them to
+// attribute reads to one operation.
+struct ReadStatistics {
+    uint64_t vmReadvCalls{};
+    uint64_t preadCalls{};
+    // Reads an offline source served by copying out of its mapped file, and the
+    // ones it answered with a pointer into the mapping instead.
+    uint64_t mappedCopies{};
+    uint64_t mappedViews{};
+    uint64_t bytesRequested{};
+    uint64_t bytesRead{};
+    // Requests the source could not satisfy.
+    uint64_t failedReads{};
+    // Pages readAvailable found unreadable, and known unreadable pages it skipped
+    // without a syscall.
+    uint64_t unreadablePages{};
+    uint64_t skippedPages{};
+
+    uint64_t syscalls() const { return vmReadvCalls + preadCalls; }
+    ReadStatistics operator-(const ReadStatistics &other) const;
+};
+
+// Where scans get target memory from: a live process, or a capture of one that is
+// analysed offline. Reads are safe to issue from several threads at once.
+class MemorySource {
+public:
+    virtual ~MemorySource() = default;
+
+    virtual bool read(uintptr_t address, void *buffer, size_t size) const = 0;
+    // Reads every request and returns the number that succeeded. The default
+    // issues one read per request.
+    virtual size_t readBatch(ReadRequest *requests, size_t count) const;
+    size_t readBatch(std::vector<ReadRequest> &requests) const { return readBatch(requests.data(), requests.size()); }
+    // Pointer to the size bytes at address when the source holds them in memory,
+    // so a scan can use them without a copy; null otherwise (read them then). The
+    // pointer stays valid as long as the source.
+    virtual const uint8_t *view(uintptr_t address, size_t size) const;
+    // Reads whatever part of [address, address + size) is readable, so one bad
+    // page does not lose a whole chunk. The readable stretches are appended to
+    // spans in address order; bytes outside them are left untouched. Returns the
+    // number of bytes read. The default is all or nothing through read().
+    virtual size_t readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const;
+
+    // The mappings the memory came from, sorted by address.
+    virtual std::vector<MemoryRegion> regions() const = 0;
+    // The live process behind the source, 0 for offline sources. Page map and
+    // soft-dirty shortcuts only apply when it is set.
+    virtual pid_t pid() const { return 0; }
+    virtual std::string describe() const = 0;
+
+    template <typename T>
+    std::optional<T> readValue(uintptr_t address) const {
+        T value{};
+        if (!read(address, &value, sizeof(T))) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    ReadStatistics statistics() const;
+
+protected:
+    MemorySource() = default;
+    MemorySource(const MemorySource &) = delete;
+    MemorySource &operator=(const MemorySource &) = delete;
+
+    struct Counters {
+        std::atomic<uint64_t> vmReadvCalls{0};
+        std::atomic<uint64_t> preadCalls{0};
+        std::atomic<uint64_t> mappedCopies{0};
+        std::atomic<uint64_t> mappedViews{0};
+        std::atomic<uint64_t> bytesRequested{0};
+        std::atomic<uint64_t> bytesRead{0};
+        std::atomic<uint64_t> failedReads{0};
+        std::atomic<uint64_t> unreadablePages{0};
+        std::atomic<uint64_t> skippedPages{0};
+
+        void assign(const Counters &other);
+    };
+
+    void countRead(std::atomic<uint64_t> &calls, size_t requested, ssize_t transferred) const;
+
+    mutable Counters counters_;
+};
+
+// The loaded segments of an ELF core file, as written by gcore or the kernel,
+// mapped read-only. Mapping pathnames come from the NT_FILE note; segments the
+// dump left empty (memory size without file contents) fail to read.
+class CoreDumpSource : public MemorySource {
+public:
+    static std::unique_ptr<CoreDumpSource> open(const std::string &path, std::string &error);
+    ~CoreDumpSource() override;
+
+    bool read(uintptr_t address, void *buffer, size_t size) const override;
+    const uint8_t *view(uintptr_t address, size_t size) const override;
+    // Copies the parts of the range the dump holds file contents for, skipping
+    // gaps between segments and the empty tails of segments.
+    size_t readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const override;
+    std::vector<MemoryRegion> regions() const override { return regions_; }
+    std::string describe() const override;
+
+private:
+    CoreDumpSource() = default;
+    bool parse(std::string &error);
+
+    std::string path_;
+    const uint8_t *mapping_{};
+    size_t mappingSize_{};
+    std::vector<MemoryRegion> regions_;
+    // File offset of each region's first byte and how many of its bytes the file
+    // holds, parallel to regions_.
+    std::vector<uint64_t> fileOffsets_;
+    std::vector<uint64_t> fileSizes_;
+};
+
+// A MemorySnapshot file written by --capture or an unknown-value session. Ranges
+// a snapshot without elided zero pages stores contiguously are handed out as views.
+class SnapshotSource : public MemorySource {
+public:
+    static std::unique_ptr<SnapshotSource> open(const std::string &path, std::string &error);
+
+    bool read(uintptr_t address, void *buffer, size_t size) const override;
+    const uint8_t *view(uintptr_t address, size_t size) const override;
+    // Copies the stored pages of the range, skipping the ones captured as
+    // unreadable.
+    size_t readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const override;
+    std::vector<MemoryRegion> regions() const override { return snapshot_.regions(); }
+    std::string describe() const override;
+
+private:
+    SnapshotSource(std::string path, MemorySnapshot snapshot) : path_(std::move(path)), snapshot_(std::move(snapshot)) {}
+
+    std::string path_;
+    MemorySnapshot snapshot_;
+};
+
+// Opens a core dump or a snapshot file, told apart by their magic bytes.
+std::unique_ptr<MemorySource> openMemoryCapture(const std::string &path, std::string &error);
@@ -1,21 +1,375 @@
 #include "OffsetScanner.h"
 
+#include "PageMap.h"
+#include "ReadPipeline.h"
+#include "ScanStats.h"
+
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <fcntl.h>
+#include <functional>
 #include <iostream>
 #include <limits>
-#include <unordered_set>
+#include <mutex>
+#include <unistd.h>
 
 namespace {
-constexpr size_t vectorSizeBytes = sizeof(float) * 3;
 constexpr size_t scanChunkSize = 64 * 1024;
-constexpr size_t chunkOverlap = vectorSizeBytes - sizeof(float);
+constexpr size_t maxScanChunkSize = 256 * 1024;
+constexpr size_t readAheadDepth = 4;
+constexpr size_t minParallelTaskSize = 1024 * 1024;
+constexpr size_t tasksPerThread = 16;
+
+using ValueBytes = std::array<uint8_t, VectorKernels::maxValueSize>;
+
+struct ScanTask {
+    uintptr_t regionStart{};
+    uintptr_t begin{};
+    uintptr_t end{};
+    uintptr_t regionEnd{};
+    size_t chunkSize{scanChunkSize};
+};
+
+// Large regions are read in chunks of up to 256 KiB to amortize the per-read
+// syscall while a chunk still fits in L2; small ones keep 64 KiB so a failed read
+// loses little.
+size_t chunkSizeFor(size_t regionBytes) {
+    return std::clamp(regionBytes / 64 / scanChunkSize * scanChunkSize, scanChunkSize, maxScanChunkSize);
+}
+
+bool coversWhole(const std::vector<ReadSpan> &spans, size_t size) {
+    return spans.size() == 1 && spans.front().offset == 0 && spans.front().size == size;
+}
+
+void countChunk(TaskStats &stats, size_t chunkBytes, size_t size, const std::vector<ReadSpan> &spans) {
+    ++stats.chunks;
+    stats.bytesScanned += chunkBytes;
+    stats.failedChunks += spans.empty() ? 1 : 0;
+    stats.partialChunks += !spans.empty() && !coversWhole(spans, size) ? 1 : 0;
+}
+
+// Compares the value starts owned by one chunk. data holds size bytes read at
+// address; the first chunkBytes belong to the chunk and the rest is overlap, so a
+// value straddling the end of the chunk is tested here and only here. Returns
+// false when onMatch asked to stop.
+template <typename MatchFn>
+bool compareChunk(VectorKernels::MatchFunction match, const VectorKernels::ValueLayout &layout,
+                  const VectorKernels::MatchTarget &target, uintptr_t address, const uint8_t *data, size_t size,
+                  size_t chunkBytes, std::vector<uint32_t> &matches, TaskStats *stats, MatchFn &&onMatch) {
+    if (size < layout.size) {
+        return true;
+    }
+    const size_t lastStart = std::min(size - layout.size, chunkBytes - 1);
+    const uint64_t compareStart = stats != nullptr ? ScanStats::now() : 0;
+    matches.clear();
+    match(data, lastStart / layout.alignment + 1, target, matches);
+    if (stats != nullptr) {
+        stats->compareNanoseconds += stats->endSpan("compare", compareStart);
+        stats->candidates += matches.size();
+    }
+    for (const uint32_t offset : matches) {
+        if (!onMatch(address + offset, data + offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Multi-target form: match is unused and the MultiMatcher tests every target in
+// one pass; onMatch(address, value, targetIndex) sees the hits in address order,
+// then target order.
+template <typename MatchFn>
+bool compareChunk(VectorKernels::MatchFunction, const VectorKernels::ValueLayout &layout, const VectorKernels::MultiMatcher &matcher,
+                  uintptr_t address, const uint8_t *data, size_t size, size_t chunkBytes, std::vector<uint32_t> &, TaskStats *stats,
+                  MatchFn &&onMatch) {
+    if (size < layout.size) {
+        return true;
+    }
+    const size_t lastStart = std::min(size - layout.size, chunkBytes - 1);
+    const uint64_t compareStart = stats != nullptr ? ScanStats::now() : 0;
+    thread_local std::vector<VectorKernels::TargetMatch> hits;
+    hits.clear();
+    matcher.match(data, lastStart / layout.alignment + 1, hits);
+    if (stats != nullptr) {
+        stats->compareNanoseconds += stats->endSpan("compare", compareStart);
+        stats->candidates += hits.size();
+    }
+    for (const auto &hit : hits) {
+        if (!onMatch(address + hit.offset, data + hit.offset, static_cast<size_t>(hit.target))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// compareChunk over the readable spans of a chunk that was only read in part. A
+// value is tested only when all of its bytes lie in one span.
+template <typename Target, typename MatchFn>
+bool compareSpans(VectorKernels::MatchFunction match, const VectorKernels::ValueLayout &layout, const Target &target,
+                  uintptr_t address, const uint8_t *data, size_t chunkBytes, const std::vector<ReadSpan> &spans,
+                  std::vector<uint32_t> &matches, TaskStats *stats, MatchFn &&onMatch) {
+    for (const auto &span : spans) {
+        if (span.offset >= chunkBytes) {
+            break;
+        }
+        if (!compareChunk(match, layout, target, address + span.offset, data + span.offset, span.size, chunkBytes - span.offset,
+                          matches, stats, onMatch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Scans every layout.alignment-aligned value start in [task.begin, task.end) on the
+// calling thread. Chunks are read with layout.size - layout.alignment extra bytes
+// (clamped to the region end). target is one MatchTarget or a MultiMatcher.
+// onMatch receives the address and the raw value bytes (plus the target index for
+// a MultiMatcher) and returns false to stop the scan, keepGoing is polled once per
+// chunk. stats, when given, is charged with the chunks, the time spent reading
+// and comparing, and the matches.
+template <typename Target, typename Buffer, typename MatchFn, typename KeepGoingFn>
+void scanRange(const MemorySource &reader, VectorKernels::MatchFunction match, const VectorKernels::ValueLayout &layout,
+               const ScanTask &task, const Target &target, Buffer &buffer,
+               std::vector<uint32_t> &matches, TaskStats *stats, MatchFn &&onMatch, KeepGoingFn &&keepGoing) {
+    const size_t chunkOverlap = layout.size - layout.alignment;
+    uintptr_t current = task.begin;
+    while (current < task.end && keepGoing()) {
+        const size_t chunkBytes = std::min(task.chunkSize, static_cast<size_t>(task.end - current));
+        const size_t bytesToRead = std::min(chunkBytes + chunkOverlap, static_cast<size_t>(task.regionEnd - current));
+        const uint64_t readStart = stats != nullptr ? ScanStats::now() : 0;
+        // Mapped sources hand out the bytes in place; everything else is copied,
+        // page by page around unreadable holes.
+        thread_local std::vector<ReadSpan> spans;
+        spans.clear();
+        const uint8_t *data = reader.view(current, bytesToRead);
+        if (data != nullptr) {
+            spans.push_back({0, bytesToRead});
+        } else {
+            buffer.resize(bytesToRead);
+            reader.readAvailable(current, buffer.data(), bytesToRead, spans);
+            data = buffer.data();
+        }
+        if (stats != nullptr) {
+            stats->readNanoseconds += stats->endSpan("read", readStart);
+            countChunk(*stats, chunkBytes, bytesToRead, spans);
+        }
+        if (!compareSpans(match, layout, target, current, data, chunkBytes, spans, matches, stats, onMatch)) {
+            return;
+        }
+        current += chunkBytes;
+    }
+}
+
+// Single-threaded counterpart of running scanRange over every task: a ReadPipeline
+// reads the following chunks while this thread compares the current one. Tasks
+// are visited in order; beginTask(index) returns the TaskStats to charge (or null)
+// and endTask(index) runs after the task's last chunk. onMatch(index, address,
+// value[, targetIndex]) returns false to stop the scan.
+template <typename Target, typename BeginTaskFn, typename MatchFn, typename EndTaskFn>
+void scanTasksPipelined(const MemorySource &reader, VectorKernels::MatchFunction match,
+                        const VectorKernels::ValueLayout &layout, const std::vector<ScanTask> &tasks, const Target &target, BeginTaskFn &&beginTask, MatchFn &&onMatch,
+                        EndTaskFn &&endTask) {
+    std::vector<ReadRange> ranges;
+    ranges.reserve(tasks.size());
+    for (const auto &task : tasks) {
+        ranges.push_back({task.begin, task.end, task.regionEnd, task.chunkSize});
+    }
+    // Reading ahead only pays off when the producer gets a core of its own.
+    const size_t depth = ThreadPool::defaultThreadCount() > 1 ? readAheadDepth : 1;
+    ReadPipeline pipeline(reader, std::move(ranges), layout.size - layout.alignment, depth);
+    std::vector<uint32_t> matches;
+    size_t taskIndex = tasks.size();
+    TaskStats *stats = nullptr;
+    while (const PipelineChunk *chunk = pipeline.next()) {
+        if (chunk->range != taskIndex) {
+            if (taskIndex != tasks.size()) {
+                endTask(taskIndex);
+            }
+            taskIndex = chunk->range;
+            stats = beginTask(taskIndex);
+        }
+        if (stats != nullptr) {
+            stats->readNanoseconds += chunk->readNanoseconds;
+            stats->addSpan("read", chunk->readThread, chunk->readStart, chunk->readNanoseconds);
+            countChunk(*stats, chunk->chunkBytes, chunk->size, chunk->spans);
+        }
+        const auto onTaskMatch = [&](uintptr_t address, const uint8_t *value, auto... targetIndex) {
+            return onMatch(taskIndex, address, value, targetIndex...);
+        };
+        if (!compareSpans(match, layout, target, chunk->address, chunk->data, chunk->chunkBytes, chunk->spans, matches, stats,
+                          onTaskMatch)) {
+            pipeline.cancel();
+            break;
+        }
+    }
+    if (taskIndex != tasks.size()) {
+        endTask(taskIndex);
+    }
+}
+
+// Fills out with the size bytes at address, reading only the pages written since
+// the soft-dirty bits were cleared. Clean pages are copied from old, the previous
+// contents of the same range, and absent anonymous pages are zero. Adjacent dirty
+// pages are read together.
+bool readChangedPages(const MemorySource &reader, const PageStates &pages, uintptr_t address, size_t size,
+                      const uint8_t *old, uint8_t *out) {
+    const PageMap::PageState *states = pages.states(address, size);
+    if (states == nullptr) {
+        return reader.read(address, out, size);
+    }
+    const uintptr_t firstPage = address / PageMap::pageSize;
+    size_t runStart = size;
+    size_t offset = 0;
+    while (offset < size) {
+        const uintptr_t at = address + offset;
+        const size_t bytes = std::min(size - offset, PageMap::pageSize - at % PageMap::pageSize);
+        const PageMap::PageState state = states[at / PageMap::pageSize - firstPage];
+        if (state == PageMap::PageState::Dirty) {
+            runStart = std::min(runStart, offset);
+        } else {
+            if (runStart != size && !reader.read(address + runStart, out + runStart, offset - runStart)) {
+                return false;
+            }
+            runStart = size;
+            if (state == PageMap::PageState::Clean) {
+                std::memcpy(out + offset, old + offset, bytes);
+            } else {
+                std::memset(out + offset, 0, bytes);
+            }
+        }
+        offset += bytes;
+    }
+    return runStart == size || reader.read(address + runStart, out + runStart, size - runStart);
+}
+
+// Stores the first size bytes of a chunk: its readable spans, and the pages
+// between them as unreadable. Spans of a page-aligned chunk start on page
+// boundaries.
+void writeSpans(MemorySnapshot::Writer &writer, uintptr_t address, const uint8_t *data, size_t size,
+                const std::vector<ReadSpan> &spans) {
+    size_t offset = 0;
+    for (const auto &span : spans) {
+        if (span.offset >= size) {
+            break;
+        }
+        if (span.offset > offset) {
+            writer.markUnreadable(address + offset, span.offset - offset);
+        }
+        const size_t bytes = std::min(span.size, size - span.offset);
+        writer.writePages(address + span.offset, data + span.offset, bytes);
+        offset = span.offset + bytes;
+    }
+    if (offset < size) {
+        writer.markUnreadable(address + offset, size - offset);
+    }
+}
+
+// Task size grows with the scanned address space so the task list stays at about
+// tasksPerThread entries per worker plus one per region, whether the scope is one
+// module or tens of GB of heap.
+std::vector<ScanTask> buildScanTasks(const std::vector<MemoryRegion> &regions, size_t threadCount) {
+    size_t totalBytes = 0;
+    for (const auto &region : regions) {
+        if (region.isReadable()) {
+            totalBytes += region.size();
+        }
+    }
+    const size_t targetTaskCount = std::max<size_t>(threadCount, 1) * tasksPerThread;
+    size_t taskSize = std::max(minParallelTaskSize, totalBytes / targetTaskCount);
+    taskSize = (taskSize + scanChunkSize - 1) / scanChunkSize * scanChunkSize;
+
+    std::vector<ScanTask> tasks;
+    for (const auto &region : regions) {
+        if (!region.isReadable()) {
+            continue;
+        }
+        for (uintptr_t begin = region.start; begin < region.end;) {
+            const uintptr_t end = begin + std::min(taskSize, static_cast<size_t>(region.end - begin));
+            tasks.push_back({region.start, begin, end, region.end, chunkSizeFor(region.size())});
+            begin = end;
+        }
+    }
+    return tasks;
+}
+
+// Whether an all-zero x component can be within tolerance of the target. When it
+// cannot, no value starting in a zero page can match.
+bool zeroCanMatch(const VectorKernels::MatchTarget &target) {
+    return std::fabs(target.components[0]) <= target.tolerance;
+}
+
+bool zeroCanMatch(const VectorKernels::MultiMatcher &matcher) {
+    const auto &targets = matcher.targets();
+    return std::any_of(targets.begin(), targets.end(), [](const auto &target) { return zeroCanMatch(target); });
+}
+
+// Splits the tasks of anonymous regions around pages that are neither resident
+// nor swapped; those read as zeros, so a scan for a value zeros cannot match has
+// nothing to find there. Each run keeps its region end, so a value starting at
+// the end of a run is still read through into the skipped page. Tasks are
+// returned unchanged when the pagemap cannot be read.
+std::vector<ScanTask> dropAbsentPages(pid_t pid, const std::vector<MemoryRegion> &regions, std::vector<ScanTask> tasks) {
+    const std::string path = "/proc/" + std::to_string(pid) + "/pagemap";
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return tasks;
+    }
+    std::vector<ScanTask> resident;
+    resident.reserve(tasks.size());
+    std::vector<uint64_t> entries;
+    for (const auto &task : tasks) {
+        const MemoryRegion *region = ProcessUtils::findRegionContaining(regions, task.regionStart);
+        const uintptr_t firstPage = task.begin / PageMap::pageSize * PageMap::pageSize;
+        entries.resize((task.end - firstPage + PageMap::pageSize - 1) / PageMap::pageSize);
+        if (region == nullptr || !PageMap::isAnonymous(*region) ||
+            !PageMap::readEntries(fd, firstPage, entries.size(), entries.data())) {
+            resident.push_back(task);
+            continue;
+        }
+        uintptr_t runBegin = 0;
+        bool inRun = false;
+        for (size_t page = 0; page <= entries.size(); ++page) {
+            const bool present = page < entries.size() && PageMap::classify(entries[page], true) != PageMap::PageState::Zero;
+            const uintptr_t pageStart = std::max<uintptr_t>(firstPage + page * PageMap::pageSize, task.begin);
+            if (present && !inRun) {
+                runBegin = pageStart;
+                inRun = true;
+            } else if (!present && inRun) {
+                resident.push_back({task.regionStart, runBegin, std::min(pageStart, task.end), task.regionEnd, task.chunkSize});
+                inRun = false;
+            }
+        }
+    }
+    ::close(fd);
+    return resident;
+}
+
+template <typename Target>
+std::vector<ScanTask> valueScanTasks(pid_t pid, const std::vector<MemoryRegion> &regions, size_t threadCount, const Target &target) {
+    std::vector<ScanTask> tasks = buildScanTasks(regions, threadCount);
+    // Offline sources have no page map to consult.
+    if (zeroCanMatch(target) || pid == 0) {
+        return tasks;
+    }
+    return dropAbsentPages(pid, regions, std::move(tasks));
+}
+
+} // namespace
+
+OffsetScanner::OffsetScanner(pid_t, std::vector<MemoryRegion> moduleRegions, ProcessMemoryReader reader)
+    : OffsetScanner(std::make_shared<ProcessMemoryReader>(std::move(reader)), std::move(moduleRegions)) {}
+
+OffsetScanner::OffsetScanner(std::shared_ptr<const MemorySource> source, std::vector<MemoryRegion> moduleRegions)
+    : source_(std::move(source)) {
+    setScope(std::move(moduleRegions));
 }
 
-OffsetScanner::OffsetScanner(pid_t pid, std::vector<MemoryRegion> moduleRegions, ProcessMemoryReader reader)
-    : pid_(pid), moduleRegions_(std::move(moduleRegions)), reader_(std::move(reader)) {
+void OffsetScanner::setScope(std::vector<MemoryRegion> moduleRegions) {
+    moduleRegions_ = std::move(moduleRegions);
     moduleBase_ = std::numeric_limits<uintptr_t>::max();
     for (const auto &region : moduleRegions_) {
         moduleBase_ = std::min(moduleBase_, region.start);
@@ -25,81 +379,647 @@ OffsetScanner::OffsetScanner(pid_t pid, std::vector<MemoryRegion> moduleRegions,
     }
 }
 
+void OffsetScanner::setThreadCount(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = ThreadPool::defaultThreadCount();
+    }
+    if (threadCount <= 1) {
+        pool_.reset();
+        return;
+    }
+    if (!pool_ || pool_->threadCount() != threadCount) {
+        pool_ = std::make_shared<ThreadPool>(threadCount);
+    }
+}
+
 std::vector<CandidateOffset> OffsetScanner::findCandidates(const Vector3 &target, float tolerance, size_t maxCandidates) const {
+    if (maxCandidates == 0) {
+        return {};
+    }
+    if (pool_) {
+        return findCandidatesParallel(target, tolerance, maxCandidates);
+    }
     std::vector<CandidateOffset> candidates;
-    std::vector<uint8_t> buffer;
-    std::unordered_set<uintptr_t> seenAddresses;
-    for (const auto &region : moduleRegions_) {
-        if (!region.isReadable()) {
-            continue;
+    const VectorKernels::MatchTarget matchTarget = VectorKernels::makeMatchTarget(valueType_, target, tolerance, fixedPointScale_);
+    const std::vector<ScanTask> tasks = valueScanTasks(source_->pid(), moduleRegions_, 1, matchTarget);
+    scanTasksPipelined(*source_, VectorKernels::select(kernel_, valueType_), VectorKernels::layoutOf(valueType_), tasks, matchTarget,
+                       [](size_t) -> TaskStats * { return nullptr; },
+                       [&](size_t taskIndex, uintptr_t address, const uint8_t *value) {
+                           candidates.push_back(
+                               {address, static_cast<ptrdiff_t>(address - moduleBase_), decode(value), tasks[taskIndex].regionStart});
+                           return candidates.size() < maxCandidates;
+                       },
+                       [](size_t) {});
+    return candidates;
+}
+
+std::vector<CandidateOffset> OffsetScanner::findCandidatesParallel(const Vector3 &target, float tolerance, size_t maxCandidates) const {
+    const VectorKernels::MatchTarget matchTarget = VectorKernels::makeMatchTarget(valueType_, target, tolerance, fixedPointScale_);
+    const std::vector<ScanTask> tasks = valueScanTasks(source_->pid(), moduleRegions_, pool_->threadCount(), matchTarget);
+
+    // Tasks are in address order. Once the tasks [0, k] are all finished and hold at
+    // least maxCandidates hits, nothing past k can make it into the result, so
+    // cutoffTask drops to k and later tasks stop or never start.
+    const VectorKernels::MatchFunction match = VectorKernels::select(kernel_, valueType_);
+    const VectorKernels::ValueLayout layout = VectorKernels::layoutOf(valueType_);
+    std::vector<std::vector<CandidateOffset>> taskResults(tasks.size());
+    std::vector<uint8_t> taskFinished(tasks.size(), 0);
+    std::atomic<size_t> cutoffTask{tasks.size()};
+    std::mutex progressMutex;
+    size_t finishedPrefix = 0;
+    size_t prefixHits = 0;
+
+    pool_->parallelFor(tasks.size(), [&](size_t taskIndex) {
+        std::vector<CandidateOffset> &results = taskResults[taskIndex];
+        if (taskIndex <= cutoffTask.load(std::memory_order_relaxed)) {
+            const ScanTask &task = tasks[taskIndex];
+            thread_local std::vector<uint8_t> buffer;
+            thread_local std::vector<uint32_t> matches;
+            scanRange(*source_, match, layout, task, matchTarget, buffer, matches, nullptr,
+                      [&](uintptr_t address, const uint8_t *value) {
+                          results.push_back({address, static_cast<ptrdiff_t>(address - moduleBase_), decode(value), task.regionStart});
+                          return results.size() < maxCandidates;
+                      },
+                      [&] { return taskIndex <= cutoffTask.load(std::memory_order_relaxed); });
         }
-        uintptr_t current = region.start;
-        while (current < region.end) {
-            const size_t bytesRemaining = static_cast<size_t>(region.end - current);
-            const size_t bytesToRead = std::min(scanChunkSize, bytesRemaining);
-            buffer.resize(bytesToRead);
-            if (!reader_.read(current, buffer.data(), bytesToRead)) {
-                current += bytesToRead;
-                continue;
-            }
-            if (bytesToRead < vectorSizeBytes) {
-                break;
-            }
-            const size_t lastStart = bytesToRead - vectorSizeBytes;
-            for (size_t offset = 0; offset <= lastStart; offset += sizeof(float)) {
-                Vector3 vector{};
-                std::memcpy(&vector.x, buffer.data() + offset, sizeof(float));
-                std::memcpy(&vector.y, buffer.data() + offset + sizeof(float), sizeof(float));
-                std::memcpy(&vector.z, buffer.data() + offset + 2 * sizeof(float), sizeof(float));
-                if (!approximatelyEqual(vector, target, tolerance)) {
-                    continue;
-                }
-                const uintptr_t absoluteAddress = current + offset;
-                if (seenAddresses.insert(absoluteAddress).second) {
-                    candidates.push_back({absoluteAddress, static_cast<ptrdiff_t>(absoluteAddress - moduleBase_), vector});
-                    if (candidates.size() >= maxCandidates) {
-                        return candidates;
-                    }
-                }
-            }
-            if (bytesToRead == bytesRemaining) {
+
+        std::lock_guard<std::mutex> lock(progressMutex);
+        taskFinished[taskIndex] = 1;
+        while (finishedPrefix < tasks.size() && taskFinished[finishedPrefix]) {
+            prefixHits += taskResults[finishedPrefix].size();
+            if (prefixHits >= maxCandidates) {
+                cutoffTask.store(finishedPrefix, std::memory_order_relaxed);
+                finishedPrefix = tasks.size();
                 break;
             }
-            uintptr_t next = current + bytesToRead;
-            if (chunkOverlap < bytesToRead) {
-                next -= chunkOverlap;
+            ++finishedPrefix;
+        }
+    });
+
+    std::vector<CandidateOffset> candidates;
+    const size_t lastTask = std::min(cutoffTask.load(), tasks.size() == 0 ? 0 : tasks.size() - 1);
+    for (size_t taskIndex = 0; taskIndex < tasks.size() && taskIndex <= lastTask; ++taskIndex) {
+        for (const auto &candidate : taskResults[taskIndex]) {
+            if (!candidates.empty() && candidates.back().address >= candidate.address) {
+                continue;
             }
-            if (next <= current) {
-                next = current + bytesToRead;
+            candidates.push_back(candidate);
+            if (candidates.size() >= maxCandidates) {
+                return candidates;
             }
-            current = next;
         }
     }
     return candidates;
 }
 
+bool OffsetScanner::streamCandidates(const Vector3 &target, float tolerance, const ScanSink &sink) const {
+    const VectorKernels::MatchTarget matchTarget = VectorKernels::makeMatchTarget(valueType_, target, tolerance, fixedPointScale_);
+    const VectorKernels::MatchFunction match = VectorKernels::select(kernel_, valueType_);
+    const VectorKernels::ValueLayout layout = VectorKernels::layoutOf(valueType_);
+    const std::vector<ScanTask> tasks = valueScanTasks(source_->pid(), moduleRegions_, threadCount(), matchTarget);
+    std::pmr::memory_resource *memory = sink.memory != nullptr ? sink.memory : std::pmr::get_default_resource();
+
+    // Each running task owns one slot of the batch storage; no more tasks run at
+    // once than there are threads, so a free slot is always left.
+    const size_t slotCount = threadCount();
+    std::pmr::vector<CandidateOffset> ownedHits(memory);
+    CandidateOffset *hitStorage = sink.hitBuffer;
+    size_t slotCapacity = sink.hitCapacity / slotCount;
+    if (hitStorage == nullptr || slotCapacity == 0) {
+        slotCapacity = 256;
+        ownedHits.resize(slotCount * slotCapacity);
+        hitStorage = ownedHits.data();
+    }
+    std::pmr::vector<size_t> freeSlots(memory);
+    for (size_t slot = slotCount; slot-- > 0;) {
+        freeSlots.push_back(slot);
+    }
+    // One read buffer per slot, reserved for the largest chunk here so the scan
+    // threads never allocate and memory is only used from this thread.
+    size_t largestRead = 0;
+    for (const auto &task : tasks) {
+        largestRead = std::max(largestRead, task.chunkSize + layout.size - layout.alignment);
+    }
+    std::pmr::vector<std::pmr::vector<uint8_t>> readBuffers(slotCount, memory);
+    for (auto &buffer : readBuffers) {
+        buffer.reserve(largestRead);
+    }
+
+    ScanProgress progress;
+    for (const auto &task : tasks) {
+        progress.totalBytes += task.end - task.begin;
+    }
+    size_t finishedTasks = 0;
+    std::mutex sinkMutex;
+    std::atomic<bool> stopped{false};
+    const auto keepGoing = [&] {
+        return !stopped.load(std::memory_order_relaxed) && (sink.cancel == nullptr || !sink.cancel->load(std::memory_order_relaxed));
+    };
+    const auto deliver = [&](const CandidateOffset *hits, size_t count) {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        progress.hits += count;
+        if (!stopped.load(std::memory_order_relaxed) && !sink.onHits(hits, count)) {
+            stopped.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    runTasks(tasks.size(), [&](size_t taskIndex) {
+        if (!keepGoing()) {
+            return;
+        }
+        const ScanTask &task = tasks[taskIndex];
+        size_t slot = 0;
+        {
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        CandidateOffset *batch = hitStorage + slot * slotCapacity;
+        size_t batchSize = 0;
+        std::pmr::vector<uint8_t> &buffer = readBuffers[slot];
+        thread_local std::vector<uint32_t> matches;
+        scanRange(*source_, match, layout, task, matchTarget, buffer, matches, nullptr,
+                  [&](uintptr_t address, const uint8_t *value) {
+                      batch[batchSize++] = {address, static_cast<ptrdiff_t>(address - moduleBase_), decode(value), task.regionStart};
+                      if (batchSize == slotCapacity) {
+                          deliver(batch, batchSize);
+                          batchSize = 0;
+                      }
+                      return keepGoing();
+                  },
+                  keepGoing);
+        if (batchSize != 0) {
+            deliver(batch, batchSize);
+        }
+
+        const bool finished = keepGoing();
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        freeSlots.push_back(slot);
+        if (finished) {
+            ++finishedTasks;
+            progress.bytesScanned += task.end - task.begin;
+            if (sink.onProgress) {
+                sink.onProgress(progress);
+            }
+        }
+    });
+    return finishedTasks == tasks.size();
+}
+
 std::vector<CandidateOffset> OffsetScanner::verifyCandidates(const std::vector<CandidateOffset> &candidates, const Vector3 &expected, float tolerance) const {
+    const size_t valueSize = VectorKernels::layoutOf(valueType_).size;
+    const VectorKernels::TestFunction test = VectorKernels::selectTest(valueType_);
+    const VectorKernels::MatchTarget matchTarget = VectorKernels::makeMatchTarget(valueType_, expected, tolerance, fixedPointScale_);
+    std::vector<ValueBytes> values(candidates.size());
+    std::vector<ReadRequest> requests(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        requests[i] = {candidates[i].address, values[i].data(), valueSize};
+    }
+    source_->readBatch(requests);
+
     std::vector<CandidateOffset> filtered;
     filtered.reserve(candidates.size());
-    for (const auto &candidate : candidates) {
-        Vector3 currentVector;
-        if (!readVector(candidate.address, currentVector)) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!requests[i].succeeded) {
             continue;
         }
-        if (approximatelyEqual(currentVector, expected, tolerance)) {
-            CandidateOffset updated = candidate;
-            updated.value = currentVector;
+        if (test(values[i].data(), matchTarget)) {
+            CandidateOffset updated = candidates[i];
+            updated.value = decode(values[i].data());
             filtered.push_back(updated);
         }
     }
     return filtered;
 }
 
+void OffsetScanner::runTasks(size_t taskCount, const std::function<void(size_t)> &task) const {
+    ThreadPool::run(pool_.get(), taskCount, task);
+}
+
+CandidateSet OffsetScanner::findCandidateSet(const Vector3 &target, float tolerance) const {
+    const size_t phase = stats_ != nullptr ? stats_->beginPhase("scan", *source_) : 0;
+    const VectorKernels::MatchFunction match = VectorKernels::select(kernel_, valueType_);
+    const VectorKernels::ValueLayout layout = VectorKernels::layoutOf(valueType_);
+    const VectorKernels::MatchTarget matchTarget = VectorKernels::makeMatchTarget(valueType_, target, tolerance, fixedPointScale_);
+    const std::vector<ScanTask> tasks = valueScanTasks(source_->pid(), moduleRegions_, threadCount(), matchTarget);
+    std::vector<CandidateSet::Block> blocks(tasks.size());
+    const auto finishTask = [&](size_t taskIndex, uint64_t taskStart, TaskStats &taskStats) {
+        if (stats_ != nullptr) {
+            stats_->endTask(phase, *ProcessUtils::findRegionContaining(moduleRegions_, tasks[taskIndex].regionStart), taskStart, taskStats);
+        }
+    };
+
+    if (!pool_) {
+        std::optional<CandidateSet::BlockBuilder> builder;
+        TaskStats taskStats;
+        uint64_t taskStart = 0;
+        scanTasksPipelined(*source_, match, layout, tasks, matchTarget,
+                           [&](size_t taskIndex) {
+                               const ScanTask &task = tasks[taskIndex];
+                               builder.emplace(task.begin, static_cast<size_t>(task.end - task.begin));
+                               taskStart = stats_ != nullptr ? ScanStats::now() : 0;
+                               taskStats = stats_ != nullptr ? stats_->beginTask() : TaskStats{};
+                               return stats_ != nullptr ? &taskStats : nullptr;
+                           },
+                           [&](size_t, uintptr_t address, const uint8_t *) {
+                               builder->add(address);
+                               return true;
+                           },
+                           [&](size_t taskIndex) {
+                               blocks[taskIndex] = builder->finish();
+                               finishTask(taskIndex, taskStart, taskStats);
+                           });
+    } else {
+        runTasks(tasks.size(), [&](size_t taskIndex) {
+            const ScanTask &task = tasks[taskIndex];
+            thread_local std::vector<uint8_t> buffer;
+            thread_local std::vector<uint32_t> matches;
+            const uint64_t taskStart = stats_ != nullptr ? ScanStats::now() : 0;
+            TaskStats taskStats = stats_ != nullptr ? stats_->beginTask() : TaskStats{};
+            CandidateSet::BlockBuilder builder(task.begin, static_cast<size_t>(task.end - task.begin));
+            scanRange(*source_, match, layout, task, matchTarget, buffer, matches, stats_ != nullptr ? &taskStats : nullptr,
+                      [&](uintptr_t address, const uint8_t *) {
+                          builder.add(address);
+                          return true;
+                      },
+                      [] { return true; });
+            blocks[taskIndex] = builder.finish();
+            finishTask(taskIndex, taskStart, taskStats);
+        });
+    }
+
+    CandidateSet candidates;
+    for (auto &block : blocks) {
+        candidates.append(std::move(block));
+    }
+    if (stats_ != nullptr) {
+        stats_->endPhase(phase, *source_, candidates.size());
+    }
+    return candidates;
+}
+
+std::vector<TargetHit> OffsetScanner::findTargetHits(const std::vector<Vector3> &targets, float tolerance, size_t maxHits) const {
+    if (targets.empty() || maxHits == 0) {
+        return {};
+    }
+    const size_t phase = stats_ != nullptr ? stats_->beginPhase("scan", *source_) : 0;
+    const VectorKernels::MatchFunction match = VectorKernels::select(kernel_, valueType_);
+    const VectorKernels::ValueLayout layout = VectorKernels::layoutOf(valueType_);
+    std::vector<VectorKernels::MatchTarget> matchTargets;
+    for (const auto &target : targets) {
+        matchTargets.push_back(VectorKernels::makeMatchTarget(valueType_, target, tolerance, fixedPointScale_));
+    }
+    const VectorKernels::MultiMatcher matcher(kernel_, valueType_, std::move(matchTargets));
+    const std::vector<ScanTask> tasks = valueScanTasks(source_->pid(), moduleRegions_, threadCount(), matcher);
+    std::vector<std::vector<TargetHit>> taskHits(tasks.size());
+    const auto finishTask = [&](size_t taskIndex, uint64_t taskStart, TaskStats &taskStats) {
+        if (stats_ != nullptr) {
+            stats_->endTask(phase, *ProcessUtils::findRegionContaining(moduleRegions_, tasks[taskIndex].regionStart), taskStart, taskStats);
+        }
+    };
+
+    if (!pool_) {
+        TaskStats taskStats;
+        uint64_t taskStart = 0;
+        size_t hitCount = 0;
+        scanTasksPipelined(*source_, match, layout, tasks, matcher,
+                           [&](size_t) {
+                               taskStart = stats_ != nullptr ? ScanStats::now() : 0;
+                               taskStats = stats_ != nullptr ? stats_->beginTask() : TaskStats{};
+                               return stats_ != nullptr ? &taskStats : nullptr;
+                           },
+                           [&](size_t taskIndex, uintptr_t address, const uint8_t *value, size_t targetIndex) {
+                               taskHits[taskIndex].push_back({address, static_cast<uint32_t>(targetIndex), decode(value)});
+                               return ++hitCount < maxHits;
+                           },
+                           [&](size_t taskIndex) { finishTask(taskIndex, taskStart, taskStats); });
+    } else {
+        // The cutoff of findCandidatesParallel: once the tasks [0, k] are finished
+        // and hold maxHits hits, later tasks stop or never start, so the hits kept
+        // are the lowest ones whatever order the tasks ran in.
+        std::vector<uint8_t> taskFinished(tasks.size(), 0);
+        std::atomic<size_t> cutoffTask{tasks.size()};
+        std::mutex progressMutex;
+        size_t finishedPrefix = 0;
+        size_t prefixHits = 0;
+        runTasks(tasks.size(), [&](size_t taskIndex) {
+            std::vector<TargetHit> &results = taskHits[taskIndex];
+            if (taskIndex <= cutoffTask.load(std::memory_order_relaxed)) {
+                thread_local std::vector<uint8_t> buffer;
+                thread_local std::vector<uint32_t> matches;
+                const uint64_t taskStart = stats_ != nullptr ? ScanStats::now() : 0;
+                TaskStats taskStats = stats_ != nullptr ? stats_->beginTask() : TaskStats{};
+                scanRange(*source_, match, layout, tasks[taskIndex], matcher, buffer, matches,
+                          stats_ != nullptr ? &taskStats : nullptr,
+                          [&](uintptr_t address, const uint8_t *value, size_t targetIndex) {
+                              results.push_back({address, static_cast<uint32_t>(targetIndex), decode(value)});
+                              return results.size() < maxHits;
+                          },
+                          [&] { return taskIndex <= cutoffTask.load(std::memory_order_relaxed); });
+                finishTask(taskIndex, taskStart, taskStats);
+            }
+
+            std::lock_guard<std::mutex> lock(progressMutex);
+            taskFinished[taskIndex] = 1;
+            while (finishedPrefix < tasks.size() && taskFinished[finishedPrefix]) {
+                prefixHits += taskHits[finishedPrefix].size();
+                if (prefixHits >= maxHits) {
+                    cutoffTask.store(finishedPrefix, std::memory_order_relaxed);
+                    finishedPrefix = tasks.size();
+                    break;
+                }
+                ++finishedPrefix;
+            }
+        });
+    }
+
+    std::vector<TargetHit> hits;
+    for (const auto &block : taskHits) {
+        hits.insert(hits.end(), block.begin(), std::min(block.end(), block.begin() + static_cast<ptrdiff_t>(maxHits - hits.size())));
+        if (hits.size() == maxHits) {
+            break;
+        }
+    }
+    if (stats_ != nullptr) {
+        stats_->endPhase(phase, *source_, hits.size());
+    }
+    return hits;
+}
+
+CandidateSet OffsetScanner::verifyCandidateSet(const CandidateSet &candidates, const Vector3 &expected, float tolerance) const {
+    constexpr size_t sparseBatchSize = 512;
+    const size_t phase = stats_ != nullptr ? stats_->beginPhase("verify", *source_, candidates.size()) : 0;
+    const size_t valueSize = VectorKernels::layoutOf(valueType_).size;
+    const VectorKernels::TestFunction test = VectorKernels::selectTest(valueType_);
+    const VectorKernels::MatchTarget matchTarget = VectorKernels::makeMatchTarget(valueType_, expected, tolerance, fixedPointScale_);
+    const auto &inputBlocks = candidates.blocks();
+    std::vector<CandidateSet::Block> blocks(inputBlocks.size());
+    runTasks(inputBlocks.size(), [&](size_t blockIndex) {
+        const CandidateSet::Block &block = inputBlocks[blockIndex];
+        CandidateSet::BlockBuilder builder(block.base, block.slotCount * CandidateSet::slotSize);
+        thread_local std::vector<uintptr_t> pending;
+        thread_local std::vector<ValueBytes> values;
+        thread_local std::vector<ReadRequest> requests;
+        pending.clear();
+
+        const auto flushPending = [&] {
+            values.resize(pending.size());
+            requests.resize(pending.size());
+            for (size_t i = 0; i < pending.size(); ++i) {
+                requests[i] = {pending[i], values[i].data(), valueSize};
+            }
+            source_->readBatch(requests);
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (requests[i].succeeded && test(values[i].data(), matchTarget)) {
+                    builder.add(pending[i]);
+                }
+            }
+            pending.clear();
+        };
+
+        if (block.encoding == CandidateSet::Encoding::Delta) {
+            block.forEach([&](uintptr_t address) {
+                pending.push_back(address);
+                if (pending.size() == sparseBatchSize) {
+                    flushPending();
+                }
+            });
+            flushPending();
+        } else {
+            // Dense blocks are re-read chunk by chunk; a chunk that cannot be read in
+            // one piece falls back to per-candidate batched reads.
+            thread_local std::vector<uint8_t> buffer;
+            uintptr_t chunkStart = block.base;
+            uintptr_t chunkEnd = std::min<uintptr_t>(block.base + scanChunkSize, block.end());
+            uintptr_t lastInChunk = 0;
+            bool chunkHasHits = false;
+            const auto flushChunk = [&] {
+                if (!chunkHasHits) {
+                    return;
+                }
+                const size_t bytesToRead = static_cast<size_t>(lastInChunk + valueSize - chunkStart);
+                buffer.resize(bytesToRead);
+                if (!source_->read(chunkStart, buffer.data(), bytesToRead)) {
+                    flushPending();
+                    return;
+                }
+                for (const uintptr_t address : pending) {
+                    if (test(buffer.data() + (address - chunkStart), matchTarget)) {
+                        builder.add(address);
+                    }
+                }
+                pending.clear();
+            };
+            block.forEach([&](uintptr_t address) {
+                if (address >= chunkEnd) {
+                    flushChunk();
+                    chunkHasHits = false;
+                    chunkStart = block.base + (address - block.base) / scanChunkSize * scanChunkSize;
+                    chunkEnd = std::min<uintptr_t>(chunkStart + scanChunkSize, block.end());
+                }
+                pending.push_back(address);
+                lastInChunk = address;
+                chunkHasHits = true;
+            });
+            flushChunk();
+        }
+        blocks[blockIndex] = builder.finish();
+    });
+
+    CandidateSet filtered;
+    for (auto &block : blocks) {
+        filtered.append(std::move(block));
+    }
+    if (stats_ != nullptr) {
+        stats_->endPhase(phase, *source_, filtered.size());
+    }
+    return filtered;
+}
+
+std::vector<MemoryRegion> OffsetScanner::snapshotRegions() const {
+    std::vector<MemoryRegion> regions;
+    for (const auto &region : moduleRegions_) {
+        if (region.isReadable()) {
+            regions.push_back(region);
+        }
+    }
+    return regions;
+}
+
+void OffsetScanner::captureSnapshot(MemorySnapshot::Writer &writer) const {
+    const std::vector<ScanTask> tasks = buildScanTasks(moduleRegions_, threadCount());
+    runTasks(tasks.size(), [&](size_t taskIndex) {
+        const ScanTask &task = tasks[taskIndex];
+        thread_local std::vector<uint8_t> buffer;
+        thread_local std::vector<ReadSpan> spans;
+        for (uintptr_t chunk = task.begin; chunk < task.end; chunk += scanChunkSize) {
+            const size_t chunkBytes = std::min(scanChunkSize, static_cast<size_t>(task.end - chunk));
+            buffer.resize(chunkBytes);
+            spans.clear();
+            source_->readAvailable(chunk, buffer.data(), chunkBytes, spans);
+            writeSpans(writer, chunk, buffer.data(), chunkBytes, spans);
+        }
+    });
+}
+
+CandidateSet OffsetScanner::compareWithSnapshot(const MemorySnapshot &previous, const CandidateSet *candidates,
+                                                const SnapshotComparison &comparison, MemorySnapshot::Writer *next,
+                                                const PageStates *pages) const {
+    const size_t phase = stats_ != nullptr ? stats_->beginPhase("compare", *source_, candidates != nullptr ? candidates->size() : 0) : 0;
+    const std::vector<ScanTask> tasks = buildScanTasks(moduleRegions_, threadCount());
+    const size_t valueBytes = comparison.valueSize();
+    const size_t overlap = valueBytes - CandidateSet::slotSize;
+    std::vector<CandidateSet::Block> blocks(tasks.size());
+    runTasks(tasks.size(), [&](size_t taskIndex) {
+        const ScanTask &task = tasks[taskIndex];
+        thread_local std::vector<uint8_t> current;
+        thread_local std::vector<uint8_t> copied;
+        thread_local std::vector<ReadSpan> spans;
+        const uint64_t taskStart = stats_ != nullptr ? ScanStats::now() : 0;
+        TaskStats taskStats = stats_ != nullptr ? stats_->beginTask() : TaskStats{};
+        CandidateSet::BlockBuilder builder(task.begin, static_cast<size_t>(task.end - task.begin));
+        for (uintptr_t chunk = task.begin; chunk < task.end; chunk += scanChunkSize) {
+            const size_t chunkBytes = std::min(scanChunkSize, static_cast<size_t>(task.end - chunk));
+            const size_t bytesToRead = std::min(chunkBytes + overlap, static_cast<size_t>(task.regionEnd - chunk));
+            current.resize(bytesToRead);
+            // The previous contents are fetched first so that, with page states,
+            // clean pages can be taken from them instead of being read again.
+            const uint8_t *old = previous.view(chunk, bytesToRead);
+            if (old == nullptr) {
+                copied.resize(bytesToRead);
+                old = previous.copyRange(chunk, bytesToRead, copied.data()) ? copied.data() : nullptr;
+            }
+            const uint64_t readStart = stats_ != nullptr ? ScanStats::now() : 0;
+            spans.clear();
+            if (pages != nullptr && old != nullptr && readChangedPages(*source_, *pages, chunk, bytesToRead, old, current.data())) {
+                spans.push_back({0, bytesToRead});
+            } else {
+                // A dirty run that faulted costs the incremental read, not the chunk.
+                source_->readAvailable(chunk, current.data(), bytesToRead, spans);
+            }
+            if (stats_ != nullptr) {
+                taskStats.readNanoseconds += taskStats.endSpan("read", readStart);
+                countChunk(taskStats, chunkBytes, bytesToRead, spans);
+            }
+            if (next != nullptr) {
+                writeSpans(*next, chunk, current.data(), chunkBytes, spans);
+            }
+            const uint64_t compareStart = stats_ != nullptr ? ScanStats::now() : 0;
+            // Previous contents from oldStart on: the whole chunk, or one span.
+            const uint8_t *oldData = old;
+            uintptr_t oldStart = chunk;
+            const auto test = [&](uintptr_t address) {
+                if (comparison.matches(oldData + (address - oldStart), current.data() + (address - chunk))) {
+                    builder.add(address);
+                    ++taskStats.candidates;
+                }
+            };
+            // Only slots whose whole value lies in one readable span are compared.
+            for (const auto &span : spans) {
+                if (span.offset >= chunkBytes || span.size < valueBytes) {
+                    continue;
+                }
+                const uintptr_t scanStart = chunk + span.offset;
+                if (old == nullptr) {
+                    // The previous step could not read all of the chunk either; its
+                    // readable pages are looked up span by span.
+                    const uint8_t *spanOld = previous.view(scanStart, span.size);
+                    if (spanOld == nullptr && previous.copyRange(scanStart, span.size, copied.data() + span.offset)) {
+                        spanOld = copied.data() + span.offset;
+                    }
+                    if (spanOld == nullptr) {
+                        continue;
+                    }
+                    oldData = spanOld;
+                    oldStart = scanStart;
+                }
+                const uintptr_t scanEnd = scanStart + std::min(span.size - valueBytes, chunkBytes - span.offset - 1) + 1;
+                if (candidates != nullptr) {
+                    candidates->forEachInRange(scanStart, scanEnd, test);
+                } else {
+                    for (uintptr_t address = scanStart; address < scanEnd; address += CandidateSet::slotSize) {
+                        test(address);
+                    }
+                }
+            }
+            if (stats_ != nullptr) {
+                taskStats.compareNanoseconds += taskStats.endSpan("compare", compareStart);
+            }
+        }
+        blocks[taskIndex] = builder.finish();
+        if (stats_ != nullptr) {
+            stats_->endTask(phase, *ProcessUtils::findRegionContaining(moduleRegions_, task.regionStart), taskStart, taskStats);
+        }
+    });
+
+    CandidateSet result;
+    for (auto &block : blocks) {
+        result.append(std::move(block));
+    }
+    if (stats_ != nullptr) {
+        stats_->endPhase(phase, *source_, result.size());
+    }
+    return result;
+}
+
+std::vector<CandidateOffset> OffsetScanner::candidatesFromSet(const CandidateSet &candidates, size_t maxCount) const {
+    return readCandidates(candidates, maxCount, VectorKernels::layoutOf(valueType_).size,
+                          [this](const uint8_t *value) { return decode(value); });
+}
+
+std::vector<CandidateOffset> OffsetScanner::candidatesFromSet(const CandidateSet &candidates, size_t maxCount,
+                                                              SnapshotValueKind kind) const {
+    SnapshotComparison comparison;
+    comparison.kind = kind;
+    return readCandidates(candidates, maxCount, comparison.valueSize(), [kind](const uint8_t *value) {
+        if (kind == SnapshotValueKind::Float) {
+            float x = 0.0f;
+            std::memcpy(&x, value, sizeof(x));
+            return Vector3{x, 0.0f, 0.0f};
+        }
+        return VectorKernels::decodeValue(VectorKernels::ValueType::Vec3f, value, 1.0);
+    });
+}
+
+std::vector<CandidateOffset> OffsetScanner::readCandidates(const CandidateSet &candidates, size_t maxCount, size_t valueSize,
+                                                           const std::function<Vector3(const uint8_t *)> &decodeValue) const {
+    std::vector<uintptr_t> addresses;
+    addresses.reserve(std::min(maxCount, candidates.size()));
+    CandidateSet::Cursor cursor(candidates);
+    uintptr_t address = 0;
+    while (addresses.size() < maxCount && cursor.next(address)) {
+        addresses.push_back(address);
+    }
+
+    std::vector<ValueBytes> values(addresses.size());
+    std::vector<ReadRequest> requests(addresses.size());
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        requests[i] = {addresses[i], values[i].data(), valueSize};
+    }
+    source_->readBatch(requests);
+
+    std::vector<CandidateOffset> result;
+    result.reserve(addresses.size());
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        if (!requests[i].succeeded) {
+            continue;
+        }
+        const MemoryRegion *region = ProcessUtils::findRegionContaining(moduleRegions_, addresses[i]);
+        result.push_back({addresses[i], static_cast<ptrdiff_t>(addresses[i] - moduleBase_),
+                          decodeValue(values[i].data()), region != nullptr ? region->start : 0});
+    }
+    return result;
+}
+
 bool OffsetScanner::readVector(uintptr_t address, Vector3 &out) const {
-    std::array<float, 3> values{};
-    if (!reader_.read(address, values.data(), sizeof(values))) {
+    ValueBytes value{};
+    if (!source_->read(address, value.data(), VectorKernels::layoutOf(valueType_).size)) {
         return false;
     }
-    out = Vector3{values[0], values[1], values[2]};
+    out = decode(value.data());
     return true;
 }
+
+Vector3 OffsetScanner::decode(const uint8_t *value) const {
+    return VectorKernels::decodeValue(valueType_, value, fixedPointScale_);
+}
@@ -1,34 +1,174 @@
 #pragma once
 
+#include "CandidateSet.h"
+#include "MemorySnapshot.h"
+#include "MemorySource.h"
 #include "ProcessMemoryReader.h"
 #include "ProcessUtils.h"
+#include "ThreadPool.h"
 #include "Vector3.h"
+#include "VectorMatchKernels.h"
 
+#include <atomic>
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <vector>
 
+class PageStates;
+class ScanStats;
+
 struct CandidateOffset {
     uintptr_t address{};
     ptrdiff_t offsetFromModule{};
     Vector3 value{};
+    uintptr_t regionStart{};
+
+    ptrdiff_t offsetFromRegion() const { return static_cast<ptrdiff_t>(address - regionStart); }
+};
+
+// An address holding a value that matched targets[target] of a multi-target scan.
+struct TargetHit {
+    uintptr_t address{};
+    uint32_t target{};
+    Vector3 value{};
+};
+
+// How far a streamed scan got. Bytes count whole scan tasks, so the figure
+// advances in steps of a few MiB.
+struct ScanProgress {
+    size_t bytesScanned{};
+    size_t totalBytes{};
+    size_t hits{};
+};
+
+// Where streamCandidates delivers its results. Callbacks are serialized, so they
+// need not be thread-safe, but they run on the scan workers and should return
+// quickly.
+struct ScanSink {
+    // Receives the hits in batches, in address order within a batch; batches from
+    // different parts of the scope arrive in no particular order. The pointer is
+    // only valid during the call. Returning false stops the scan.
+    std::function<bool(const CandidateOffset *hits, size_t count)> onHits;
+    // Optional; called whenever a scan task finished.
+    std::function<void(const ScanProgress &progress)> onProgress;
+    // Optional; polled between chunks, the scan stops soon after it turns true.
+    const std::atomic<bool> *cancel{};
+    // Optional storage for the batches, split evenly among the scan threads, so a
+    // batch holds up to hitCapacity / threadCount() hits. Without it (or with
+    // fewer entries than threads) it is allocated from memory once per scan.
+    CandidateOffset *hitBuffer{};
+    size_t hitCapacity{};
+    // Source of the read buffers and of the batch storage; null uses the default
+    // resource. Everything is allocated up front on the calling thread, so it need
+    // not be thread-safe, and nothing is allocated per hit.
+    std::pmr::memory_resource *memory{};
 };
 
 class OffsetScanner {
 public:
+    // moduleRegions is the scan scope: the mappings of one module, or any set of
+    // mappings picked with ProcessUtils::filterRegions for a whole-process scan.
+    // It must be sorted by address.
     OffsetScanner(pid_t pid, std::vector<MemoryRegion> moduleRegions, ProcessMemoryReader reader);
+    // Scans any memory source, e.g. a core dump or snapshot opened with
+    // openMemoryCapture, with moduleRegions taken from its regions().
+    OffsetScanner(std::shared_ptr<const MemorySource> source, std::vector<MemoryRegion> moduleRegions);
+
+    // Replaces the scan scope, e.g. after the mappings changed, and keeps the
+    // reader, thread pool and settings.
+    void setScope(std::vector<MemoryRegion> moduleRegions);
 
     std::vector<CandidateOffset> findCandidates(const Vector3 &target, float tolerance, size_t maxCandidates = 256) const;
+    // Streaming form of findCandidates for library callers: hits go to sink as the
+    // scan finds them instead of being collected, with no cap on their number.
+    // Returns true when the whole scope was scanned, false when onHits or cancel
+    // stopped it early.
+    bool streamCandidates(const Vector3 &target, float tolerance, const ScanSink &sink) const;
     std::vector<CandidateOffset> verifyCandidates(const std::vector<CandidateOffset> &candidates, const Vector3 &expected, float tolerance) const;
 
+    // Uncapped variants of the two passes. Hits are kept in a CandidateSet, which
+    // stores them as bitmaps or delta runs per scan task instead of one
+    // CandidateOffset each.
+    CandidateSet findCandidateSet(const Vector3 &target, float tolerance) const;
+    CandidateSet verifyCandidateSet(const CandidateSet &candidates, const Vector3 &expected, float tolerance) const;
+    // Reads the scope once and tests every chunk against all targets with a
+    // VectorKernels::MultiMatcher, so the cost grows with the bytes scanned rather
+    // than bytes times targets. Hits come in address order; the scan stops once
+    // maxHits were found.
+    std::vector<TargetHit> findTargetHits(const std::vector<Vector3> &targets, float tolerance, size_t maxHits = 1u << 20) const;
+    // Unknown-value scans. captureSnapshot stores the readable scope regions;
+    // compareWithSnapshot tests every slot (or only the ones in candidates) against
+    // the same address in previous and keeps those satisfying comparison. The
+    // memory read by the comparison is written to next when given, so it becomes
+    // the baseline of the following step without a second read. With pages, only
+    // pages that are soft-dirty (written since previous was captured) are read;
+    // the others are taken from previous.
+    std::vector<MemoryRegion> snapshotRegions() const;
+    void captureSnapshot(MemorySnapshot::Writer &writer) const;
+    CandidateSet compareWithSnapshot(const MemorySnapshot &previous, const CandidateSet *candidates,
+                                     const SnapshotComparison &comparison, MemorySnapshot::Writer *next,
+                                     const PageStates *pages = nullptr) const;
+
+    // Reads the current value of the first maxCount addresses in the set.
+    std::vector<CandidateOffset> candidatesFromSet(const CandidateSet &candidates, size_t maxCount) const;
+    // The same for a set left by compareWithSnapshot, whose values are kind rather
+    // than the scanner's value type. A float is returned as x.
+    std::vector<CandidateOffset> candidatesFromSet(const CandidateSet &candidates, size_t maxCount,
+                                                   SnapshotValueKind kind) const;
+
+    // Number of worker threads used by findCandidates; 0 selects one per core and
+    // 1 keeps the single-threaded scan.
+    void setThreadCount(size_t threadCount);
+    size_t threadCount() const { return pool_ ? pool_->threadCount() : 1; }
+    // Shares pool with other scanners; null scans single-threaded.
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { pool_ = std::move(pool); }
+
+    // Compare kernel used by findCandidates; defaults to the best one the CPU
+    // supports. Unsupported kernels fall back to the scalar path.
+    void setKernel(VectorKernels::KernelKind kernel) { kernel_ = kernel; }
+    VectorKernels::KernelKind kernel() const { return kernel_; }
+
+    // Memory layout of the searched value; defaults to three packed floats. Vec3i
+    // coordinates are divided by fixedPointScale to get world units.
+    void setValueType(VectorKernels::ValueType type, double fixedPointScale = 1.0) {
+        valueType_ = type;
+        fixedPointScale_ = fixedPointScale;
+    }
+    VectorKernels::ValueType valueType() const { return valueType_; }
+    double fixedPointScale() const { return fixedPointScale_; }
+
+    // Instrumentation for the set-based passes and compareWithSnapshot; null (the
+    // default) disables it. The stats object must outlive the scans.
+    void setStats(ScanStats *stats) { stats_ = stats; }
+
+    // Address module offsets are relative to: the lowest scope address unless set,
+    // e.g. when the scope leaves out the module's first mapping. setScope resets it.
+    void setModuleBase(uintptr_t base) { moduleBase_ = base; }
     uintptr_t moduleBase() const { return moduleBase_; }
+    const MemorySource &reader() const { return *source_; }
+    // Scans read from source from now on, e.g. a FrozenCopy of the scope.
+    void setSource(std::shared_ptr<const MemorySource> source) { source_ = std::move(source); }
+    // Null when scans run single-threaded.
+    ThreadPool *threadPool() const { return pool_.get(); }
     const std::vector<MemoryRegion> &moduleRegions() const { return moduleRegions_; }
 
 private:
     bool readVector(uintptr_t address, Vector3 &out) const;
+    Vector3 decode(const uint8_t *value) const;
+    std::vector<CandidateOffset> readCandidates(const CandidateSet &candidates, size_t maxCount, size_t valueSize,
+                                                const std::function<Vector3(const uint8_t *)> &decodeValue) const;
+    void runTasks(size_t taskCount, const std::function<void(size_t)> &task) const;
+    std::vector<CandidateOffset> findCandidatesParallel(const Vector3 &target, float tolerance, size_t maxCandidates) const;
 
-    pid_t pid_{};
+    std::shared_ptr<const MemorySource> source_;
     std::vector<MemoryRegion> moduleRegions_;
     uintptr_t moduleBase_{};
-    ProcessMemoryReader reader_;
+    std::shared_ptr<ThreadPool> pool_;
+    VectorKernels::KernelKind kernel_{VectorKernels::bestSupported()};
+    VectorKernels::ValueType valueType_{VectorKernels::ValueType::Vec3f};
+    double fixedPointScale_{1.0};
+    ScanStats *stats_{};
 };
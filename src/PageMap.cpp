@@ -0,0 +1,154 @@
+#include "PageMap.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+bool writeClearRefs(const std::string &path, std::string &error) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    const bool written = ::write(fd, "4", 1) == 1;
+    if (!written) {
+        error = "cannot write " + path + ": " + std::strerror(errno);
+    }
+    ::close(fd);
+    return written;
+}
+
+bool probeSoftDirty() {
+    void *page = ::mmap(nullptr, PageMap::pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        return false;
+    }
+    auto *bytes = static_cast<volatile uint8_t *>(page);
+    bytes[0] = 1;
+    bool supported = false;
+    std::string error;
+    const int fd = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0 && writeClearRefs("/proc/self/clear_refs", error)) {
+        uint64_t entry = 0;
+        bytes[0] = 2;
+        supported = PageMap::readEntries(fd, reinterpret_cast<uintptr_t>(page), 1, &entry) &&
+                    (entry & PageMap::softDirtyBit) != 0;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    ::munmap(page, PageMap::pageSize);
+    return supported;
+}
+
+// Pages the region touches, counted by absolute page number: a region that
+// starts or ends inside a page still has an entry for that page.
+size_t pagesSpanned(const MemoryRegion &region) {
+    if (region.end <= region.start) {
+        return 0;
+    }
+    return (region.end - 1) / PageMap::pageSize - region.start / PageMap::pageSize + 1;
+}
+
+} // namespace
+
+namespace PageMap {
+
+bool softDirtySupported() {
+    static const bool supported = probeSoftDirty();
+    return supported;
+}
+
+bool clearSoftDirty(pid_t pid, std::string &error) {
+    return writeClearRefs("/proc/" + std::to_string(pid) + "/clear_refs", error);
+}
+
+bool readEntries(int pagemapFd, uintptr_t address, size_t pageCount, uint64_t *entries) {
+    auto *out = reinterpret_cast<uint8_t *>(entries);
+    size_t remaining = pageCount * sizeof(uint64_t);
+    off_t offset = static_cast<off_t>(address / pageSize * sizeof(uint64_t));
+    while (remaining > 0) {
+        const ssize_t count = ::pread(pagemapFd, out, remaining, offset);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        out += count;
+        offset += count;
+        remaining -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+bool isAnonymous(const MemoryRegion &region) {
+    const RegionKind kind = region.kind();
+    return kind == RegionKind::Anonymous || kind == RegionKind::Heap || kind == RegionKind::Stack;
+}
+
+PageState classify(uint64_t entry, bool anonymous) {
+    if ((entry & softDirtyBit) != 0) {
+        return PageState::Dirty;
+    }
+    if ((entry & (presentBit | swappedBit)) != 0) {
+        return PageState::Clean;
+    }
+    // A page dropped with MADV_DONTNEED loses its soft-dirty bit along with the
+    // page table entry, so absence has to be judged on its own.
+    return anonymous ? PageState::Zero : PageState::Dirty;
+}
+
+}
+
+std::optional<PageStates> PageStates::capture(pid_t pid, const std::vector<MemoryRegion> &regions, std::string &error) {
+    const std::string path = "/proc/" + std::to_string(pid) + "/pagemap";
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    PageStates states;
+    states.regions_ = regions;
+    size_t totalPages = 0;
+    size_t largestRegion = 0;
+    for (const auto &region : regions) {
+        const size_t pages = pagesSpanned(region);
+        states.regionFirstPage_.push_back(totalPages);
+        totalPages += pages;
+        largestRegion = std::max(largestRegion, pages);
+    }
+    states.states_.resize(totalPages);
+    std::vector<uint64_t> entries(largestRegion);
+    for (size_t i = 0; i < regions.size(); ++i) {
+        const MemoryRegion &region = regions[i];
+        const size_t pages = pagesSpanned(region);
+        if (!PageMap::readEntries(fd, region.start - region.start % PageMap::pageSize, pages, entries.data())) {
+            // Treat a region that vanished as dirty; the scan's own read decides.
+            std::fill_n(entries.begin(), pages, PageMap::softDirtyBit);
+        }
+        const bool anonymous = PageMap::isAnonymous(region);
+        PageMap::PageState *out = states.states_.data() + states.regionFirstPage_[i];
+        for (size_t page = 0; page < pages; ++page) {
+            out[page] = PageMap::classify(entries[page], anonymous);
+            states.dirtyPages_ += out[page] == PageMap::PageState::Dirty ? 1 : 0;
+            states.zeroPages_ += out[page] == PageMap::PageState::Zero ? 1 : 0;
+        }
+    }
+    ::close(fd);
+    return states;
+}
+
+const PageMap::PageState *PageStates::states(uintptr_t address, size_t size) const {
+    const MemoryRegion *region = ProcessUtils::findRegionContaining(regions_, address);
+    if (region == nullptr || size > region->end - address) {
+        return nullptr;
+    }
+    const size_t index = static_cast<size_t>(region - regions_.data());
+    return states_.data() + regionFirstPage_[index] + (address / PageMap::pageSize - region->start / PageMap::pageSize);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ProcessUtils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Access to /proc/<pid>/pagemap and the soft-dirty bits behind it. Every page of
+// the address space has a 64-bit entry; only the flag bits are used here, which
+// are readable by anyone allowed to ptrace the process.
+namespace PageMap {
+
+constexpr size_t pageSize = 4096;
+constexpr uint64_t softDirtyBit = uint64_t{1} << 55;
+constexpr uint64_t swappedBit = uint64_t{1} << 62;
+constexpr uint64_t presentBit = uint64_t{1} << 63;
+
+enum class PageState {
+    // Not written since the soft-dirty bits were last cleared.
+    Clean,
+    // Written since the last clear, or of unknown content: must be read.
+    Dirty,
+    // Anonymous page that is neither resident nor swapped; it reads as zeros.
+    Zero,
+};
+
+// Whether the running kernel tracks soft-dirty bits. Probed once by clearing the
+// bits of this process and checking that a page written afterwards reports dirty.
+bool softDirtySupported();
+// Writes "4" to /proc/<pid>/clear_refs, which clears the soft-dirty bit of every
+// page of pid.
+bool clearSoftDirty(pid_t pid, std::string &error);
+
+// Entries for pageCount pages starting at the page-aligned address.
+bool readEntries(int pagemapFd, uintptr_t address, size_t pageCount, uint64_t *entries);
+
+// Anonymous, heap and stack mappings, whose untouched pages read as zeros.
+bool isAnonymous(const MemoryRegion &region);
+// anonymous selects how a non-resident page is treated: it reads as zeros in an
+// anonymous mapping but comes from the file in a file-backed one.
+PageState classify(uint64_t entry, bool anonymous);
+
+}
+
+// Pagemap entries of a set of regions captured at one point in time, so the bits
+// can be read before they are cleared and consulted while the scan runs.
+class PageStates {
+public:
+    static std::optional<PageStates> capture(pid_t pid, const std::vector<MemoryRegion> &regions, std::string &error);
+
+    // States of the pages holding the size bytes at address, one per page in
+    // address order, when the bytes lie in one captured region; null otherwise.
+    const PageMap::PageState *states(uintptr_t address, size_t size) const;
+    size_t pageCount() const { return states_.size(); }
+    size_t dirtyPages() const { return dirtyPages_; }
+    size_t zeroPages() const { return zeroPages_; }
+
+private:
+    std::vector<MemoryRegion> regions_;
+    std::vector<size_t> regionFirstPage_;
+    // Classified when captured, so lookups need no region kind.
+    std::vector<PageMap::PageState> states_;
+    size_t dirtyPages_{};
+    size_t zeroPages_{};
+};
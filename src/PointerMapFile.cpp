@@ -0,0 +1,267 @@
+#include "PointerMapFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char pointerMapMagic[8] = {'O', 'S', 'P', 'M', 'A', 'P', '0', '1'};
+constexpr uint32_t pointerMapVersion = 1;
+constexpr uint32_t flagTruncated = 1u << 0;
+constexpr uint64_t regionStatic = 1u << 0;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t regionCount;
+    uint64_t regionTableOffset;
+    uint64_t stringTableOffset;
+    uint64_t stringTableSize;
+    uint64_t moduleNameOffset;
+    uint64_t moduleNameLength;
+    uint64_t moduleBase;
+    uint64_t targetCount;
+    uint64_t targetOffset;
+    uint64_t pairCount;
+    uint64_t pairOffset;
+};
+
+struct FileRegion {
+    uint64_t start;
+    uint64_t end;
+    char permissions[8];
+    uint64_t pathOffset;
+    uint64_t pathLength;
+    uint64_t flags;
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void writePadding(std::ofstream &out, uint64_t from, uint64_t to) {
+    static const char zeros[8] = {};
+    out.write(zeros, static_cast<std::streamsize>(to - from));
+}
+
+bool isStaticRegion(const MemoryRegion &region, const std::vector<MemoryRegion> &staticRegions) {
+    return std::any_of(staticRegions.begin(), staticRegions.end(), [&](const MemoryRegion &candidate) {
+        return candidate.start == region.start && candidate.end == region.end;
+    });
+}
+
+} // namespace
+
+bool PointerMapFile::save(const std::string &path, const PointerMap &map, const std::vector<MemoryRegion> &regions,
+                          const std::string &moduleName, const std::vector<MemoryRegion> &staticRegions,
+                          const std::vector<uintptr_t> &targets, std::string &error) {
+    FileHeader header{};
+    std::memcpy(header.magic, pointerMapMagic, sizeof(pointerMapMagic));
+    header.version = pointerMapVersion;
+    header.flags = map.truncated() ? flagTruncated : 0;
+    header.regionCount = regions.size();
+    header.regionTableOffset = sizeof(FileHeader);
+    header.stringTableOffset = header.regionTableOffset + regions.size() * sizeof(FileRegion);
+
+    std::vector<FileRegion> fileRegions(regions.size());
+    std::string strings;
+    for (size_t i = 0; i < regions.size(); ++i) {
+        const MemoryRegion &region = regions[i];
+        FileRegion &entry = fileRegions[i];
+        entry.start = region.start;
+        entry.end = region.end;
+        std::memset(entry.permissions, 0, sizeof(entry.permissions));
+        std::memcpy(entry.permissions, region.permissions.data(), std::min(region.permissions.size(), sizeof(entry.permissions)));
+        entry.pathOffset = strings.size();
+        entry.pathLength = region.pathname.size();
+        entry.flags = isStaticRegion(region, staticRegions) ? regionStatic : 0;
+        strings += region.pathname;
+    }
+    header.moduleNameOffset = strings.size();
+    header.moduleNameLength = moduleName.size();
+    strings += moduleName;
+    header.stringTableSize = strings.size();
+    header.moduleBase = staticRegions.empty() ? 0 : staticRegions.front().start;
+    for (const auto &region : staticRegions) {
+        header.moduleBase = std::min<uint64_t>(header.moduleBase, region.start);
+    }
+
+    header.targetCount = targets.size();
+    header.targetOffset = alignUp(header.stringTableOffset + strings.size(), sizeof(uint64_t));
+    header.pairCount = map.size();
+    header.pairOffset = header.targetOffset + targets.size() * sizeof(uint64_t);
+    const std::vector<uint64_t> fileTargets(targets.begin(), targets.end());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(fileRegions.data()), static_cast<std::streamsize>(fileRegions.size() * sizeof(FileRegion)));
+    out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    writePadding(out, header.stringTableOffset + strings.size(), header.targetOffset);
+    out.write(reinterpret_cast<const char *>(fileTargets.data()), static_cast<std::streamsize>(fileTargets.size() * sizeof(uint64_t)));
+    out.write(reinterpret_cast<const char *>(map.view().pairs), static_cast<std::streamsize>(map.size() * sizeof(PointerPair)));
+    if (!out.flush()) {
+        error = "failed to write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::optional<PointerMapFile> PointerMapFile::open(const std::string &path, std::string &error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open pointer map " + path + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    struct stat info{};
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        error = path + " is truncated";
+        return std::nullopt;
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    PointerMapFile file;
+    file.mapping_ = static_cast<const uint8_t *>(mapping);
+    file.mappingSize_ = size;
+
+    FileHeader header{};
+    std::memcpy(&header, file.mapping_, sizeof(header));
+    if (std::memcmp(header.magic, pointerMapMagic, sizeof(pointerMapMagic)) != 0 || header.version != pointerMapVersion) {
+        error = path + " is not a pointer map file or has an unsupported version";
+        return std::nullopt;
+    }
+    const bool fits = header.regionTableOffset + header.regionCount * sizeof(FileRegion) <= size &&
+                      header.stringTableOffset + header.stringTableSize <= size &&
+                      header.moduleNameOffset + header.moduleNameLength <= header.stringTableSize &&
+                      header.targetOffset % sizeof(uint64_t) == 0 && header.targetOffset + header.targetCount * sizeof(uint64_t) <= size &&
+                      header.pairOffset % sizeof(uint64_t) == 0 && header.pairOffset + header.pairCount * sizeof(PointerPair) <= size;
+    if (!fits) {
+        error = path + " is truncated or corrupt";
+        return std::nullopt;
+    }
+
+    const char *strings = reinterpret_cast<const char *>(file.mapping_ + header.stringTableOffset);
+    for (uint64_t i = 0; i < header.regionCount; ++i) {
+        FileRegion entry{};
+        std::memcpy(&entry, file.mapping_ + header.regionTableOffset + i * sizeof(FileRegion), sizeof(entry));
+        MemoryRegion region;
+        region.start = static_cast<uintptr_t>(entry.start);
+        region.end = static_cast<uintptr_t>(entry.end);
+        region.permissions.assign(entry.permissions, strnlen(entry.permissions, sizeof(entry.permissions)));
+        if (entry.pathOffset + entry.pathLength <= header.stringTableSize) {
+            region.pathname.assign(strings + entry.pathOffset, entry.pathLength);
+        }
+        if ((entry.flags & regionStatic) != 0) {
+            file.staticRegions_.push_back(region);
+        }
+        file.regions_.push_back(std::move(region));
+    }
+    file.moduleName_.assign(strings + header.moduleNameOffset, header.moduleNameLength);
+    file.moduleBase_ = static_cast<uintptr_t>(header.moduleBase);
+    file.truncated_ = (header.flags & flagTruncated) != 0;
+    const auto *targets = reinterpret_cast<const uint64_t *>(file.mapping_ + header.targetOffset);
+    file.targets_.assign(targets, targets + header.targetCount);
+    file.view_.pairs = reinterpret_cast<const PointerPair *>(file.mapping_ + header.pairOffset);
+    file.view_.count = static_cast<size_t>(header.pairCount);
+    return file;
+}
+
+PointerMapFile::PointerMapFile(PointerMapFile &&other) noexcept
+    : mapping_(other.mapping_),
+      mappingSize_(other.mappingSize_),
+      view_(other.view_),
+      regions_(std::move(other.regions_)),
+      staticRegions_(std::move(other.staticRegions_)),
+      moduleName_(std::move(other.moduleName_)),
+      moduleBase_(other.moduleBase_),
+      targets_(std::move(other.targets_)),
+      truncated_(other.truncated_) {
+    other.mapping_ = nullptr;
+    other.mappingSize_ = 0;
+    other.view_ = {};
+}
+
+PointerMapFile &PointerMapFile::operator=(PointerMapFile &&other) noexcept {
+    if (this != &other) {
+        if (mapping_ != nullptr) {
+            ::munmap(const_cast<uint8_t *>(mapping_), mappingSize_);
+        }
+        mapping_ = other.mapping_;
+        mappingSize_ = other.mappingSize_;
+        view_ = other.view_;
+        regions_ = std::move(other.regions_);
+        staticRegions_ = std::move(other.staticRegions_);
+        moduleName_ = std::move(other.moduleName_);
+        moduleBase_ = other.moduleBase_;
+        targets_ = std::move(other.targets_);
+        truncated_ = other.truncated_;
+        other.mapping_ = nullptr;
+        other.mappingSize_ = 0;
+        other.view_ = {};
+    }
+    return *this;
+}
+
+PointerMapFile::~PointerMapFile() {
+    if (mapping_ != nullptr) {
+        ::munmap(const_cast<uint8_t *>(mapping_), mappingSize_);
+    }
+}
+
+std::optional<std::vector<PointerChain>> intersectPointerChains(const std::vector<std::string> &paths,
+                                                                const PointerSearchOptions &options, ThreadPool *pool,
+                                                                std::string &moduleName, std::string &error) {
+    std::vector<PointerChain> common;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto file = PointerMapFile::open(paths[i], error);
+        if (!file) {
+            return std::nullopt;
+        }
+        if (i == 0) {
+            moduleName = file->moduleName();
+        } else if (file->moduleName() != moduleName) {
+            error = paths[i] + " was built for module '" + file->moduleName() + "', expected '" + moduleName + "'";
+            return std::nullopt;
+        }
+
+        // Any of a run's targets may be the object we are after, so a run
+        // contributes the union of the chains to all of its targets.
+        PointerScanner scanner(file->view(), file->staticRegions(), file->moduleBase(), pool);
+        std::vector<PointerChain> found;
+        for (const uintptr_t target : file->targets()) {
+            auto chains = scanner.findChains(target, options);
+            std::move(chains.begin(), chains.end(), std::back_inserter(found));
+        }
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+
+        if (i == 0) {
+            common = std::move(found);
+        } else {
+            std::vector<PointerChain> kept;
+            std::set_intersection(common.begin(), common.end(), found.begin(), found.end(), std::back_inserter(kept));
+            common = std::move(kept);
+        }
+        if (common.empty()) {
+            break;
+        }
+    }
+    return common;
+}
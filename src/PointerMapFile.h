@@ -0,0 +1,59 @@
+#pragma once
+
+#include "PointerScanner.h"
+#include "ProcessUtils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A pointer map saved to disk together with the region table it was built from,
+// the static module it is anchored to and the target addresses of that run. The
+// pair array is stored sorted and 8-byte aligned, so an opened file is queried
+// straight from the read-only mapping: only the pages the search touches are
+// ever read in.
+class PointerMapFile {
+public:
+    // staticRegions are the module mappings chains may start from; their lowest
+    // start is the module base the chain offsets are relative to.
+    static bool save(const std::string &path, const PointerMap &map, const std::vector<MemoryRegion> &regions,
+                     const std::string &moduleName, const std::vector<MemoryRegion> &staticRegions,
+                     const std::vector<uintptr_t> &targets, std::string &error);
+    static std::optional<PointerMapFile> open(const std::string &path, std::string &error);
+
+    PointerMapFile(PointerMapFile &&other) noexcept;
+    PointerMapFile &operator=(PointerMapFile &&other) noexcept;
+    PointerMapFile(const PointerMapFile &) = delete;
+    PointerMapFile &operator=(const PointerMapFile &) = delete;
+    ~PointerMapFile();
+
+    PointerMapView view() const { return view_; }
+    const std::vector<MemoryRegion> &regions() const { return regions_; }
+    const std::vector<MemoryRegion> &staticRegions() const { return staticRegions_; }
+    const std::string &moduleName() const { return moduleName_; }
+    uintptr_t moduleBase() const { return moduleBase_; }
+    const std::vector<uintptr_t> &targets() const { return targets_; }
+    bool truncated() const { return truncated_; }
+
+private:
+    PointerMapFile() = default;
+
+    const uint8_t *mapping_{};
+    size_t mappingSize_{};
+    PointerMapView view_;
+    std::vector<MemoryRegion> regions_;
+    std::vector<MemoryRegion> staticRegions_;
+    std::string moduleName_;
+    uintptr_t moduleBase_{};
+    std::vector<uintptr_t> targets_;
+    bool truncated_{false};
+};
+
+// Chains (module name, base offset and offsets) that reach one of the saved
+// targets in every file. Files are opened and searched one at a time, so at most
+// one mapping is live; maps built for different modules are rejected.
+std::optional<std::vector<PointerChain>> intersectPointerChains(const std::vector<std::string> &paths,
+                                                                const PointerSearchOptions &options, ThreadPool *pool,
+                                                                std::string &moduleName, std::string &error);
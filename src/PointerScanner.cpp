@@ -0,0 +1,378 @@
+#include "PointerScanner.h"
+
+#include "Vector3.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <mutex>
+
+namespace {
+
+constexpr size_t pointerChunkSize = 64 * 1024;
+constexpr size_t pointerTaskSize = 4 * 1024 * 1024;
+constexpr size_t frontierTaskSize = 256;
+
+bool pairLess(const PointerPair &lhs, const PointerPair &rhs) {
+    return lhs.pointee != rhs.pointee ? lhs.pointee < rhs.pointee : lhs.location < rhs.location;
+}
+
+struct PointerTask {
+    uintptr_t begin{};
+    uintptr_t end{};
+};
+
+// One way an address was reached: the pointer stored at address plus offset
+// lands on node parent of the level before.
+struct SearchNode {
+    uintptr_t address{};
+    size_t parent{};
+    uintptr_t offset{};
+};
+
+// The addresses reached at one depth. An address reached from several parents
+// is expanded once but keeps every edge, so each path to it yields its chains.
+struct SearchLevel {
+    // Sorted by address.
+    std::vector<SearchNode> edges;
+    // First edge of each distinct address, then edges.size().
+    std::vector<size_t> nodeStarts;
+
+    size_t nodeCount() const { return nodeStarts.size() - 1; }
+    uintptr_t address(size_t node) const { return edges[nodeStarts[node]].address; }
+};
+
+struct StaticHit {
+    size_t depth{};
+    SearchNode node;
+};
+
+} // namespace
+
+std::pair<const PointerPair *, const PointerPair *> PointerMapView::pointingInto(uint64_t low, uint64_t high) const {
+    const PointerPair *end = pairs + count;
+    const PointerPair *first = std::lower_bound(pairs, end, low, [](const PointerPair &pair, uint64_t value) {
+        return pair.pointee < value;
+    });
+    const PointerPair *last = std::upper_bound(first, end, high, [](uint64_t value, const PointerPair &pair) {
+        return value < pair.pointee;
+    });
+    return {first, last};
+}
+
+PointerMap PointerMap::build(const MemorySource &reader, const std::vector<MemoryRegion> &regions, ThreadPool *pool,
+                             size_t maxEntries) {
+    std::vector<MemoryRegion> readable;
+    std::vector<PointerTask> tasks;
+    for (const auto &region : regions) {
+        if (!region.isReadable() || region.kind() == RegionKind::Special) {
+            continue;
+        }
+        readable.push_back(region);
+        if (!region.isWritable()) {
+            continue;
+        }
+        for (uintptr_t begin = region.start; begin < region.end; begin += pointerTaskSize) {
+            tasks.push_back({begin, std::min<uintptr_t>(begin + pointerTaskSize, region.end)});
+        }
+    }
+    PointerMap map;
+    if (readable.empty()) {
+        return map;
+    }
+    const uintptr_t lowest = readable.front().start;
+    const uintptr_t highest = readable.back().end;
+
+    // Tasks are in address order and keep their pairs in location order until the
+    // cut is known, so truncation keeps the lowest locations whatever order the
+    // tasks ran in. The cut is the first task k whose prefix [0, k] holds
+    // maxEntries pairs; nothing past it can be kept, so task k and the later
+    // tasks stop. Counts only grow, so k only moves down.
+    std::vector<std::vector<PointerPair>> taskPairs(tasks.size());
+    std::vector<std::atomic<size_t>> taskCounts(tasks.size());
+    std::atomic<size_t> collected{0};
+    std::atomic<size_t> cutoffTask{tasks.size()};
+    std::mutex cutoffMutex;
+    const auto updateCutoff = [&] {
+        std::lock_guard<std::mutex> lock(cutoffMutex);
+        size_t prefix = 0;
+        const size_t limit = cutoffTask.load();
+        for (size_t k = 0; k < limit; ++k) {
+            prefix += taskCounts[k].load(std::memory_order_relaxed);
+            if (prefix >= maxEntries) {
+                cutoffTask.store(k);
+                return;
+            }
+        }
+    };
+    ThreadPool::run(pool, tasks.size(), [&](size_t taskIndex) {
+        const PointerTask &task = tasks[taskIndex];
+        std::vector<PointerPair> &pairs = taskPairs[taskIndex];
+        thread_local std::vector<uint64_t> buffer;
+        thread_local std::vector<ReadSpan> spans;
+        const MemoryRegion *lastHit = nullptr;
+        for (uintptr_t chunk = task.begin; chunk < task.end && taskIndex < cutoffTask.load(std::memory_order_relaxed);
+             chunk += pointerChunkSize) {
+            const size_t chunkBytes = std::min(pointerChunkSize, static_cast<size_t>(task.end - chunk));
+            buffer.resize(chunkBytes / sizeof(uint64_t));
+            spans.clear();
+            if (reader.readAvailable(chunk, buffer.data(), buffer.size() * sizeof(uint64_t), spans) == 0) {
+                continue;
+            }
+            const size_t before = pairs.size();
+            for (const auto &span : spans) {
+                const size_t spanEnd = (span.offset + span.size) / sizeof(uint64_t);
+                for (size_t i = (span.offset + sizeof(uint64_t) - 1) / sizeof(uint64_t); i < spanEnd; ++i) {
+                    const uint64_t value = buffer[i];
+                    if (value < lowest || value >= highest) {
+                        continue;
+                    }
+                    if (lastHit == nullptr || value < lastHit->start || value >= lastHit->end) {
+                        lastHit = ProcessUtils::findRegionContaining(readable, static_cast<uintptr_t>(value));
+                        if (lastHit == nullptr) {
+                            continue;
+                        }
+                    }
+                    pairs.push_back({value, chunk + i * sizeof(uint64_t)});
+                }
+            }
+            // Counted per chunk rather than per pair to keep the counters cold.
+            const size_t added = pairs.size() - before;
+            taskCounts[taskIndex].store(pairs.size(), std::memory_order_relaxed);
+            if (collected.fetch_add(added) + added >= maxEntries) {
+                updateCutoff();
+            }
+        }
+    });
+    map.truncated_ = cutoffTask.load() < tasks.size();
+    // The first maxEntries pairs by location are kept.
+    size_t total = 0;
+    for (auto &pairs : taskPairs) {
+        const size_t kept = std::min(pairs.size(), maxEntries - total);
+        if (kept == 0) {
+            std::vector<PointerPair>().swap(pairs);
+        } else {
+            pairs.resize(kept);
+        }
+        total += kept;
+    }
+
+    ThreadPool::run(pool, taskPairs.size(), [&](size_t taskIndex) {
+        std::sort(taskPairs[taskIndex].begin(), taskPairs[taskIndex].end(), pairLess);
+    });
+
+    // Parallel merge: split the pointee space at sampled quantiles, then every
+    // task list copies its slice of each range to that range's place in the map,
+    // and every range is sorted in place.
+    std::vector<uint64_t> samples;
+    for (const auto &pairs : taskPairs) {
+        const size_t step = std::max<size_t>(pairs.size() / 64, 1);
+        for (size_t i = 0; i < pairs.size(); i += step) {
+            samples.push_back(pairs[i].pointee);
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t rangeCount = std::max<size_t>(pool != nullptr ? pool->threadCount() * 4 : 1, 1);
+    std::vector<uint64_t> splitters;
+    for (size_t r = 1; r < rangeCount && !samples.empty(); ++r) {
+        splitters.push_back(samples[samples.size() * r / rangeCount]);
+    }
+    splitters.push_back(UINT64_MAX);
+
+    std::vector<std::vector<size_t>> bounds(taskPairs.size(), std::vector<size_t>(splitters.size() + 1, 0));
+    for (size_t list = 0; list < taskPairs.size(); ++list) {
+        const auto &pairs = taskPairs[list];
+        for (size_t r = 0; r < splitters.size(); ++r) {
+            const bool last = r + 1 == splitters.size();
+            bounds[list][r + 1] = last ? pairs.size()
+                                       : static_cast<size_t>(std::lower_bound(pairs.begin(), pairs.end(), splitters[r],
+                                                                              [](const PointerPair &pair, uint64_t value) {
+                                                                                  return pair.pointee < value;
+                                                                              }) -
+                                                             pairs.begin());
+        }
+    }
+    // Where each list's slice of each range goes: ranges in order, and within a
+    // range the slices in list order.
+    std::vector<std::vector<size_t>> destinations(taskPairs.size(), std::vector<size_t>(splitters.size(), 0));
+    std::vector<size_t> rangeStart(splitters.size() + 1, 0);
+    for (size_t r = 0; r < splitters.size(); ++r) {
+        size_t offset = rangeStart[r];
+        for (size_t list = 0; list < taskPairs.size(); ++list) {
+            destinations[list][r] = offset;
+            offset += bounds[list][r + 1] - bounds[list][r];
+        }
+        rangeStart[r + 1] = offset;
+    }
+
+    // The map is allocated without being written, so its pages are committed as
+    // the slices land, and each list is freed once copied: the lists and the map
+    // never both hold every pair.
+    map.pairs_.reset(new PointerPair[total]);
+    map.count_ = total;
+    ThreadPool::run(pool, taskPairs.size(), [&](size_t list) {
+        std::vector<PointerPair> &pairs = taskPairs[list];
+        for (size_t r = 0; r < splitters.size(); ++r) {
+            std::copy(pairs.begin() + static_cast<std::ptrdiff_t>(bounds[list][r]),
+                      pairs.begin() + static_cast<std::ptrdiff_t>(bounds[list][r + 1]), map.pairs_.get() + destinations[list][r]);
+        }
+        std::vector<PointerPair>().swap(pairs);
+    });
+    // A range is one sorted run per list, merged pairwise until one is left.
+    ThreadPool::run(pool, splitters.size(), [&](size_t r) {
+        PointerPair *pairs = map.pairs_.get();
+        std::vector<size_t> runs;
+        for (size_t list = 0; list < taskPairs.size(); ++list) {
+            if (bounds[list][r + 1] != bounds[list][r]) {
+                runs.push_back(destinations[list][r]);
+            }
+        }
+        runs.push_back(rangeStart[r + 1]);
+        while (runs.size() > 2) {
+            std::vector<size_t> merged;
+            for (size_t i = 0; i + 1 < runs.size(); i += 2) {
+                merged.push_back(runs[i]);
+                if (i + 2 < runs.size()) {
+                    std::inplace_merge(pairs + runs[i], pairs + runs[i + 1], pairs + runs[i + 2], pairLess);
+                }
+            }
+            merged.push_back(runs.back());
+            runs.swap(merged);
+        }
+    });
+    return map;
+}
+
+PointerScanner::PointerScanner(PointerMapView map, std::vector<MemoryRegion> staticRegions, uintptr_t moduleBase, ThreadPool *pool)
+    : map_(map), staticRegions_(std::move(staticRegions)), moduleBase_(moduleBase), pool_(pool) {}
+
+bool PointerScanner::isStatic(uintptr_t address) const {
+    return ProcessUtils::findRegionContaining(staticRegions_, address) != nullptr;
+}
+
+std::vector<PointerChain> PointerScanner::findChains(uintptr_t target, const PointerSearchOptions &options) const {
+    truncated_ = false;
+    std::vector<SearchLevel> levels(1);
+    levels[0].edges.push_back({target, 0, 0});
+    levels[0].nodeStarts = {0, 1};
+    std::vector<StaticHit> hits;
+
+    for (size_t depth = 0; depth < options.maxDepth && levels.back().nodeCount() != 0 && hits.size() < options.maxResults;
+         ++depth) {
+        const SearchLevel &frontier = levels.back();
+        const size_t taskCount = (frontier.nodeCount() + frontierTaskSize - 1) / frontierTaskSize;
+        std::vector<std::vector<SearchNode>> taskChildren(taskCount);
+        std::vector<std::vector<SearchNode>> taskHits(taskCount);
+        std::atomic<bool> levelTruncated{false};
+        ThreadPool::run(pool_, taskCount, [&](size_t taskIndex) {
+            const size_t first = taskIndex * frontierTaskSize;
+            const size_t last = std::min(first + frontierTaskSize, frontier.nodeCount());
+            for (size_t index = first; index < last; ++index) {
+                const uintptr_t address = frontier.address(index);
+                const uintptr_t low = address > options.maxOffset ? address - options.maxOffset : 0;
+                const auto range = map_.pointingInto(low, address);
+                for (const PointerPair *pair = range.first; pair != range.second; ++pair) {
+                    const SearchNode child{static_cast<uintptr_t>(pair->location), index,
+                                           address - static_cast<uintptr_t>(pair->pointee)};
+                    if (isStatic(child.address)) {
+                        taskHits[taskIndex].push_back(child);
+                    } else if (taskChildren[taskIndex].size() < options.maxFrontier) {
+                        taskChildren[taskIndex].push_back(child);
+                    } else {
+                        levelTruncated.store(true);
+                    }
+                }
+            }
+        });
+
+        for (auto &taskHit : taskHits) {
+            for (const auto &node : taskHit) {
+                if (hits.size() >= options.maxResults) {
+                    truncated_ = true;
+                    break;
+                }
+                hits.push_back({depth + 1, node});
+            }
+        }
+        if (depth + 1 == options.maxDepth) {
+            break;
+        }
+
+        // Addresses are deduplicated per depth, not across depths: an address
+        // reached again deeper is expanded again, so chains that pass through it
+        // at either depth are found.
+        SearchLevel next;
+        for (auto &children : taskChildren) {
+            next.edges.insert(next.edges.end(), children.begin(), children.end());
+            std::vector<SearchNode>().swap(children);
+        }
+        std::stable_sort(next.edges.begin(), next.edges.end(), [](const SearchNode &lhs, const SearchNode &rhs) {
+            return lhs.address < rhs.address;
+        });
+        for (size_t edge = 0; edge < next.edges.size(); ++edge) {
+            if (edge == 0 || next.edges[edge].address != next.edges[edge - 1].address) {
+                if (next.nodeStarts.size() == options.maxFrontier) {
+                    next.edges.resize(edge);
+                    levelTruncated.store(true);
+                    break;
+                }
+                next.nodeStarts.push_back(edge);
+            }
+        }
+        next.nodeStarts.push_back(next.edges.size());
+        truncated_ = truncated_ || levelTruncated.load();
+        levels.push_back(std::move(next));
+    }
+
+    // Every path from a hit back to the target is one chain.
+    std::vector<PointerChain> chains;
+    PointerChain chain;
+    const std::function<void(size_t, size_t)> walk = [&](size_t level, size_t node) {
+        if (level == 0) {
+            if (chains.size() >= options.maxResults) {
+                truncated_ = true;
+                return;
+            }
+            chains.push_back(chain);
+            return;
+        }
+        const SearchLevel &current = levels[level];
+        for (size_t edge = current.nodeStarts[node]; edge < current.nodeStarts[node + 1] && chains.size() < options.maxResults;
+             ++edge) {
+            chain.offsets.push_back(current.edges[edge].offset);
+            walk(level - 1, current.edges[edge].parent);
+            chain.offsets.pop_back();
+        }
+    };
+    for (const auto &hit : hits) {
+        chain.baseOffset = hit.node.address - moduleBase_;
+        chain.offsets.assign(1, hit.node.offset);
+        walk(hit.depth - 1, hit.node.parent);
+    }
+    std::sort(chains.begin(), chains.end());
+    return chains;
+}
+
+bool operator<(const PointerChain &lhs, const PointerChain &rhs) {
+    if (lhs.offsets.size() != rhs.offsets.size()) {
+        return lhs.offsets.size() < rhs.offsets.size();
+    }
+    if (lhs.baseOffset != rhs.baseOffset) {
+        return lhs.baseOffset < rhs.baseOffset;
+    }
+    return lhs.offsets < rhs.offsets;
+}
+
+bool operator==(const PointerChain &lhs, const PointerChain &rhs) {
+    return lhs.baseOffset == rhs.baseOffset && lhs.offsets == rhs.offsets;
+}
+
+std::string formatPointerChain(const PointerChain &chain, const std::string &moduleName) {
+    std::vector<uintptr_t> offsets;
+    offsets.reserve(chain.offsets.size() + 1);
+    offsets.push_back(chain.baseOffset);
+    offsets.insert(offsets.end(), chain.offsets.begin(), chain.offsets.end());
+    return moduleName + " + " + formatOffsets(offsets);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "MemorySource.h"
+#include "ProcessUtils.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Left without member initializers so PointerMap::build can allocate the map
+// without writing to it.
+struct PointerPair {
+    uint64_t pointee;
+    uint64_t location;
+};
+
+// Read-only view of pointer pairs sorted by pointee, then location.
+struct PointerMapView {
+    const PointerPair *pairs{};
+    size_t count{};
+
+    // Pairs whose pointee lies in [low, high].
+    std::pair<const PointerPair *, const PointerPair *> pointingInto(uint64_t low, uint64_t high) const;
+};
+
+// Reverse pointer index of a process: every 8-byte aligned value in a writable
+// region that points into a readable region, sorted by the address it points to.
+class PointerMap {
+public:
+    // Walks the writable regions of regions in parallel on pool (inline when
+    // null). Collection stops at maxEntries pairs to bound memory, keeping the
+    // pairs stored at the lowest addresses; truncated() reports whether that
+    // happened.
+    static PointerMap build(const MemorySource &reader, const std::vector<MemoryRegion> &regions, ThreadPool *pool,
+                            size_t maxEntries);
+
+    PointerMapView view() const { return {pairs_.get(), count_}; }
+    size_t size() const { return count_; }
+    bool truncated() const { return truncated_; }
+
+private:
+    std::unique_ptr<PointerPair[]> pairs_;
+    size_t count_{};
+    bool truncated_{false};
+};
+
+struct PointerChain {
+    // Offset of the first pointer from the module base, then the offset added to
+    // each dereferenced pointer; the last one lands on the target.
+    uintptr_t baseOffset{};
+    std::vector<uintptr_t> offsets;
+};
+
+// Shorter chains first, then by base offset and offsets.
+bool operator<(const PointerChain &lhs, const PointerChain &rhs);
+bool operator==(const PointerChain &lhs, const PointerChain &rhs);
+
+struct PointerSearchOptions {
+    size_t maxDepth{4};
+    size_t maxOffset{0x1000};
+    size_t maxResults{1024};
+    // Upper bound on nodes kept per BFS level; wider levels are cut.
+    size_t maxFrontier{1u << 20};
+};
+
+// Bounded breadth-first search from a target address back through the pointer
+// map to pointers stored inside static regions (the module image). An address is
+// expanded at most once per depth however many parents reach it there, and every
+// path is kept, so no chain within the limits is lost to a shared node; the cost
+// is up to maxDepth expansions of an address reachable at several depths.
+class PointerScanner {
+public:
+    PointerScanner(PointerMapView map, std::vector<MemoryRegion> staticRegions, uintptr_t moduleBase, ThreadPool *pool);
+
+    std::vector<PointerChain> findChains(uintptr_t target, const PointerSearchOptions &options) const;
+    bool lastSearchTruncated() const { return truncated_; }
+
+private:
+    bool isStatic(uintptr_t address) const;
+
+    PointerMapView map_;
+    std::vector<MemoryRegion> staticRegions_;
+    uintptr_t moduleBase_{};
+    ThreadPool *pool_{};
+    mutable bool truncated_{false};
+};
+
+std::string formatPointerChain(const PointerChain &chain, const std::string &moduleName);
@@ -3,16 +3,26 @@
 #endif
 #include "ProcessMemoryReader.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <cstring>
 #include <fcntl.h>
-#include <iostream>
+#include <mutex>
 #include <string>
 #include <sys/uio.h>
 #include <unistd.h>
 
 namespace {
 
+#if defined(IOV_MAX)
+constexpr size_t maxIovecsPerCall = IOV_MAX;
+#else
+constexpr size_t maxIovecsPerCall = 1024;
+#endif
+
+constexpr uintptr_t pageSize = 4096;
+
 int openProcessMemory(pid_t pid) {
     const std::string path = "/proc/" + std::to_string(pid) + "/mem";
     const int fd = ::open(path.c_str(), O_RDONLY);
@@ -22,7 +32,7 @@ int openProcessMemory(pid_t pid) {
 } // namespace
 
 ProcessMemoryReader::ProcessMemoryReader(pid_t pid)
-    : pid_(pid), memFd_(openProcessMemory(pid)) {}
+    : pid_(pid), memFd_(openProcessMemory(pid)), regionIndex_(pid) {}
 
 ProcessMemoryReader::~ProcessMemoryReader() {
     if (memFd_ >= 0) {
@@ -31,8 +41,12 @@ ProcessMemoryReader::~ProcessMemoryReader() {
 }
 
 ProcessMemoryReader::ProcessMemoryReader(ProcessMemoryReader &&other) noexcept
-    : pid_(other.pid_), memFd_(other.memFd_) {
+    : pid_(other.pid_), memFd_(other.memFd_), unreadable_(std::move(other.unreadable_)),
+      regionIndex_(std::move(other.regionIndex_)) {
+    counters_.assign(other.counters_);
+    hasUnreadable_.store(!unreadable_.empty());
     other.memFd_ = -1;
+    other.forgetUnreadable();
 }
 
 ProcessMemoryReader &ProcessMemoryReader::operator=(ProcessMemoryReader &&other) noexcept {
@@ -42,7 +56,12 @@ ProcessMemoryReader &ProcessMemoryReader::operator=(ProcessMemoryReader &&other)
         }
         pid_ = other.pid_;
         memFd_ = other.memFd_;
+        counters_.assign(other.counters_);
+        unreadable_ = std::move(other.unreadable_);
+        hasUnreadable_.store(!unreadable_.empty());
+        regionIndex_ = std::move(other.regionIndex_);
         other.memFd_ = -1;
+        other.forgetUnreadable();
     }
     return *this;
 }
@@ -51,10 +70,31 @@ bool ProcessMemoryReader::isValid() const {
     return pid_ > 0;
 }
 
+std::vector<MemoryRegion> ProcessMemoryReader::regions() const {
+    std::lock_guard<std::mutex> lock(regionsMutex_);
+    RegionDiff diff;
+    std::string error;
+    if (!regionIndex_.refresh(diff, error)) {
+        return {};
+    }
+    if (!diff.empty()) {
+        forgetUnreadable(diff);
+    }
+    return regionIndex_.regions();
+}
+
+std::string ProcessMemoryReader::describe() const {
+    return "pid " + std::to_string(pid_);
+}
+
 bool ProcessMemoryReader::read(uintptr_t address, void *buffer, size_t size) const {
     if (size == 0) {
         return true;
     }
+    if (overlapsUnreadable(address, size)) {
+        counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
 #if defined(__linux__)
     struct iovec local{};
     struct iovec remote{};
@@ -63,6 +103,7 @@ bool ProcessMemoryReader::read(uintptr_t address, void *buffer, size_t size) con
     remote.iov_base = reinterpret_cast<void *>(address);
     remote.iov_len = size;
     const ssize_t bytesRead = ::process_vm_readv(pid_, &local, 1, &remote, 1, 0);
+    countRead(counters_.vmReadvCalls, size, bytesRead);
     if (bytesRead == static_cast<ssize_t>(size)) {
         return true;
     }
@@ -70,9 +111,220 @@ bool ProcessMemoryReader::read(uintptr_t address, void *buffer, size_t size) con
     if (memFd_ >= 0) {
         const off_t offset = static_cast<off_t>(address);
         const ssize_t bytesRead = ::pread(memFd_, buffer, size, offset);
+        countRead(counters_.preadCalls, size, bytesRead);
         if (bytesRead == static_cast<ssize_t>(size)) {
             return true;
         }
     }
+    counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
     return false;
 }
+
+ssize_t ProcessMemoryReader::readPrefix(uintptr_t address, uint8_t *buffer, size_t size) const {
+    bool pageFault = false;
+#if defined(__linux__)
+    struct iovec local{buffer, size};
+    struct iovec remote{reinterpret_cast<void *>(address), size};
+    const ssize_t bytesRead = ::process_vm_readv(pid_, &local, 1, &remote, 1, 0);
+    countRead(counters_.vmReadvCalls, size, bytesRead);
+    if (bytesRead > 0) {
+        return bytesRead;
+    }
+    if (errno == ESRCH) {
+        return -1;
+    }
+    pageFault = errno == EFAULT;
+#endif
+    if (memFd_ >= 0) {
+        const ssize_t bytesRead = ::pread(memFd_, buffer, size, static_cast<off_t>(address));
+        countRead(counters_.preadCalls, size, bytesRead);
+        if (bytesRead > 0) {
+            return bytesRead;
+        }
+        // /proc/<pid>/mem reports an unreadable page as EIO and a gone address
+        // space as end of file.
+        pageFault = bytesRead < 0 && (errno == EIO || errno == EFAULT);
+    }
+    return pageFault ? 0 : -1;
+}
+
+size_t ProcessMemoryReader::readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const {
+    auto *bytes = static_cast<uint8_t *>(buffer);
+    const size_t firstSpan = spans.size();
+    size_t offset = 0;
+    size_t total = 0;
+    while (offset < size) {
+        const uintptr_t at = address + offset;
+        size_t length = size - offset;
+        PageRun run;
+        if (findUnreadable(at, run)) {
+            if (run.start <= at) {
+                const size_t skipped = std::min(static_cast<size_t>(run.end - at), length);
+                counters_.skippedPages.fetch_add((skipped + pageSize - 1) / pageSize, std::memory_order_relaxed);
+                offset += skipped;
+                continue;
+            }
+            length = std::min(length, static_cast<size_t>(run.start - at));
+        }
+        const ssize_t transferred = readPrefix(at, bytes + offset, length);
+        if (transferred < 0) {
+            break;
+        }
+        if (transferred > 0) {
+            if (spans.size() > firstSpan && spans.back().offset + spans.back().size == offset) {
+                spans.back().size += static_cast<size_t>(transferred);
+            } else {
+                spans.push_back({offset, static_cast<size_t>(transferred)});
+            }
+            total += static_cast<size_t>(transferred);
+            offset += static_cast<size_t>(transferred);
+            continue;
+        }
+        const uintptr_t pageStart = at & ~(pageSize - 1);
+        addUnreadable(pageStart, pageStart + pageSize);
+        counters_.unreadablePages.fetch_add(1, std::memory_order_relaxed);
+        offset = std::min(size, static_cast<size_t>(pageStart + pageSize - address));
+    }
+    if (total < size) {
+        counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool ProcessMemoryReader::findUnreadable(uintptr_t address, PageRun &run) const {
+    if (!hasUnreadable_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> lock(unreadableMutex_);
+    const auto it = std::upper_bound(unreadable_.begin(), unreadable_.end(), address,
+                                     [](uintptr_t value, const PageRun &entry) { return value < entry.end; });
+    if (it == unreadable_.end()) {
+        return false;
+    }
+    run = *it;
+    return true;
+}
+
+bool ProcessMemoryReader::overlapsUnreadable(uintptr_t address, size_t size) const {
+    PageRun run;
+    return findUnreadable(address, run) && run.start < address + size;
+}
+
+void ProcessMemoryReader::addUnreadable(uintptr_t start, uintptr_t end) const {
+    std::unique_lock<std::shared_mutex> lock(unreadableMutex_);
+    // Runs touching [start, end) are merged into it.
+    auto first = std::lower_bound(unreadable_.begin(), unreadable_.end(), start,
+                                  [](const PageRun &entry, uintptr_t value) { return entry.end < value; });
+    auto last = first;
+    while (last != unreadable_.end() && last->start <= end) {
+        start = std::min(start, last->start);
+        end = std::max(end, last->end);
+        ++last;
+    }
+    first = unreadable_.erase(first, last);
+    unreadable_.insert(first, {start, end});
+    hasUnreadable_.store(true, std::memory_order_release);
+}
+
+void ProcessMemoryReader::forgetUnreadable(const RegionDiff &diff) const {
+    std::unique_lock<std::shared_mutex> lock(unreadableMutex_);
+    const auto changed = [&](const PageRun &run) {
+        const auto overlaps = [&](const RegionEntry &entry) { return entry.start < run.end && run.start < entry.end; };
+        return std::any_of(diff.added.begin(), diff.added.end(), overlaps) ||
+               std::any_of(diff.removed.begin(), diff.removed.end(), overlaps);
+    };
+    unreadable_.erase(std::remove_if(unreadable_.begin(), unreadable_.end(), changed), unreadable_.end());
+    hasUnreadable_.store(!unreadable_.empty(), std::memory_order_release);
+}
+
+void ProcessMemoryReader::forgetUnreadable() const {
+    std::unique_lock<std::shared_mutex> lock(unreadableMutex_);
+    unreadable_.clear();
+    hasUnreadable_.store(false, std::memory_order_release);
+}
+
+size_t ProcessMemoryReader::unreadablePageCount() const {
+    std::shared_lock<std::shared_mutex> lock(unreadableMutex_);
+    size_t pages = 0;
+    for (const auto &run : unreadable_) {
+        pages += static_cast<size_t>(run.end - run.start) / pageSize;
+    }
+    return pages;
+}
+
+size_t ProcessMemoryReader::readBatch(ReadRequest *requests, size_t count) const {
+    // Requests on cached unreadable pages are neither batched nor retried.
+    thread_local std::vector<uint8_t> knownUnreadable;
+    knownUnreadable.assign(count, 0);
+    const bool checkCache = hasUnreadable_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        requests[i].succeeded = requests[i].size == 0;
+        if (checkCache && !requests[i].succeeded && overlapsUnreadable(requests[i].address, requests[i].size)) {
+            knownUnreadable[i] = 1;
+            counters_.skippedPages.fetch_add((requests[i].size + pageSize - 1) / pageSize, std::memory_order_relaxed);
+        }
+    }
+#if defined(__linux__)
+    thread_local std::vector<struct iovec> localIovecs;
+    thread_local std::vector<struct iovec> remoteIovecs;
+    thread_local std::vector<size_t> batchIndices;
+    localIovecs.resize(maxIovecsPerCall);
+    remoteIovecs.resize(maxIovecsPerCall);
+    batchIndices.resize(maxIovecsPerCall);
+    size_t index = 0;
+    while (index < count) {
+        size_t batchSize = 0;
+        size_t batchBytes = 0;
+        for (; index < count && batchSize < maxIovecsPerCall; ++index) {
+            if (requests[index].succeeded || knownUnreadable[index] != 0) {
+                continue;
+            }
+            const ReadRequest &request = requests[index];
+            const size_t i = batchSize++;
+            batchIndices[i] = index;
+            localIovecs[i].iov_base = request.buffer;
+            localIovecs[i].iov_len = request.size;
+            remoteIovecs[i].iov_base = reinterpret_cast<void *>(request.address);
+            remoteIovecs[i].iov_len = request.size;
+            batchBytes += request.size;
+        }
+        if (batchSize == 0) {
+            break;
+        }
+        const ssize_t bytesRead = ::process_vm_readv(pid_, localIovecs.data(), batchSize, remoteIovecs.data(), batchSize, 0);
+        countRead(counters_.vmReadvCalls, batchBytes, bytesRead);
+        if (bytesRead < 0 && errno != EFAULT) {
+            break;
+        }
+        size_t remaining = bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0;
+        size_t i = 0;
+        for (; i < batchSize; ++i) {
+            ReadRequest &request = requests[batchIndices[i]];
+            if (remaining < request.size) {
+                break;
+            }
+            remaining -= request.size;
+            request.succeeded = true;
+        }
+        // Entry i broke the transfer; everything after it has not been attempted.
+        if (i + 1 < batchSize) {
+            index = batchIndices[i + 1];
+        }
+    }
+#endif
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; ++i) {
+        ReadRequest &request = requests[i];
+        if (!request.succeeded && knownUnreadable[i] == 0 && memFd_ >= 0) {
+            const ssize_t bytesRead = ::pread(memFd_, request.buffer, request.size, static_cast<off_t>(request.address));
+            countRead(counters_.preadCalls, request.size, bytesRead);
+            request.succeeded = bytesRead == static_cast<ssize_t>(request.size);
+        }
+        if (request.succeeded) {
+            ++succeeded;
+        } else {
+            counters_.failedReads.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return succeeded;
+}
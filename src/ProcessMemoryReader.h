@@ -1,13 +1,24 @@
 #pragma once
 
+#include "MemorySource.h"
+#include "RegionIndex.h"
+
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <sys/types.h>
+#include <vector>
 
-class ProcessMemoryReader {
+// Live process memory through process_vm_readv, with /proc/<pid>/mem as the
+// fallback. Pages found unreadable are cached, so reads touching them fail or
+// skip them without a syscall until forgetUnreadable drops them.
+class ProcessMemoryReader : public MemorySource {
 public:
     explicit ProcessMemoryReader(pid_t pid);
-    ~ProcessMemoryReader();
+    ~ProcessMemoryReader() override;
 
     ProcessMemoryReader(const ProcessMemoryReader &) = delete;
     ProcessMemoryReader &operator=(const ProcessMemoryReader &) = delete;
@@ -16,20 +27,56 @@ public:
     ProcessMemoryReader &operator=(ProcessMemoryReader &&) noexcept;
 
     bool isValid() const;
-    bool read(uintptr_t address, void *buffer, size_t size) const;
+    bool read(uintptr_t address, void *buffer, size_t size) const override;
+    // Reads up to the first fault, takes the readable prefix process_vm_readv
+    // reports, records the faulting page and continues after it, so a hole costs
+    // one page rather than the whole range.
+    size_t readAvailable(uintptr_t address, void *buffer, size_t size, std::vector<ReadSpan> &spans) const override;
+
+    // Reads every request, packing up to IOV_MAX remote ranges into each
+    // process_vm_readv call. A short transfer marks the entries it fully covered as
+    // succeeded and resumes after the entry that broke it; entries that still fail
+    // are retried with pread on /proc/<pid>/mem. Requests touching a cached
+    // unreadable page fail without a syscall. Returns the number of requests that
+    // succeeded.
+    size_t readBatch(ReadRequest *requests, size_t count) const override;
+    using MemorySource::readBatch;
 
-    template <typename T>
-    std::optional<T> readValue(uintptr_t address) const {
-        T value{};
-        if (!read(address, &value, sizeof(T))) {
-            return std::nullopt;
-        }
-        return value;
-    }
+    // Lists the current mappings and drops the cached unreadable pages of the ones
+    // that changed since the previous listing, so rescoping never trusts a stale
+    // hole.
+    std::vector<MemoryRegion> regions() const override;
+    pid_t pid() const override { return pid_; }
+    std::string describe() const override;
 
-    pid_t pid() const { return pid_; }
+    // Drops the cached unreadable pages of mappings that changed, since a hole may
+    // be readable once remapped. Pass the diff of every RegionIndex::refresh.
+    void forgetUnreadable(const RegionDiff &diff) const;
+    void forgetUnreadable() const;
+    size_t unreadablePageCount() const;
 
 private:
+    struct PageRun {
+        uintptr_t start{};
+        uintptr_t end{};
+    };
+
+    // Bytes read from address on: positive for a readable prefix, 0 when the first
+    // page faults and -1 when the process cannot be read at all (e.g. it exited).
+    ssize_t readPrefix(uintptr_t address, uint8_t *buffer, size_t size) const;
+    // The cached run containing address, or else the first one after it.
+    bool findUnreadable(uintptr_t address, PageRun &run) const;
+    bool overlapsUnreadable(uintptr_t address, size_t size) const;
+    void addUnreadable(uintptr_t start, uintptr_t end) const;
+
     pid_t pid_;
     int memFd_;
+    // Unreadable pages as sorted, disjoint runs; a few runs cover the usual guard
+    // pages and holes. hasUnreadable_ keeps the empty case lock-free.
+    mutable std::shared_mutex unreadableMutex_;
+    mutable std::vector<PageRun> unreadable_;
+    mutable std::atomic<bool> hasUnreadable_{false};
+    // The mappings as last listed by regions().
+    mutable std::mutex regionsMutex_;
+    mutable RegionIndex regionIndex_;
 };
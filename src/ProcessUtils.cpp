@@ -1,5 +1,8 @@
 #include "ProcessUtils.h"
 
+#include "MemorySource.h"
+#include "RegionIndex.h"
+
 #include <algorithm>
 #include <cctype>
 #include <filesystem>
@@ -9,6 +12,15 @@
 
 namespace {
 
+// One index per thread serves every listing, so its read buffer, entries and
+// interned paths carry over between calls. Null when the maps cannot be read.
+const RegionIndex *loadRegionIndex(pid_t pid) {
+    thread_local RegionIndex index;
+    index.setPid(pid);
+    std::string error;
+    return index.load(error) ? &index : nullptr;
+}
+
 bool isNumber(const std::string &text) {
     return !text.empty() && std::all_of(text.begin(), text.end(), [](unsigned char ch) {
         return std::isdigit(ch) != 0;
@@ -24,8 +36,45 @@ std::string trim(const std::string &value) {
     return value.substr(first, last - first + 1);
 }
 
+constexpr RegionKind allKinds[] = {
+    RegionKind::Anonymous, RegionKind::FileBacked, RegionKind::Heap, RegionKind::Stack, RegionKind::Special,
+};
+
 } // namespace
 
+RegionKind MemoryRegion::kind() const {
+    if (pathname.empty() || pathname.rfind("[anon:", 0) == 0) {
+        return RegionKind::Anonymous;
+    }
+    if (pathname == "[heap]") {
+        return RegionKind::Heap;
+    }
+    if (pathname.rfind("[stack", 0) == 0) {
+        return RegionKind::Stack;
+    }
+    if (pathname[0] == '[') {
+        return RegionKind::Special;
+    }
+    return RegionKind::FileBacked;
+}
+
+bool RegionFilter::matches(const MemoryRegion &region) const {
+    for (const char permission : requiredPermissions) {
+        if (region.permissions.find(permission) == std::string::npos) {
+            return false;
+        }
+    }
+    for (const char permission : excludedPermissions) {
+        if (region.permissions.find(permission) != std::string::npos) {
+            return false;
+        }
+    }
+    if ((kinds & static_cast<unsigned>(region.kind())) == 0) {
+        return false;
+    }
+    return region.size() >= minSize && region.size() <= maxSize;
+}
+
 namespace ProcessUtils {
 
 std::vector<ProcessInfo> listProcesses() {
@@ -64,49 +113,33 @@ std::optional<ProcessInfo> findProcessByName(const std::string &name) {
     return *it;
 }
 
+std::vector<ProcessInfo> findProcessesByName(const std::string &name) {
+    std::vector<ProcessInfo> processes = listProcesses();
+    processes.erase(std::remove_if(processes.begin(), processes.end(), [&](const ProcessInfo &info) { return info.name != name; }),
+                    processes.end());
+    return processes;
+}
+
 std::vector<MemoryRegion> listMemoryRegions(pid_t pid) {
-    std::vector<MemoryRegion> regions;
-    std::ifstream mapsFile("/proc/" + std::to_string(pid) + "/maps");
-    if (!mapsFile) {
-        return regions;
-    }
-    std::string line;
-    while (std::getline(mapsFile, line)) {
-        std::istringstream iss(line);
-        std::string addressRange;
-        MemoryRegion region;
-        std::string offset;
-        std::string device;
-        std::string inode;
-        std::string pathname;
-        if (!(iss >> addressRange >> region.permissions >> offset >> device >> inode)) {
-            continue;
-        }
-        std::getline(iss, pathname);
-        region.pathname = trim(pathname);
-        const auto dashPos = addressRange.find('-');
-        if (dashPos == std::string::npos) {
-            continue;
-        }
-        region.start = std::stoull(addressRange.substr(0, dashPos), nullptr, 16);
-        region.end = std::stoull(addressRange.substr(dashPos + 1), nullptr, 16);
-        regions.push_back(region);
-    }
-    return regions;
+    const RegionIndex *index = loadRegionIndex(pid);
+    return index != nullptr ? index->regions() : std::vector<MemoryRegion>{};
 }
 
 std::vector<MemoryRegion> findModuleRegions(pid_t pid, const std::string &moduleName) {
-    std::vector<MemoryRegion> matches;
-    const auto regions = listMemoryRegions(pid);
-    for (const auto &region : regions) {
-        if (!region.pathname.empty()) {
-            const auto namePos = region.pathname.find(moduleName);
-            if (namePos != std::string::npos) {
-                matches.push_back(region);
-            }
-        }
-    }
-    return matches;
+    const RegionIndex *index = loadRegionIndex(pid);
+    return index != nullptr ? index->moduleRegions(moduleName) : std::vector<MemoryRegion>{};
+}
+
+std::vector<MemoryRegion> listMemoryRegions(const MemorySource &source) {
+    return source.regions();
+}
+
+std::vector<MemoryRegion> findModuleRegions(const MemorySource &source, const std::string &moduleName) {
+    std::vector<MemoryRegion> regions = source.regions();
+    regions.erase(std::remove_if(regions.begin(), regions.end(),
+                                 [&](const MemoryRegion &region) { return region.pathname.find(moduleName) == std::string::npos; }),
+                  regions.end());
+    return regions;
 }
 
 std::string describeMemoryRegion(const MemoryRegion &region) {
@@ -119,4 +152,62 @@ std::string describeMemoryRegion(const MemoryRegion &region) {
     return oss.str();
 }
 
+std::vector<MemoryRegion> filterRegions(const std::vector<MemoryRegion> &regions, const RegionFilter &filter) {
+    std::vector<MemoryRegion> matches;
+    for (const auto &region : regions) {
+        if (filter.matches(region)) {
+            matches.push_back(region);
+        }
+    }
+    return matches;
+}
+
+const MemoryRegion *findRegionContaining(const std::vector<MemoryRegion> &regions, uintptr_t address) {
+    auto it = std::upper_bound(regions.begin(), regions.end(), address, [](uintptr_t value, const MemoryRegion &region) {
+        return value < region.start;
+    });
+    if (it == regions.begin()) {
+        return nullptr;
+    }
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+const char *regionKindName(RegionKind kind) {
+    switch (kind) {
+    case RegionKind::Anonymous:
+        return "anon";
+    case RegionKind::FileBacked:
+        return "file";
+    case RegionKind::Heap:
+        return "heap";
+    case RegionKind::Stack:
+        return "stack";
+    case RegionKind::Special:
+        return "special";
+    }
+    return "unknown";
+}
+
+bool parseRegionKinds(const std::string &text, unsigned &kinds) {
+    kinds = 0;
+    std::istringstream iss(text);
+    std::string name;
+    while (std::getline(iss, name, ',')) {
+        name = trim(name);
+        if (name == "all") {
+            kinds |= allRegionKinds;
+            continue;
+        }
+        const auto it = std::find_if(std::begin(allKinds), std::end(allKinds), [&](RegionKind kind) {
+            return name == regionKindName(kind);
+        });
+        if (it == std::end(allKinds)) {
+            return false;
+        }
+        kinds |= static_cast<unsigned>(*it);
+    }
+    return kinds != 0;
+}
+
 } // namespace ProcessUtils
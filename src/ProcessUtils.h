@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
@@ -7,6 +8,16 @@
 
 #include <sys/types.h>
 
+enum class RegionKind : unsigned {
+    Anonymous = 1u << 0,
+    FileBacked = 1u << 1,
+    Heap = 1u << 2,
+    Stack = 1u << 3,
+    Special = 1u << 4,
+};
+
+constexpr unsigned allRegionKinds = 0x1f;
+
 struct MemoryRegion {
     uintptr_t start{};
     uintptr_t end{};
@@ -16,8 +27,24 @@ struct MemoryRegion {
     size_t size() const { return static_cast<size_t>(end - start); }
     bool isReadable() const { return !permissions.empty() && permissions[0] == 'r'; }
     bool isWritable() const { return permissions.size() > 1 && permissions[1] == 'w'; }
+    RegionKind kind() const;
 };
 
+// Selects mappings for a scan. Permission strings list characters from the maps
+// permission field ("rwxps"); every required one must be present and no excluded
+// one may be. kinds is a mask of RegionKind bits.
+struct RegionFilter {
+    std::string requiredPermissions{"r"};
+    std::string excludedPermissions;
+    unsigned kinds{allRegionKinds};
+    size_t minSize{0};
+    size_t maxSize{SIZE_MAX};
+
+    bool matches(const MemoryRegion &region) const;
+};
+
+class MemorySource;
+
 struct ProcessInfo {
     pid_t pid{};
     std::string name;
@@ -27,8 +54,19 @@ namespace ProcessUtils {
 
 std::vector<ProcessInfo> listProcesses();
 std::optional<ProcessInfo> findProcessByName(const std::string &name);
+// Every process named name, by pid.
+std::vector<ProcessInfo> findProcessesByName(const std::string &name);
 std::vector<MemoryRegion> listMemoryRegions(pid_t pid);
 std::vector<MemoryRegion> findModuleRegions(pid_t pid, const std::string &moduleName);
+// The same listings for any memory source, live or captured.
+std::vector<MemoryRegion> listMemoryRegions(const MemorySource &source);
+std::vector<MemoryRegion> findModuleRegions(const MemorySource &source, const std::string &moduleName);
 std::string describeMemoryRegion(const MemoryRegion &region);
+std::vector<MemoryRegion> filterRegions(const std::vector<MemoryRegion> &regions, const RegionFilter &filter);
+// regions must be sorted by address, as listMemoryRegions returns them.
+const MemoryRegion *findRegionContaining(const std::vector<MemoryRegion> &regions, uintptr_t address);
+const char *regionKindName(RegionKind kind);
+// Parses a comma separated list such as "anon,heap,stack" into a RegionKind mask.
+bool parseRegionKinds(const std::string &text, unsigned &kinds);
 
 }
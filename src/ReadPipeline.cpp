@@ -0,0 +1,120 @@
+#include "ReadPipeline.h"
+
+#include "ScanStats.h"
+
+#include <algorithm>
+
+ReadPipeline::ReadPipeline(const MemorySource &reader, std::vector<ReadRange> ranges, size_t overlap, size_t depth)
+    : reader_(reader), ranges_(std::move(ranges)), overlap_(overlap) {
+    size_t largestChunk = 0;
+    for (const auto &range : ranges_) {
+        largestChunk = std::max(largestChunk, std::min(range.chunkSize, static_cast<size_t>(range.end - range.begin)));
+    }
+    buffers_.resize(std::max<size_t>(depth, 1));
+    slots_.resize(buffers_.size());
+    for (auto &buffer : buffers_) {
+        buffer.reserve(largestChunk + overlap_);
+    }
+    cursor_ = ranges_.empty() ? 0 : ranges_.front().begin;
+    if (slots_.size() > 1) {
+        producer_ = std::thread([this] { produce(); });
+    }
+}
+
+ReadPipeline::~ReadPipeline() {
+    cancel();
+    if (producer_.joinable()) {
+        producer_.join();
+    }
+}
+
+void ReadPipeline::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+    }
+    freeCondition_.notify_all();
+    readyCondition_.notify_all();
+}
+
+const PipelineChunk *ReadPipeline::next() {
+    if (!producer_.joinable()) {
+        return !cancelled_ && fill(0) ? &slots_[0] : nullptr;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (holding_) {
+        holding_ = false;
+        head_ = (head_ + 1) % slots_.size();
+        --inUse_;
+        freeCondition_.notify_one();
+    }
+    readyCondition_.wait(lock, [this] { return ready_ > 0 || finished_ || cancelled_; });
+    if (cancelled_ || ready_ == 0) {
+        return nullptr;
+    }
+    --ready_;
+    holding_ = true;
+    return &slots_[head_];
+}
+
+bool ReadPipeline::fill(size_t slot) {
+    while (rangeIndex_ < ranges_.size() && cursor_ >= ranges_[rangeIndex_].end) {
+        ++rangeIndex_;
+        cursor_ = rangeIndex_ < ranges_.size() ? ranges_[rangeIndex_].begin : 0;
+    }
+    if (rangeIndex_ == ranges_.size()) {
+        return false;
+    }
+    const ReadRange &range = ranges_[rangeIndex_];
+    PipelineChunk &chunk = slots_[slot];
+    std::vector<uint8_t> &buffer = buffers_[slot];
+    chunk.range = rangeIndex_;
+    chunk.address = cursor_;
+    chunk.chunkBytes = std::min(std::max<size_t>(range.chunkSize, 1), static_cast<size_t>(range.end - cursor_));
+    chunk.size = std::min(chunk.chunkBytes + overlap_, static_cast<size_t>(range.regionEnd - cursor_));
+    chunk.readStart = ScanStats::now();
+    chunk.data = reader_.view(cursor_, chunk.size);
+    chunk.spans.clear();
+    if (chunk.data != nullptr) {
+        chunk.spans.push_back({0, chunk.size});
+    } else {
+        buffer.resize(chunk.size);
+        reader_.readAvailable(cursor_, buffer.data(), chunk.size, chunk.spans);
+        chunk.data = buffer.data();
+    }
+    chunk.readNanoseconds = ScanStats::now() - chunk.readStart;
+    chunk.readThread = ScanStats::threadIndex();
+    cursor_ += chunk.chunkBytes;
+    return true;
+}
+
+void ReadPipeline::produce() {
+    for (;;) {
+        size_t slot = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            freeCondition_.wait(lock, [this] { return inUse_ < slots_.size() || cancelled_; });
+            if (cancelled_) {
+                return;
+            }
+            slot = tail_;
+        }
+        // The slot is outside [head_, head_ + inUse_), so the consumer never looks
+        // at it while it is being filled.
+        if (!fill(slot)) {
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tail_ = (tail_ + 1) % slots_.size();
+            ++inUse_;
+            ++ready_;
+        }
+        readyCondition_.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+    }
+    readyCondition_.notify_one();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "MemorySource.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One span of a scan: [begin, end) is read in chunkSize pieces, each extended by
+// the pipeline's overlap but never past regionEnd.
+struct ReadRange {
+    uintptr_t begin{};
+    uintptr_t end{};
+    uintptr_t regionEnd{};
+    size_t chunkSize{};
+};
+
+struct PipelineChunk {
+    size_t range{};
+    uintptr_t address{};
+    // Bytes of the range this chunk is responsible for, and the bytes in data
+    // (chunkBytes plus the overlap that was still inside the region).
+    size_t chunkBytes{};
+    size_t size{};
+    // The parts of data that could be read; empty when the whole chunk failed.
+    std::vector<ReadSpan> spans;
+    // When the read ran and on which ScanStats thread index, for tracing.
+    uint64_t readStart{};
+    uint64_t readNanoseconds{};
+    uint32_t readThread{};
+    const uint8_t *data{};
+};
+
+// Reads the ranges chunk by chunk on a producer thread into a ring of depth
+// reusable buffers while the consumer scans the chunks already read, so the copy
+// out of the target and the compare overlap. Chunks are delivered in order. With
+// depth 1 there is no producer thread and next() reads on the calling thread,
+// which is faster when there is no second core to overlap with. Chunks a source
+// can view in place are delivered without a copy.
+class ReadPipeline {
+public:
+    ReadPipeline(const MemorySource &reader, std::vector<ReadRange> ranges, size_t overlap, size_t depth = 4);
+    ~ReadPipeline();
+
+    ReadPipeline(const ReadPipeline &) = delete;
+    ReadPipeline &operator=(const ReadPipeline &) = delete;
+
+    // Hands the previous chunk's buffer back to the producer and waits for the
+    // next chunk. Returns null once every range was delivered or after cancel().
+    const PipelineChunk *next();
+    // Stops reading ahead; next() returns null from now on.
+    void cancel();
+
+private:
+    void produce();
+    // Reads the chunk at the cursor into slot and advances the cursor; false once
+    // every range is done.
+    bool fill(size_t slot);
+
+    const MemorySource &reader_;
+    std::vector<ReadRange> ranges_;
+    size_t overlap_{};
+    std::vector<std::vector<uint8_t>> buffers_;
+    std::vector<PipelineChunk> slots_;
+    size_t rangeIndex_{};
+    uintptr_t cursor_{};
+
+    std::mutex mutex_;
+    std::condition_variable readyCondition_;
+    std::condition_variable freeCondition_;
+    // Slots are filled at tail_ and consumed at head_; ready_ counts filled slots
+    // not yet handed out and inUse_ additionally the one the consumer holds.
+    size_t head_{};
+    size_t tail_{};
+    size_t ready_{};
+    size_t inUse_{};
+    bool holding_{false};
+    bool finished_{false};
+    bool cancelled_{false};
+    std::thread producer_;
+};
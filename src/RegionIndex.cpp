@@ -0,0 +1,309 @@
+#include "RegionIndex.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+constexpr size_t initialBufferSize = 64 * 1024;
+
+// Parses hex digits at text[pos] and advances pos past them.
+uint64_t parseHex(std::string_view text, size_t &pos) {
+    uint64_t value = 0;
+    for (; pos < text.size(); ++pos) {
+        const char c = text[pos];
+        unsigned digit = 0;
+        if (c >= '0' && c <= '9') {
+            digit = static_cast<unsigned>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = static_cast<unsigned>(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            digit = static_cast<unsigned>(c - 'A' + 10);
+        } else {
+            break;
+        }
+        value = value << 4 | digit;
+    }
+    return value;
+}
+
+uint64_t parseDecimal(std::string_view text, size_t &pos) {
+    uint64_t value = 0;
+    for (; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos) {
+        value = value * 10 + static_cast<uint64_t>(text[pos] - '0');
+    }
+    return value;
+}
+
+void skipSpaces(std::string_view text, size_t &pos) {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) {
+        ++pos;
+    }
+}
+
+void skipField(std::string_view text, size_t &pos) {
+    while (pos < text.size() && text[pos] != ' ' && text[pos] != '\t') {
+        ++pos;
+    }
+}
+
+bool lessByStart(const RegionEntry &lhs, const RegionEntry &rhs) {
+    return lhs.start < rhs.start;
+}
+
+} // namespace
+
+bool RegionEntry::sameMapping(const RegionEntry &other) const {
+    return start == other.start && end == other.end && offset == other.offset && inode == other.inode &&
+           pathId == other.pathId && std::memcmp(permissions, other.permissions, sizeof(permissions)) == 0;
+}
+
+bool RegionIndex::readMaps(std::string &error) {
+    const std::string path = "/proc/" + std::to_string(pid_) + "/maps";
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    if (buffer_.empty()) {
+        buffer_.resize(initialBufferSize);
+    }
+    // The buffer is kept between loads; it only grows when the maps outgrow it.
+    size_t used = 0;
+    for (;;) {
+        if (used == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+        const ssize_t count = ::read(fd, buffer_.data() + used, buffer_.size() - used);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = "cannot read " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<size_t>(count);
+    }
+    ::close(fd);
+    compactPaths();
+    parseInto(std::string_view(buffer_.data(), used), scratch_);
+    return true;
+}
+
+void RegionIndex::parseInto(std::string_view text, std::vector<RegionEntry> &entries) {
+    entries.clear();
+    size_t lineStart = 0;
+    while (lineStart < text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = text.size();
+        }
+        const std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        // start-end perms offset dev inode [pathname]
+        RegionEntry entry;
+        size_t pos = 0;
+        entry.start = static_cast<uintptr_t>(parseHex(line, pos));
+        if (pos == 0 || pos >= line.size() || line[pos] != '-') {
+            continue;
+        }
+        ++pos;
+        entry.end = static_cast<uintptr_t>(parseHex(line, pos));
+        skipSpaces(line, pos);
+        const size_t permissionsStart = pos;
+        skipField(line, pos);
+        std::memcpy(entry.permissions, line.data() + permissionsStart,
+                    std::min(pos - permissionsStart, sizeof(entry.permissions)));
+        skipSpaces(line, pos);
+        entry.offset = parseHex(line, pos);
+        skipSpaces(line, pos);
+        skipField(line, pos);
+        skipSpaces(line, pos);
+        entry.inode = parseDecimal(line, pos);
+        skipSpaces(line, pos);
+        std::string_view path = line.substr(pos);
+        while (!path.empty() && (path.back() == ' ' || path.back() == '\t' || path.back() == '\r')) {
+            path.remove_suffix(1);
+        }
+        entry.pathId = path.empty() ? 0 : internPath(path);
+        entries.push_back(entry);
+    }
+    // The kernel lists mappings in address order; sort only if a source did not.
+    if (!std::is_sorted(entries.begin(), entries.end(), lessByStart)) {
+        std::sort(entries.begin(), entries.end(), lessByStart);
+    }
+}
+
+uint32_t RegionIndex::internPath(std::string_view path) {
+    const auto it = pathIds_.find(path);
+    if (it != pathIds_.end()) {
+        return it->second;
+    }
+    const std::string_view stored = pathStorage_.emplace_back(path);
+    const auto id = static_cast<uint32_t>(paths_.size());
+    paths_.push_back(stored);
+    pathIds_.emplace(stored, id);
+    return id;
+}
+
+void RegionIndex::compactPaths() {
+    pathRemap_.assign(paths_.size(), 0);
+    for (const auto &entry : entries_) {
+        pathRemap_[entry.pathId] = 1;
+    }
+    size_t used = 0;
+    for (size_t id = 1; id < pathRemap_.size(); ++id) {
+        used += pathRemap_[id];
+    }
+    if (paths_.size() - 1 - used <= used) {
+        return;
+    }
+    std::deque<std::string> storage;
+    paths_.resize(1);
+    pathIds_.clear();
+    for (size_t id = 1; id < pathRemap_.size(); ++id) {
+        if (pathRemap_[id] == 0) {
+            continue;
+        }
+        const std::string_view stored = storage.emplace_back(std::move(pathStorage_[id - 1]));
+        pathRemap_[id] = static_cast<uint32_t>(paths_.size());
+        paths_.push_back(stored);
+        pathIds_.emplace(stored, pathRemap_[id]);
+    }
+    pathStorage_ = std::move(storage);
+    for (auto &entry : entries_) {
+        entry.pathId = pathRemap_[entry.pathId];
+    }
+}
+
+void RegionIndex::setPid(pid_t pid) {
+    if (pid != pid_) {
+        pid_ = pid;
+        entries_.clear();
+    }
+}
+
+bool RegionIndex::load(std::string &error) {
+    if (!readMaps(error)) {
+        return false;
+    }
+    entries_.swap(scratch_);
+    return true;
+}
+
+bool RegionIndex::refresh(RegionDiff &diff, std::string &error) {
+    diff = {};
+    if (!readMaps(error)) {
+        return false;
+    }
+    // Both lists are sorted by start, so one merge pass finds the differences.
+    size_t oldIndex = 0;
+    size_t newIndex = 0;
+    while (oldIndex < entries_.size() || newIndex < scratch_.size()) {
+        if (newIndex == scratch_.size()) {
+            diff.removed.push_back(entries_[oldIndex++]);
+        } else if (oldIndex == entries_.size()) {
+            diff.added.push_back(scratch_[newIndex++]);
+        } else if (entries_[oldIndex].sameMapping(scratch_[newIndex])) {
+            ++diff.unchanged;
+            ++oldIndex;
+            ++newIndex;
+        } else if (entries_[oldIndex].start < scratch_[newIndex].start) {
+            diff.removed.push_back(entries_[oldIndex++]);
+        } else if (scratch_[newIndex].start < entries_[oldIndex].start) {
+            diff.added.push_back(scratch_[newIndex++]);
+        } else {
+            diff.removed.push_back(entries_[oldIndex++]);
+            diff.added.push_back(scratch_[newIndex++]);
+        }
+    }
+    entries_.swap(scratch_);
+    return true;
+}
+
+void RegionIndex::parse(std::string_view text) {
+    entries_.clear();
+    compactPaths();
+    parseInto(text, entries_);
+}
+
+const RegionEntry *RegionIndex::find(uintptr_t address) const {
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), address,
+                               [](uintptr_t value, const RegionEntry &entry) { return value < entry.start; });
+    if (it == entries_.begin()) {
+        return nullptr;
+    }
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+void RegionIndex::assignRegion(const RegionEntry &entry, MemoryRegion &region) const {
+    const std::string_view pathname = path(entry);
+    region.start = entry.start;
+    region.end = entry.end;
+    region.permissions.assign(entry.permissions, strnlen(entry.permissions, sizeof(entry.permissions)));
+    region.pathname.assign(pathname.data(), pathname.size());
+}
+
+MemoryRegion RegionIndex::region(const RegionEntry &entry) const {
+    MemoryRegion region;
+    assignRegion(entry, region);
+    return region;
+}
+
+std::vector<MemoryRegion> RegionIndex::collect(const std::vector<uint8_t> *pathMatches, const RegionFilter *filter) const {
+    std::vector<MemoryRegion> result;
+    if (filter == nullptr) {
+        result.reserve(entries_.size());
+    }
+    MemoryRegion candidate;
+    for (const auto &entry : entries_) {
+        if (pathMatches != nullptr && (*pathMatches)[entry.pathId] == 0) {
+            continue;
+        }
+        if (filter == nullptr) {
+            result.push_back(region(entry));
+            continue;
+        }
+        assignRegion(entry, candidate);
+        if (filter->matches(candidate)) {
+            result.push_back(candidate);
+        }
+    }
+    return result;
+}
+
+std::vector<uint8_t> RegionIndex::matchPaths(std::string_view moduleName) const {
+    std::vector<uint8_t> pathMatches(paths_.size(), 0);
+    for (size_t id = 1; id < paths_.size(); ++id) {
+        pathMatches[id] = paths_[id].find(moduleName) != std::string_view::npos ? 1 : 0;
+    }
+    return pathMatches;
+}
+
+std::vector<MemoryRegion> RegionIndex::regions() const {
+    return collect(nullptr, nullptr);
+}
+
+std::vector<MemoryRegion> RegionIndex::regions(const RegionFilter &filter) const {
+    return collect(nullptr, &filter);
+}
+
+std::vector<MemoryRegion> RegionIndex::moduleRegions(std::string_view moduleName) const {
+    const std::vector<uint8_t> pathMatches = matchPaths(moduleName);
+    return collect(&pathMatches, nullptr);
+}
+
+std::vector<MemoryRegion> RegionIndex::moduleRegions(std::string_view moduleName, const RegionFilter &filter) const {
+    const std::vector<uint8_t> pathMatches = matchPaths(moduleName);
+    return collect(&pathMatches, &filter);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ProcessUtils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+// One line of /proc/<pid>/maps without owning strings: the pathname is an id into
+// the index's interned path table (0 for anonymous mappings).
+struct RegionEntry {
+    uintptr_t start{};
+    uintptr_t end{};
+    uint64_t offset{};
+    uint64_t inode{};
+    uint32_t pathId{};
+    char permissions[4]{};
+
+    size_t size() const { return static_cast<size_t>(end - start); }
+    bool sameMapping(const RegionEntry &other) const;
+};
+
+// Regions that appeared and disappeared between two loads. A mapping whose
+// bounds, permissions or backing changed shows up in both lists.
+struct RegionDiff {
+    std::vector<RegionEntry> added;
+    std::vector<RegionEntry> removed;
+    size_t unchanged{};
+
+    bool empty() const { return added.empty() && removed.empty(); }
+};
+
+// Sorted index of a process's mappings. The maps file is read in one pass into a
+// reused buffer and parsed in place; each distinct pathname is stored once, so a
+// refresh of an unchanged process does not allocate. Paths no longer mapped are
+// dropped once they outnumber the mapped ones, so path ids (including those in a
+// RegionDiff) are only valid until the next load.
+class RegionIndex {
+public:
+    RegionIndex() = default;
+    explicit RegionIndex(pid_t pid) : pid_(pid) {}
+
+    // Interned paths are referenced by view, so the index moves but never copies.
+    RegionIndex(const RegionIndex &) = delete;
+    RegionIndex &operator=(const RegionIndex &) = delete;
+    RegionIndex(RegionIndex &&) = default;
+    RegionIndex &operator=(RegionIndex &&) = default;
+
+    // Points the index at another process, keeping its buffers for the next load.
+    void setPid(pid_t pid);
+    // Replaces the index with the current maps of pid. False when the maps file
+    // cannot be read.
+    bool load(std::string &error);
+    // Reloads and reports what changed since the previous load.
+    bool refresh(RegionDiff &diff, std::string &error);
+    // Parses maps text directly, e.g. from a saved copy.
+    void parse(std::string_view text);
+
+    pid_t pid() const { return pid_; }
+    const std::vector<RegionEntry> &entries() const { return entries_; }
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    std::string_view path(const RegionEntry &entry) const { return paths_[entry.pathId]; }
+    size_t pathCount() const { return paths_.size() - 1; }
+
+    // Entry containing address, or null; O(log n).
+    const RegionEntry *find(uintptr_t address) const;
+
+    MemoryRegion region(const RegionEntry &entry) const;
+    std::vector<MemoryRegion> regions() const;
+    // Mappings passing filter. Entries are tested through one reused region, so
+    // only the ones kept allocate their pathname.
+    std::vector<MemoryRegion> regions(const RegionFilter &filter) const;
+    // Mappings whose pathname contains moduleName. Each distinct path is tested
+    // once, not once per mapping.
+    std::vector<MemoryRegion> moduleRegions(std::string_view moduleName) const;
+    std::vector<MemoryRegion> moduleRegions(std::string_view moduleName, const RegionFilter &filter) const;
+
+private:
+    bool readMaps(std::string &error);
+    void parseInto(std::string_view text, std::vector<RegionEntry> &entries);
+    uint32_t internPath(std::string_view path);
+    // Drops the paths entries_ no longer uses once they outnumber the used ones,
+    // renumbering the rest.
+    void compactPaths();
+    void assignRegion(const RegionEntry &entry, MemoryRegion &region) const;
+    // Entries whose path is marked in pathMatches (every entry when null) and that
+    // pass filter (every entry when null).
+    std::vector<MemoryRegion> collect(const std::vector<uint8_t> *pathMatches, const RegionFilter *filter) const;
+    std::vector<uint8_t> matchPaths(std::string_view moduleName) const;
+
+    pid_t pid_{};
+    std::vector<char> buffer_;
+    std::vector<RegionEntry> entries_;
+    std::vector<RegionEntry> scratch_;
+    // paths_[0] is the empty path. The deque keeps the strings in place so the
+    // views used as map keys stay valid.
+    std::deque<std::string> pathStorage_;
+    std::vector<std::string_view> paths_{std::string_view{}};
+    std::unordered_map<std::string_view, uint32_t> pathIds_;
+    // New id of each path during compactPaths, 0 for unused ones.
+    std::vector<uint32_t> pathRemap_;
+};
@@ -0,0 +1,167 @@
+#include "ScanStats.h"
+
+#include <atomic>
+#include <fstream>
+
+namespace {
+
+uint32_t currentThreadIndex() {
+    static std::atomic<uint32_t> nextIndex{0};
+    thread_local const uint32_t index = nextIndex.fetch_add(1);
+    return index;
+}
+
+double milliseconds(uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e6;
+}
+
+} // namespace
+
+uint64_t TaskStats::endSpan(const char *name, uint64_t start) {
+    const uint64_t end = ScanStats::now();
+    if (tracing) {
+        spans.push_back({name, currentThreadIndex(), start, end - start});
+    }
+    return end - start;
+}
+
+void TaskStats::addSpan(const char *name, uint32_t thread, uint64_t start, uint64_t duration) {
+    if (tracing) {
+        spans.push_back({name, thread, start, duration});
+    }
+}
+
+ScanStats::ScanStats(bool tracing) : tracing_(tracing), origin_(now()) {}
+
+uint32_t ScanStats::threadIndex() {
+    return currentThreadIndex();
+}
+
+uint64_t ScanStats::now() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+size_t ScanStats::beginPhase(const char *name, const MemorySource &reader, uint64_t candidatesIn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScanPhaseStats phase;
+    phase.name = name;
+    phase.candidatesIn = candidatesIn;
+    phases_.push_back(std::move(phase));
+    phaseNames_.push_back(name);
+    phaseStarts_.push_back(now());
+    phaseReads_.push_back(reader.statistics());
+    return phases_.size() - 1;
+}
+
+void ScanStats::endPhase(size_t phase, const MemorySource &reader, uint64_t candidatesOut) {
+    const uint64_t end = now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScanPhaseStats &stats = phases_[phase];
+    stats.wallNanoseconds = end - phaseStarts_[phase];
+    stats.reads = reader.statistics() - phaseReads_[phase];
+    stats.candidatesOut = candidatesOut;
+    if (tracing_) {
+        spans_.push_back({phaseNames_[phase], currentThreadIndex(), phaseStarts_[phase], stats.wallNanoseconds});
+    }
+}
+
+TaskStats ScanStats::beginTask() const {
+    TaskStats task;
+    task.tracing = tracing_;
+    return task;
+}
+
+void ScanStats::endTask(size_t phase, const MemoryRegion &region, uint64_t taskStart, TaskStats &task) {
+    const uint64_t duration = task.endSpan("task", taskStart);
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScanPhaseStats &stats = phases_[phase];
+    stats.bytesScanned += task.bytesScanned;
+    stats.chunks += task.chunks;
+    stats.failedChunks += task.failedChunks;
+    stats.partialChunks += task.partialChunks;
+    stats.readNanoseconds += task.readNanoseconds;
+    stats.compareNanoseconds += task.compareNanoseconds;
+
+    RegionScanStats &regionStats = stats.regions[region.start];
+    regionStats.region = region;
+    regionStats.bytesScanned += task.bytesScanned;
+    regionStats.failedChunks += task.failedChunks;
+    regionStats.candidates += task.candidates;
+    regionStats.nanoseconds += duration;
+    spans_.insert(spans_.end(), task.spans.begin(), task.spans.end());
+}
+
+void ScanStats::writeJson(JsonWriter &json) const {
+    json.beginArray();
+    for (const auto &phase : phases_) {
+        json.beginObject();
+        json.key("name").value(phase.name);
+        json.key("wall_ms").value(milliseconds(phase.wallNanoseconds));
+        json.key("candidates_in").value(phase.candidatesIn);
+        json.key("candidates_out").value(phase.candidatesOut);
+        json.key("bytes_scanned").value(phase.bytesScanned);
+        json.key("chunks").value(phase.chunks);
+        json.key("failed_chunks").value(phase.failedChunks);
+        json.key("partial_chunks").value(phase.partialChunks);
+        json.key("read_ms").value(milliseconds(phase.readNanoseconds));
+        json.key("compare_ms").value(milliseconds(phase.compareNanoseconds));
+        json.key("reads").beginObject();
+        json.key("bytes_requested").value(phase.reads.bytesRequested);
+        json.key("bytes_read").value(phase.reads.bytesRead);
+        json.key("process_vm_readv_calls").value(phase.reads.vmReadvCalls);
+        json.key("pread_calls").value(phase.reads.preadCalls);
+        json.key("mapped_copies").value(phase.reads.mappedCopies);
+        json.key("mapped_views").value(phase.reads.mappedViews);
+        json.key("failed_reads").value(phase.reads.failedReads);
+        json.key("unreadable_pages").value(phase.reads.unreadablePages);
+        json.key("skipped_pages").value(phase.reads.skippedPages);
+        json.endObject();
+        json.key("regions").beginArray();
+        for (const auto &entry : phase.regions) {
+            const RegionScanStats &region = entry.second;
+            json.beginObject();
+            json.key("start").address(region.region.start);
+            json.key("end").address(region.region.end);
+            json.key("permissions").value(region.region.permissions);
+            json.key("path").value(region.region.pathname);
+            json.key("bytes_scanned").value(region.bytesScanned);
+            json.key("failed_chunks").value(region.failedChunks);
+            json.key("candidates").value(region.candidates);
+            json.key("time_ms").value(milliseconds(region.nanoseconds));
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+    }
+    json.endArray();
+}
+
+bool ScanStats::writeTrace(const std::string &path, std::string &error) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("traceEvents").beginArray();
+    for (const auto &span : spans_) {
+        json.beginObject();
+        json.key("name").value(span.name);
+        json.key("ph").value("X");
+        json.key("pid").value(0);
+        json.key("tid").value(span.thread);
+        json.key("ts").value(static_cast<double>(span.start - origin_) / 1e3);
+        json.key("dur").value(static_cast<double>(span.duration) / 1e3);
+        json.endObject();
+    }
+    json.endArray();
+    json.key("displayTimeUnit").value("ms");
+    json.endObject();
+    if (!out) {
+        error = "failed to write " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "JsonWriter.h"
+#include "MemorySource.h"
+#include "ProcessUtils.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceSpan {
+    const char *name{};
+    uint32_t thread{};
+    uint64_t start{};
+    uint64_t duration{};
+};
+
+// Filled by one scan task without synchronization and folded into ScanStats when
+// the task ends.
+struct TaskStats {
+    uint64_t bytesScanned{};
+    uint64_t chunks{};
+    uint64_t failedChunks{};
+    // Chunks read only in part because some of their pages were unreadable.
+    uint64_t partialChunks{};
+    uint64_t candidates{};
+    uint64_t readNanoseconds{};
+    uint64_t compareNanoseconds{};
+    bool tracing{false};
+    std::vector<TraceSpan> spans;
+
+    // Adds a span ending now when tracing and returns its duration.
+    uint64_t endSpan(const char *name, uint64_t start);
+    // Adds a span measured elsewhere, e.g. on a read-ahead thread.
+    void addSpan(const char *name, uint32_t thread, uint64_t start, uint64_t duration);
+};
+
+struct RegionScanStats {
+    MemoryRegion region;
+    uint64_t bytesScanned{};
+    uint64_t failedChunks{};
+    uint64_t candidates{};
+    // Sum of the task times spent in the region, across all threads.
+    uint64_t nanoseconds{};
+};
+
+struct ScanPhaseStats {
+    std::string name;
+    uint64_t wallNanoseconds{};
+    ReadStatistics reads;
+    uint64_t bytesScanned{};
+    uint64_t chunks{};
+    uint64_t failedChunks{};
+    uint64_t partialChunks{};
+    uint64_t readNanoseconds{};
+    uint64_t compareNanoseconds{};
+    uint64_t candidatesIn{};
+    uint64_t candidatesOut{};
+    std::map<uintptr_t, RegionScanStats> regions;
+};
+
+// Counters for the scans of one run. Attach with OffsetScanner::setStats; every
+// scanner operation becomes a phase with reader counters, per-region totals and,
+// when tracing, read/compare spans per chunk.
+class ScanStats {
+public:
+    explicit ScanStats(bool tracing = false);
+
+    // Monotonic nanoseconds; spans are stored relative to the stats' creation.
+    static uint64_t now();
+    // Small per-thread number used as the trace thread id.
+    static uint32_t threadIndex();
+    bool tracing() const { return tracing_; }
+
+    size_t beginPhase(const char *name, const MemorySource &reader, uint64_t candidatesIn = 0);
+    void endPhase(size_t phase, const MemorySource &reader, uint64_t candidatesOut);
+    TaskStats beginTask() const;
+    void endTask(size_t phase, const MemoryRegion &region, uint64_t taskStart, TaskStats &task);
+
+    const std::vector<ScanPhaseStats> &phases() const { return phases_; }
+
+    void writeJson(JsonWriter &json) const;
+    // Chrome trace event format, loadable in chrome://tracing or Perfetto.
+    bool writeTrace(const std::string &path, std::string &error) const;
+
+private:
+    bool tracing_{false};
+    uint64_t origin_{};
+    std::mutex mutex_;
+    std::vector<ScanPhaseStats> phases_;
+    std::vector<const char *> phaseNames_;
+    std::vector<uint64_t> phaseStarts_;
+    std::vector<ReadStatistics> phaseReads_;
+    std::vector<TraceSpan> spans_;
+};
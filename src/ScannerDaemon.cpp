@@ -0,0 +1,712 @@
+#include "ScannerDaemon.h"
+
+#include "CandidateWatcher.h"
+#include "Vector3.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// How often blocking waits wake up to look at the stop flag.
+constexpr int stopPollMilliseconds = 200;
+
+std::vector<std::string> splitWords(const std::string &line) {
+    std::istringstream in(line);
+    std::vector<std::string> words;
+    std::string word;
+    while (in >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+std::string formatAddress(uintptr_t address) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << address;
+    return oss.str();
+}
+
+std::string formatMilliseconds(std::chrono::steady_clock::duration elapsed) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << std::chrono::duration<double, std::milli>(elapsed).count() << " ms";
+    return oss.str();
+}
+
+bool parseVector(const std::string &text, Vector3 &out, std::string &error) {
+    try {
+        out = Vector3::parse(text);
+        return true;
+    } catch (const std::exception &ex) {
+        error = ex.what();
+        return false;
+    }
+}
+
+bool parseCount(const std::string &text, size_t &out) {
+    // strtoull accepts a sign and negates the value; a count never has one.
+    if (text.empty() || !std::isxdigit(static_cast<unsigned char>(text.front()))) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text.c_str(), &end, 0);
+    if (end == text.c_str() || *end != '\0' || errno == ERANGE) {
+        return false;
+    }
+    out = static_cast<size_t>(value);
+    return true;
+}
+
+bool makeAddress(const std::string &path, sockaddr_un &address, std::string &error) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        error = "socket path must be 1 to " + std::to_string(sizeof(address.sun_path) - 1) + " bytes: " + path;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+int connectTo(const std::string &path, std::string &error) {
+    sockaddr_un address{};
+    if (!makeAddress(path, address, error)) {
+        return -1;
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("cannot create socket: ") + std::strerror(errno);
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        error = "cannot connect to " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool writeAll(int fd, const std::string &text) {
+    size_t written = 0;
+    while (written < text.size()) {
+        const ssize_t count = ::send(fd, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// Buffered line reader over a socket. readLine waits in slices so that a set stop
+// flag is noticed while the peer is idle.
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    bool readLine(std::string &line, const std::atomic<bool> *stop) {
+        for (;;) {
+            const size_t newline = buffer_.find('\n');
+            if (newline != std::string::npos) {
+                line = buffer_.substr(0, newline);
+                buffer_.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                return true;
+            }
+            if (stop != nullptr && stop->load()) {
+                return false;
+            }
+            pollfd entry{fd_, POLLIN, 0};
+            const int ready = ::poll(&entry, 1, stop != nullptr ? stopPollMilliseconds : -1);
+            if (ready < 0 && errno != EINTR) {
+                return false;
+            }
+            if (ready <= 0) {
+                continue;
+            }
+            char chunk[4096];
+            const ssize_t count = ::recv(fd_, chunk, sizeof(chunk), 0);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            buffer_.append(chunk, static_cast<size_t>(count));
+        }
+    }
+
+private:
+    int fd_;
+    std::string buffer_;
+};
+
+} // namespace
+
+// One client. Result lines are sent as soon as they are produced so long scans and
+// watches stream their output; a write failure marks the client gone.
+class ScannerDaemon::Connection {
+public:
+    explicit Connection(int fd) : fd_(fd), reader_(fd) {}
+
+    bool readLine(std::string &line, const std::atomic<bool> *stop) { return reader_.readLine(line, stop); }
+
+    void result(const std::string &text) { send("- " + text); }
+    void ok(const std::string &summary) { send(summary.empty() ? "ok" : "ok " + summary); }
+    void fail(const std::string &message) { send("error " + message); }
+    bool alive() const { return alive_; }
+
+private:
+    void send(const std::string &line) {
+        if (alive_) {
+            alive_ = writeAll(fd_, line + "\n");
+        }
+    }
+
+    int fd_;
+    LineReader reader_;
+    bool alive_{true};
+};
+
+struct ScannerDaemon::Session {
+    ProcessInfo process;
+    // Empty when the scope is every mapping passing the region filter.
+    std::string moduleName;
+    RegionIndex index;
+    // Shared with the scanner; kept to drop cached holes when mappings change.
+    std::shared_ptr<ProcessMemoryReader> reader;
+    std::unique_ptr<OffsetScanner> scanner;
+
+    std::vector<MemoryRegion> scope(const RegionFilter &filter) const {
+        return moduleName.empty() ? index.regions(filter) : index.moduleRegions(moduleName, filter);
+    }
+
+    // Module offsets count from the module's first mapping, which the region
+    // filter may leave out of the scope.
+    void updateModuleBase() {
+        if (moduleName.empty()) {
+            return;
+        }
+        const std::vector<MemoryRegion> mappings = index.moduleRegions(moduleName);
+        if (!mappings.empty()) {
+            scanner->setModuleBase(mappings.front().start);
+        }
+    }
+};
+
+ScannerDaemon::ScannerDaemon(std::string socketPath, DaemonSettings settings)
+    : socketPath_(std::move(socketPath)), settings_(std::move(settings)) {}
+
+ScannerDaemon::~ScannerDaemon() = default;
+
+bool ScannerDaemon::attach(const std::string &process, const std::string &moduleName, std::string &error) {
+    std::optional<ProcessInfo> info;
+    size_t pid = 0;
+    if (parseCount(process, pid)) {
+        for (const auto &candidate : ProcessUtils::listProcesses()) {
+            if (candidate.pid == static_cast<pid_t>(pid)) {
+                info = candidate;
+            }
+        }
+    } else {
+        info = ProcessUtils::findProcessByName(process);
+    }
+    if (!info) {
+        error = "process '" + process + "' not found";
+        return false;
+    }
+
+    auto session = std::make_unique<Session>();
+    session->process = *info;
+    session->moduleName = moduleName;
+    session->index = RegionIndex(info->pid);
+    if (!session->index.load(error)) {
+        return false;
+    }
+    std::vector<MemoryRegion> scope = session->scope(settings_.regionFilter);
+    if (scope.empty()) {
+        error = moduleName.empty() ? "no mappings match the region filters" : "module '" + moduleName + "' not found in process";
+        return false;
+    }
+    session->reader = std::make_shared<ProcessMemoryReader>(info->pid);
+    if (!session->reader->isValid()) {
+        error = "cannot open the memory of pid " + std::to_string(info->pid) + "; root privileges may be required";
+        return false;
+    }
+    session->scanner = std::make_unique<OffsetScanner>(session->reader, std::move(scope));
+    session->updateModuleBase();
+    session_ = std::move(session);
+    // Addresses of the previous process mean nothing in this one.
+    sets_.clear();
+    applySettings();
+    return true;
+}
+
+void ScannerDaemon::applySettings() {
+    if (!session_) {
+        return;
+    }
+    OffsetScanner &scanner = *session_->scanner;
+    scanner.setThreadCount(settings_.threads);
+    scanner.setKernel(settings_.kernel ? *settings_.kernel : VectorKernels::bestSupported());
+    scanner.setValueType(settings_.valueType, settings_.fixedPointScale);
+}
+
+bool ScannerDaemon::refreshScope(std::string &summary, std::string &error) {
+    RegionDiff diff;
+    if (!session_->index.refresh(diff, error)) {
+        return false;
+    }
+    if (diff.empty()) {
+        summary = "mappings unchanged";
+        return true;
+    }
+    session_->reader->forgetUnreadable(diff);
+    session_->scanner->setScope(session_->scope(settings_.regionFilter));
+    session_->updateModuleBase();
+    summary = std::to_string(diff.added.size()) + " mappings added, " + std::to_string(diff.removed.size()) + " removed";
+    return true;
+}
+
+bool ScannerDaemon::run(const std::atomic<bool> *stop, std::string &error) {
+    sockaddr_un address{};
+    if (!makeAddress(socketPath_, address, error)) {
+        return false;
+    }
+    std::string ignored;
+    const int existing = connectTo(socketPath_, ignored);
+    if (existing >= 0) {
+        ::close(existing);
+        error = "a daemon is already serving " + socketPath_;
+        return false;
+    }
+    // Only a stale socket left by a daemon that died is replaced.
+    struct stat existingFile {};
+    if (::lstat(socketPath_.c_str(), &existingFile) == 0) {
+        if (!S_ISSOCK(existingFile.st_mode)) {
+            error = socketPath_ + " exists and is not a socket";
+            return false;
+        }
+        ::unlink(socketPath_.c_str());
+    } else if (errno != ENOENT) {
+        error = "cannot check " + socketPath_ + ": " + std::strerror(errno);
+        return false;
+    }
+
+    const int listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        error = std::string("cannot create socket: ") + std::strerror(errno);
+        return false;
+    }
+    // The daemon can read the attached process, so only its owner may connect.
+    const mode_t previousMask = ::umask(0177);
+    const bool bound = ::bind(listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+    ::umask(previousMask);
+    if (!bound || ::listen(listenFd, 4) != 0) {
+        error = "cannot listen on " + socketPath_ + ": " + std::strerror(errno);
+        ::close(listenFd);
+        return false;
+    }
+
+    stop_ = stop;
+    shutdown_ = false;
+    while (!shutdown_ && !(stop != nullptr && stop->load())) {
+        pollfd entry{listenFd, POLLIN, 0};
+        const int ready = ::poll(&entry, 1, stopPollMilliseconds);
+        if (ready <= 0) {
+            continue;
+        }
+        const int clientFd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientFd < 0) {
+            continue;
+        }
+        Connection connection(clientFd);
+        std::string line;
+        while (!shutdown_ && connection.alive() && connection.readLine(line, stop)) {
+            const std::vector<std::string> words = splitWords(line);
+            if (!words.empty() && !dispatch(words, connection)) {
+                break;
+            }
+        }
+        ::close(clientFd);
+    }
+    ::close(listenFd);
+    ::unlink(socketPath_.c_str());
+    return true;
+}
+
+bool ScannerDaemon::dispatch(const std::vector<std::string> &words, Connection &connection) {
+    const std::string &command = words[0];
+    if (command == "quit") {
+        connection.ok("bye");
+        return false;
+    }
+    if (command == "shutdown") {
+        connection.ok("shutting down");
+        shutdown_ = true;
+        return false;
+    }
+    if (command == "attach") {
+        commandAttach(words, connection);
+    } else if (command == "set") {
+        if (words.size() != 3) {
+            connection.fail("usage: set <name> <value>");
+            return true;
+        }
+        const std::string problem = setOption(words[1], words[2]);
+        if (problem.empty()) {
+            connection.ok(words[1] + " = " + words[2]);
+        } else {
+            connection.fail(problem);
+        }
+    } else if (command == "sets") {
+        commandSets(connection);
+    } else if (command == "drop") {
+        if (words.size() != 2 || sets_.erase(words[1]) == 0) {
+            connection.fail(words.size() != 2 ? "usage: drop <set>" : "no set named " + words[1]);
+        } else {
+            connection.ok("dropped " + words[1]);
+        }
+    } else if (command == "status") {
+        commandStatus(connection);
+    } else if (!session_) {
+        connection.fail("not attached; use attach <name|pid> [<module>]");
+    } else if (command == "scan" || command == "verify") {
+        commandScan(words, connection, command == "verify");
+    } else if (command == "list") {
+        commandList(words, connection);
+    } else if (command == "watch") {
+        commandWatch(words, connection);
+    } else if (command == "refresh") {
+        std::string summary;
+        std::string error;
+        if (refreshScope(summary, error)) {
+            connection.ok(summary);
+        } else {
+            connection.fail(error);
+        }
+    } else {
+        connection.fail("unknown command: " + command);
+    }
+    return true;
+}
+
+std::string ScannerDaemon::setOption(const std::string &name, const std::string &value) {
+    size_t count = 0;
+    if (name == "tolerance" || name == "fixed-scale" || name == "watch-rate") {
+        char *end = nullptr;
+        const double number = std::strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0' || !(number > 0.0)) {
+            return name + " must be a positive number";
+        }
+        if (name == "tolerance") {
+            settings_.tolerance = static_cast<float>(number);
+        } else if (name == "fixed-scale") {
+            settings_.fixedPointScale = number;
+        } else {
+            settings_.watchRate = number;
+        }
+    } else if (name == "max-results" || name == "threads" || name == "watch-still" || name == "watch-max") {
+        if (!parseCount(value, count)) {
+            return name + " must be a count";
+        }
+        if (name == "max-results") {
+            settings_.maxResults = count;
+        } else if (name == "threads") {
+            settings_.threads = count;
+        } else if (name == "watch-still") {
+            settings_.watchStill = count;
+        } else {
+            settings_.watchMax = count;
+        }
+    } else if (name == "kernel") {
+        VectorKernels::KernelKind kernel{};
+        if (!VectorKernels::parseKernelName(value, kernel)) {
+            return "unknown kernel: " + value;
+        }
+        settings_.kernel = kernel;
+    } else if (name == "type") {
+        if (!VectorKernels::parseValueTypeName(value, settings_.valueType)) {
+            return "unknown value type: " + value;
+        }
+    } else {
+        return "unknown setting: " + name;
+    }
+    applySettings();
+    return {};
+}
+
+void ScannerDaemon::commandAttach(const std::vector<std::string> &words, Connection &connection) {
+    if (words.size() < 2 || words.size() > 3) {
+        connection.fail("usage: attach <name|pid> [<module>]");
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::string error;
+    if (!attach(words[1], words.size() == 3 ? words[2] : std::string(), error)) {
+        connection.fail(error);
+        return;
+    }
+    size_t totalBytes = 0;
+    for (const auto &region : session_->scanner->moduleRegions()) {
+        totalBytes += region.size();
+    }
+    connection.ok("attached to " + session_->process.name + " (pid " + std::to_string(session_->process.pid) + "), " +
+                  std::to_string(session_->scanner->moduleRegions().size()) + " mappings, " + std::to_string(totalBytes >> 20) +
+                  " MiB in " + formatMilliseconds(std::chrono::steady_clock::now() - start));
+}
+
+void ScannerDaemon::commandScan(const std::vector<std::string> &words, Connection &connection, bool verify) {
+    if (words.size() != 3) {
+        connection.fail(std::string("usage: ") + (verify ? "verify" : "scan") + " <set> <x,y,z>");
+        return;
+    }
+    Vector3 target;
+    std::string error;
+    if (!parseVector(words[2], target, error)) {
+        connection.fail(error);
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const OffsetScanner &scanner = *session_->scanner;
+    CandidateSet result;
+    if (verify) {
+        const auto existing = sets_.find(words[1]);
+        if (existing == sets_.end()) {
+            connection.fail("no set named " + words[1]);
+            return;
+        }
+        const size_t before = existing->second.size();
+        result = scanner.verifyCandidateSet(existing->second, target, settings_.tolerance);
+        listMembers(result, settings_.maxResults, connection);
+        connection.ok(words[1] + ": " + std::to_string(result.size()) + " of " + std::to_string(before) + " candidates kept in " +
+                      formatMilliseconds(std::chrono::steady_clock::now() - start));
+    } else {
+        // Mappings come and go between steps; one maps read keeps the scope current.
+        std::string summary;
+        if (!refreshScope(summary, error)) {
+            connection.fail(error);
+            return;
+        }
+        result = scanner.findCandidateSet(target, settings_.tolerance);
+        listMembers(result, settings_.maxResults, connection);
+        connection.ok(words[1] + ": " + std::to_string(result.size()) + " candidates in " +
+                      formatMilliseconds(std::chrono::steady_clock::now() - start));
+    }
+    sets_[words[1]] = std::move(result);
+}
+
+void ScannerDaemon::listMembers(const CandidateSet &set, size_t count, Connection &connection) const {
+    for (const auto &candidate : session_->scanner->candidatesFromSet(set, count)) {
+        const RegionEntry *entry = session_->index.find(candidate.address);
+        std::ostringstream line;
+        line << formatAddress(candidate.address) << " " << candidate.value.toString(5);
+        if (entry != nullptr) {
+            line << " " << formatAddress(entry->start) << "+0x" << std::hex << candidate.address - entry->start << std::dec;
+            const std::string_view path = session_->index.path(*entry);
+            if (!path.empty()) {
+                line << " " << path;
+            }
+        }
+        connection.result(line.str());
+    }
+}
+
+void ScannerDaemon::commandList(const std::vector<std::string> &words, Connection &connection) {
+    size_t count = settings_.maxResults;
+    if (words.size() < 2 || words.size() > 3 || (words.size() == 3 && !parseCount(words[2], count))) {
+        connection.fail("usage: list <set> [n]");
+        return;
+    }
+    const auto found = sets_.find(words[1]);
+    if (found == sets_.end()) {
+        connection.fail("no set named " + words[1]);
+        return;
+    }
+    listMembers(found->second, count, connection);
+    connection.ok(words[1] + ": " + std::to_string(found->second.size()) + " candidates");
+}
+
+void ScannerDaemon::commandWatch(const std::vector<std::string> &words, Connection &connection) {
+    if (words.size() < 3 || words.size() > 4) {
+        connection.fail("usage: watch <set> <seconds> [reference]");
+        return;
+    }
+    const auto found = sets_.find(words[1]);
+    if (found == sets_.end()) {
+        connection.fail("no set named " + words[1]);
+        return;
+    }
+    WatchOptions options;
+    char *end = nullptr;
+    options.duration = std::strtod(words[2].c_str(), &end);
+    // A watch blocks the daemon, so it must end on its own.
+    if (end == words[2].c_str() || *end != '\0' || !(options.duration > 0.0)) {
+        connection.fail("watch needs a positive duration in seconds");
+        return;
+    }
+    size_t reference = 0;
+    if (words.size() == 4) {
+        if (!parseCount(words[3], reference)) {
+            connection.fail("invalid reference address: " + words[3]);
+            return;
+        }
+        options.reference = static_cast<uintptr_t>(reference);
+    }
+    options.rate = settings_.watchRate;
+    options.tolerance = settings_.tolerance;
+    options.stillLimit = settings_.watchStill;
+    options.valueType = settings_.valueType;
+    options.fixedPointScale = settings_.fixedPointScale;
+
+    const OffsetScanner &scanner = *session_->scanner;
+    const std::vector<CandidateOffset> candidates = scanner.candidatesFromSet(found->second, settings_.watchMax);
+    CandidateWatcher watcher(scanner.reader(), candidates, options);
+    watcher.run(stop_, [&](const WatchProgress &progress) {
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1) << progress.elapsed << "s: " << progress.polls << " polls, " << progress.remaining
+             << " candidates, p99 " << static_cast<double>(progress.latency->percentile(0.99)) / 1000.0 << " us";
+        connection.result(line.str());
+    });
+
+    // Without a reference nothing is pruned for holding still, so keep the movers.
+    std::vector<WatchedCandidate> survivors;
+    for (const auto &candidate : watcher.candidates()) {
+        if (options.reference || candidate.moves > 0) {
+            survivors.push_back(candidate);
+        }
+    }
+    std::sort(survivors.begin(), survivors.end(),
+              [](const WatchedCandidate &lhs, const WatchedCandidate &rhs) { return lhs.address < rhs.address; });
+    // Only the first watchMax members were watched; the ones after them stay.
+    const CandidateSet &before = found->second;
+    uintptr_t lastWatched = 0;
+    CandidateSet::Cursor cursor(before);
+    size_t watched = 0;
+    while (watched < settings_.watchMax && cursor.next(lastWatched)) {
+        ++watched;
+    }
+    size_t untouched = 0;
+    CandidateSet kept;
+    auto survivor = survivors.begin();
+    for (const auto &block : before.blocks()) {
+        if (settings_.watchMax == 0 || block.base > lastWatched) {
+            untouched += block.count;
+            kept.append(CandidateSet::Block(block));
+            continue;
+        }
+        CandidateSet::BlockBuilder builder(block.base, block.slotCount * CandidateSet::slotSize);
+        block.forEach([&](uintptr_t address) {
+            if (address > lastWatched) {
+                ++untouched;
+                builder.add(address);
+                return;
+            }
+            while (survivor != survivors.end() && survivor->address < address) {
+                ++survivor;
+            }
+            if (survivor != survivors.end() && survivor->address == address) {
+                builder.add(address);
+            }
+        });
+        kept.append(builder.finish());
+    }
+    std::stable_sort(survivors.begin(), survivors.end(),
+                     [](const WatchedCandidate &lhs, const WatchedCandidate &rhs) { return lhs.moves > rhs.moves; });
+    for (size_t i = 0; i < survivors.size() && i < settings_.maxResults; ++i) {
+        std::ostringstream line;
+        line << formatAddress(survivors[i].address) << " " << survivors[i].value.toString(5) << " moved " << survivors[i].moves
+             << " distance " << std::fixed << std::setprecision(3) << survivors[i].distance;
+        connection.result(line.str());
+    }
+    connection.ok(words[1] + ": " + std::to_string(kept.size()) + " of " + std::to_string(before.size()) + " candidates kept (" +
+                  std::to_string(survivors.size()) + " of " + std::to_string(candidates.size()) + " watched after " +
+                  std::to_string(watcher.polls()) + " polls, " + std::to_string(untouched) + " past the watch limit unchanged)");
+    found->second = std::move(kept);
+}
+
+void ScannerDaemon::commandSets(Connection &connection) {
+    for (const auto &[name, set] : sets_) {
+        connection.result(name + " " + std::to_string(set.size()) + " candidates, " + std::to_string(set.memoryUsage()) + " bytes");
+    }
+    connection.ok(std::to_string(sets_.size()) + " sets");
+}
+
+void ScannerDaemon::commandStatus(Connection &connection) {
+    if (!session_) {
+        connection.ok("not attached");
+        return;
+    }
+    const OffsetScanner &scanner = *session_->scanner;
+    const ReadStatistics reads = scanner.reader().statistics();
+    connection.result("process " + session_->process.name + " (pid " + std::to_string(session_->process.pid) + ")");
+    connection.result("scope " + (session_->moduleName.empty() ? std::string("all regions") : "module " + session_->moduleName) + ", " +
+                      std::to_string(scanner.moduleRegions().size()) + " mappings");
+    connection.result(std::string("kernel ") + VectorKernels::kernelName(scanner.kernel()) + ", type " +
+                      VectorKernels::valueTypeName(scanner.valueType()) + ", " + std::to_string(scanner.threadCount()) + " threads");
+    connection.result("reads " + std::to_string(reads.syscalls()) + " syscalls, " + std::to_string(reads.bytesRead >> 20) + " MiB");
+    connection.ok("attached");
+}
+
+bool runDaemonClient(const std::string &socketPath, const std::vector<std::string> &commands, std::string &error) {
+    const int fd = connectTo(socketPath, error);
+    if (fd < 0) {
+        return false;
+    }
+    LineReader reader(fd);
+    bool succeeded = true;
+    const auto send = [&](const std::string &command) {
+        if (!writeAll(fd, command + "\n")) {
+            error = "connection to " + socketPath + " lost";
+            return false;
+        }
+        std::string line;
+        while (reader.readLine(line, nullptr)) {
+            if (line.compare(0, 2, "- ") == 0) {
+                std::cout << line.substr(2) << std::endl;
+            } else if (line.compare(0, 6, "error ") == 0) {
+                std::cerr << "Error: " << line.substr(6) << std::endl;
+                succeeded = false;
+                return true;
+            } else {
+                std::cout << line << std::endl;
+                return true;
+            }
+        }
+        error = "connection to " + socketPath + " closed";
+        return false;
+    };
+
+    bool connected = true;
+    if (commands.empty()) {
+        std::string command;
+        while (connected && std::getline(std::cin, command)) {
+            if (!splitWords(command).empty()) {
+                connected = send(command);
+            }
+        }
+    } else {
+        for (size_t i = 0; connected && i < commands.size(); ++i) {
+            connected = send(commands[i]);
+        }
+    }
+    ::close(fd);
+    return connected && succeeded;
+}
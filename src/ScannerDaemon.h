@@ -0,0 +1,95 @@
+#pragma once
+
+#include "CandidateSet.h"
+#include "OffsetScanner.h"
+#include "ProcessUtils.h"
+#include "RegionIndex.h"
+#include "VectorMatchKernels.h"
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Defaults of a daemon session; each can be changed by a client with "set".
+struct DaemonSettings {
+    float tolerance{0.01f};
+    size_t maxResults{64};
+    size_t threads{0};
+    std::optional<VectorKernels::KernelKind> kernel;
+    VectorKernels::ValueType valueType{VectorKernels::ValueType::Vec3f};
+    double fixedPointScale{1.0};
+    RegionFilter regionFilter;
+    double watchRate{1000.0};
+    size_t watchStill{3};
+    size_t watchMax{1024};
+};
+
+// Long-lived scanner serving one client at a time on a Unix domain socket. The
+// attached process keeps one ProcessMemoryReader, RegionIndex and OffsetScanner,
+// and candidate sets live in memory under a name, so a narrowing step costs the
+// scan and nothing else.
+//
+// The protocol is line based. A client sends one command per line; the daemon
+// answers with any number of "- " prefixed result lines, streamed as they are
+// produced, and ends each answer with one "ok <summary>" or "error <message>"
+// line. Commands:
+//   attach <name|pid> [<module>]  scan one module, or every mapping passing the filter
+//   set <name> <value>            tolerance, max-results, threads, kernel, type,
+//                                 fixed-scale, watch-rate, watch-still, watch-max
+//   scan <set> <x,y,z>            new set with every match in the scope
+//   verify <set> <x,y,z>          keep the members of set that still match
+//   list <set> [n]                current values of the first n members
+//   watch <set> <seconds> [ref]   poll the members, keep the ones that move (with
+//                                 the vector at ref when it is given)
+//   sets | drop <set> | refresh | status | quit | shutdown
+class ScannerDaemon {
+public:
+    ScannerDaemon(std::string socketPath, DaemonSettings settings);
+    ~ScannerDaemon();
+
+    ScannerDaemon(const ScannerDaemon &) = delete;
+    ScannerDaemon &operator=(const ScannerDaemon &) = delete;
+
+    // Attaches before the first client connects, as the attach command does.
+    bool attach(const std::string &process, const std::string &moduleName, std::string &error);
+
+    // Binds the socket (mode 0600) and serves clients until stop is set or a
+    // client sends shutdown. A stale socket file is replaced; one that still
+    // accepts connections is an error.
+    bool run(const std::atomic<bool> *stop, std::string &error);
+
+private:
+    class Connection;
+    struct Session;
+
+    // Runs one command line; false ends the connection.
+    bool dispatch(const std::vector<std::string> &words, Connection &connection);
+    bool refreshScope(std::string &summary, std::string &error);
+    void applySettings();
+    std::string setOption(const std::string &name, const std::string &value);
+
+    void commandAttach(const std::vector<std::string> &words, Connection &connection);
+    void commandScan(const std::vector<std::string> &words, Connection &connection, bool verify);
+    void commandList(const std::vector<std::string> &words, Connection &connection);
+    void commandWatch(const std::vector<std::string> &words, Connection &connection);
+    void commandSets(Connection &connection);
+    void commandStatus(Connection &connection);
+    void listMembers(const CandidateSet &set, size_t count, Connection &connection) const;
+
+    std::string socketPath_;
+    DaemonSettings settings_;
+    std::unique_ptr<Session> session_;
+    std::map<std::string, CandidateSet> sets_;
+    const std::atomic<bool> *stop_{};
+    bool shutdown_{false};
+};
+
+// Thin client: sends each command to the daemon at socketPath and copies the
+// answers to stdout, result lines without their prefix. With no commands they are
+// read from stdin, one per line. Returns false when the daemon cannot be reached
+// or any command failed.
+bool runDaemonClient(const std::string &socketPath, const std::vector<std::string> &commands, std::string &error);
@@ -0,0 +1,643 @@
+#include "SignatureScanner.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OFFSET_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t chunkSize = 1u << 20;
+constexpr uint32_t noState = std::numeric_limits<uint32_t>::max();
+constexpr size_t bucketCount = 8;
+constexpr size_t teddyAnchorsPerBucket = 16;
+// Anchors longer than this are cut, which bounds the automaton at
+// maxAnchorLength states per signature.
+constexpr size_t maxAnchorLength = 16;
+
+// Rough cost of a byte as an anchor byte: how often it shows up in x86-64 code,
+// where zero padding, REX prefixes, common opcodes and ModRM bytes dominate.
+unsigned bytePenalty(uint8_t byte) {
+    switch (byte) {
+    case 0x00:
+        return 4;
+    case 0xFF:
+    case 0xCC:
+        return 2;
+    case 0x0F:
+    case 0x1F:
+    case 0x24:
+    case 0x44:
+    case 0x48:
+    case 0x49:
+    case 0x4C:
+    case 0x84:
+    case 0x89:
+    case 0x8B:
+    case 0x90:
+    case 0xC0:
+    case 0xE8:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+std::string trim(const std::string &text) {
+    const size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool parseNumber(const std::string &text, int64_t &out) {
+    char *end = nullptr;
+    const long long value = std::strtoll(text.c_str(), &end, 0);
+    if (end == text.c_str() || *end != '\0') {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+bool parseOffset(const std::string &text, size_t &out) {
+    int64_t value = 0;
+    if (!parseNumber(text, value) || value < 0) {
+        return false;
+    }
+    out = static_cast<size_t>(value);
+    return true;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool testBit(const uint64_t *bits, unsigned index) {
+    return (bits[index >> 6] >> (index & 63) & 1) != 0;
+}
+
+void setBit(std::vector<uint64_t> &bits, unsigned index) {
+    bits[index >> 6] |= uint64_t{1} << (index & 63);
+}
+
+unsigned pairAt(const uint8_t *data) {
+    return static_cast<unsigned>(data[0]) | static_cast<unsigned>(data[1]) << 8;
+}
+
+uint32_t prefixAt(const uint8_t *data) {
+    uint32_t prefix = 0;
+    std::memcpy(&prefix, data, sizeof(prefix));
+    return prefix;
+}
+
+#if defined(OFFSET_SCANNER_X86)
+// Teddy-style test of 64 positions, 32 per step: for each of the first four
+// anchor bytes, nibble table lookups give the buckets whose anchors may have that
+// byte there, and a position is flagged when one bucket survives all four. Reads
+// 67 bytes from data.
+__attribute__((target("avx2"))) uint64_t teddyBlockAvx2(const uint8_t *data, const uint8_t (*lowTables)[16],
+                                                        const uint8_t (*highTables)[16]) {
+    const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t flagged = 0;
+    for (size_t half = 0; half < 2; ++half) {
+        __m256i buckets = _mm256_set1_epi8(-1);
+        for (size_t k = 0; k < 4; ++k) {
+            const __m128i lowTable = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lowTables[k]));
+            const __m128i highTable = _mm_loadu_si128(reinterpret_cast<const __m128i *>(highTables[k]));
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + half * 32 + k));
+            const __m256i lowBuckets = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(lowTable), _mm256_and_si256(bytes, nibbleMask));
+            const __m256i highBuckets = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(highTable),
+                                                            _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibbleMask));
+            buckets = _mm256_and_si256(buckets, _mm256_and_si256(lowBuckets, highBuckets));
+        }
+        const uint32_t empty = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(buckets, zero)));
+        flagged |= static_cast<uint64_t>(~empty) << (half * 32);
+    }
+    return flagged;
+}
+#endif
+
+} // namespace
+
+std::optional<Signature> Signature::parse(const std::string &line, std::string &error) {
+    const size_t equals = line.find('=');
+    if (equals == std::string::npos) {
+        error = "expected <name> = <bytes>";
+        return std::nullopt;
+    }
+    Signature signature;
+    signature.name = trim(line.substr(0, equals));
+    if (signature.name.empty() || signature.name.find_first_of(" \t") != std::string::npos) {
+        error = "signature name must be one word";
+        return std::nullopt;
+    }
+    const size_t semicolon = line.find(';', equals);
+    std::istringstream bytes(line.substr(equals + 1, semicolon == std::string::npos ? std::string::npos : semicolon - equals - 1));
+    std::string token;
+    bool concrete = false;
+    while (bytes >> token) {
+        if (token == "?" || token == "??") {
+            signature.bytes.push_back(0);
+            signature.mask.push_back(0);
+            continue;
+        }
+        const int high = token.size() == 2 ? hexDigit(token[0]) : -1;
+        const int low = token.size() == 2 ? hexDigit(token[1]) : -1;
+        if (high < 0 || low < 0) {
+            error = "invalid byte '" + token + "'";
+            return std::nullopt;
+        }
+        signature.bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+        signature.mask.push_back(1);
+        concrete = true;
+    }
+    if (!concrete) {
+        error = "signature " + signature.name + " has no concrete byte";
+        return std::nullopt;
+    }
+
+    std::vector<std::string> modifiers;
+    if (semicolon != std::string::npos) {
+        std::istringstream in(line.substr(semicolon + 1));
+        while (in >> token) {
+            modifiers.push_back(token);
+        }
+    }
+    for (size_t i = 0; i < modifiers.size(); ++i) {
+        const std::string &modifier = modifiers[i];
+        const bool hasValue = i + 1 < modifiers.size();
+        if (modifier == "rip" && hasValue && parseOffset(modifiers[i + 1], signature.operandOffset)) {
+            signature.resolve = Resolve::RipRelative;
+            signature.instructionEnd = signature.operandOffset + 4;
+            ++i;
+            if (i + 1 < modifiers.size() && parseOffset(modifiers[i + 1], signature.instructionEnd)) {
+                ++i;
+            }
+        } else if (modifier == "operand" && hasValue && parseOffset(modifiers[i + 1], signature.operandOffset)) {
+            signature.resolve = Resolve::Operand;
+            ++i;
+        } else if (modifier == "add" && hasValue && parseNumber(modifiers[i + 1], signature.adjust)) {
+            ++i;
+        } else {
+            error = "invalid modifier '" + modifier + "'; expected rip <operand> [<end>], operand <operand> or add <n>";
+            return std::nullopt;
+        }
+    }
+    return signature;
+}
+
+bool loadSignatureFile(const std::string &path, std::vector<Signature> &signatures, std::string &error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(in, line); ++lineNumber) {
+        const std::string text = trim(line);
+        if (text.empty() || text[0] == '#') {
+            continue;
+        }
+        auto signature = Signature::parse(text, error);
+        if (!signature) {
+            error = path + ":" + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+        signatures.push_back(std::move(*signature));
+    }
+    return true;
+}
+
+SignatureMatcher::SignatureMatcher(std::vector<Signature> signatures, VectorKernels::KernelKind kernel)
+    : signatures_(std::move(signatures)), kernel_(VectorKernels::isSupported(kernel) ? kernel : VectorKernels::KernelKind::Scalar) {
+    for (const auto &signature : signatures_) {
+        maxSize_ = std::max(maxSize_, signature.size());
+        // Any window of concrete bytes can be the anchor. Windows that fill the
+        // prefix win, then the ones whose prefix bytes are rarest, then longer ones.
+        Anchor best;
+        unsigned bestPenalty = 0;
+        for (size_t runStart = 0; runStart < signature.size();) {
+            if (signature.mask[runStart] == 0) {
+                ++runStart;
+                continue;
+            }
+            size_t runEnd = runStart;
+            while (runEnd < signature.size() && signature.mask[runEnd] != 0) {
+                ++runEnd;
+            }
+            const size_t lastStart = runEnd - runStart >= prefixLength ? runEnd - prefixLength : runStart;
+            for (size_t start = runStart; start <= lastStart; ++start) {
+                const size_t length = std::min(runEnd - start, maxAnchorLength);
+                unsigned penalty = 0;
+                for (size_t k = 0; k < std::min(length, prefixLength); ++k) {
+                    penalty += bytePenalty(signature.bytes[start + k]);
+                }
+                const bool full = length >= prefixLength;
+                const bool bestFull = best.length >= prefixLength;
+                if (best.length == 0 || full > bestFull ||
+                    (full == bestFull && (penalty < bestPenalty || (penalty == bestPenalty && length > best.length)))) {
+                    best = {static_cast<uint32_t>(start), static_cast<uint32_t>(length)};
+                    bestPenalty = penalty;
+                }
+            }
+            runStart = runEnd;
+        }
+        anchors_.push_back(best);
+    }
+    buildAutomaton();
+    buildPrefilter();
+}
+
+void SignatureMatcher::buildAutomaton() {
+    // Class 0 stands for every byte no anchor contains.
+    classCount_ = 1;
+    for (size_t i = 0; i < signatures_.size(); ++i) {
+        const uint8_t *anchor = signatures_[i].bytes.data() + anchors_[i].offset;
+        for (size_t k = 0; k < anchors_[i].length; ++k) {
+            if (byteClass_[anchor[k]] == 0) {
+                byteClass_[anchor[k]] = static_cast<uint8_t>(classCount_++);
+            }
+        }
+    }
+
+    size_t maxStates = 1;
+    for (const auto &anchor : anchors_) {
+        maxStates += anchor.length;
+    }
+    std::vector<uint32_t> next(maxStates * classCount_, noState);
+    std::vector<std::vector<uint32_t>> stateOutputs(maxStates);
+    std::vector<uint32_t> depth(maxStates, 0);
+    stateCount_ = 1;
+    for (size_t i = 0; i < signatures_.size(); ++i) {
+        const uint8_t *anchor = signatures_[i].bytes.data() + anchors_[i].offset;
+        uint32_t state = 0;
+        for (size_t k = 0; k < anchors_[i].length; ++k) {
+            uint32_t &child = next[state * classCount_ + byteClass_[anchor[k]]];
+            if (child == noState) {
+                depth[stateCount_] = depth[state] + 1;
+                child = static_cast<uint32_t>(stateCount_++);
+            }
+            state = child;
+        }
+        stateOutputs[state].push_back(static_cast<uint32_t>(i));
+    }
+    next.resize(stateCount_ * classCount_);
+
+    // Breadth-first over the trie: a missing transition takes the one of the
+    // failure state, whose row is already complete.
+    std::vector<uint32_t> failure(stateCount_, 0);
+    std::vector<uint32_t> outputLink(stateCount_, 0);
+    std::vector<uint32_t> queue;
+    for (size_t c = 0; c < classCount_; ++c) {
+        uint32_t &child = next[c];
+        if (child == noState) {
+            child = 0;
+        } else {
+            queue.push_back(child);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const uint32_t state = queue[head];
+        const uint32_t fallback = failure[state];
+        for (size_t c = 0; c < classCount_; ++c) {
+            uint32_t &child = next[state * classCount_ + c];
+            const uint32_t fallbackChild = next[fallback * classCount_ + c];
+            if (child == noState) {
+                child = fallbackChild;
+                continue;
+            }
+            failure[child] = fallbackChild;
+            outputLink[child] = stateOutputs[fallbackChild].empty() ? outputLink[fallbackChild] : fallbackChild;
+            queue.push_back(child);
+        }
+    }
+
+    // Renumber the states in breadth-first order, so the shallow states that take
+    // most transitions share the first rows of the table, and flag the transitions
+    // into states that report an anchor.
+    std::vector<uint32_t> renumbered(stateCount_, 0);
+    for (size_t i = 0; i < queue.size(); ++i) {
+        renumbered[queue[i]] = static_cast<uint32_t>(i + 1);
+    }
+    std::vector<uint32_t> order(1, 0);
+    order.insert(order.end(), queue.begin(), queue.end());
+    outputBegin_.assign(stateCount_ + 1, 0);
+    outputLink_.assign(stateCount_, 0);
+    outputs_.clear();
+    std::vector<uint8_t> reports(stateCount_, 0);
+    depth_.assign(stateCount_, 0);
+    for (size_t state = 0; state < stateCount_; ++state) {
+        const uint32_t old = order[state];
+        depth_[state] = static_cast<uint8_t>(std::min<uint32_t>(depth[old], prefixLength));
+        outputBegin_[state] = static_cast<uint32_t>(outputs_.size());
+        outputs_.insert(outputs_.end(), stateOutputs[old].begin(), stateOutputs[old].end());
+        outputLink_[state] = renumbered[outputLink[old]];
+        reports[state] = !stateOutputs[old].empty() || outputLink[old] != 0 ? 1 : 0;
+    }
+    outputBegin_[stateCount_] = static_cast<uint32_t>(outputs_.size());
+
+    const auto fill = [&](auto &table, auto reportBit) {
+        table.resize(stateCount_ * classCount_);
+        for (size_t state = 0; state < stateCount_; ++state) {
+            for (size_t c = 0; c < classCount_; ++c) {
+                const uint32_t target = renumbered[next[order[state] * classCount_ + c]];
+                table[state * classCount_ + c] = static_cast<std::remove_reference_t<decltype(table[0])>>(
+                    target | (reports[target] != 0 ? reportBit : 0));
+            }
+        }
+    };
+    if (stateCount_ < (1u << 15)) {
+        fill(narrowNext_, 1u << 15);
+    } else {
+        fill(wideNext_, 1u << 31);
+    }
+}
+
+void SignatureMatcher::buildPrefilter() {
+    // Teddy loses to the pair table once its buckets hold many anchors each.
+    teddy_ = kernel_ == VectorKernels::KernelKind::Avx2 && anchors_.size() <= bucketCount * teddyAnchorsPerBucket;
+    startPairs_.assign((1u << 16) / 64, 0);
+    firstPairs_.assign((1u << 16) / 64, 0);
+    shortPairs_.assign((1u << 16) / 64, 0);
+    singleBytes_.assign(256 / 64, 0);
+    size_t prefixCount = 0;
+    for (const auto &anchor : anchors_) {
+        prefixCount += anchor.length >= prefixLength ? 1 : 0;
+    }
+    size_t tableSize = 16;
+    while (tableSize < prefixCount * 4) {
+        tableSize *= 2;
+    }
+    prefixes_.assign(tableSize, 0);
+    prefixShift_ = 32;
+    for (size_t size = tableSize; size > 1; size /= 2) {
+        --prefixShift_;
+    }
+
+    for (size_t i = 0; i < signatures_.size(); ++i) {
+        const uint8_t *anchor = signatures_[i].bytes.data() + anchors_[i].offset;
+        const size_t length = anchors_[i].length;
+        if (length == 1) {
+            setBit(singleBytes_, anchor[0]);
+            for (unsigned second = 0; second < 256; ++second) {
+                setBit(startPairs_, anchor[0] | second << 8);
+            }
+        } else {
+            setBit(startPairs_, pairAt(anchor));
+            setBit(firstPairs_, pairAt(anchor));
+        }
+        if (length == 2 || length == 3) {
+            setBit(shortPairs_, pairAt(anchor));
+        }
+        if (length >= prefixLength) {
+            const uint32_t prefix = prefixAt(anchor);
+            size_t slot = prefixSlot(prefix);
+            while (prefixes_[slot] != 0 && static_cast<uint32_t>(prefixes_[slot]) != prefix) {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            prefixes_[slot] = prefix | uint64_t{1} << 32;
+        }
+        // Positions past the end of a short anchor accept any byte.
+        const uint8_t bucket = static_cast<uint8_t>(1u << (anchor[0] % bucketCount));
+        for (size_t k = 0; k < prefixLength; ++k) {
+            for (size_t nibble = 0; nibble < 16; ++nibble) {
+                const bool any = k >= length;
+                nibbleLow_[k][nibble] |= any || (anchor[k] & 15) == nibble ? bucket : 0;
+                nibbleHigh_[k][nibble] |= any || (anchor[k] >> 4) == nibble ? bucket : 0;
+            }
+        }
+    }
+}
+
+size_t SignatureMatcher::prefixSlot(uint32_t prefix) const {
+    return static_cast<size_t>(static_cast<uint32_t>(prefix * 0x9E3779B1u) >> prefixShift_);
+}
+
+bool SignatureMatcher::canStartAt(const uint8_t *data, size_t position, size_t size) const {
+    if (testBit(singleBytes_.data(), data[position])) {
+        return true;
+    }
+    if (position + 1 >= size || !testBit(firstPairs_.data(), pairAt(data + position))) {
+        return false;
+    }
+    if (testBit(shortPairs_.data(), pairAt(data + position))) {
+        return true;
+    }
+    if (position + prefixLength > size) {
+        return false;
+    }
+    const uint32_t prefix = prefixAt(data + position);
+    for (size_t slot = prefixSlot(prefix);; slot = (slot + 1) & (prefixes_.size() - 1)) {
+        if (prefixes_[slot] == 0) {
+            return false;
+        }
+        if (static_cast<uint32_t>(prefixes_[slot]) == prefix) {
+            return true;
+        }
+    }
+}
+
+uint64_t SignatureMatcher::coarseBlock(const uint8_t *data) const {
+#if defined(OFFSET_SCANNER_X86)
+    if (teddy_) {
+        return teddyBlockAvx2(data, nibbleLow_, nibbleHigh_);
+    }
+#endif
+    // Table lookups without branches; the exact test runs only on flagged positions.
+    uint64_t flagged = 0;
+    for (size_t k = 0; k < blockSize; ++k) {
+        flagged |= static_cast<uint64_t>(testBit(startPairs_.data(), pairAt(data + k))) << k;
+    }
+    return flagged;
+}
+
+size_t SignatureMatcher::nextStart(const uint8_t *data, size_t position, size_t size, Block &block) const {
+    while (position < size) {
+        if (position < block.start || position >= block.end) {
+            if (position + blockSize + prefixLength - 1 > size) {
+                for (; position < size; ++position) {
+                    if (canStartAt(data, position, size)) {
+                        return position;
+                    }
+                }
+                return size;
+            }
+            block.start = position;
+            block.end = position + blockSize;
+            block.flagged = coarseBlock(data + position);
+        }
+        uint64_t flagged = block.flagged & ~uint64_t{0} << (position - block.start);
+        for (; flagged != 0; flagged &= flagged - 1) {
+            const size_t candidate = block.start + static_cast<size_t>(__builtin_ctzll(flagged));
+            if (canStartAt(data, candidate, size)) {
+                block.flagged = flagged;
+                return candidate;
+            }
+        }
+        position = block.end;
+    }
+    return position;
+}
+
+void SignatureMatcher::reportAnchor(const uint8_t *data, size_t size, size_t ownedSize, uintptr_t base, size_t anchorEnd,
+                                    uint32_t state, std::vector<SignatureMatch> &matches) const {
+    for (; state != 0; state = outputLink_[state]) {
+        for (uint32_t i = outputBegin_[state]; i < outputBegin_[state + 1]; ++i) {
+            const uint32_t index = outputs_[i];
+            const Signature &signature = signatures_[index];
+            const Anchor &anchor = anchors_[index];
+            const size_t anchorStart = anchorEnd + 1 - anchor.length;
+            if (anchorStart < anchor.offset) {
+                continue;
+            }
+            const size_t start = anchorStart - anchor.offset;
+            if (start >= ownedSize || start + signature.size() > size) {
+                continue;
+            }
+            bool matched = true;
+            for (size_t k = 0; k < signature.size() && matched; ++k) {
+                matched = signature.mask[k] == 0 || data[start + k] == signature.bytes[k];
+            }
+            if (matched) {
+                matches.push_back({base + start, index});
+            }
+        }
+    }
+}
+
+void SignatureMatcher::scan(const uint8_t *data, size_t size, size_t ownedSize, uintptr_t base,
+                            std::vector<SignatureMatch> &matches) const {
+    if (signatures_.empty() || ownedSize == 0) {
+        return;
+    }
+    // Nothing ending past this can start inside the owned range.
+    size = std::min(size, ownedSize + maxSize_ - 1);
+    if (!narrowNext_.empty()) {
+        scanWith(narrowNext_.data(), data, size, ownedSize, base, matches);
+    } else {
+        scanWith(wideNext_.data(), data, size, ownedSize, base, matches);
+    }
+}
+
+template <typename State>
+void SignatureMatcher::scanWith(const State *next, const uint8_t *data, size_t size, size_t ownedSize, uintptr_t base,
+                                std::vector<SignatureMatch> &matches) const {
+    constexpr State reportBit = State{1} << (sizeof(State) * 8 - 1);
+    Block block;
+    size_t state = 0;
+    // Positions below this have had their anchors reported; a reset revisits some.
+    size_t reportedEnd = 0;
+    for (size_t position = 0; position < size; ++position) {
+        if (state == 0) {
+            position = nextStart(data, position, size, block);
+            if (position >= size) {
+                break;
+            }
+        }
+        const State transition = next[state * classCount_ + byteClass_[data[position]]];
+        state = transition & ~reportBit;
+        // Fewer than prefixLength bytes into the longest anchor prefix: if no anchor
+        // starts where it does, every live partial match starts later, and the
+        // prefilter finds those faster than the automaton steps to them.
+        const size_t depth = depth_[state];
+        if (depth != 0 && depth < prefixLength && !canStartAt(data, position + 1 - depth, size)) {
+            state = 0;
+            position -= depth - 1;
+            continue;
+        }
+        if ((transition & reportBit) != 0 && position >= reportedEnd) {
+            reportedEnd = position + 1;
+            reportAnchor(data, size, ownedSize, base, position, static_cast<uint32_t>(state), matches);
+        }
+    }
+}
+
+std::vector<SignatureResult> findSignatures(const OffsetScanner &scanner, const SignatureMatcher &matcher) {
+    struct Chunk {
+        uintptr_t start{};
+        size_t ownedSize{};
+        // Readable bytes from start, up to the end of the region.
+        size_t available{};
+    };
+    std::vector<Chunk> chunks;
+    for (const auto &region : scanner.moduleRegions()) {
+        for (uintptr_t start = region.start; start < region.end; start += chunkSize) {
+            chunks.push_back({start, std::min<size_t>(chunkSize, region.end - start), region.end - start});
+        }
+    }
+
+    const size_t overlap = matcher.maxSignatureSize() > 0 ? matcher.maxSignatureSize() - 1 : 0;
+    std::vector<std::vector<SignatureMatch>> chunkMatches(chunks.size());
+    ThreadPool::run(scanner.threadPool(), chunks.size(), [&](size_t index) {
+        thread_local std::vector<uint8_t> buffer;
+        thread_local std::vector<ReadSpan> spans;
+        const Chunk &chunk = chunks[index];
+        const size_t size = std::min(chunk.ownedSize + overlap, chunk.available);
+        buffer.resize(size);
+        spans.clear();
+        scanner.reader().readAvailable(chunk.start, buffer.data(), size, spans);
+        // A signature crossing an unreadable page cannot match; each readable
+        // stretch is scanned on its own.
+        for (const auto &span : spans) {
+            if (span.offset >= chunk.ownedSize) {
+                break;
+            }
+            matcher.scan(buffer.data() + span.offset, span.size, std::min(span.size, chunk.ownedSize - span.offset),
+                         chunk.start + span.offset, chunkMatches[index]);
+        }
+    });
+
+    std::vector<SignatureResult> results(matcher.signatures().size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        results[i].signature = static_cast<uint32_t>(i);
+    }
+    for (const auto &matches : chunkMatches) {
+        for (const auto &match : matches) {
+            results[match.signature].matches.push_back(match.address);
+        }
+    }
+    for (auto &result : results) {
+        std::sort(result.matches.begin(), result.matches.end());
+        if (result.matches.empty()) {
+            continue;
+        }
+        const Signature &signature = matcher.signatures()[result.signature];
+        const uintptr_t match = result.matches.front();
+        if (signature.resolve == Signature::Resolve::Match) {
+            result.value = static_cast<uint64_t>(match + signature.adjust);
+            continue;
+        }
+        const auto operand = scanner.reader().readValue<int32_t>(match + signature.operandOffset);
+        if (!operand) {
+            continue;
+        }
+        if (signature.resolve == Signature::Resolve::RipRelative) {
+            result.value = static_cast<uint64_t>(match + signature.instructionEnd + *operand + signature.adjust);
+        } else {
+            result.value = static_cast<uint64_t>(*operand + signature.adjust);
+        }
+    }
+    return results;
+}
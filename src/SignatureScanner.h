@@ -0,0 +1,160 @@
+#pragma once
+
+#include "OffsetScanner.h"
+#include "VectorMatchKernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A byte signature (array of bytes with wildcards) and how to turn a match into
+// the value it locates. Parsed from one line of a signature file:
+//
+//   name = 48 8B 05 ?? ?? ?? ?? 48 85 C0 ; rip 3
+//
+// Bytes are hex pairs, ? or ?? is a wildcard. Optional modifiers after the ';':
+//   rip <operand> [<end>]  the rel32 at match + operand is relative to the end of
+//                          the instruction, match + end (default operand + 4)
+//   operand <operand>      the value is the signed 32-bit immediate or
+//                          displacement at match + operand, e.g. a field offset
+//   add <n>                added to the result
+// Without rip or operand the value is the match address itself.
+struct Signature {
+    enum class Resolve {
+        Match,
+        RipRelative,
+        Operand,
+    };
+
+    std::string name;
+    std::vector<uint8_t> bytes;
+    // Non-zero where bytes[i] has to match; zero for wildcards.
+    std::vector<uint8_t> mask;
+    Resolve resolve{Resolve::Match};
+    size_t operandOffset{};
+    size_t instructionEnd{};
+    int64_t adjust{};
+
+    size_t size() const { return bytes.size(); }
+    // True when the resolved value is an address rather than an operand value.
+    bool yieldsAddress() const { return resolve != Resolve::Operand; }
+
+    static std::optional<Signature> parse(const std::string &line, std::string &error);
+};
+
+// One signature per line; blank lines and lines starting with # are skipped.
+bool loadSignatureFile(const std::string &path, std::vector<Signature> &signatures, std::string &error);
+
+struct SignatureMatch {
+    uintptr_t address{};
+    uint32_t signature{};
+};
+
+// Finds every signature of a set in one pass. The longest run of concrete bytes
+// of each signature is its anchor; an Aho-Corasick automaton over all anchors
+// (with the byte alphabet reduced to the values the anchors use) finds anchor
+// occurrences, and each is checked against its full masked signature. Whenever
+// the automaton is back at its root, a prefilter skips ahead to the next position
+// where an anchor can start: 64 positions at a time through a table of starting
+// pairs, or Teddy-style nibble lookups on the first four bytes with AVX2, then
+// exactly through pair tables and a hash set of anchor prefixes.
+class SignatureMatcher {
+public:
+    SignatureMatcher(std::vector<Signature> signatures, VectorKernels::KernelKind kernel);
+
+    // Appends the matches that start in data[0, ownedSize) to matches, as base plus
+    // their offset. data holds size >= ownedSize bytes; the bytes past ownedSize
+    // only complete signatures that start before it.
+    void scan(const uint8_t *data, size_t size, size_t ownedSize, uintptr_t base, std::vector<SignatureMatch> &matches) const;
+
+    const std::vector<Signature> &signatures() const { return signatures_; }
+    size_t maxSignatureSize() const { return maxSize_; }
+    size_t stateCount() const { return stateCount_; }
+    VectorKernels::KernelKind kernel() const { return kernel_; }
+
+private:
+    static constexpr size_t prefixLength = 4;
+    static constexpr size_t blockSize = 64;
+
+    struct Anchor {
+        uint32_t offset{};
+        uint32_t length{};
+    };
+
+    // Positions of [start, end) that passed the coarse prefilter and have not been
+    // rejected by the exact test yet, as bits from start.
+    struct Block {
+        size_t start{};
+        size_t end{};
+        uint64_t flagged{};
+    };
+
+    void buildAutomaton();
+    void buildPrefilter();
+    // Flags the positions of data[0, blockSize) where an anchor may start; reads
+    // blockSize + prefixLength - 1 bytes.
+    uint64_t coarseBlock(const uint8_t *data) const;
+    // First position from position on where an anchor starts, or size.
+    size_t nextStart(const uint8_t *data, size_t position, size_t size, Block &block) const;
+    size_t prefixSlot(uint32_t prefix) const;
+    bool canStartAt(const uint8_t *data, size_t position, size_t size) const;
+    template <typename State>
+    void scanWith(const State *next, const uint8_t *data, size_t size, size_t ownedSize, uintptr_t base,
+                  std::vector<SignatureMatch> &matches) const;
+    void reportAnchor(const uint8_t *data, size_t size, size_t ownedSize, uintptr_t base, size_t anchorEnd, uint32_t state,
+                      std::vector<SignatureMatch> &matches) const;
+
+    std::vector<Signature> signatures_;
+    std::vector<Anchor> anchors_;
+    size_t maxSize_{};
+    VectorKernels::KernelKind kernel_;
+
+    uint8_t byteClass_[256]{};
+    size_t classCount_{};
+    size_t stateCount_{};
+    // Complete transition table, stateCount_ rows of classCount_ entries, states in
+    // breadth-first order. The top bit of an entry flags a state that reports an
+    // anchor; only one of the two tables is used, the narrow one when it fits.
+    std::vector<uint16_t> narrowNext_;
+    std::vector<uint32_t> wideNext_;
+    // Signatures whose anchor ends in each state, as a range into outputs_, and the
+    // nearest state on the failure chain that has outputs of its own (0 if none).
+    std::vector<uint32_t> outputBegin_;
+    std::vector<uint32_t> outputs_;
+    std::vector<uint32_t> outputLink_;
+    // Bytes into the anchor prefix each state stands for, capped at prefixLength.
+    std::vector<uint8_t> depth_;
+
+    // Exact start test: one-byte anchors by byte, two- and three-byte anchors by
+    // pair, longer ones by their four-byte prefix in an open-addressed set whose
+    // entries carry bit 32 when used. firstPairs_ holds the first pair of every
+    // anchor longer than one byte and rejects most positions early.
+    std::vector<uint64_t> singleBytes_;
+    std::vector<uint64_t> firstPairs_;
+    std::vector<uint64_t> shortPairs_;
+    std::vector<uint64_t> prefixes_;
+    unsigned prefixShift_{};
+
+    // Coarse prefilter, one of: every pair an anchor can start with, or (with AVX2
+    // and few enough anchors) nibble tables for the first four anchor bytes, where
+    // byte k passes bucket b when bit b is set in both its low and high entry.
+    std::vector<uint64_t> startPairs_;
+    bool teddy_{};
+    uint8_t nibbleLow_[prefixLength][16]{};
+    uint8_t nibbleHigh_[prefixLength][16]{};
+};
+
+struct SignatureResult {
+    uint32_t signature{};
+    // Every match, in address order; a usable signature has exactly one.
+    std::vector<uintptr_t> matches;
+    // Resolved from the first match; empty without matches or when the operand
+    // cannot be read.
+    std::optional<uint64_t> value;
+};
+
+// Scans the scanner's scope for every signature, in chunks spread over its thread
+// pool, and resolves the first match of each. Results follow the signature order.
+std::vector<SignatureResult> findSignatures(const OffsetScanner &scanner, const SignatureMatcher &matcher);
@@ -0,0 +1,152 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+
+// The pool whose task the current thread is running, if any.
+thread_local const ThreadPool *runningPool = nullptr;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : workerCount_(std::max<size_t>(threadCount, 1)) {
+    queues_.reserve(workerCount_);
+    for (size_t i = 0; i < workerCount_; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    threads_.reserve(workerCount_ - 1);
+    for (size_t i = 1; i < workerCount_; ++i) {
+        threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::defaultThreadCount() {
+    const unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : static_cast<size_t>(hardware);
+}
+
+void ThreadPool::run(ThreadPool *pool, size_t taskCount, const std::function<void(size_t)> &task) {
+    if (pool != nullptr) {
+        pool->parallelFor(taskCount, task);
+        return;
+    }
+    for (size_t i = 0; i < taskCount; ++i) {
+        task(i);
+    }
+}
+
+void ThreadPool::parallelFor(size_t taskCount, const std::function<void(size_t)> &task) {
+    if (taskCount == 0) {
+        return;
+    }
+    if (workerCount_ == 1 || taskCount == 1 || runningPool == this) {
+        for (size_t i = 0; i < taskCount; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> batchLock(batchMutex_);
+    for (size_t worker = 0; worker < workerCount_; ++worker) {
+        const size_t first = taskCount * worker / workerCount_;
+        const size_t last = taskCount * (worker + 1) / workerCount_;
+        std::lock_guard<std::mutex> queueLock(queues_[worker]->mutex);
+        for (size_t index = first; index < last; ++index) {
+            queues_[worker]->tasks.push_back(index);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        currentTask_ = &task;
+        firstError_ = nullptr;
+        activeWorkers_ = workerCount_ - 1;
+        ++generation_;
+    }
+    wakeCondition_.notify_all();
+
+    drainTasks(0);
+
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    doneCondition_.wait(lock, [this] { return activeWorkers_ == 0; });
+    currentTask_ = nullptr;
+    if (firstError_) {
+        std::exception_ptr error = firstError_;
+        firstError_ = nullptr;
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(size_t workerIndex) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            wakeCondition_.wait(lock, [&] { return stopping_ || generation_ != seenGeneration; });
+            if (stopping_) {
+                return;
+            }
+            seenGeneration = generation_;
+        }
+        drainTasks(workerIndex);
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            --activeWorkers_;
+        }
+        doneCondition_.notify_all();
+    }
+}
+
+// Queues are only filled before a batch starts, so once nothing is left to pop
+// this worker is done; tasks still running elsewhere are waited for through
+// activeWorkers_ and doneCondition_ instead of by spinning here.
+void ThreadPool::drainTasks(size_t workerIndex) {
+    const ThreadPool *outer = runningPool;
+    runningPool = this;
+    size_t taskIndex = 0;
+    while (popTask(workerIndex, taskIndex)) {
+        try {
+            (*currentTask_)(taskIndex);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            if (!firstError_) {
+                firstError_ = std::current_exception();
+            }
+        }
+    }
+    runningPool = outer;
+}
+
+bool ThreadPool::popTask(size_t workerIndex, size_t &taskIndex) {
+    {
+        WorkQueue &own = *queues_[workerIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            taskIndex = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t step = 1; step < workerCount_; ++step) {
+        WorkQueue &victim = *queues_[(workerIndex + step) % workerCount_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            taskIndex = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool that runs batches of indexed tasks. Every worker owns a
+// deque seeded with a contiguous slice of the batch; a worker that drains its own
+// deque steals from the back of the others, so one slow slice cannot hold up the
+// whole batch.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t threadCount() const { return workerCount_; }
+
+    // Runs task(index) for every index in [0, taskCount) and blocks until all of
+    // them finished. The calling thread takes part as worker 0. Batches submitted
+    // from different threads are serialized. A batch submitted from inside one of
+    // this pool's tasks runs inline on the calling thread, since every worker may
+    // already be busy with the outer batch.
+    void parallelFor(size_t taskCount, const std::function<void(size_t)> &task);
+
+    // parallelFor on pool, or a plain loop on the calling thread when pool is null.
+    static void run(ThreadPool *pool, size_t taskCount, const std::function<void(size_t)> &task);
+
+    static size_t defaultThreadCount();
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void workerLoop(size_t workerIndex);
+    void drainTasks(size_t workerIndex);
+    bool popTask(size_t workerIndex, size_t &taskIndex);
+
+    size_t workerCount_{};
+    std::vector<std::thread> threads_;
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+
+    std::mutex batchMutex_;
+    std::mutex stateMutex_;
+    std::condition_variable wakeCondition_;
+    std::condition_variable doneCondition_;
+    const std::function<void(size_t)> *currentTask_{};
+    uint64_t generation_{};
+    size_t activeWorkers_{};
+    bool stopping_{false};
+    std::exception_ptr firstError_;
+};
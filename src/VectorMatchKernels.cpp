@@ -0,0 +1,1075 @@
+#include "VectorMatchKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OFFSET_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using VectorKernels::MatchTarget;
+
+// Compile-time description of a value layout: count components of Element, stride
+// bytes apart, size bytes read per value, starting on alignment-byte boundaries.
+struct Vec3fTraits {
+    using Element = float;
+    static constexpr size_t count = 3;
+    static constexpr size_t stride = sizeof(float);
+    static constexpr size_t size = 3 * sizeof(float);
+    static constexpr size_t alignment = sizeof(float);
+};
+
+struct Vec3dTraits {
+    using Element = double;
+    static constexpr size_t count = 3;
+    static constexpr size_t stride = sizeof(double);
+    static constexpr size_t size = 3 * sizeof(double);
+    static constexpr size_t alignment = sizeof(double);
+};
+
+struct Vec4fTraits {
+    using Element = float;
+    static constexpr size_t count = 3;
+    static constexpr size_t stride = sizeof(float);
+    static constexpr size_t size = 4 * sizeof(float);
+    static constexpr size_t alignment = 4 * sizeof(float);
+};
+
+struct Vec3iTraits {
+    using Element = int32_t;
+    static constexpr size_t count = 3;
+    static constexpr size_t stride = sizeof(int32_t);
+    static constexpr size_t size = 3 * sizeof(int32_t);
+    static constexpr size_t alignment = sizeof(int32_t);
+};
+
+// Per-component comparison in the element type. Floating-point components match
+// when |value - target| <= tolerance, computed like approximatelyEqual so NaN never
+// matches; integer components match inside the closed range [low, high].
+template <typename Element>
+struct Bounds {
+    Element target[3];
+    Element tolerance;
+
+    explicit Bounds(const MatchTarget &match) : tolerance(static_cast<Element>(match.tolerance)) {
+        for (size_t i = 0; i < 3; ++i) {
+            target[i] = static_cast<Element>(match.components[i]);
+        }
+    }
+    bool test(Element value, size_t component) const { return std::fabs(value - target[component]) <= tolerance; }
+};
+
+template <>
+struct Bounds<int32_t> {
+    int32_t low[3];
+    int32_t high[3];
+
+    explicit Bounds(const MatchTarget &match) {
+        constexpr double minimum = std::numeric_limits<int32_t>::min();
+        constexpr double maximum = std::numeric_limits<int32_t>::max();
+        for (size_t i = 0; i < 3; ++i) {
+            const double lowValue = std::ceil(match.components[i] - match.tolerance);
+            const double highValue = std::floor(match.components[i] + match.tolerance);
+            if (!(lowValue <= highValue) || highValue < minimum || lowValue > maximum) {
+                // Empty range; low > high never matches.
+                low[i] = std::numeric_limits<int32_t>::max();
+                high[i] = std::numeric_limits<int32_t>::min();
+                continue;
+            }
+            low[i] = static_cast<int32_t>(std::max(lowValue, minimum));
+            high[i] = static_cast<int32_t>(std::min(highValue, maximum));
+        }
+    }
+    bool test(int32_t value, size_t component) const { return value >= low[component] && value <= high[component]; }
+};
+
+template <typename Traits>
+inline typename Traits::Element loadComponent(const uint8_t *data, size_t component) {
+    typename Traits::Element value;
+    std::memcpy(&value, data + component * Traits::stride, sizeof(value));
+    return value;
+}
+
+template <typename Traits>
+inline bool matchesAt(const uint8_t *data, const Bounds<typename Traits::Element> &bounds) {
+    for (size_t component = 0; component < Traits::count; ++component) {
+        if (!bounds.test(loadComponent<Traits>(data, component), component)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Traits>
+void matchScalar(const uint8_t *data, size_t startCount, const MatchTarget &target, std::vector<uint32_t> &matches) {
+    const Bounds<typename Traits::Element> bounds(target);
+    for (size_t index = 0; index < startCount; ++index) {
+        if (matchesAt<Traits>(data + index * Traits::alignment, bounds)) {
+            matches.push_back(static_cast<uint32_t>(index * Traits::alignment));
+        }
+    }
+}
+
+template <typename Traits>
+void matchScalarTail(const uint8_t *data, size_t index, size_t startCount, const Bounds<typename Traits::Element> &bounds,
+                     std::vector<uint32_t> &matches) {
+    for (; index < startCount; ++index) {
+        if (matchesAt<Traits>(data + index * Traits::alignment, bounds)) {
+            matches.push_back(static_cast<uint32_t>(index * Traits::alignment));
+        }
+    }
+}
+
+template <typename Traits>
+bool testScalar(const uint8_t *data, const MatchTarget &target) {
+    return matchesAt<Traits>(data, Bounds<typename Traits::Element>(target));
+}
+
+inline void appendLanes(unsigned int mask, size_t firstIndex, size_t elementSize, std::vector<uint32_t> &matches) {
+    while (mask != 0) {
+        const unsigned int lane = static_cast<unsigned int>(__builtin_ctz(mask));
+        matches.push_back(static_cast<uint32_t>((firstIndex + lane) * elementSize));
+        mask &= mask - 1;
+    }
+}
+
+using VectorKernels::TargetMatch;
+
+// Emits the lanes set in any of the per-target masks lane by lane, so the matches
+// of a block come out in offset order, then target order.
+inline void appendTargetLanes(const unsigned int *masks, size_t targetCount, size_t firstIndex, size_t elementSize,
+                              std::vector<TargetMatch> &matches) {
+    unsigned int any = 0;
+    for (size_t target = 0; target < targetCount; ++target) {
+        any |= masks[target];
+    }
+    while (any != 0) {
+        const unsigned int lane = static_cast<unsigned int>(__builtin_ctz(any));
+        for (size_t target = 0; target < targetCount; ++target) {
+            if ((masks[target] >> lane & 1u) != 0) {
+                matches.push_back({static_cast<uint32_t>((firstIndex + lane) * elementSize), static_cast<uint32_t>(target)});
+            }
+        }
+        any &= any - 1;
+    }
+}
+
+template <typename Traits>
+void matchTargetsScalarTail(const uint8_t *data, size_t index, size_t startCount, const std::vector<MatchTarget> &targets,
+                            std::vector<TargetMatch> &matches) {
+    for (; index < startCount; ++index) {
+        for (size_t target = 0; target < targets.size(); ++target) {
+            if (matchesAt<Traits>(data + index * Traits::alignment, Bounds<typename Traits::Element>(targets[target]))) {
+                matches.push_back({static_cast<uint32_t>(index * Traits::alignment), static_cast<uint32_t>(target)});
+            }
+        }
+    }
+}
+
+// Cells are addressed by floor(component / cellSize). Values whose cell index is
+// not representable (NaN, infinities, absurd magnitudes) cannot match a grid
+// target.
+constexpr double maxCellIndex = 4.0e18;
+
+inline bool cellIndex(double component, double inverseCellSize, int64_t &index) {
+    const double cell = component * inverseCellSize;
+    if (!(std::fabs(cell) < maxCellIndex)) {
+        return false;
+    }
+    index = static_cast<int64_t>(cell);
+    index -= cell < static_cast<double>(index) ? 1 : 0;
+    return true;
+}
+
+inline uint64_t hashCell(int64_t index) {
+    const uint64_t mixed = static_cast<uint64_t>(index) * 0x9e3779b97f4a7c15ull;
+    return mixed ^ (mixed >> 29);
+}
+
+// Distinct cells may share a key; the exact test on every listed target keeps
+// that harmless.
+inline uint64_t columnKey(int64_t x, int64_t y) {
+    const uint64_t key = hashCell(x) ^ hashCell(y) * 0xc2b2ae3d27d4eb4full;
+    return key ^ (key >> 32);
+}
+
+inline uint64_t cellKey(uint64_t column, int64_t z) {
+    const uint64_t key = column ^ hashCell(z) * 0x165667b19e3779f9ull;
+    return key ^ (key >> 32);
+}
+
+inline bool filterHas(const std::vector<uint64_t> &filter, uint64_t key) {
+    const uint64_t bit = key & (filter.size() * 64 - 1);
+    return (filter[bit >> 6] >> (bit & 63) & 1u) != 0;
+}
+
+// The x bucket of a value is the top bucketBits of its bit pattern, with the sign
+// flipped for integers so buckets follow the value order. Float buckets follow
+// the magnitude within each sign.
+constexpr unsigned bucketBits = 21;
+
+inline uint32_t xBucket(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits >> (32 - bucketBits);
+}
+
+inline uint32_t xBucket(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return static_cast<uint32_t>(bits >> (64 - bucketBits));
+}
+
+inline uint32_t xBucket(int32_t value) {
+    return (static_cast<uint32_t>(value) ^ 0x80000000u) >> (32 - bucketBits);
+}
+
+inline bool bucketSet(const std::vector<uint32_t> &buckets, uint32_t bucket) {
+    return (buckets[bucket >> 5] >> (bucket & 31) & 1u) != 0;
+}
+
+template <typename Traits>
+inline void testGridCell(const uint8_t *value, uint32_t offset, const std::vector<MatchTarget> &targets,
+                         const VectorKernels::TargetGrid &grid, double inverseCellSize, std::vector<TargetMatch> &matches) {
+    int64_t x = 0;
+    int64_t y = 0;
+    int64_t z = 0;
+    if (!cellIndex(static_cast<double>(loadComponent<Traits>(value, 0)), inverseCellSize, x) ||
+        !cellIndex(static_cast<double>(loadComponent<Traits>(value, 1)), inverseCellSize, y)) {
+        return;
+    }
+    const uint64_t column = columnKey(x, y);
+    if (!filterHas(grid.xyFilter, column) ||
+        !cellIndex(static_cast<double>(loadComponent<Traits>(value, 2)), inverseCellSize, z)) {
+        return;
+    }
+    const uint64_t key = cellKey(column, z);
+    const size_t mask = grid.cells.size() - 1;
+    for (size_t slot = key & mask;; slot = (slot + 1) & mask) {
+        const VectorKernels::GridCell &cell = grid.cells[slot];
+        if (cell.first == cell.end) {
+            return;
+        }
+        if (cell.key != key) {
+            continue;
+        }
+        for (uint32_t i = cell.first; i < cell.end; ++i) {
+            const uint32_t target = grid.targets[i];
+            if (matchesAt<Traits>(value, Bounds<typename Traits::Element>(targets[target]))) {
+                matches.push_back({offset, target});
+            }
+        }
+        return;
+    }
+}
+
+template <typename Traits>
+void matchTargetsGridTail(const uint8_t *data, size_t index, size_t startCount, const std::vector<MatchTarget> &targets,
+                          const VectorKernels::TargetGrid &grid, std::vector<TargetMatch> &matches) {
+    const double inverseCellSize = 1.0 / grid.cellSize;
+    for (; index < startCount; ++index) {
+        const uint8_t *value = data + index * Traits::alignment;
+        if (bucketSet(grid.xBuckets, xBucket(loadComponent<Traits>(value, 0)))) {
+            testGridCell<Traits>(value, static_cast<uint32_t>(index * Traits::alignment), targets, grid, inverseCellSize, matches);
+        }
+    }
+}
+
+template <typename Traits>
+void matchTargetsGrid(const uint8_t *data, size_t startCount, const std::vector<MatchTarget> &targets,
+                      const VectorKernels::TargetGrid &grid, std::vector<TargetMatch> &matches) {
+    matchTargetsGridTail<Traits>(data, 0, startCount, targets, grid, matches);
+}
+
+#if defined(OFFSET_SCANNER_X86)
+
+// Lane i of the three loads holds floats i, i+1 and i+2, so one compare per load
+// tests a full triple for every lane. |a - t| is computed the same way as
+// approximatelyEqual and compared with an ordered predicate, which keeps NaN lanes
+// false just like the scalar <=.
+void matchVec3fSse2(const uint8_t *data, size_t startCount, const MatchTarget &match, std::vector<uint32_t> &matches) {
+    const Bounds<float> bounds(match);
+    const float *floats = reinterpret_cast<const float *>(data);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 targetX = _mm_set1_ps(bounds.target[0]);
+    const __m128 targetY = _mm_set1_ps(bounds.target[1]);
+    const __m128 targetZ = _mm_set1_ps(bounds.target[2]);
+    const __m128 limit = _mm_set1_ps(bounds.tolerance);
+    size_t index = 0;
+    for (; index + 4 <= startCount; index += 4) {
+        const __m128 dx = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(floats + index), targetX));
+        const __m128 mx = _mm_cmple_ps(dx, limit);
+        if (_mm_movemask_ps(mx) == 0) {
+            continue;
+        }
+        const __m128 dy = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(floats + index + 1), targetY));
+        const __m128 dz = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(floats + index + 2), targetZ));
+        const __m128 all = _mm_and_ps(mx, _mm_and_ps(_mm_cmple_ps(dy, limit), _mm_cmple_ps(dz, limit)));
+        appendLanes(static_cast<unsigned int>(_mm_movemask_ps(all)), index, sizeof(float), matches);
+    }
+    matchScalarTail<Vec3fTraits>(data, index, startCount, bounds, matches);
+}
+
+__attribute__((target("avx2"))) void matchVec3fAvx2(const uint8_t *data, size_t startCount, const MatchTarget &match,
+                                                    std::vector<uint32_t> &matches) {
+    const Bounds<float> bounds(match);
+    const float *floats = reinterpret_cast<const float *>(data);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 targetX = _mm256_set1_ps(bounds.target[0]);
+    const __m256 targetY = _mm256_set1_ps(bounds.target[1]);
+    const __m256 targetZ = _mm256_set1_ps(bounds.target[2]);
+    const __m256 limit = _mm256_set1_ps(bounds.tolerance);
+    size_t index = 0;
+    for (; index + 16 <= startCount; index += 16) {
+        const __m256 dx0 = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(floats + index), targetX));
+        const __m256 dx1 = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(floats + index + 8), targetX));
+        const __m256 mx0 = _mm256_cmp_ps(dx0, limit, _CMP_LE_OQ);
+        const __m256 mx1 = _mm256_cmp_ps(dx1, limit, _CMP_LE_OQ);
+        if (_mm256_testz_ps(_mm256_or_ps(mx0, mx1), _mm256_or_ps(mx0, mx1)) != 0) {
+            continue;
+        }
+        for (size_t half = 0; half < 2; ++half) {
+            const size_t base = index + half * 8;
+            const __m256 mx = half == 0 ? mx0 : mx1;
+            if (_mm256_movemask_ps(mx) == 0) {
+                continue;
+            }
+            const __m256 dy = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(floats + base + 1), targetY));
+            const __m256 dz = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(floats + base + 2), targetZ));
+            const __m256 all = _mm256_and_ps(mx, _mm256_and_ps(_mm256_cmp_ps(dy, limit, _CMP_LE_OQ),
+                                                                _mm256_cmp_ps(dz, limit, _CMP_LE_OQ)));
+            appendLanes(static_cast<unsigned int>(_mm256_movemask_ps(all)), base, sizeof(float), matches);
+        }
+    }
+    matchScalarTail<Vec3fTraits>(data, index, startCount, bounds, matches);
+}
+
+// Doubles use the same overlapping-load scheme with 2 (SSE2) or 4 (AVX2) lanes.
+void matchVec3dSse2(const uint8_t *data, size_t startCount, const MatchTarget &match, std::vector<uint32_t> &matches) {
+    const Bounds<double> bounds(match);
+    const double *doubles = reinterpret_cast<const double *>(data);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    const __m128d limit = _mm_set1_pd(bounds.tolerance);
+    const __m128d target[3] = {_mm_set1_pd(bounds.target[0]), _mm_set1_pd(bounds.target[1]), _mm_set1_pd(bounds.target[2])};
+    size_t index = 0;
+    for (; index + 2 <= startCount; index += 2) {
+        unsigned int mask = 3;
+        for (size_t component = 0; component < 3 && mask != 0; ++component) {
+            const __m128d difference = _mm_andnot_pd(signMask, _mm_sub_pd(_mm_loadu_pd(doubles + index + component), target[component]));
+            mask &= static_cast<unsigned int>(_mm_movemask_pd(_mm_cmple_pd(difference, limit)));
+        }
+        appendLanes(mask, index, sizeof(double), matches);
+    }
+    matchScalarTail<Vec3dTraits>(data, index, startCount, bounds, matches);
+}
+
+__attribute__((target("avx2"))) void matchVec3dAvx2(const uint8_t *data, size_t startCount, const MatchTarget &match,
+                                                    std::vector<uint32_t> &matches) {
+    const Bounds<double> bounds(match);
+    const double *doubles = reinterpret_cast<const double *>(data);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d limit = _mm256_set1_pd(bounds.tolerance);
+    const __m256d target[3] = {_mm256_set1_pd(bounds.target[0]), _mm256_set1_pd(bounds.target[1]),
+                               _mm256_set1_pd(bounds.target[2])};
+    size_t index = 0;
+    for (; index + 4 <= startCount; index += 4) {
+        unsigned int mask = 15;
+        for (size_t component = 0; component < 3 && mask != 0; ++component) {
+            const __m256d difference =
+                _mm256_andnot_pd(signMask, _mm256_sub_pd(_mm256_loadu_pd(doubles + index + component), target[component]));
+            mask &= static_cast<unsigned int>(_mm256_movemask_pd(_mm256_cmp_pd(difference, limit, _CMP_LE_OQ)));
+        }
+        appendLanes(mask, index, sizeof(double), matches);
+    }
+    matchScalarTail<Vec3dTraits>(data, index, startCount, bounds, matches);
+}
+
+// One 16-byte value per SSE register; w is masked out of the movemask.
+void matchVec4fSse2(const uint8_t *data, size_t startCount, const MatchTarget &match, std::vector<uint32_t> &matches) {
+    const Bounds<float> bounds(match);
+    const float *floats = reinterpret_cast<const float *>(data);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 target = _mm_setr_ps(bounds.target[0], bounds.target[1], bounds.target[2], 0.0f);
+    const __m128 limit = _mm_set1_ps(bounds.tolerance);
+    for (size_t index = 0; index < startCount; ++index) {
+        const __m128 difference = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(floats + index * 4), target));
+        if ((_mm_movemask_ps(_mm_cmple_ps(difference, limit)) & 7) == 7) {
+            matches.push_back(static_cast<uint32_t>(index * Vec4fTraits::alignment));
+        }
+    }
+}
+
+__attribute__((target("avx2"))) void matchVec4fAvx2(const uint8_t *data, size_t startCount, const MatchTarget &match,
+                                                    std::vector<uint32_t> &matches) {
+    const Bounds<float> bounds(match);
+    const float *floats = reinterpret_cast<const float *>(data);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 target = _mm256_setr_ps(bounds.target[0], bounds.target[1], bounds.target[2], 0.0f, bounds.target[0],
+                                         bounds.target[1], bounds.target[2], 0.0f);
+    const __m256 limit = _mm256_set1_ps(bounds.tolerance);
+    size_t index = 0;
+    for (; index + 2 <= startCount; index += 2) {
+        const __m256 difference = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(floats + index * 4), target));
+        const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(difference, limit, _CMP_LE_OQ)));
+        if ((mask & 0x07) == 0x07) {
+            matches.push_back(static_cast<uint32_t>(index * Vec4fTraits::alignment));
+        }
+        if ((mask & 0x70) == 0x70) {
+            matches.push_back(static_cast<uint32_t>((index + 1) * Vec4fTraits::alignment));
+        }
+    }
+    matchScalarTail<Vec4fTraits>(data, index, startCount, bounds, matches);
+}
+
+// Fixed-point triples: a lane matches when no component is below low or above high.
+void matchVec3iSse2(const uint8_t *data, size_t startCount, const MatchTarget &match, std::vector<uint32_t> &matches) {
+    const Bounds<int32_t> bounds(match);
+    const auto *ints = reinterpret_cast<const int32_t *>(data);
+    __m128i low[3];
+    __m128i high[3];
+    for (size_t component = 0; component < 3; ++component) {
+        low[component] = _mm_set1_epi32(bounds.low[component]);
+        high[component] = _mm_set1_epi32(bounds.high[component]);
+    }
+    size_t index = 0;
+    for (; index + 4 <= startCount; index += 4) {
+        unsigned int mask = 15;
+        for (size_t component = 0; component < 3 && mask != 0; ++component) {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ints + index + component));
+            const __m128i outside = _mm_or_si128(_mm_cmplt_epi32(values, low[component]), _mm_cmpgt_epi32(values, high[component]));
+            mask &= ~static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(outside))) & 15;
+        }
+        appendLanes(mask, index, sizeof(int32_t), matches);
+    }
+    matchScalarTail<Vec3iTraits>(data, index, startCount, bounds, matches);
+}
+
+__attribute__((target("avx2"))) void matchVec3iAvx2(const uint8_t *data, size_t startCount, const MatchTarget &match,
+                                                    std::vector<uint32_t> &matches) {
+    const Bounds<int32_t> bounds(match);
+    const auto *ints = reinterpret_cast<const int32_t *>(data);
+    __m256i low[3];
+    __m256i high[3];
+    for (size_t component = 0; component < 3; ++component) {
+        low[component] = _mm256_set1_epi32(bounds.low[component]);
+        high[component] = _mm256_set1_epi32(bounds.high[component]);
+    }
+    size_t index = 0;
+    for (; index + 8 <= startCount; index += 8) {
+        unsigned int mask = 255;
+        for (size_t component = 0; component < 3 && mask != 0; ++component) {
+            const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ints + index + component));
+            const __m256i outside =
+                _mm256_or_si256(_mm256_cmpgt_epi32(low[component], values), _mm256_cmpgt_epi32(values, high[component]));
+            mask &= ~static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 255;
+        }
+        appendLanes(mask, index, sizeof(int32_t), matches);
+    }
+    matchScalarTail<Vec3iTraits>(data, index, startCount, bounds, matches);
+}
+
+
+// Broadcast form of the vec3f kernels: each block of x lanes is loaded once and
+// compared against every target's x; y and z are only loaded when some target
+// matched an x.
+void matchTargetsVec3fSse2(const uint8_t *data, size_t startCount, const std::vector<MatchTarget> &targets,
+                           std::vector<TargetMatch> &matches) {
+    constexpr size_t maxTargets = VectorKernels::MultiMatcher::maxBroadcastTargets;
+    const size_t targetCount = std::min(targets.size(), maxTargets);
+    const float *floats = reinterpret_cast<const float *>(data);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 targetX[maxTargets];
+    __m128 targetY[maxTargets];
+    __m128 targetZ[maxTargets];
+    __m128 limit[maxTargets];
+    for (size_t target = 0; target < targetCount; ++target) {
+        const Bounds<float> bounds(targets[target]);
+        targetX[target] = _mm_set1_ps(bounds.target[0]);
+        targetY[target] = _mm_set1_ps(bounds.target[1]);
+        targetZ[target] = _mm_set1_ps(bounds.target[2]);
+        limit[target] = _mm_set1_ps(bounds.tolerance);
+    }
+    unsigned int masks[maxTargets];
+    size_t index = 0;
+    for (; index + 4 <= startCount; index += 4) {
+        const __m128 x = _mm_loadu_ps(floats + index);
+        unsigned int any = 0;
+        for (size_t target = 0; target < targetCount; ++target) {
+            const __m128 dx = _mm_andnot_ps(signMask, _mm_sub_ps(x, targetX[target]));
+            masks[target] = static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(dx, limit[target])));
+            any |= masks[target];
+        }
+        if (any == 0) {
+            continue;
+        }
+        const __m128 y = _mm_loadu_ps(floats + index + 1);
+        const __m128 z = _mm_loadu_ps(floats + index + 2);
+        for (size_t target = 0; target < targetCount; ++target) {
+            if (masks[target] == 0) {
+                continue;
+            }
+            const __m128 dy = _mm_andnot_ps(signMask, _mm_sub_ps(y, targetY[target]));
+            const __m128 dz = _mm_andnot_ps(signMask, _mm_sub_ps(z, targetZ[target]));
+            const __m128 yz = _mm_and_ps(_mm_cmple_ps(dy, limit[target]), _mm_cmple_ps(dz, limit[target]));
+            masks[target] &= static_cast<unsigned int>(_mm_movemask_ps(yz));
+        }
+        appendTargetLanes(masks, targetCount, index, sizeof(float), matches);
+    }
+    matchTargetsScalarTail<Vec3fTraits>(data, index, startCount, targets, matches);
+}
+
+__attribute__((target("avx2"))) void matchTargetsVec3fAvx2(const uint8_t *data, size_t startCount,
+                                                           const std::vector<MatchTarget> &targets,
+                                                           std::vector<TargetMatch> &matches) {
+    constexpr size_t maxTargets = VectorKernels::MultiMatcher::maxBroadcastTargets;
+    const size_t targetCount = std::min(targets.size(), maxTargets);
+    const float *floats = reinterpret_cast<const float *>(data);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 targetX[maxTargets];
+    __m256 targetY[maxTargets];
+    __m256 targetZ[maxTargets];
+    __m256 limit[maxTargets];
+    for (size_t target = 0; target < targetCount; ++target) {
+        const Bounds<float> bounds(targets[target]);
+        targetX[target] = _mm256_set1_ps(bounds.target[0]);
+        targetY[target] = _mm256_set1_ps(bounds.target[1]);
+        targetZ[target] = _mm256_set1_ps(bounds.target[2]);
+        limit[target] = _mm256_set1_ps(bounds.tolerance);
+    }
+    unsigned int masks[maxTargets];
+    size_t index = 0;
+    for (; index + 8 <= startCount; index += 8) {
+        const __m256 x = _mm256_loadu_ps(floats + index);
+        __m256 any = _mm256_setzero_ps();
+        __m256 matchX[maxTargets];
+        for (size_t target = 0; target < targetCount; ++target) {
+            const __m256 dx = _mm256_andnot_ps(signMask, _mm256_sub_ps(x, targetX[target]));
+            matchX[target] = _mm256_cmp_ps(dx, limit[target], _CMP_LE_OQ);
+            any = _mm256_or_ps(any, matchX[target]);
+        }
+        if (_mm256_testz_ps(any, any) != 0) {
+            continue;
+        }
+        const __m256 y = _mm256_loadu_ps(floats + index + 1);
+        const __m256 z = _mm256_loadu_ps(floats + index + 2);
+        for (size_t target = 0; target < targetCount; ++target) {
+            const __m256 dy = _mm256_andnot_ps(signMask, _mm256_sub_ps(y, targetY[target]));
+            const __m256 dz = _mm256_andnot_ps(signMask, _mm256_sub_ps(z, targetZ[target]));
+            const __m256 all = _mm256_and_ps(matchX[target], _mm256_and_ps(_mm256_cmp_ps(dy, limit[target], _CMP_LE_OQ),
+                                                                           _mm256_cmp_ps(dz, limit[target], _CMP_LE_OQ)));
+            masks[target] = static_cast<unsigned int>(_mm256_movemask_ps(all));
+        }
+        appendTargetLanes(masks, targetCount, index, sizeof(float), matches);
+    }
+    matchTargetsScalarTail<Vec3fTraits>(data, index, startCount, targets, matches);
+}
+
+// Eight x buckets are tested per gather from the bucket bitmap; only the lanes
+// whose bucket is set go on to the cell lookup.
+__attribute__((target("avx2"))) void matchTargetsGridVec3fAvx2(const uint8_t *data, size_t startCount,
+                                                               const std::vector<MatchTarget> &targets,
+                                                               const VectorKernels::TargetGrid &grid,
+                                                               std::vector<TargetMatch> &matches) {
+    const double inverseCellSize = 1.0 / grid.cellSize;
+    const auto *words = reinterpret_cast<const int *>(grid.xBuckets.data());
+    const __m256i bitMask = _mm256_set1_epi32(31);
+    size_t index = 0;
+    for (; index + 8 <= startCount; index += 8) {
+        const __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + index * sizeof(float)));
+        const __m256i bucket = _mm256_srli_epi32(bits, 32 - bucketBits);
+        const __m256i word = _mm256_i32gather_epi32(words, _mm256_srli_epi32(bucket, 5), 4);
+        const __m256i bit = _mm256_slli_epi32(_mm256_srlv_epi32(word, _mm256_and_si256(bucket, bitMask)), 31);
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(bit)));
+        while (mask != 0) {
+            const size_t lane = static_cast<size_t>(__builtin_ctz(mask));
+            const size_t offset = (index + lane) * sizeof(float);
+            testGridCell<Vec3fTraits>(data + offset, static_cast<uint32_t>(offset), targets, grid, inverseCellSize, matches);
+            mask &= mask - 1;
+        }
+    }
+    matchTargetsGridTail<Vec3fTraits>(data, index, startCount, targets, grid, matches);
+}
+
+#endif
+
+struct TypeKernels {
+    VectorKernels::ValueType type;
+    const char *name;
+    VectorKernels::ValueLayout layout;
+    VectorKernels::MatchFunction scalar;
+    VectorKernels::MatchFunction sse2;
+    VectorKernels::MatchFunction avx2;
+    VectorKernels::TestFunction test;
+};
+
+template <typename Traits>
+constexpr VectorKernels::ValueLayout layoutFor() {
+    return {Traits::size, Traits::alignment};
+}
+
+#if defined(OFFSET_SCANNER_X86)
+#define OFFSET_SCANNER_SIMD(function) &function
+#else
+#define OFFSET_SCANNER_SIMD(function) nullptr
+#endif
+
+const TypeKernels typeKernels[] = {
+    {VectorKernels::ValueType::Vec3f, "vec3f", layoutFor<Vec3fTraits>(), &matchScalar<Vec3fTraits>,
+     OFFSET_SCANNER_SIMD(matchVec3fSse2), OFFSET_SCANNER_SIMD(matchVec3fAvx2), &testScalar<Vec3fTraits>},
+    {VectorKernels::ValueType::Vec3d, "vec3d", layoutFor<Vec3dTraits>(), &matchScalar<Vec3dTraits>,
+     OFFSET_SCANNER_SIMD(matchVec3dSse2), OFFSET_SCANNER_SIMD(matchVec3dAvx2), &testScalar<Vec3dTraits>},
+    {VectorKernels::ValueType::Vec4f, "vec4f", layoutFor<Vec4fTraits>(), &matchScalar<Vec4fTraits>,
+     OFFSET_SCANNER_SIMD(matchVec4fSse2), OFFSET_SCANNER_SIMD(matchVec4fAvx2), &testScalar<Vec4fTraits>},
+    {VectorKernels::ValueType::Vec3i, "vec3i", layoutFor<Vec3iTraits>(), &matchScalar<Vec3iTraits>,
+     OFFSET_SCANNER_SIMD(matchVec3iSse2), OFFSET_SCANNER_SIMD(matchVec3iAvx2), &testScalar<Vec3iTraits>},
+};
+
+#undef OFFSET_SCANNER_SIMD
+
+const TypeKernels &kernelsFor(VectorKernels::ValueType type) {
+    for (const auto &entry : typeKernels) {
+        if (entry.type == type) {
+            return entry;
+        }
+    }
+    return typeKernels[0];
+}
+
+} // namespace
+
+namespace VectorKernels {
+
+bool isSupported(KernelKind kind) {
+    switch (kind) {
+    case KernelKind::Scalar:
+        return true;
+#if defined(OFFSET_SCANNER_X86)
+    case KernelKind::Sse2:
+        return __builtin_cpu_supports("sse2") != 0;
+    case KernelKind::Avx2:
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    default:
+        return false;
+    }
+}
+
+KernelKind bestSupported() {
+    if (isSupported(KernelKind::Avx2)) {
+        return KernelKind::Avx2;
+    }
+    if (isSupported(KernelKind::Sse2)) {
+        return KernelKind::Sse2;
+    }
+    return KernelKind::Scalar;
+}
+
+MatchFunction select(KernelKind kind, ValueType type) {
+    const TypeKernels &kernels = kernelsFor(type);
+    if (!isSupported(kind)) {
+        return kernels.scalar;
+    }
+    switch (kind) {
+    case KernelKind::Sse2:
+        return kernels.sse2 != nullptr ? kernels.sse2 : kernels.scalar;
+    case KernelKind::Avx2:
+        return kernels.avx2 != nullptr ? kernels.avx2 : kernels.scalar;
+    default:
+        return kernels.scalar;
+    }
+}
+
+TestFunction selectTest(ValueType type) {
+    return kernelsFor(type).test;
+}
+
+std::vector<KernelKind> supportedKernels() {
+    std::vector<KernelKind> kinds;
+    for (KernelKind kind : {KernelKind::Scalar, KernelKind::Sse2, KernelKind::Avx2}) {
+        if (isSupported(kind)) {
+            kinds.push_back(kind);
+        }
+    }
+    return kinds;
+}
+
+const char *kernelName(KernelKind kind) {
+    switch (kind) {
+    case KernelKind::Scalar:
+        return "scalar";
+    case KernelKind::Sse2:
+        return "sse2";
+    case KernelKind::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+bool parseKernelName(const std::string &name, KernelKind &out) {
+    for (KernelKind kind : {KernelKind::Scalar, KernelKind::Sse2, KernelKind::Avx2}) {
+        if (name == kernelName(kind)) {
+            out = kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+ValueLayout layoutOf(ValueType type) {
+    return kernelsFor(type).layout;
+}
+
+const char *valueTypeName(ValueType type) {
+    return kernelsFor(type).name;
+}
+
+bool parseValueTypeName(const std::string &name, ValueType &out) {
+    for (const auto &entry : typeKernels) {
+        if (name == entry.name) {
+            out = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<ValueType> allValueTypes() {
+    std::vector<ValueType> types;
+    for (const auto &entry : typeKernels) {
+        types.push_back(entry.type);
+    }
+    return types;
+}
+
+MatchTarget makeMatchTarget(ValueType type, const Vector3 &target, float tolerance, double fixedPointScale) {
+    const double scale = type == ValueType::Vec3i ? fixedPointScale : 1.0;
+    MatchTarget match;
+    match.components[0] = static_cast<double>(target.x) * scale;
+    match.components[1] = static_cast<double>(target.y) * scale;
+    match.components[2] = static_cast<double>(target.z) * scale;
+    match.tolerance = static_cast<double>(tolerance) * scale;
+    return match;
+}
+
+Vector3 decodeValue(ValueType type, const uint8_t *data, double fixedPointScale) {
+    switch (type) {
+    case ValueType::Vec3d:
+        return {static_cast<float>(loadComponent<Vec3dTraits>(data, 0)), static_cast<float>(loadComponent<Vec3dTraits>(data, 1)),
+                static_cast<float>(loadComponent<Vec3dTraits>(data, 2))};
+    case ValueType::Vec3i: {
+        const double scale = fixedPointScale != 0.0 ? fixedPointScale : 1.0;
+        return {static_cast<float>(loadComponent<Vec3iTraits>(data, 0) / scale),
+                static_cast<float>(loadComponent<Vec3iTraits>(data, 1) / scale),
+                static_cast<float>(loadComponent<Vec3iTraits>(data, 2) / scale)};
+    }
+    case ValueType::Vec3f:
+    case ValueType::Vec4f:
+        break;
+    }
+    return {loadComponent<Vec3fTraits>(data, 0), loadComponent<Vec3fTraits>(data, 1), loadComponent<Vec3fTraits>(data, 2)};
+}
+
+namespace {
+
+// Sets the buckets of every Element value in [low, high]. Float buckets are
+// ordered by magnitude, so a range crossing zero is marked as two halves.
+template <typename Element>
+void markBuckets(std::vector<uint32_t> &buckets, double low, double high) {
+    const auto mark = [&](Element from, Element to) {
+        uint32_t first = xBucket(from);
+        uint32_t last = xBucket(to);
+        if (first > last) {
+            std::swap(first, last);
+        }
+        for (uint32_t bucket = first; bucket <= last; ++bucket) {
+            buckets[bucket >> 5] |= 1u << (bucket & 31);
+        }
+    };
+    if constexpr (std::is_integral_v<Element>) {
+        constexpr double minimum = std::numeric_limits<Element>::min();
+        constexpr double maximum = std::numeric_limits<Element>::max();
+        low = std::max(std::floor(low), minimum);
+        high = std::min(std::ceil(high), maximum);
+        if (low <= high) {
+            mark(static_cast<Element>(low), static_cast<Element>(high));
+        }
+    } else {
+        if (low < 0.0) {
+            mark(static_cast<Element>(low), static_cast<Element>(std::min(high, -0.0)));
+        }
+        if (high >= 0.0) {
+            mark(static_cast<Element>(std::max(low, 0.0)), static_cast<Element>(high));
+        }
+    }
+}
+
+TargetGrid buildTargetGrid(ValueType type, const std::vector<MatchTarget> &targets) {
+    // A box is widened by a relative margin that covers the rounding of the
+    // element-type compare, and a cell is at least as wide as the widest box, so
+    // every box spans at most two cells per axis.
+    const auto margin = [](const MatchTarget &target, size_t component) {
+        return target.tolerance + (std::fabs(target.components[component]) + target.tolerance) * 0x1p-20;
+    };
+    TargetGrid grid;
+    grid.cellSize = 0.0;
+    for (const auto &target : targets) {
+        for (size_t component = 0; component < 3; ++component) {
+            grid.cellSize = std::max(grid.cellSize, 2.0 * margin(target, component));
+        }
+    }
+    if (!(grid.cellSize > 0.0) || !std::isfinite(grid.cellSize)) {
+        grid.cellSize = 1.0;
+    }
+    const double inverseCellSize = 1.0 / grid.cellSize;
+
+    grid.xBuckets.assign((size_t{1} << bucketBits) / 32, 0);
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    std::vector<uint64_t> columns;
+    for (size_t target = 0; target < targets.size(); ++target) {
+        int64_t low[3];
+        int64_t high[3];
+        bool representable = true;
+        for (size_t component = 0; component < 3; ++component) {
+            const double center = targets[target].components[component];
+            const double reach = margin(targets[target], component);
+            representable = representable && cellIndex(center - reach, inverseCellSize, low[component]) &&
+                            cellIndex(center + reach, inverseCellSize, high[component]);
+        }
+        if (!representable) {
+            continue;
+        }
+        const double xLow = targets[target].components[0] - margin(targets[target], 0);
+        const double xHigh = targets[target].components[0] + margin(targets[target], 0);
+        switch (type) {
+        case ValueType::Vec3d:
+            markBuckets<double>(grid.xBuckets, xLow, xHigh);
+            break;
+        case ValueType::Vec3i:
+            markBuckets<int32_t>(grid.xBuckets, xLow, xHigh);
+            break;
+        case ValueType::Vec3f:
+        case ValueType::Vec4f:
+            markBuckets<float>(grid.xBuckets, xLow, xHigh);
+            break;
+        }
+        for (int64_t x = low[0]; x <= high[0]; ++x) {
+            for (int64_t y = low[1]; y <= high[1]; ++y) {
+                columns.push_back(columnKey(x, y));
+                for (int64_t z = low[2]; z <= high[2]; ++z) {
+                    entries.emplace_back(cellKey(columns.back(), z), static_cast<uint32_t>(target));
+                }
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    // About 16 bits per occupied column keeps false positives near 6%.
+    size_t filterWords = 1;
+    while (filterWords * 64 < columns.size() * 16) {
+        filterWords *= 2;
+    }
+    grid.xyFilter.assign(filterWords, 0);
+    for (const uint64_t column : columns) {
+        const uint64_t bit = column & (filterWords * 64 - 1);
+        grid.xyFilter[bit >> 6] |= uint64_t{1} << (bit & 63);
+    }
+
+    size_t slots = 16;
+    while (slots < entries.size() * 2) {
+        slots *= 2;
+    }
+    grid.cells.assign(slots, GridCell{});
+    for (size_t i = 0; i < entries.size();) {
+        const uint64_t key = entries[i].first;
+        GridCell cell{key, static_cast<uint32_t>(grid.targets.size()), 0};
+        for (; i < entries.size() && entries[i].first == key; ++i) {
+            grid.targets.push_back(entries[i].second);
+        }
+        cell.end = static_cast<uint32_t>(grid.targets.size());
+        size_t slot = key & (slots - 1);
+        while (grid.cells[slot].first != grid.cells[slot].end) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        grid.cells[slot] = cell;
+    }
+    return grid;
+}
+
+} // namespace
+
+MultiMatcher::MultiMatcher(KernelKind kind, ValueType type, std::vector<MatchTarget> targets)
+    : kind_(isSupported(kind) ? kind : KernelKind::Scalar), type_(type), targets_(std::move(targets)), single_(select(kind, type)) {
+    if (usesGrid()) {
+        grid_ = buildTargetGrid(type_, targets_);
+    }
+}
+
+void MultiMatcher::match(const uint8_t *data, size_t startCount, std::vector<TargetMatch> &matches) const {
+    if (usesGrid()) {
+#if defined(OFFSET_SCANNER_X86)
+        if (type_ == ValueType::Vec3f && kind_ == KernelKind::Avx2) {
+            matchTargetsGridVec3fAvx2(data, startCount, targets_, grid_, matches);
+            return;
+        }
+#endif
+        switch (type_) {
+        case ValueType::Vec3f:
+            matchTargetsGrid<Vec3fTraits>(data, startCount, targets_, grid_, matches);
+            return;
+        case ValueType::Vec3d:
+            matchTargetsGrid<Vec3dTraits>(data, startCount, targets_, grid_, matches);
+            return;
+        case ValueType::Vec4f:
+            matchTargetsGrid<Vec4fTraits>(data, startCount, targets_, grid_, matches);
+            return;
+        case ValueType::Vec3i:
+            matchTargetsGrid<Vec3iTraits>(data, startCount, targets_, grid_, matches);
+            return;
+        }
+    }
+#if defined(OFFSET_SCANNER_X86)
+    if (type_ == ValueType::Vec3f && kind_ == KernelKind::Avx2) {
+        matchTargetsVec3fAvx2(data, startCount, targets_, matches);
+        return;
+    }
+    if (type_ == ValueType::Vec3f && kind_ == KernelKind::Sse2) {
+        matchTargetsVec3fSse2(data, startCount, targets_, matches);
+        return;
+    }
+#endif
+    // Other layouts run their single-target kernel once per target over the same
+    // data, which is still in cache after the first pass, and merge the offsets.
+    thread_local std::vector<uint32_t> offsets;
+    const size_t first = matches.size();
+    for (size_t target = 0; target < targets_.size(); ++target) {
+        offsets.clear();
+        single_(data, startCount, targets_[target], offsets);
+        for (const uint32_t offset : offsets) {
+            matches.push_back({offset, static_cast<uint32_t>(target)});
+        }
+    }
+    std::sort(matches.begin() + static_cast<ptrdiff_t>(first), matches.end(), [](const TargetMatch &lhs, const TargetMatch &rhs) {
+        return lhs.offset != rhs.offset ? lhs.offset < rhs.offset : lhs.target < rhs.target;
+    });
+}
+
+namespace {
+
+template <typename Element>
+void fillBenchmarkBuffer(std::vector<uint8_t> &bytes, const ValueLayout &layout, const MatchTarget &target) {
+    const size_t elementCount = bytes.size() / sizeof(Element);
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> distribution(-1000.0, 1000.0);
+    for (size_t i = 0; i < elementCount; ++i) {
+        const auto value = static_cast<Element>(distribution(generator));
+        std::memcpy(bytes.data() + i * sizeof(Element), &value, sizeof(value));
+    }
+    const Element planted[3] = {static_cast<Element>(target.components[0]), static_cast<Element>(target.components[1]),
+                                static_cast<Element>(target.components[2])};
+    for (size_t offset = 0; offset + layout.size <= bytes.size(); offset += 4099 * layout.alignment) {
+        std::memcpy(bytes.data() + offset, planted, sizeof(planted));
+    }
+    if constexpr (std::is_floating_point_v<Element>) {
+        const Element nan = std::numeric_limits<Element>::quiet_NaN();
+        const Element infinity = std::numeric_limits<Element>::infinity();
+        for (size_t i = 7; i < elementCount; i += 1021) {
+            std::memcpy(bytes.data() + i * sizeof(Element), &nan, sizeof(nan));
+        }
+        for (size_t i = 11; i < elementCount; i += 2053) {
+            std::memcpy(bytes.data() + i * sizeof(Element), &infinity, sizeof(infinity));
+        }
+    }
+}
+
+// A scale of 4 keeps the fixed-point target exact.
+MatchTarget benchmarkTarget(ValueType type) {
+    return makeMatchTarget(type, Vector3{12.5f, -40.25f, 300.0f}, 0.01f, 4.0);
+}
+
+std::vector<uint8_t> makeBenchmarkBuffer(ValueType type, size_t bufferBytes) {
+    const ValueLayout layout = layoutOf(type);
+    std::vector<uint8_t> bytes(std::max(bufferBytes, layout.size) / layout.alignment * layout.alignment);
+    switch (type) {
+    case ValueType::Vec3d:
+        fillBenchmarkBuffer<double>(bytes, layout, benchmarkTarget(type));
+        break;
+    case ValueType::Vec3i:
+        fillBenchmarkBuffer<int32_t>(bytes, layout, benchmarkTarget(type));
+        break;
+    case ValueType::Vec3f:
+    case ValueType::Vec4f:
+        fillBenchmarkBuffer<float>(bytes, layout, benchmarkTarget(type));
+        break;
+    }
+    return bytes;
+}
+
+} // namespace
+
+KernelBenchmark benchmarkKernel(KernelKind kind, size_t bufferBytes, size_t iterations, ValueType type) {
+    const ValueLayout layout = layoutOf(type);
+    const std::vector<uint8_t> bytes = makeBenchmarkBuffer(type, bufferBytes);
+    const MatchTarget matchTarget = benchmarkTarget(type);
+
+    const MatchFunction match = select(kind, type);
+    const size_t startCount = (bytes.size() - layout.size) / layout.alignment + 1;
+    std::vector<uint32_t> matches;
+    matches.reserve(startCount / 1024 + 16);
+
+    KernelBenchmark result;
+    result.kind = kind;
+    result.type = type;
+    iterations = std::max<size_t>(iterations, 1);
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
+        matches.clear();
+        match(bytes.data(), startCount, matchTarget, matches);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    result.matches = matches.size();
+    const double totalBytes = static_cast<double>(bytes.size()) * static_cast<double>(iterations);
+    result.gigabytesPerSecond = elapsed.count() > 0.0 ? totalBytes / elapsed.count() / 1e9 : 0.0;
+    return result;
+}
+
+KernelBenchmark benchmarkMultiMatcher(KernelKind kind, size_t bufferBytes, size_t iterations, ValueType type, size_t targetCount) {
+    const ValueLayout layout = layoutOf(type);
+    const std::vector<uint8_t> bytes = makeBenchmarkBuffer(type, bufferBytes);
+    // The planted target plus others spread over the range of the noise values.
+    std::vector<MatchTarget> targets{benchmarkTarget(type)};
+    std::mt19937 generator(54321);
+    std::uniform_real_distribution<float> distribution(-1000.0f, 1000.0f);
+    while (targets.size() < std::max<size_t>(targetCount, 1)) {
+        const Vector3 position{distribution(generator), distribution(generator), distribution(generator)};
+        targets.push_back(makeMatchTarget(type, position, 0.01f, 4.0));
+    }
+    const MultiMatcher matcher(kind, type, std::move(targets));
+    const size_t startCount = (bytes.size() - layout.size) / layout.alignment + 1;
+    std::vector<TargetMatch> matches;
+    matches.reserve(startCount / 1024 + 16);
+
+    KernelBenchmark result;
+    result.kind = kind;
+    result.type = type;
+    iterations = std::max<size_t>(iterations, 1);
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
+        matches.clear();
+        matcher.match(bytes.data(), startCount, matches);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    result.matches = matches.size();
+    const double totalBytes = static_cast<double>(bytes.size()) * static_cast<double>(iterations);
+    result.gigabytesPerSecond = elapsed.count() > 0.0 ? totalBytes / elapsed.count() / 1e9 : 0.0;
+    return result;
+}
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Vector3.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VectorKernels {
+
+enum class KernelKind {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// In-memory layouts a position can have. Vec4f is x, y, z plus an ignored w on a
+// 16-byte boundary; Vec3i holds int32 fixed-point coordinates.
+enum class ValueType {
+    Vec3f,
+    Vec3d,
+    Vec4f,
+    Vec3i,
+};
+
+struct ValueLayout {
+    // Bytes a kernel reads per value, and the step between candidate addresses.
+    size_t size{};
+    size_t alignment{};
+};
+
+// A target already converted into the value's own units: fixed-point targets and
+// tolerances are multiplied by the scale.
+struct MatchTarget {
+    double components[3]{};
+    double tolerance{};
+};
+
+constexpr size_t maxValueSize = 32;
+
+// Tests the values starting at every alignment-byte offset below
+// startCount * alignment and appends the byte offset of each value whose x, y and z
+// are within tolerance of target. data must hold (startCount - 1) * alignment +
+// size readable bytes. Every kernel of a type yields exactly the offsets its scalar
+// kernel would, including for NaN/Inf inputs.
+using MatchFunction = void (*)(const uint8_t *data, size_t startCount, const MatchTarget &target,
+                               std::vector<uint32_t> &matches);
+// Scalar test of one value, for verifying single candidates.
+using TestFunction = bool (*)(const uint8_t *data, const MatchTarget &target);
+
+bool isSupported(KernelKind kind);
+KernelKind bestSupported();
+MatchFunction select(KernelKind kind, ValueType type = ValueType::Vec3f);
+TestFunction selectTest(ValueType type);
+std::vector<KernelKind> supportedKernels();
+
+const char *kernelName(KernelKind kind);
+bool parseKernelName(const std::string &name, KernelKind &out);
+
+ValueLayout layoutOf(ValueType type);
+const char *valueTypeName(ValueType type);
+bool parseValueTypeName(const std::string &name, ValueType &out);
+std::vector<ValueType> allValueTypes();
+MatchTarget makeMatchTarget(ValueType type, const Vector3 &target, float tolerance, double fixedPointScale);
+// Reads x, y and z at data back into world units.
+Vector3 decodeValue(ValueType type, const uint8_t *data, double fixedPointScale);
+
+// Hit of a multi-target compare: the byte offset of the value and the index of
+// the target it is within tolerance of.
+struct TargetMatch {
+    uint32_t offset{};
+    uint32_t target{};
+};
+
+// Targets bucketed by position for MultiMatcher. xBuckets is a bitmap over the
+// top 21 bits of each x component's bit pattern; a value whose bucket is clear
+// cannot match any target. The remaining values are looked up by grid cell
+// (ix, iy, iz), which covers [i * cellSize, (i + 1) * cellSize) on each axis:
+// first in xyFilter, a small bitmap of hashed occupied (ix, iy) columns, then in
+// an open-addressing table of cells naming a run of indices in targets.
+struct GridCell {
+    uint64_t key{};
+    uint32_t first{};
+    // first == end marks an empty slot.
+    uint32_t end{};
+};
+
+struct TargetGrid {
+    double cellSize{1.0};
+    std::vector<uint32_t> xBuckets;
+    std::vector<uint64_t> xyFilter;
+    std::vector<GridCell> cells;
+    std::vector<uint32_t> targets;
+};
+
+// Compares every value against a set of targets in one pass over the data. Up to
+// maxBroadcastTargets targets are broadcast into SIMD registers and tested
+// against each loaded value. Larger sets are bucketed into a grid of cells at
+// least one tolerance box wide, so a value costs a bitmap test and at most one
+// cell lookup however many targets there are. Either way the matches are exactly the ones the
+// single-target kernels report for each target.
+class MultiMatcher {
+public:
+    static constexpr size_t maxBroadcastTargets = 4;
+
+    MultiMatcher(KernelKind kind, ValueType type, std::vector<MatchTarget> targets);
+
+    // Same contract as MatchFunction; matches are appended in offset order, then
+    // target order.
+    void match(const uint8_t *data, size_t startCount, std::vector<TargetMatch> &matches) const;
+
+    ValueType type() const { return type_; }
+    const std::vector<MatchTarget> &targets() const { return targets_; }
+    bool usesGrid() const { return targets_.size() > maxBroadcastTargets; }
+
+private:
+    KernelKind kind_{};
+    ValueType type_{};
+    std::vector<MatchTarget> targets_;
+    MatchFunction single_{};
+    TargetGrid grid_;
+};
+
+struct KernelBenchmark {
+    KernelKind kind{};
+    ValueType type{};
+    double gigabytesPerSecond{};
+    size_t matches{};
+};
+
+// Runs the kernel over a synthetic buffer of bufferBytes (random values with planted
+// hits and, for floating-point types, NaNs and infinities) and reports the
+// sustained throughput.
+KernelBenchmark benchmarkKernel(KernelKind kind, size_t bufferBytes, size_t iterations, ValueType type = ValueType::Vec3f);
+// The same buffer searched for targetCount targets at once through a MultiMatcher.
+KernelBenchmark benchmarkMultiMatcher(KernelKind kind, size_t bufferBytes, size_t iterations, ValueType type, size_t targetCount);
+
+}
@@ -1,12 +1,36 @@
+#include "CandidateWatcher.h"
+#include "ElfModule.h"
+#include "EntityArrayFinder.h"
+#include "FrozenCopy.h"
+#include "InstanceScan.h"
+#include "JsonWriter.h"
+#include "MemorySnapshot.h"
+#include "MemorySource.h"
 #include "OffsetScanner.h"
+#include "PageMap.h"
+#include "PointerMapFile.h"
+#include "PointerScanner.h"
 #include "ProcessMemoryReader.h"
 #include "ProcessUtils.h"
+#include "ScanStats.h"
+#include "ScannerDaemon.h"
+#include "SignatureScanner.h"
 #include "Vector3.h"
+#include "VectorMatchKernels.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <sstream>
 #include <string>
@@ -16,24 +40,180 @@ namespace {
 
 struct Options {
     std::string processName;
+    // --from: a core dump or snapshot file scanned instead of a live process.
+    std::string sourcePath;
+    // --capture: write the scope to a snapshot file instead of scanning it.
+    std::string capturePath;
+    // --freeze: stop the process and scan a copy taken while it was stopped.
+    std::optional<FreezeMethod> freeze;
+    // --all-instances and --pids: scan several processes and compare their offsets.
+    bool allInstances{false};
+    std::vector<pid_t> pids;
+    size_t memoryBudget{1u << 30};
     std::string moduleName;
     Vector3 primary{};
+    // Every --primary given; more than one searches for an entity array.
+    std::vector<Vector3> primaries;
     Vector3 secondary{};
+    // --target and --targets-file positions, searched for in one pass.
+    std::vector<Vector3> targets;
     bool hasPrimary{false};
     bool hasSecondary{false};
     float tolerance{0.01f};
     size_t maxResults{64};
+    size_t threads{0};
+    std::optional<VectorKernels::KernelKind> kernel;
+    VectorKernels::ValueType valueType{VectorKernels::ValueType::Vec3f};
+    double fixedPointScale{1.0};
+    bool benchKernels{false};
+    bool allRegions{false};
+    // Scan only the module's writable ELF segments.
+    bool dataSegments{false};
+    RegionFilter regionFilter;
+    std::string sessionDirectory;
+    bool startSnapshot{false};
+    std::optional<ChangeKind> compareChange;
+    SnapshotValueKind valueKind{SnapshotValueKind::Vector3};
+    std::optional<float> delta;
+    SnapshotPageStorage pageStorage{SnapshotPageStorage::Full};
+    bool fullRescan{false};
+    bool pointerScan{false};
+    PointerSearchOptions pointerSearch;
+    size_t pointerTargets{8};
+    size_t maxPointerEntries{64u << 20};
+    std::string pointerMapPath;
+    std::vector<std::string> intersectPaths;
+    bool jsonOutput{false};
+    std::string statsPath;
+    std::string tracePath;
+    bool watch{false};
+    WatchOptions watchOptions;
+    size_t watchMax{1024};
+    EntityArrayOptions entityArrays;
+    // --signatures files, resolved instead of a position scan.
+    std::vector<Signature> signatures;
+    std::string daemonSocket;
+    std::string connectSocket;
+    // Everything after --connect <socket>, one command per argument.
+    std::vector<std::string> connectCommands;
 };
 
+struct TargetReport {
+    Vector3 position{};
+    size_t hitCount{};
+    std::vector<CandidateOffset> candidates;
+};
+
+// What a scan left behind, for --output json.
+struct ScanReport {
+    size_t candidateCount{};
+    std::vector<CandidateOffset> candidates;
+    std::vector<EntityArray> entityArrays;
+    std::vector<TargetReport> targets;
+    std::vector<SignatureResult> signatures;
+    std::optional<FreezeTiming> freeze;
+};
+
+std::atomic<bool> watchStopRequested{false};
+
+void requestWatchStop(int) {
+    watchStopRequested.store(true);
+}
+
+std::atomic<bool> daemonStopRequested{false};
+
+void requestDaemonStop(int) {
+    daemonStopRequested.store(true);
+}
+
 void printUsage(const char *programName) {
-    std::cout << "Usage: " << programName << " --process <name> --module <module> --primary <x,y,z> [options]\n"
+    std::cout << "Usage: " << programName << " (--process <name> | --from <file>) (--module <module> | --all-regions) --primary <x,y,z> [options]\n"
+              << "       " << programName << " --process <name> (--module <module> | --all-regions) --capture <file>\n"
+              << "       " << programName << " --process <name> (--module <module> | --all-regions) --session <dir> (--snapshot | --compare <mode>) [options]\n"
+              << "       " << programName << " (--process <name> --all-instances | --pids <list>) --module <module> (--primary <x,y,z> | --signatures <file>) [options]\n"
+              << "       " << programName << " --intersect-chains <map> --intersect-chains <map> ... [--max-depth <n>] [--max-offset <n>]\n"
+              << "       " << programName << " --daemon <socket> [--process <name> (--module <module> | --all-regions)] [options]\n"
+              << "       " << programName << " --connect <socket> [command ...]\n"
               << "Options:\n"
               << "  --process <name>       Target process name as listed in /proc/<pid>/comm\n"
+              << "  --from <file>         Scan a core dump (e.g. from gcore) or a --capture snapshot offline\n"
+              << "                        instead of a live process; --module matches mapping paths\n"
+              << "  --capture <file>      Save the scope of --process to a snapshot file for later --from runs\n"
+              << "  --freeze <method>     Stop the process with ptrace or signal (SIGSTOP) while the scope is\n"
+              << "                        copied, then scan the copy: one consistent point in time\n"
+              << "  --all-instances       Scan every process named --process at once and report the module\n"
+              << "                        offsets that agree across them (--primary or --signatures)\n"
+              << "  --pids <list>         Like --all-instances for a comma separated list of pids\n"
+              << "  --memory-budget <n>   Memory the instances scanned at once may hold, 0 for no limit\n"
+              << "                        (K/M/G suffixes allowed, default 1G)\n"
               << "  --module <module>     Module or binary name to constrain the scan\n"
-              << "  --primary <x,y,z>     Known position sample (floats)\n"
+              << "  --all-regions         Scan every readable mapping instead of one module; --module then\n"
+              << "                        only names the static base for --pointer-scan\n"
+              << "  --data-segments       Scan only the writable ELF segments of --module (.data, .bss and\n"
+              << "                        the anonymous mapping holding the rest of .bss)\n"
+              << "  --include-perms <p>   Only scan mappings having all of these permissions, e.g. rw (default r)\n"
+              << "  --exclude-perms <p>   Skip mappings having any of these permissions, e.g. xs\n"
+              << "  --region-kinds <k>    Comma separated kinds to scan: anon,file,heap,stack,special,all (default all)\n"
+              << "  --min-region-size <n> Skip mappings smaller than n bytes (K/M/G suffixes allowed)\n"
+              << "  --max-region-size <n> Skip mappings larger than n bytes (K/M/G suffixes allowed)\n"
+              << "  --primary <x,y,z>     Known position sample (floats); repeat with the positions of other\n"
+              << "                        entities to find the array of structs holding them\n"
               << "  --secondary <x,y,z>   Optional second sample for validation\n"
+              << "  --target <x,y,z>      Position to search for instead of --primary; repeat to find several\n"
+              << "                        positions in one pass over memory\n"
+              << "  --targets-file <file> Read --target positions from file, one x,y,z per line\n"
               << "  --tolerance <value>   Comparison tolerance (default 0.01)\n"
               << "  --max-results <n>     Maximum number of candidates to display (default 64)\n"
+              << "  --threads <n>         Scan worker threads, 0 uses every core (default 0)\n"
+              << "  --kernel <name>       Compare kernel: scalar, sse2 or avx2 (default: best supported)\n"
+              << "  --type <layout>       Position layout: vec3f (default), vec3d, vec4f (16-byte aligned, w\n"
+              << "                        ignored) or vec3i (int32 fixed point)\n"
+              << "  --fixed-scale <s>     Units per world unit for vec3i, e.g. 256 for 24.8 (default 1)\n"
+              << "  --signatures <file>   Resolve the byte signatures in file against --module instead of\n"
+              << "                        searching for a position; one 'name = 48 8B 05 ?? ?? ?? ?? ; rip 3'\n"
+              << "                        per line, see SignatureScanner.h for the modifiers\n"
+              << "  --bench-kernels       Measure the throughput of every supported kernel and exit\n"
+              << "Reporting:\n"
+              << "  --output <format>     text (default) or json; json prints one document with the candidates\n"
+              << "                        and scan counters on stdout and moves progress text to stderr\n"
+              << "  --stats-json <file>   Write per-phase and per-region scan counters to file\n"
+              << "  --trace <file>        Write read/compare spans in Chrome trace format to file\n"
+              << "Entity arrays (two or more --primary):\n"
+              << "  --max-stride <n>      Largest distance between consecutive entries (default 0x1000)\n"
+              << "  --max-entities <n>    Largest number of entries in one array (default 4096)\n"
+              << "Live watch:\n"
+              << "  --watch               Poll the verified candidates and drop the ones that do not move\n"
+              << "  --watch-rate <hz>     Polls per second (default 1000)\n"
+              << "  --watch-duration <s>  Seconds to watch, 0 until Ctrl-C (default 10)\n"
+              << "  --watch-reference <a> Address of a vector known to move; candidates holding still while it\n"
+              << "                        moves are dropped. Without it only motion is reported\n"
+              << "  --watch-still <n>     Consecutive still polls before a candidate is dropped (default 3)\n"
+              << "  --watch-max <n>       Maximum number of candidates to watch (default 1024)\n"
+              << "Pointer chains:\n"
+              << "  --pointer-scan        Search pointer chains from the module to the verified candidates\n"
+              << "  --max-depth <n>       Maximum chain length (default 4)\n"
+              << "  --max-offset <n>      Maximum offset added to each pointer (default 0x1000)\n"
+              << "  --pointer-targets <n> Number of candidates to search chains for (default 8)\n"
+              << "  --max-pointer-entries <n> Cap on pointer map entries, 16 bytes each (default 64M)\n"
+              << "  --pointer-map-save <file> Save the pointer map and targets for a later --intersect-chains\n"
+              << "  --intersect-chains <file> Print chains found in every saved pointer map (repeat per run)\n"
+              << "Unknown value scans:\n"
+              << "  --session <dir>       Directory holding the snapshot and candidates between steps\n"
+              << "  --snapshot            Start a session: capture the scope and treat every slot as a candidate\n"
+              << "  --compare <mode>      Keep candidates that changed, unchanged, increased, decreased or moved\n"
+              << "                        since the previous step, then snapshot again\n"
+              << "  --value-kind <kind>   vector3 (default) or float\n"
+              << "  --delta <d>           Expected change for increased/decreased, distance for moved\n"
+              << "  --elide-zero-pages    Store snapshots without their all-zero pages\n"
+              << "  --compress-pages      Also store each snapshot page zlib-compressed when that makes it smaller\n"
+              << "  --full-rescan         Re-read every page on --compare instead of only the soft-dirty ones\n"
+              << "Daemon:\n"
+              << "  --daemon <socket>     Serve scan, verify, list and watch commands on a Unix socket, keeping\n"
+              << "                        the process, its mappings and named candidate sets between commands;\n"
+              << "                        the other options set the session defaults\n"
+              << "  --connect <socket>    Send each following argument as one command to a daemon and print\n"
+              << "                        the answers; without arguments commands are read from stdin, e.g.\n"
+              << "                        'attach game libgame.so', 'scan a 1,2,3', 'verify a 1,2,4', 'list a'\n"
               << std::endl;
 }
 
@@ -47,6 +227,65 @@ bool parseVectorArgument(const std::string &argument, Vector3 &out, std::string
     }
 }
 
+// Decimal, or hexadecimal with a 0x prefix; a leading zero does not mean octal.
+bool parseSizeArgument(const std::string &argument, size_t &out, std::string &error) {
+    const bool hex = argument.size() > 2 && argument[0] == '0' && (argument[1] == 'x' || argument[1] == 'X');
+    const char *digits = argument.c_str() + (hex ? 2 : 0);
+    // strtoull would skip blanks and accept a sign, wrapping -1 to the largest value.
+    if (!std::isxdigit(static_cast<unsigned char>(*digits))) {
+        error = "invalid size: " + argument;
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(digits, &end, hex ? 16 : 10);
+    if (end == digits || errno == ERANGE) {
+        error = "invalid size: " + argument;
+        return false;
+    }
+    unsigned long long multiplier = 1;
+    const std::string suffix = end;
+    if (suffix == "K" || suffix == "k") {
+        multiplier = 1ull << 10;
+    } else if (suffix == "M" || suffix == "m") {
+        multiplier = 1ull << 20;
+    } else if (suffix == "G" || suffix == "g") {
+        multiplier = 1ull << 30;
+    } else if (!suffix.empty()) {
+        error = "invalid size: " + argument;
+        return false;
+    }
+    if (value > std::numeric_limits<size_t>::max() / multiplier) {
+        error = "size out of range: " + argument;
+        return false;
+    }
+    out = static_cast<size_t>(value * multiplier);
+    return true;
+}
+
+// One x,y,z per line; blank lines and lines starting with # are skipped.
+bool readTargetsFile(const std::string &path, std::vector<Vector3> &targets, std::string &error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(in, line); ++lineNumber) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        Vector3 target;
+        if (!parseVectorArgument(line.substr(first), target, error)) {
+            error = path + ":" + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+        targets.push_back(target);
+    }
+    return true;
+}
+
 bool parseOptions(int argc, char **argv, Options &options, std::string &error) {
     if (argc < 2) {
         error = "not enough arguments";
@@ -60,6 +299,52 @@ bool parseOptions(int argc, char **argv, Options &options, std::string &error) {
                 return false;
             }
             options.processName = argv[++i];
+        } else if (arg == "--from") {
+            if (i + 1 >= argc) {
+                error = "--from requires a path";
+                return false;
+            }
+            options.sourcePath = argv[++i];
+        } else if (arg == "--capture") {
+            if (i + 1 >= argc) {
+                error = "--capture requires a path";
+                return false;
+            }
+            options.capturePath = argv[++i];
+        } else if (arg == "--freeze") {
+            FreezeMethod method{};
+            if (i + 1 >= argc || !parseFreezeMethod(argv[i + 1], method)) {
+                error = "--freeze requires ptrace or signal";
+                return false;
+            }
+            options.freeze = method;
+            ++i;
+        } else if (arg == "--all-instances") {
+            options.allInstances = true;
+        } else if (arg == "--pids") {
+            if (i + 1 >= argc) {
+                error = "--pids requires a list";
+                return false;
+            }
+            std::istringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                char *end = nullptr;
+                const long pid = std::strtol(item.c_str(), &end, 10);
+                if (item.empty() || *end != '\0' || pid <= 0) {
+                    error = "invalid pid in --pids: " + item;
+                    return false;
+                }
+                options.pids.push_back(static_cast<pid_t>(pid));
+            }
+        } else if (arg == "--memory-budget") {
+            if (i + 1 >= argc) {
+                error = "--memory-budget requires a value";
+                return false;
+            }
+            if (!parseSizeArgument(argv[++i], options.memoryBudget, error)) {
+                return false;
+            }
         } else if (arg == "--module") {
             if (i + 1 >= argc) {
                 error = "--module requires a value";
@@ -74,6 +359,8 @@ bool parseOptions(int argc, char **argv, Options &options, std::string &error) {
             if (!parseVectorArgument(argv[++i], options.primary, error)) {
                 return false;
             }
+            options.primaries.push_back(options.primary);
+            options.primary = options.primaries.front();
             options.hasPrimary = true;
         } else if (arg == "--secondary") {
             if (i + 1 >= argc) {
@@ -84,6 +371,32 @@ bool parseOptions(int argc, char **argv, Options &options, std::string &error) {
                 return false;
             }
             options.hasSecondary = true;
+        } else if (arg == "--target") {
+            if (i + 1 >= argc) {
+                error = "--target requires a value";
+                return false;
+            }
+            Vector3 target;
+            if (!parseVectorArgument(argv[++i], target, error)) {
+                return false;
+            }
+            options.targets.push_back(target);
+        } else if (arg == "--targets-file") {
+            if (i + 1 >= argc) {
+                error = "--targets-file requires a path";
+                return false;
+            }
+            if (!readTargetsFile(argv[++i], options.targets, error)) {
+                return false;
+            }
+        } else if (arg == "--signatures") {
+            if (i + 1 >= argc) {
+                error = "--signatures requires a path";
+                return false;
+            }
+            if (!loadSignatureFile(argv[++i], options.signatures, error)) {
+                return false;
+            }
         } else if (arg == "--tolerance") {
             if (i + 1 >= argc) {
                 error = "--tolerance requires a value";
@@ -96,6 +409,260 @@ bool parseOptions(int argc, char **argv, Options &options, std::string &error) {
                 return false;
             }
             options.maxResults = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads") {
+            if (i + 1 >= argc) {
+                error = "--threads requires a value";
+                return false;
+            }
+            options.threads = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--kernel") {
+            if (i + 1 >= argc) {
+                error = "--kernel requires a value";
+                return false;
+            }
+            VectorKernels::KernelKind kernel{};
+            if (!VectorKernels::parseKernelName(argv[++i], kernel)) {
+                error = "unknown kernel: " + std::string(argv[i]);
+                return false;
+            }
+            options.kernel = kernel;
+        } else if (arg == "--type") {
+            if (i + 1 >= argc) {
+                error = "--type requires a value";
+                return false;
+            }
+            if (!VectorKernels::parseValueTypeName(argv[++i], options.valueType)) {
+                error = "unknown value type: " + std::string(argv[i]);
+                return false;
+            }
+        } else if (arg == "--fixed-scale") {
+            if (i + 1 >= argc) {
+                error = "--fixed-scale requires a value";
+                return false;
+            }
+            options.fixedPointScale = std::strtod(argv[++i], nullptr);
+            if (!(options.fixedPointScale > 0.0)) {
+                error = "--fixed-scale must be positive";
+                return false;
+            }
+        } else if (arg == "--all-regions") {
+            options.allRegions = true;
+        } else if (arg == "--data-segments") {
+            options.dataSegments = true;
+        } else if (arg == "--include-perms") {
+            if (i + 1 >= argc) {
+                error = "--include-perms requires a value";
+                return false;
+            }
+            options.regionFilter.requiredPermissions = argv[++i];
+        } else if (arg == "--exclude-perms") {
+            if (i + 1 >= argc) {
+                error = "--exclude-perms requires a value";
+                return false;
+            }
+            options.regionFilter.excludedPermissions = argv[++i];
+        } else if (arg == "--region-kinds") {
+            if (i + 1 >= argc) {
+                error = "--region-kinds requires a value";
+                return false;
+            }
+            if (!ProcessUtils::parseRegionKinds(argv[++i], options.regionFilter.kinds)) {
+                error = "invalid region kinds: " + std::string(argv[i]);
+                return false;
+            }
+        } else if (arg == "--min-region-size") {
+            if (i + 1 >= argc) {
+                error = "--min-region-size requires a value";
+                return false;
+            }
+            if (!parseSizeArgument(argv[++i], options.regionFilter.minSize, error)) {
+                return false;
+            }
+        } else if (arg == "--max-region-size") {
+            if (i + 1 >= argc) {
+                error = "--max-region-size requires a value";
+                return false;
+            }
+            if (!parseSizeArgument(argv[++i], options.regionFilter.maxSize, error)) {
+                return false;
+            }
+        } else if (arg == "--output") {
+            if (i + 1 >= argc) {
+                error = "--output requires a format";
+                return false;
+            }
+            const std::string format = argv[++i];
+            if (format != "text" && format != "json") {
+                error = "unknown output format: " + format;
+                return false;
+            }
+            options.jsonOutput = format == "json";
+        } else if (arg == "--stats-json") {
+            if (i + 1 >= argc) {
+                error = "--stats-json requires a path";
+                return false;
+            }
+            options.statsPath = argv[++i];
+        } else if (arg == "--trace") {
+            if (i + 1 >= argc) {
+                error = "--trace requires a path";
+                return false;
+            }
+            options.tracePath = argv[++i];
+        } else if (arg == "--watch") {
+            options.watch = true;
+        } else if (arg == "--watch-rate") {
+            if (i + 1 >= argc) {
+                error = "--watch-rate requires a value";
+                return false;
+            }
+            options.watchOptions.rate = std::strtod(argv[++i], nullptr);
+            if (!(options.watchOptions.rate > 0.0)) {
+                error = "--watch-rate must be positive";
+                return false;
+            }
+        } else if (arg == "--watch-duration") {
+            if (i + 1 >= argc) {
+                error = "--watch-duration requires a value";
+                return false;
+            }
+            options.watchOptions.duration = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--watch-reference") {
+            if (i + 1 >= argc) {
+                error = "--watch-reference requires an address";
+                return false;
+            }
+            options.watchOptions.reference = static_cast<uintptr_t>(std::strtoull(argv[++i], nullptr, 0));
+        } else if (arg == "--watch-still") {
+            if (i + 1 >= argc) {
+                error = "--watch-still requires a value";
+                return false;
+            }
+            options.watchOptions.stillLimit = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--watch-max") {
+            if (i + 1 >= argc) {
+                error = "--watch-max requires a value";
+                return false;
+            }
+            options.watchMax = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--pointer-scan") {
+            options.pointerScan = true;
+        } else if (arg == "--max-depth") {
+            if (i + 1 >= argc) {
+                error = "--max-depth requires a value";
+                return false;
+            }
+            options.pointerSearch.maxDepth = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "--max-offset") {
+            if (i + 1 >= argc) {
+                error = "--max-offset requires a value";
+                return false;
+            }
+            if (!parseSizeArgument(argv[++i], options.pointerSearch.maxOffset, error)) {
+                return false;
+            }
+        } else if (arg == "--pointer-targets") {
+            if (i + 1 >= argc) {
+                error = "--pointer-targets requires a value";
+                return false;
+            }
+            options.pointerTargets = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-pointer-entries") {
+            if (i + 1 >= argc) {
+                error = "--max-pointer-entries requires a value";
+                return false;
+            }
+            if (!parseSizeArgument(argv[++i], options.maxPointerEntries, error)) {
+                return false;
+            }
+        } else if (arg == "--pointer-map-save") {
+            if (i + 1 >= argc) {
+                error = "--pointer-map-save requires a path";
+                return false;
+            }
+            options.pointerMapPath = argv[++i];
+        } else if (arg == "--intersect-chains") {
+            if (i + 1 >= argc) {
+                error = "--intersect-chains requires a path";
+                return false;
+            }
+            options.intersectPaths.emplace_back(argv[++i]);
+        } else if (arg == "--session") {
+            if (i + 1 >= argc) {
+                error = "--session requires a value";
+                return false;
+            }
+            options.sessionDirectory = argv[++i];
+        } else if (arg == "--snapshot") {
+            options.startSnapshot = true;
+        } else if (arg == "--compare") {
+            if (i + 1 >= argc) {
+                error = "--compare requires a value";
+                return false;
+            }
+            ChangeKind change{};
+            if (!parseChangeKind(argv[++i], change)) {
+                error = "unknown compare mode: " + std::string(argv[i]);
+                return false;
+            }
+            options.compareChange = change;
+        } else if (arg == "--value-kind") {
+            if (i + 1 >= argc) {
+                error = "--value-kind requires a value";
+                return false;
+            }
+            if (!parseSnapshotValueKind(argv[++i], options.valueKind)) {
+                error = "unknown value kind: " + std::string(argv[i]);
+                return false;
+            }
+        } else if (arg == "--delta") {
+            if (i + 1 >= argc) {
+                error = "--delta requires a value";
+                return false;
+            }
+            options.delta = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--max-stride") {
+            if (i + 1 >= argc) {
+                error = "--max-stride requires a value";
+                return false;
+            }
+            if (!parseSizeArgument(argv[++i], options.entityArrays.maxStride, error)) {
+                return false;
+            }
+        } else if (arg == "--max-entities") {
+            if (i + 1 >= argc) {
+                error = "--max-entities requires a value";
+                return false;
+            }
+            options.entityArrays.maxEntries = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--full-rescan") {
+            options.fullRescan = true;
+        } else if (arg == "--elide-zero-pages") {
+            if (options.pageStorage == SnapshotPageStorage::Full) {
+                options.pageStorage = SnapshotPageStorage::ElideZeroPages;
+            }
+        } else if (arg == "--compress-pages") {
+            if (!MemorySnapshot::Writer::compressionAvailable()) {
+                error = "--compress-pages needs zlib, which this build does not have";
+                return false;
+            }
+            options.pageStorage = SnapshotPageStorage::Compressed;
+        } else if (arg == "--bench-kernels") {
+            options.benchKernels = true;
+        } else if (arg == "--daemon") {
+            if (i + 1 >= argc) {
+                error = "--daemon requires a socket path";
+                return false;
+            }
+            options.daemonSocket = argv[++i];
+        } else if (arg == "--connect") {
+            if (i + 1 >= argc) {
+                error = "--connect requires a socket path";
+                return false;
+            }
+            options.connectSocket = argv[++i];
+            options.connectCommands.assign(argv + i + 1, argv + argc);
+            return true;
         } else if (arg == "--help" || arg == "-h") {
             return false;
         } else {
@@ -103,18 +670,135 @@ bool parseOptions(int argc, char **argv, Options &options, std::string &error) {
             return false;
         }
     }
-    if (options.processName.empty()) {
-        error = "missing --process";
+    if (options.benchKernels || !options.intersectPaths.empty()) {
+        return true;
+    }
+    if (!options.daemonSocket.empty()) {
+        if (options.freeze || options.allInstances || !options.pids.empty()) {
+            error = "--freeze, --all-instances and --pids are not supported by the daemon";
+            return false;
+        }
+        if (!options.processName.empty() && options.moduleName.empty() && !options.allRegions) {
+            error = "missing --module or --all-regions";
+            return false;
+        }
+        return true;
+    }
+    if (options.allInstances || !options.pids.empty()) {
+        if (options.allInstances == options.processName.empty() || (options.allInstances && !options.pids.empty())) {
+            error = options.allInstances ? "--all-instances requires --process" : "--pids replaces --process and --all-instances";
+            return false;
+        }
+        if (options.moduleName.empty() || options.allRegions) {
+            error = "several instances are compared by module offset and require --module without --all-regions";
+            return false;
+        }
+        if (!options.sourcePath.empty() || !options.capturePath.empty() || !options.sessionDirectory.empty() ||
+            options.startSnapshot || options.compareChange || options.watch || options.pointerScan || options.hasSecondary ||
+            !options.targets.empty() || options.primaries.size() > 1 || !options.statsPath.empty() || !options.tracePath.empty()) {
+            error = "several instances can only be searched for one --primary or resolved with --signatures";
+            return false;
+        }
+        if (options.hasPrimary == !options.signatures.empty()) {
+            error = options.hasPrimary ? "--primary and --signatures are exclusive" : "missing --primary or --signatures";
+            return false;
+        }
+        return true;
+    }
+    if (options.processName.empty() == options.sourcePath.empty()) {
+        error = options.processName.empty() ? "missing --process or --from" : "--process and --from are exclusive";
         return false;
     }
-    if (options.moduleName.empty()) {
+    if (options.moduleName.empty() && !options.allRegions) {
         error = "missing --module";
         return false;
     }
+    if (options.dataSegments && (options.moduleName.empty() || options.allRegions)) {
+        error = "--data-segments requires --module without --all-regions";
+        return false;
+    }
+    if (!options.sourcePath.empty() && options.watch) {
+        error = "--watch polls a live process and cannot be used with --from";
+        return false;
+    }
+    if (options.freeze) {
+        if (!options.sourcePath.empty()) {
+            error = "--freeze stops a live process; use --process";
+            return false;
+        }
+        // These read the process after the scan, or outside the copied scope.
+        if (options.watch || options.pointerScan || options.hasSecondary) {
+            error = "--freeze scans a copy and cannot be combined with --watch, --pointer-scan or --secondary";
+            return false;
+        }
+    }
+    if (!options.capturePath.empty()) {
+        if (!options.sourcePath.empty()) {
+            error = "--capture reads a live process; use --process";
+            return false;
+        }
+        if (options.hasPrimary || !options.targets.empty() || !options.signatures.empty() || !options.sessionDirectory.empty() ||
+            options.startSnapshot || options.compareChange) {
+            error = "--capture only saves memory; scan the file afterwards with --from";
+            return false;
+        }
+        return true;
+    }
+    if (options.pointerScan && options.moduleName.empty()) {
+        error = "--pointer-scan requires --module for the static base";
+        return false;
+    }
+    if (!options.pointerMapPath.empty() && !options.pointerScan) {
+        error = "--pointer-map-save requires --pointer-scan";
+        return false;
+    }
+    const bool unknownValueStep = options.startSnapshot || options.compareChange.has_value();
+    if (unknownValueStep) {
+        if (options.startSnapshot && options.compareChange) {
+            error = "--snapshot and --compare are exclusive";
+            return false;
+        }
+        if (options.sessionDirectory.empty()) {
+            error = "--snapshot and --compare require --session";
+            return false;
+        }
+        if (options.compareChange == ChangeKind::Moved && !options.delta) {
+            error = "--compare moved requires --delta";
+            return false;
+        }
+        if (options.valueKind == SnapshotValueKind::Vector3 &&
+            (options.compareChange == ChangeKind::Increased || options.compareChange == ChangeKind::Decreased)) {
+            error = "increased/decreased need --value-kind float; use moved for vectors";
+            return false;
+        }
+        return true;
+    }
+    if (!options.signatures.empty()) {
+        if (options.moduleName.empty() || options.allRegions) {
+            error = "--signatures resolves module offsets and requires --module without --all-regions";
+            return false;
+        }
+        if (options.hasPrimary || !options.targets.empty() || options.watch || options.pointerScan || options.dataSegments) {
+            error = "--signatures cannot be combined with --primary, --target, --watch, --pointer-scan or --data-segments";
+            return false;
+        }
+        return true;
+    }
+    if (!options.targets.empty()) {
+        if (options.hasPrimary || options.hasSecondary || options.watch || options.pointerScan) {
+            error = "--target cannot be combined with --primary, --secondary, --watch or --pointer-scan";
+            return false;
+        }
+        return true;
+    }
     if (!options.hasPrimary) {
         error = "missing --primary";
         return false;
     }
+    if (options.primaries.size() > 1 && (options.hasSecondary || options.watch || options.pointerScan)) {
+        error = "several --primary values search for entity arrays; --secondary, --watch and --pointer-scan take one";
+        return false;
+    }
     return true;
 }
 
@@ -124,78 +808,1118 @@ std::string formatAddress(uintptr_t address) {
     return oss.str();
 }
 
-void printCandidate(const CandidateOffset &candidate) {
-    std::cout << "  address: " << formatAddress(candidate.address)
-              << " | module offset: 0x" << std::hex << candidate.offsetFromModule
-              << std::dec << " | value: " << candidate.value.toString(5)
-              << std::endl;
+// Appends " | section: .bss + 0x10" when the module headers place the address.
+void printSectionOffset(uintptr_t address, const ElfModule *elf) {
+    if (elf == nullptr) {
+        return;
+    }
+    if (const auto location = elf->locate(address)) {
+        std::cout << " | section: " << location->name << " + 0x" << std::hex << location->offset << std::dec;
+    }
 }
 
-} // namespace
+void printCandidate(const CandidateOffset &candidate, const std::vector<MemoryRegion> &regions, bool regionRelative,
+                    const ElfModule *elf) {
+    std::cout << "  address: " << formatAddress(candidate.address);
+    if (regionRelative) {
+        const MemoryRegion *region = ProcessUtils::findRegionContaining(regions, candidate.address);
+        std::cout << " | region offset: " << formatAddress(candidate.regionStart) << " + 0x" << std::hex
+                  << candidate.offsetFromRegion() << std::dec;
+        if (region != nullptr) {
+            std::cout << " (" << ProcessUtils::regionKindName(region->kind());
+            if (!region->pathname.empty()) {
+                std::cout << " " << region->pathname;
+            }
+            std::cout << ")";
+        }
+    } else {
+        std::cout << " | module offset: 0x" << std::hex << candidate.offsetFromModule << std::dec;
+        printSectionOffset(candidate.address, elf);
+    }
+    std::cout << " | value: " << candidate.value.toString(5) << std::endl;
+}
 
-int main(int argc, char **argv) {
-    Options options;
+int runUnknownValueStep(const Options &options, const OffsetScanner &scanner, const ElfModule *elf, ScanReport &report) {
+    const std::string snapshotPath = options.sessionDirectory + "/snapshot.bin";
+    const std::string nextSnapshotPath = options.sessionDirectory + "/snapshot.next";
+    const std::string candidatesPath = options.sessionDirectory + "/candidates.bin";
+    const std::string softDirtyPath = options.sessionDirectory + "/soft-dirty";
     std::string error;
-    if (!parseOptions(argc, argv, options, error)) {
-        if (!error.empty()) {
-            std::cerr << "Error: " << error << "\n";
+    std::error_code ignored;
+    std::filesystem::create_directories(options.sessionDirectory, ignored);
+
+    // The marker records that the soft-dirty bits of pid were cleared right before
+    // the current snapshot was read, so clean pages still hold the snapshot's
+    // contents. It is removed before clearing again and rewritten only when the
+    // step completes, so a failed step never leaves a stale claim behind.
+    const pid_t pid = scanner.reader().pid();
+    bool softDirtyArmed = false;
+    {
+        std::ifstream marker(softDirtyPath);
+        pid_t markedPid = 0;
+        softDirtyArmed = marker >> markedPid && markedPid == pid;
+    }
+    std::filesystem::remove(softDirtyPath, ignored);
+    // Offline sources have no pid and no page table to track.
+    const bool trackDirty = pid != 0 && !options.fullRescan && PageMap::softDirtySupported();
+    std::optional<PageStates> pages;
+    bool cleared = false;
+    if (trackDirty) {
+        // A page written between capturing the bits and clearing them would read as
+        // clean now and be cleared for the next step, so its write would never be
+        // seen. The target is held stopped across both; if it cannot be stopped this
+        // step compares in full and only clears.
+        ProcessFreezer freezer(pid, FreezeMethod::Ptrace);
+        if (softDirtyArmed && !options.startSnapshot) {
+            std::string stopError;
+            if (freezer.stop(stopError)) {
+                pages = PageStates::capture(pid, scanner.snapshotRegions(), error);
+            } else {
+                std::cerr << "Warning: " << stopError << "; using full reads\n";
+            }
         }
-        printUsage(argv[0]);
+        cleared = PageMap::clearSoftDirty(pid, error);
+        freezer.resume();
+        if (!cleared) {
+            std::cerr << "Warning: " << error << "; using full reads\n";
+            pages.reset();
+        }
+    }
+    if (pages) {
+        std::cout << "Incremental compare: " << pages->dirtyPages() << " of " << pages->pageCount()
+                  << " pages written since the last step, " << pages->zeroPages() << " not resident" << std::endl;
+    } else if (!options.startSnapshot) {
+        std::cout << "Full compare: "
+                  << (options.fullRescan ? "--full-rescan given"
+                      : pid == 0                       ? "the memory comes from a capture"
+                      : !PageMap::softDirtySupported() ? "soft-dirty tracking is not available"
+                                                        : "the previous step did not track dirty pages")
+                  << std::endl;
+    }
+
+    auto writer = MemorySnapshot::Writer::create(nextSnapshotPath, scanner.snapshotRegions(), options.pageStorage, error);
+    if (!writer) {
+        std::cerr << "Error: " << error << "\n";
         return EXIT_FAILURE;
     }
 
-    auto processInfo = ProcessUtils::findProcessByName(options.processName);
-    if (!processInfo) {
-        std::cerr << "Process '" << options.processName << "' not found.\n";
+    std::optional<CandidateSet> candidates;
+    if (options.startSnapshot) {
+        scanner.captureSnapshot(*writer);
+        std::filesystem::remove(candidatesPath, ignored);
+    } else {
+        auto previous = MemorySnapshot::open(snapshotPath, error);
+        if (!previous) {
+            std::cerr << "Error: " << error << " (start the session with --snapshot)\n";
+            return EXIT_FAILURE;
+        }
+        std::optional<CandidateSet> survivors;
+        if (std::filesystem::exists(candidatesPath)) {
+            survivors = CandidateSet::load(candidatesPath, error);
+            if (!survivors) {
+                std::cerr << "Error: " << error << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        SnapshotComparison comparison;
+        comparison.kind = options.valueKind;
+        comparison.change = *options.compareChange;
+        comparison.tolerance = options.tolerance;
+        comparison.hasDelta = options.delta.has_value();
+        comparison.delta = options.delta.value_or(0.0f);
+        candidates = scanner.compareWithSnapshot(*previous, survivors ? &*survivors : nullptr, comparison, writer.get(),
+                                                 pages ? &*pages : nullptr);
+    }
+
+    if (!writer->finish(error)) {
+        std::cerr << "Error: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    writer.reset();
+    std::filesystem::rename(nextSnapshotPath, snapshotPath, ignored);
+    if (ignored) {
+        std::cerr << "Error: cannot replace " << snapshotPath << ": " << ignored.message() << "\n";
         return EXIT_FAILURE;
     }
+    if (cleared) {
+        std::ofstream(softDirtyPath) << pid << "\n";
+    }
+    auto snapshot = MemorySnapshot::open(snapshotPath, error);
+    if (snapshot) {
+        std::cout << "Snapshot: " << (snapshot->capturedBytes() >> 20) << " MiB captured, "
+                  << (snapshot->fileBytes() >> 20) << " MiB on disk" << std::endl;
+    }
 
-    const auto moduleRegions = ProcessUtils::findModuleRegions(processInfo->pid, options.moduleName);
-    if (moduleRegions.empty()) {
-        std::cerr << "Module '" << options.moduleName << "' not found in process.\n";
+    if (!candidates) {
+        std::cout << "Session started; every slot is a candidate. Change the value in-game and run --compare." << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (!candidates->save(candidatesPath, error)) {
+        std::cerr << "Error: " << error << "\n";
         return EXIT_FAILURE;
     }
+    std::cout << "Remaining candidates: " << candidates->size() << " ("
+              << (candidates->memoryUsage() + 1023) / 1024 << " KiB)" << std::endl;
+    report.candidateCount = candidates->size();
+    report.candidates = scanner.candidatesFromSet(*candidates, options.maxResults, options.valueKind);
+    for (const auto &candidate : report.candidates) {
+        std::cout << "  address: " << formatAddress(candidate.address) << " | module offset: 0x" << std::hex
+                  << candidate.offsetFromModule << std::dec;
+        printSectionOffset(candidate.address, elf);
+        std::cout << " | value: ";
+        if (options.valueKind == SnapshotValueKind::Float) {
+            std::cout << candidate.value.x;
+        } else {
+            std::cout << candidate.value.toString(5);
+        }
+        std::cout << std::endl;
+    }
+    return candidates->empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void runPointerScan(const Options &options, const OffsetScanner &scanner, const std::vector<CandidateOffset> &candidates) {
+    // The scope may be a subset of the module; chains start from all of it, and
+    // offsets count from its first mapping whatever the region filters kept.
+    std::vector<MemoryRegion> staticRegions = ProcessUtils::findModuleRegions(scanner.reader(), options.moduleName);
+    if (staticRegions.empty()) {
+        std::cout << "Module '" << options.moduleName << "' not found; skipping pointer scan." << std::endl;
+        return;
+    }
+    const uintptr_t moduleBase = staticRegions.front().start;
+
+    std::cout << "Building pointer map..." << std::endl;
+    const auto started = std::chrono::steady_clock::now();
+    const std::vector<MemoryRegion> regions = ProcessUtils::listMemoryRegions(scanner.reader());
+    const PointerMap map = PointerMap::build(scanner.reader(), regions, scanner.threadPool(), options.maxPointerEntries);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    std::cout << "Pointer map: " << map.size() << " pointers (" << (map.size() * sizeof(PointerPair) >> 20)
+              << " MiB) in " << std::fixed << std::setprecision(2) << elapsed.count() << "s" << std::defaultfloat
+              << (map.truncated() ? ", truncated at --max-pointer-entries" : "") << std::endl;
+
+    const size_t targetCount = std::min(options.pointerTargets, candidates.size());
+    if (!options.pointerMapPath.empty()) {
+        std::vector<uintptr_t> targets;
+        for (size_t i = 0; i < targetCount; ++i) {
+            targets.push_back(candidates[i].address);
+        }
+        std::string error;
+        if (PointerMapFile::save(options.pointerMapPath, map, regions, options.moduleName, staticRegions, targets, error)) {
+            std::cout << "Saved pointer map with " << targets.size() << " targets to " << options.pointerMapPath << std::endl;
+        } else {
+            std::cerr << "Error: " << error << "\n";
+        }
+    }
 
-    ProcessMemoryReader reader(processInfo->pid);
-    if (!reader.isValid()) {
-        std::cerr << "Failed to open target process memory. Root privileges may be required.\n";
+    PointerScanner pointerScanner(map.view(), std::move(staticRegions), moduleBase, scanner.threadPool());
+    for (size_t i = 0; i < targetCount; ++i) {
+        const auto chains = pointerScanner.findChains(candidates[i].address, options.pointerSearch);
+        std::cout << "Pointer chains to " << formatAddress(candidates[i].address) << ": " << chains.size()
+                  << (pointerScanner.lastSearchTruncated() ? " (search truncated)" : "") << std::endl;
+        for (const auto &chain : chains) {
+            std::cout << "  " << formatPointerChain(chain, options.moduleName) << std::endl;
+        }
+    }
+}
+
+std::string formatMicroseconds(uint64_t nanoseconds) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << static_cast<double>(nanoseconds) / 1000.0 << " us";
+    return oss.str();
+}
+
+// Watches the candidates and returns the ones still in the running, most active first.
+std::vector<CandidateOffset> runWatch(const Options &options, const OffsetScanner &scanner, const std::vector<CandidateOffset> &candidates) {
+    WatchOptions watchOptions = options.watchOptions;
+    watchOptions.tolerance = options.tolerance;
+    watchOptions.valueType = scanner.valueType();
+    watchOptions.fixedPointScale = scanner.fixedPointScale();
+    CandidateWatcher watcher(scanner.reader(), candidates, watchOptions);
+    std::cout << "Watching " << candidates.size() << " candidates at " << watchOptions.rate << " Hz";
+    if (watchOptions.duration > 0.0) {
+        std::cout << " for " << watchOptions.duration << "s";
+    }
+    std::cout << " (Ctrl-C stops)..." << std::endl;
+
+    watchStopRequested.store(false);
+    const auto previousHandler = std::signal(SIGINT, requestWatchStop);
+    watcher.run(&watchStopRequested, [](const WatchProgress &progress) {
+        std::cout << "  " << std::fixed << std::setprecision(1) << progress.elapsed << "s: " << progress.polls << " polls, "
+                  << progress.remaining << " candidates, p99 " << formatMicroseconds(progress.latency->percentile(0.99))
+                  << (progress.missedDeadlines > 0 ? ", " + std::to_string(progress.missedDeadlines) + " missed ticks" : "")
+                  << std::defaultfloat << std::endl;
+    });
+    std::signal(SIGINT, previousHandler);
+
+    const LatencyHistogram &latency = watcher.latency();
+    std::cout << "Watch finished after " << watcher.polls() << " polls (" << watcher.missedDeadlines() << " missed ticks)." << std::endl;
+    std::cout << "Poll latency: p50 " << formatMicroseconds(latency.percentile(0.50)) << ", p90 "
+              << formatMicroseconds(latency.percentile(0.90)) << ", p99 " << formatMicroseconds(latency.percentile(0.99))
+              << ", max " << formatMicroseconds(latency.max()) << std::endl;
+    if (watchOptions.reference) {
+        std::cout << "Reference moved in " << watcher.referenceMoves() << " polls; dropped " << watcher.pruned()
+                  << " candidates." << std::endl;
+    } else if (watcher.pruned() > 0) {
+        std::cout << "Dropped " << watcher.pruned() << " unreadable candidates." << std::endl;
+    }
+
+    std::vector<WatchedCandidate> survivors = watcher.candidates();
+    std::stable_sort(survivors.begin(), survivors.end(),
+                     [](const WatchedCandidate &lhs, const WatchedCandidate &rhs) { return lhs.moves > rhs.moves; });
+    std::vector<CandidateOffset> remaining;
+    std::cout << "Watched candidates:" << std::endl;
+    for (const auto &survivor : survivors) {
+        const auto original = std::find_if(candidates.begin(), candidates.end(),
+                                           [&](const CandidateOffset &candidate) { return candidate.address == survivor.address; });
+        CandidateOffset candidate = *original;
+        candidate.value = survivor.value;
+        remaining.push_back(candidate);
+        std::cout << "  address: " << formatAddress(survivor.address) << " | moved in " << survivor.moves
+                  << " polls | distance: " << std::fixed << std::setprecision(3) << survivor.distance << std::defaultfloat
+                  << " | value: " << survivor.value.toString(5) << std::endl;
+    }
+    return remaining;
+}
+
+void printRegionOffset(uintptr_t address, const std::vector<MemoryRegion> &regions) {
+    const MemoryRegion *region = ProcessUtils::findRegionContaining(regions, address);
+    if (region == nullptr) {
+        return;
+    }
+    std::cout << " | region offset: " << formatAddress(region->start) << " + 0x" << std::hex << address - region->start
+              << std::dec << " (" << ProcessUtils::regionKindName(region->kind());
+    if (!region->pathname.empty()) {
+        std::cout << " " << region->pathname;
+    }
+    std::cout << ")";
+}
+
+int runEntityArrayScan(const Options &options, const OffsetScanner &scanner, const ElfModule *elf, ScanReport &report) {
+    std::cout << "Searching for an entity array holding " << options.primaries.size() << " positions with tolerance "
+              << options.tolerance << " as " << VectorKernels::valueTypeName(scanner.valueType()) << ", stride up to 0x"
+              << std::hex << options.entityArrays.maxStride << std::dec << std::endl;
+    report.entityArrays = findEntityArrays(scanner, options.primaries, options.tolerance, options.entityArrays);
+    if (report.entityArrays.empty()) {
+        std::cout << "No array holds every sample at a common stride." << std::endl;
         return EXIT_FAILURE;
     }
+    std::cout << "Found " << report.entityArrays.size() << " entity array(s):" << std::endl;
+    for (const auto &array : report.entityArrays) {
+        std::cout << "  base: " << formatAddress(array.base);
+        if (options.allRegions) {
+            printRegionOffset(array.base, scanner.moduleRegions());
+        } else {
+            std::cout << " | module offset: 0x" << std::hex << array.base - scanner.moduleBase() << std::dec;
+            printSectionOffset(array.base, elf);
+        }
+        std::cout << " | stride: 0x" << std::hex << array.stride << std::dec << " | entries: " << array.count()
+                  << " | samples at entries";
+        for (const size_t entry : array.sampleEntries) {
+            std::cout << " " << entry;
+        }
+        std::cout << std::endl;
+        const size_t shown = std::min(array.count(), options.maxResults);
+        for (size_t i = 0; i < shown; ++i) {
+            std::cout << "    [" << i << "] " << formatAddress(array.base + i * array.stride) << " "
+                      << array.values[i].toString(5) << std::endl;
+        }
+        if (shown < array.count()) {
+            std::cout << "    ... " << array.count() - shown << " more" << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
 
-    OffsetScanner scanner(processInfo->pid, moduleRegions, std::move(reader));
+int runMultiTargetScan(const Options &options, const OffsetScanner &scanner, const ElfModule *elf, ScanReport &report) {
+    std::cout << "Searching for " << options.targets.size() << " position(s) in one pass with tolerance " << options.tolerance
+              << " as " << VectorKernels::valueTypeName(scanner.valueType()) << " using " << scanner.threadCount()
+              << " thread(s) and "
+              << (options.targets.size() > VectorKernels::MultiMatcher::maxBroadcastTargets ? "a target grid" : "broadcast compares")
+              << std::endl;
+    const auto hits = scanner.findTargetHits(options.targets, options.tolerance);
+    report.candidateCount = hits.size();
+    report.targets.resize(options.targets.size());
+    for (size_t i = 0; i < options.targets.size(); ++i) {
+        report.targets[i].position = options.targets[i];
+    }
+    for (const auto &hit : hits) {
+        TargetReport &target = report.targets[hit.target];
+        ++target.hitCount;
+        if (target.candidates.size() < options.maxResults) {
+            const MemoryRegion *region = ProcessUtils::findRegionContaining(scanner.moduleRegions(), hit.address);
+            target.candidates.push_back({hit.address, static_cast<ptrdiff_t>(hit.address - scanner.moduleBase()), hit.value,
+                                         region != nullptr ? region->start : 0});
+        }
+    }
+    size_t found = 0;
+    for (size_t i = 0; i < report.targets.size(); ++i) {
+        const TargetReport &target = report.targets[i];
+        if (target.hitCount == 0) {
+            continue;
+        }
+        ++found;
+        std::cout << "Target " << i << " " << target.position.toString(5) << ": " << target.hitCount << " hit(s)" << std::endl;
+        for (const auto &candidate : target.candidates) {
+            printCandidate(candidate, scanner.moduleRegions(), options.allRegions, elf);
+        }
+    }
+    std::cout << found << " of " << options.targets.size() << " target(s) found, " << hits.size() << " hit(s) in total." << std::endl;
+    return found != 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-    std::cout << "Scanning process '" << processInfo->name << "' (pid " << processInfo->pid << ")\n";
-    std::cout << "Module regions:" << std::endl;
-    for (const auto &region : moduleRegions) {
-        std::cout << "  " << ProcessUtils::describeMemoryRegion(region) << std::endl;
+int runSignatureScan(const Options &options, const OffsetScanner &scanner, const ElfModule *elf, ScanReport &report) {
+    const SignatureMatcher matcher(options.signatures, scanner.kernel());
+    size_t totalBytes = 0;
+    for (const auto &region : scanner.moduleRegions()) {
+        totalBytes += region.size();
     }
+    std::cout << "Resolving " << matcher.signatures().size() << " signature(s) over " << (totalBytes >> 10) << " KiB with "
+              << matcher.stateCount() << " automaton states and the " << VectorKernels::kernelName(matcher.kernel())
+              << " prefilter" << std::endl;
+    const auto start = std::chrono::steady_clock::now();
+    report.signatures = findSignatures(scanner, matcher);
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    size_t unique = 0;
+    for (const auto &result : report.signatures) {
+        const Signature &signature = matcher.signatures()[result.signature];
+        std::cout << "  " << signature.name << ": ";
+        if (result.matches.empty()) {
+            std::cout << "not found" << std::endl;
+            continue;
+        }
+        unique += result.matches.size() == 1 ? 1 : 0;
+        if (!result.value) {
+            std::cout << "operand at " << formatAddress(result.matches.front() + signature.operandOffset) << " unreadable";
+        } else if (signature.yieldsAddress()) {
+            std::cout << formatAddress(*result.value) << " | module offset: 0x" << std::hex << *result.value - scanner.moduleBase()
+                      << std::dec;
+            printSectionOffset(static_cast<uintptr_t>(*result.value), elf);
+        } else {
+            std::cout << "value " << static_cast<int64_t>(*result.value) << " (" << formatAddress(*result.value) << ")";
+        }
+        std::cout << " | match: " << formatAddress(result.matches.front());
+        if (result.matches.size() > 1) {
+            std::cout << " (ambiguous, " << result.matches.size() << " matches)";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << unique << " of " << report.signatures.size() << " signature(s) resolved to a unique match in " << std::fixed
+              << std::setprecision(2) << milliseconds << std::defaultfloat << " ms." << std::endl;
+    return unique == report.signatures.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
+int runPositionScan(const Options &options, const OffsetScanner &scanner, const std::vector<MemoryRegion> &moduleRegions,
+                    const ElfModule *elf, ScanReport &report) {
+    if (!options.signatures.empty()) {
+        return runSignatureScan(options, scanner, elf, report);
+    }
+    if (!options.targets.empty()) {
+        return runMultiTargetScan(options, scanner, elf, report);
+    }
+    if (options.primaries.size() > 1) {
+        return runEntityArrayScan(options, scanner, elf, report);
+    }
     std::cout << "Searching for primary position " << options.primary.toString(5)
-              << " with tolerance " << options.tolerance << std::endl;
-    auto candidates = scanner.findCandidates(options.primary, options.tolerance, options.maxResults);
-    if (candidates.empty()) {
-        std::cout << "No matching candidates found in module." << std::endl;
+              << " with tolerance " << options.tolerance
+              << " as " << VectorKernels::valueTypeName(scanner.valueType())
+              << " using " << scanner.threadCount() << " thread(s) and the "
+              << VectorKernels::kernelName(scanner.kernel()) << " kernel" << std::endl;
+    auto candidateSet = scanner.findCandidateSet(options.primary, options.tolerance);
+    if (candidateSet.empty()) {
+        std::cout << "No matching candidates found in " << (options.allRegions ? "process." : "module.") << std::endl;
         return EXIT_FAILURE;
     }
 
-    std::cout << "Found " << candidates.size() << " candidate addresses." << std::endl;
+    std::cout << "Found " << candidateSet.size() << " candidate addresses ("
+              << (candidateSet.memoryUsage() + 1023) / 1024 << " KiB)." << std::endl;
     if (options.hasSecondary) {
         std::cout << "Validating using secondary sample " << options.secondary.toString(5) << std::endl;
-        candidates = scanner.verifyCandidates(candidates, options.secondary, options.tolerance);
-        if (candidates.empty()) {
+        candidateSet = scanner.verifyCandidateSet(candidateSet, options.secondary, options.tolerance);
+        if (candidateSet.empty()) {
             std::cout << "No candidates survived the secondary validation." << std::endl;
             return EXIT_FAILURE;
         }
-        std::cout << "Remaining candidates after validation: " << candidates.size() << std::endl;
+        std::cout << "Remaining candidates after validation: " << candidateSet.size() << std::endl;
     } else {
         std::cout << "Provide --secondary to validate results after moving in-game." << std::endl;
     }
 
-    std::cout << "Candidate offsets:" << std::endl;
+    const auto candidates = scanner.candidatesFromSet(candidateSet, options.maxResults);
+    report.candidateCount = candidateSet.size();
+    report.candidates = candidates;
+    if (candidates.size() < candidateSet.size()) {
+        std::cout << "Candidate offsets (first " << candidates.size() << "):" << std::endl;
+    } else {
+        std::cout << "Candidate offsets:" << std::endl;
+    }
     for (const auto &candidate : candidates) {
-        printCandidate(candidate);
+        printCandidate(candidate, moduleRegions, options.allRegions, elf);
+    }
+
+    if (options.allRegions) {
+        std::cout << "Region offsets are relative to the start of the mapping that holds the vector." << std::endl;
+    } else {
+        std::cout << "Use the module offset to access the position vector relative to the module base." << std::endl;
+    }
+    if (options.watch) {
+        std::vector<CandidateOffset> watched = scanner.candidatesFromSet(candidateSet, options.watchMax);
+        watched = runWatch(options, scanner, watched);
+        report.candidateCount = watched.size();
+        report.candidates = watched;
+        if (options.pointerScan) {
+            runPointerScan(options, scanner, watched);
+        }
+        return EXIT_SUCCESS;
+    }
+    if (options.pointerScan) {
+        runPointerScan(options, scanner, candidates);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Every output writes a module offset the same way: "module_offset" as a signed
+// integer and "module_offset_hex" as the same value in signed hex.
+void writeModuleOffsetJson(JsonWriter &json, int64_t offset) {
+    std::ostringstream hex;
+    hex << (offset < 0 ? "-0x" : "0x") << std::hex
+        << (offset < 0 ? uint64_t{0} - static_cast<uint64_t>(offset) : static_cast<uint64_t>(offset));
+    json.key("module_offset").value(offset);
+    json.key("module_offset_hex").value(hex.str());
+}
+
+// Adds "section" and "section_offset" when the module headers place the address.
+void writeSectionJson(JsonWriter &json, uintptr_t address, const ElfModule *elf) {
+    if (elf == nullptr) {
+        return;
+    }
+    if (const auto location = elf->locate(address)) {
+        json.key("section").value(location->name);
+        json.key("section_offset").value(location->offset);
+    }
+}
+
+void writeEntityArrayJson(JsonWriter &json, const EntityArray &array, const OffsetScanner &scanner, const ElfModule *elf) {
+    json.beginObject();
+    json.key("base").address(array.base);
+    writeModuleOffsetJson(json, static_cast<int64_t>(array.base - scanner.moduleBase()));
+    writeSectionJson(json, array.base, elf);
+    const MemoryRegion *region = ProcessUtils::findRegionContaining(scanner.moduleRegions(), array.base);
+    if (region != nullptr) {
+        json.key("region_start").address(region->start);
+        json.key("region_offset").value(static_cast<uint64_t>(array.base - region->start));
+    }
+    json.key("stride").value(array.stride);
+    json.key("count").value(array.count());
+    json.key("sample_entries").beginArray();
+    for (const size_t entry : array.sampleEntries) {
+        json.value(entry);
+    }
+    json.endArray();
+    json.endObject();
+}
+
+void writeCandidateJson(JsonWriter &json, const CandidateOffset &candidate, const std::vector<MemoryRegion> &regions,
+                        const ElfModule *elf) {
+    json.beginObject();
+    json.key("address").address(candidate.address);
+    writeModuleOffsetJson(json, static_cast<int64_t>(candidate.offsetFromModule));
+    writeSectionJson(json, candidate.address, elf);
+    const MemoryRegion *region = ProcessUtils::findRegionContaining(regions, candidate.address);
+    if (region != nullptr) {
+        json.key("region_start").address(region->start);
+        json.key("region_offset").value(static_cast<uint64_t>(candidate.address - region->start));
+        json.key("region_kind").value(ProcessUtils::regionKindName(region->kind()));
+        json.key("region_path").value(region->pathname);
+    }
+    json.key("value").beginArray().value(candidate.value.x).value(candidate.value.y).value(candidate.value.z).endArray();
+    json.endObject();
+}
+
+void writeSignatureJson(JsonWriter &json, const Signature &signature, const SignatureResult &result, uintptr_t moduleBase,
+                        const ElfModule *elf) {
+    json.beginObject();
+    json.key("name").value(signature.name);
+    json.key("matches").beginArray();
+    for (const uintptr_t match : result.matches) {
+        json.address(match);
+    }
+    json.endArray();
+    if (result.value && signature.yieldsAddress()) {
+        json.key("address").address(*result.value);
+        writeModuleOffsetJson(json, static_cast<int64_t>(*result.value - moduleBase));
+        writeSectionJson(json, static_cast<uintptr_t>(*result.value), elf);
+    } else if (result.value) {
+        json.key("value").value(static_cast<int64_t>(*result.value));
+    }
+    json.endObject();
+}
+
+void writeFreezeJson(JsonWriter &json, const FreezeTiming &freeze) {
+    json.key("freeze").beginObject();
+    json.key("method").value(freezeMethodName(freeze.method));
+    json.key("threads").value(freeze.threads);
+    json.key("bytes").value(freeze.bytes);
+    json.key("unreadable_bytes").value(freeze.unreadableBytes);
+    json.key("zero_bytes").value(freeze.zeroBytes);
+    json.key("prepare_ms").value(freeze.prepareMilliseconds);
+    json.key("stop_ms").value(freeze.stopMilliseconds);
+    json.key("copy_ms").value(freeze.copyMilliseconds);
+    json.key("pause_ms").value(freeze.pauseMilliseconds);
+    json.endObject();
+}
+
+bool writeReports(const Options &options, const ProcessInfo &process, const OffsetScanner &scanner, const ElfModule *elf,
+                  const ScanStats &stats, const ScanReport &report, std::ostream &jsonOut) {
+    std::string error;
+    if (!options.tracePath.empty() && !stats.writeTrace(options.tracePath, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return false;
+    }
+    if (!options.statsPath.empty()) {
+        std::ofstream out(options.statsPath, std::ios::trunc);
+        JsonWriter json(out);
+        json.beginObject();
+        json.key("phases");
+        stats.writeJson(json);
+        json.endObject();
+        if (!out) {
+            std::cerr << "Error: cannot write " << options.statsPath << "\n";
+            return false;
+        }
+    }
+    if (options.jsonOutput) {
+        JsonWriter json(jsonOut);
+        json.beginObject();
+        json.key("process").beginObject().key("name").value(process.name).key("pid").value(process.pid).endObject();
+        json.key("source").value(scanner.reader().describe());
+        json.key("scope").value(options.allRegions ? "all-regions" : options.dataSegments ? "data-segments" : "module");
+        json.key("module").value(options.moduleName);
+        json.key("module_base").address(scanner.moduleBase());
+        json.key("threads").value(scanner.threadCount());
+        json.key("kernel").value(VectorKernels::kernelName(scanner.kernel()));
+        json.key("value_type").value(VectorKernels::valueTypeName(scanner.valueType()));
+        if (report.freeze) {
+            writeFreezeJson(json, *report.freeze);
+        }
+        json.key("candidate_count").value(report.candidateCount);
+        json.key("candidates").beginArray();
+        for (const auto &candidate : report.candidates) {
+            writeCandidateJson(json, candidate, scanner.moduleRegions(), elf);
+        }
+        json.endArray();
+        if (!report.targets.empty()) {
+            json.key("targets").beginArray();
+            for (const auto &target : report.targets) {
+                json.beginObject();
+                json.key("position").beginArray().value(target.position.x).value(target.position.y).value(target.position.z).endArray();
+                json.key("hit_count").value(target.hitCount);
+                json.key("candidates").beginArray();
+                for (const auto &candidate : target.candidates) {
+                    writeCandidateJson(json, candidate, scanner.moduleRegions(), elf);
+                }
+                json.endArray();
+                json.endObject();
+            }
+            json.endArray();
+        }
+        if (!report.signatures.empty()) {
+            json.key("signatures").beginArray();
+            for (const auto &result : report.signatures) {
+                writeSignatureJson(json, options.signatures[result.signature], result, scanner.moduleBase(), elf);
+            }
+            json.endArray();
+        }
+        if (!report.entityArrays.empty()) {
+            json.key("entity_arrays").beginArray();
+            for (const auto &array : report.entityArrays) {
+                writeEntityArrayJson(json, array, scanner, elf);
+            }
+            json.endArray();
+        }
+        json.key("phases");
+        stats.writeJson(json);
+        json.endObject();
+        jsonOut.flush();
+    }
+    return true;
+}
+
+void printInstance(const InstanceResult &result, bool signatures) {
+    std::cout << "  pid " << result.process.pid << " (" << result.process.name << "): ";
+    if (!result.succeeded()) {
+        std::cout << "error: " << result.error << std::endl;
+        return;
+    }
+    if (signatures) {
+        const size_t unique = static_cast<size_t>(std::count_if(result.signatures.begin(), result.signatures.end(),
+                                                                [](const SignatureResult &found) { return found.matches.size() == 1; }));
+        std::cout << unique << " of " << result.signatures.size() << " signature(s) unique";
+    } else {
+        std::cout << result.candidateCount << " candidate(s)";
+    }
+    std::cout << std::fixed << std::setprecision(2) << " | " << (result.scopeBytes >> 10) << " KiB in " << result.milliseconds << " ms";
+    if (result.freeze) {
+        std::cout << " | paused " << result.freeze->pauseMilliseconds << " ms";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+void writeInstanceJson(JsonWriter &json, const InstanceResult &result, const Options &options) {
+    json.beginObject();
+    json.key("pid").value(result.process.pid);
+    json.key("name").value(result.process.name);
+    if (!result.succeeded()) {
+        json.key("error").value(result.error);
+        json.endObject();
+        return;
     }
+    json.key("module_base").address(result.moduleBase);
+    json.key("scope_bytes").value(result.scopeBytes);
+    json.key("milliseconds").value(result.milliseconds);
+    if (options.signatures.empty()) {
+        json.key("candidate_count").value(result.candidateCount);
+        json.key("candidates").beginArray();
+        for (size_t i = 0; i < result.candidates.size() && i < options.maxResults; ++i) {
+            writeCandidateJson(json, result.candidates[i], {}, nullptr);
+        }
+        json.endArray();
+    } else {
+        json.key("signatures").beginArray();
+        for (const auto &found : result.signatures) {
+            writeSignatureJson(json, options.signatures[found.signature], found, result.moduleBase, nullptr);
+        }
+        json.endArray();
+    }
+    if (result.freeze) {
+        writeFreezeJson(json, *result.freeze);
+    }
+    json.endObject();
+}
+
+// Scans every selected instance on one shared pool, printing each as it finishes,
+// then reports the module offsets all of them agree on.
+int runInstanceScan(const Options &options, std::ostream &jsonOut) {
+    std::vector<ProcessInfo> processes;
+    if (options.allInstances) {
+        processes = ProcessUtils::findProcessesByName(options.processName);
+        if (processes.empty()) {
+            std::cerr << "Process '" << options.processName << "' not found.\n";
+            return EXIT_FAILURE;
+        }
+    } else {
+        const auto running = ProcessUtils::listProcesses();
+        for (const pid_t pid : options.pids) {
+            auto it = std::find_if(running.begin(), running.end(), [pid](const ProcessInfo &info) { return info.pid == pid; });
+            if (it == running.end()) {
+                std::cerr << "Process " << pid << " not found.\n";
+                return EXIT_FAILURE;
+            }
+            processes.push_back(*it);
+        }
+    }
+
+    InstanceScanSettings settings;
+    settings.moduleName = options.moduleName;
+    settings.dataSegments = options.dataSegments;
+    settings.regionFilter = options.regionFilter;
+    settings.signatures = options.signatures;
+    settings.primary = options.primary;
+    settings.tolerance = options.tolerance;
+    settings.valueType = options.valueType;
+    settings.fixedPointScale = options.fixedPointScale;
+    settings.freeze = options.freeze;
+    settings.memoryBudget = options.memoryBudget;
+    if (options.kernel) {
+        if (!VectorKernels::isSupported(*options.kernel)) {
+            std::cerr << "Kernel '" << VectorKernels::kernelName(*options.kernel)
+                      << "' is not supported by this CPU, using scalar.\n";
+        }
+        settings.kernel = *options.kernel;
+    }
+    const size_t threads = options.threads == 0 ? ThreadPool::defaultThreadCount() : options.threads;
+    const auto pool = threads > 1 ? std::make_shared<ThreadPool>(threads) : nullptr;
+    const bool signatures = !options.signatures.empty();
+
+    std::cout << "Scanning module '" << options.moduleName << "' in " << processes.size() << " instance(s) on " << threads
+              << " thread(s)";
+    if (options.memoryBudget != 0) {
+        std::cout << " within a " << (options.memoryBudget >> 20) << " MiB memory budget";
+    }
+    std::cout << std::endl;
+    const auto start = std::chrono::steady_clock::now();
+    size_t peakBytes = 0;
+    const auto results = scanInstances(
+        processes, settings, pool, [&](const InstanceResult &result) { printInstance(result, signatures); }, &peakBytes);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t scanned = static_cast<size_t>(
+        std::count_if(results.begin(), results.end(), [](const InstanceResult &result) { return result.succeeded(); }));
+    std::cout << "Scanned " << scanned << " of " << results.size() << " instance(s) in " << std::fixed << std::setprecision(2)
+              << seconds << std::defaultfloat << " s, holding at most " << ((peakBytes + (1u << 20) - 1) >> 20)
+              << " MiB at once by estimate." << std::endl;
+
+    bool agreed = scanned == results.size();
+    std::vector<OffsetAgreement> offsets;
+    size_t truncated = 0;
+    std::vector<SignatureAgreement> signatureAgreements;
+    if (signatures) {
+        signatureAgreements = agreeingSignatures(results, options.signatures);
+        std::cout << "Agreement across " << scanned << " instance(s):" << std::endl;
+        for (const auto &agreement : signatureAgreements) {
+            const Signature &signature = options.signatures[agreement.signature];
+            std::cout << "  " << signature.name << ": ";
+            if (agreement.agreed) {
+                std::cout << (signature.yieldsAddress() ? "module offset " : "value ") << formatAddress(*agreement.value);
+            } else if (agreement.distinctValues == 0) {
+                std::cout << "unresolved in every instance";
+                agreed = false;
+            } else {
+                std::cout << "differs, " << agreement.distinctValues << " distinct value(s) and " << agreement.unresolved
+                          << " unresolved";
+                agreed = false;
+            }
+            std::cout << std::endl;
+        }
+    } else {
+        offsets = agreeingOffsets(results, settings.maxCandidates);
+        std::cout << offsets.size() << " module offset(s) hold the position in all " << scanned << " instance(s)"
+                  << (offsets.empty() ? "." : ":") << std::endl;
+        for (size_t i = 0; i < offsets.size() && i < options.maxResults; ++i) {
+            std::cout << "  module offset: 0x" << std::hex << offsets[i].moduleOffset << std::dec << std::endl;
+        }
+        truncated = truncatedInstances(results, settings.maxCandidates);
+        if (truncated != 0) {
+            std::cout << truncated << " instance(s) had more than " << settings.maxCandidates
+                      << " candidates; only the first ones were compared." << std::endl;
+        }
+        agreed = agreed && !offsets.empty();
+    }
+
+    if (options.jsonOutput) {
+        JsonWriter json(jsonOut);
+        json.beginObject();
+        json.key("module").value(options.moduleName);
+        json.key("threads").value(threads);
+        json.key("memory_budget").value(options.memoryBudget);
+        json.key("peak_memory_estimate").value(peakBytes);
+        if (!signatures) {
+            json.key("truncated_instances").value(truncated);
+        }
+        json.key("instances").beginArray();
+        for (const auto &result : results) {
+            writeInstanceJson(json, result, options);
+        }
+        json.endArray();
+        json.key("agreement").beginArray();
+        for (const auto &agreement : signatureAgreements) {
+            const Signature &signature = options.signatures[agreement.signature];
+            json.beginObject();
+            json.key("name").value(signature.name);
+            json.key("agreed").value(agreement.agreed);
+            if (agreement.agreed && signature.yieldsAddress()) {
+                writeModuleOffsetJson(json, static_cast<int64_t>(*agreement.value));
+            } else if (agreement.agreed) {
+                json.key("value").value(static_cast<int64_t>(*agreement.value));
+            }
+            json.key("unresolved").value(agreement.unresolved);
+            json.key("distinct_values").value(agreement.distinctValues);
+            json.endObject();
+        }
+        for (const auto &agreement : offsets) {
+            json.beginObject();
+            writeModuleOffsetJson(json, static_cast<int64_t>(agreement.moduleOffset));
+            json.key("truncated_instances").value(agreement.truncatedInstances);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+        jsonOut.flush();
+    }
+    return agreed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int runChainIntersection(const Options &options) {
+    ThreadPool pool(options.threads == 0 ? ThreadPool::defaultThreadCount() : options.threads);
+    std::string moduleName;
+    std::string error;
+    const auto chains = intersectPointerChains(options.intersectPaths, options.pointerSearch, &pool, moduleName, error);
+    if (!chains) {
+        std::cerr << "Error: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << chains->size() << " chains are present in all " << options.intersectPaths.size() << " pointer maps:" << std::endl;
+    for (const auto &chain : *chains) {
+        std::cout << "  " << formatPointerChain(chain, moduleName) << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+int runDaemon(const Options &options) {
+    DaemonSettings settings;
+    settings.tolerance = options.tolerance;
+    settings.maxResults = options.maxResults;
+    settings.threads = options.threads;
+    settings.kernel = options.kernel;
+    settings.valueType = options.valueType;
+    settings.fixedPointScale = options.fixedPointScale;
+    settings.regionFilter = options.regionFilter;
+    settings.watchRate = options.watchOptions.rate;
+    settings.watchStill = options.watchOptions.stillLimit;
+    settings.watchMax = options.watchMax;
+    ScannerDaemon daemon(options.daemonSocket, settings);
+    std::string error;
+    if (!options.processName.empty() &&
+        !daemon.attach(options.processName, options.allRegions ? std::string() : options.moduleName, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+
+    daemonStopRequested.store(false);
+    const auto previousInterrupt = std::signal(SIGINT, requestDaemonStop);
+    const auto previousTerminate = std::signal(SIGTERM, requestDaemonStop);
+    std::cout << "Serving on " << options.daemonSocket << " (Ctrl-C stops)" << std::endl;
+    const bool served = daemon.run(&daemonStopRequested, error);
+    std::signal(SIGINT, previousInterrupt);
+    std::signal(SIGTERM, previousTerminate);
+    if (!served) {
+        std::cerr << "Error: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+void printFreezeTiming(const ProcessInfo &process, const FreezeTiming &timing) {
+    std::cout << std::fixed << std::setprecision(2) << "Froze pid " << process.pid << " (" << freezeMethodName(timing.method)
+              << ", " << timing.threads << " threads) for " << timing.pauseMilliseconds << " ms: stopped in "
+              << timing.stopMilliseconds << " ms, copied " << (timing.bytes >> 20) << " MiB in " << timing.copyMilliseconds
+              << " ms (buffers prepared in " << timing.prepareMilliseconds << " ms)" << std::defaultfloat;
+    if (timing.zeroBytes != 0) {
+        std::cout << ", " << (timing.zeroBytes >> 20) << " MiB untouched";
+    }
+    if (timing.unreadableBytes != 0) {
+        std::cout << ", " << (timing.unreadableBytes >> 10) << " KiB unreadable";
+    }
+    std::cout << std::endl;
+}
 
-    std::cout << "Use the module offset to access the position vector relative to the module base." << std::endl;
+// Saves the scope so later runs can scan it with --from and get identical input.
+int runCapture(const Options &options, const OffsetScanner &scanner, const ProcessInfo &process) {
+    std::string error;
+    const auto start = std::chrono::steady_clock::now();
+    auto writer = MemorySnapshot::Writer::create(options.capturePath, scanner.snapshotRegions(), options.pageStorage, error);
+    if (!writer) {
+        std::cerr << "Error: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    scanner.captureSnapshot(*writer);
+    if (!writer->finish(error)) {
+        std::cerr << "Error: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    writer.reset();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto snapshot = MemorySnapshot::open(options.capturePath, error);
+    if (!snapshot) {
+        std::cerr << "Error: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Captured " << (snapshot->capturedBytes() >> 20) << " MiB of " << snapshot->regions().size() << " mappings of '"
+              << process.name << "' (pid " << process.pid << ") to " << options.capturePath << " ("
+              << (snapshot->fileBytes() >> 20) << " MiB on disk) in " << std::fixed << std::setprecision(2) << seconds
+              << std::defaultfloat << " s" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int runKernelBenchmarks() {
+    constexpr size_t bufferBytes = 64 * 1024 * 1024;
+    constexpr size_t iterations = 8;
+    std::cout << "Benchmarking compare kernels over " << (bufferBytes >> 20) << " MiB x " << iterations << std::endl;
+    for (const auto type : VectorKernels::allValueTypes()) {
+        for (const auto kind : VectorKernels::supportedKernels()) {
+            const auto result = VectorKernels::benchmarkKernel(kind, bufferBytes, iterations, type);
+            std::cout << "  " << std::left << std::setw(6) << VectorKernels::valueTypeName(type) << std::setw(8)
+                      << VectorKernels::kernelName(kind) << std::right << std::fixed << std::setprecision(2)
+                      << result.gigabytesPerSecond << " GB/s" << std::defaultfloat << " (" << result.matches
+                      << " matches)" << std::endl;
+        }
+    }
+    std::cout << "Multi-target vec3f compares:" << std::endl;
+    for (const size_t targetCount : {1, 4, 16, 256, 4096}) {
+        for (const auto kind : VectorKernels::supportedKernels()) {
+            const auto result =
+                VectorKernels::benchmarkMultiMatcher(kind, bufferBytes, iterations, VectorKernels::ValueType::Vec3f, targetCount);
+            std::cout << "  " << std::left << std::setw(6) << targetCount << std::setw(8) << VectorKernels::kernelName(kind)
+                      << std::right << std::fixed << std::setprecision(2) << result.gigabytesPerSecond << " GB/s"
+                      << std::defaultfloat << " (" << result.matches << " matches)" << std::endl;
+        }
+    }
     return EXIT_SUCCESS;
 }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    std::string error;
+    if (!parseOptions(argc, argv, options, error)) {
+        if (!error.empty()) {
+            std::cerr << "Error: " << error << "\n";
+        }
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (options.benchKernels) {
+        return runKernelBenchmarks();
+    }
+    if (!options.connectSocket.empty()) {
+        if (!runDaemonClient(options.connectSocket, options.connectCommands, error)) {
+            if (!error.empty()) {
+                std::cerr << "Error: " << error << "\n";
+            }
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    if (!options.daemonSocket.empty()) {
+        return runDaemon(options);
+    }
+    // With --output json stdout carries only the JSON document; everything else
+    // printed along the way goes to stderr.
+    std::ostream jsonOut(std::cout.rdbuf());
+    if (options.jsonOutput) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    if (!options.intersectPaths.empty()) {
+        return runChainIntersection(options);
+    }
+    if (options.allInstances || !options.pids.empty()) {
+        return runInstanceScan(options, jsonOut);
+    }
+
+    // Offline captures stand in for the process; their pid is 0.
+    ProcessInfo processInfo;
+    std::shared_ptr<const MemorySource> source;
+    std::shared_ptr<const ProcessMemoryReader> liveReader;
+    if (!options.sourcePath.empty()) {
+        source = openMemoryCapture(options.sourcePath, error);
+        if (!source) {
+            std::cerr << "Error: " << error << "\n";
+            return EXIT_FAILURE;
+        }
+        processInfo.name = options.sourcePath;
+    } else {
+        auto found = ProcessUtils::findProcessByName(options.processName);
+        if (!found) {
+            std::cerr << "Process '" << options.processName << "' not found.\n";
+            return EXIT_FAILURE;
+        }
+        processInfo = *found;
+        auto reader = std::make_shared<ProcessMemoryReader>(processInfo.pid);
+        if (!reader->isValid()) {
+            std::cerr << "Failed to open target process memory. Root privileges may be required.\n";
+            return EXIT_FAILURE;
+        }
+        liveReader = reader;
+        source = std::move(reader);
+    }
+
+    std::vector<MemoryRegion> moduleRegions;
+    std::vector<MemoryRegion> moduleMappings;
+    if (options.allRegions) {
+        moduleRegions = ProcessUtils::filterRegions(ProcessUtils::listMemoryRegions(*source), options.regionFilter);
+        if (moduleRegions.empty()) {
+            std::cerr << "No mappings in the " << (processInfo.pid != 0 ? "process" : "capture") << " match the region filters.\n";
+            return EXIT_FAILURE;
+        }
+    } else {
+        moduleMappings = ProcessUtils::findModuleRegions(*source, options.moduleName);
+        moduleRegions = ProcessUtils::filterRegions(moduleMappings, options.regionFilter);
+        if (moduleRegions.empty()) {
+            std::cerr << "Module '" << options.moduleName << "' not found in " << (processInfo.pid != 0 ? "process" : "capture")
+                      << ".\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Module scans report section offsets whenever the headers can be read;
+    // --data-segments needs them to pick the scope.
+    std::optional<ElfModule> elf;
+    if (!options.allRegions) {
+        elf = ElfModule::forModule(processInfo.pid, moduleMappings, *source, error);
+        if (!elf && options.dataSegments) {
+            std::cerr << "Cannot read the ELF headers of '" << options.moduleName << "': " << error << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    const ElfModule *elfPointer = elf ? &*elf : nullptr;
+    const uintptr_t moduleBase = moduleMappings.empty() ? 0 : moduleMappings.front().start;
+    if (options.dataSegments) {
+        moduleRegions = ProcessUtils::filterRegions(elf->dataRegions(ProcessUtils::listMemoryRegions(*source)),
+                                                    options.regionFilter);
+        if (moduleRegions.empty()) {
+            std::cerr << "Module '" << options.moduleName << "' has no writable data mappings.\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    OffsetScanner scanner(source, moduleRegions);
+    // Module offsets count from the module's first mapping even when the region
+    // filters or --data-segments leave it out of the scope.
+    if (!moduleMappings.empty()) {
+        scanner.setModuleBase(moduleBase);
+    }
+    scanner.setThreadCount(options.threads);
+    if (options.kernel) {
+        if (!VectorKernels::isSupported(*options.kernel)) {
+            std::cerr << "Kernel '" << VectorKernels::kernelName(*options.kernel)
+                      << "' is not supported by this CPU, using scalar.\n";
+        }
+        scanner.setKernel(*options.kernel);
+    }
+    scanner.setValueType(options.valueType, options.fixedPointScale);
+
+    ScanReport report;
+    if (options.freeze) {
+        auto frozen = FrozenCopy::capture(*liveReader, scanner.snapshotRegions(), *options.freeze, scanner.threadPool(), error);
+        if (!frozen) {
+            std::cerr << "Error: " << error << "\n";
+            return EXIT_FAILURE;
+        }
+        report.freeze = frozen->timing();
+        printFreezeTiming(processInfo, *report.freeze);
+        scanner.setSource(std::move(frozen));
+    }
+    if (!options.capturePath.empty()) {
+        return runCapture(options, scanner, processInfo);
+    }
+    if (processInfo.pid != 0) {
+        std::cout << "Scanning process '" << processInfo.name << "' (pid " << processInfo.pid << ")\n";
+    } else {
+        std::cout << "Scanning " << source->describe() << "\n";
+    }
+    if (options.allRegions) {
+        size_t totalBytes = 0;
+        for (const auto &region : moduleRegions) {
+            totalBytes += region.size();
+        }
+        std::cout << "Scanning " << moduleRegions.size() << " mappings, " << (totalBytes >> 20) << " MiB in total" << std::endl;
+    } else {
+        std::cout << (options.dataSegments ? "Module data segments:" : "Module regions:") << std::endl;
+        for (const auto &region : moduleRegions) {
+            std::cout << "  " << ProcessUtils::describeMemoryRegion(region);
+            printSectionOffset(region.start, elfPointer);
+            std::cout << std::endl;
+        }
+    }
+
+    ScanStats stats(!options.tracePath.empty());
+    if (options.jsonOutput || !options.statsPath.empty() || !options.tracePath.empty()) {
+        scanner.setStats(&stats);
+    }
+    const int status = options.startSnapshot || options.compareChange
+                           ? runUnknownValueStep(options, scanner, elfPointer, report)
+                           : runPositionScan(options, scanner, moduleRegions, elfPointer, report);
+    if (!writeReports(options, processInfo, scanner, elfPointer, stats, report, jsonOut)) {
+        return EXIT_FAILURE;
+    }
+    return status;
+}